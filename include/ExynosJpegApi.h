@@ -18,6 +18,8 @@
 #ifndef __EXYNOS_JPEG_BASE_H__
 #define __EXYNOS_JPEG_BASE_H__
 
+#include <stddef.h>
+#include <sys/types.h>
 #include <linux/videodev2.h>
 #include <linux/videodev2_exynos_media.h>
 
@@ -27,6 +29,15 @@
 #define JPEG_BUF_TYPE_USER_PTR (1)
 #define JPEG_BUF_TYPE_DMA_BUF (2)
 
+/* hardware encodes tried by ExynosJpegEncoder::encodeToSize() */
+#define JPEG_RC_MAX_ENCODE (3)
+
+/* largest ExynosJpegDecoder::setScaleDown(), 1/8 of the image */
+#define JPEG_MAX_SCALE_DOWN_SHIFT (3)
+
+/* jobs queued at once by ExynosJpegDecoder::decodeBatch() */
+#define JPEG_BATCH_DEPTH (2)
+
 class ExynosJpegBase {
 public:
     #define JPEG_MAX_PLANE_CNT          (3)
@@ -56,6 +67,7 @@ public:
         ERROR_GET_SIZE_FAIL,
         ERROR_BUF_NOT_SET_YET,
         ERROR_REQBUF_FAIL,
+        ERROR_EXCUTE_TIMEOUT,
         ERROR_INVALID_V4l2_BUF_TYPE = -0x80,
         ERROR_INVALID_SELECT,
         ERROR_MMAP_FAILED,
@@ -104,35 +116,127 @@ public:
         int              reserved[8];
     };
 
+    /*
+     * Device layer under the V4L2 wrappers. The default is the real node, a
+     * replacement (such as the fake M2M device) routes every open, ioctl and
+     * mmap of the library to itself. Members follow the libc calls.
+     */
+    struct DEVICE_OPS{
+        const char *name;
+        int     (*open)(const char *pcPath, int iFlags);
+        int     (*close)(int iFd);
+        int     (*ioctl)(int iFd, unsigned long ulReq, void *pArg);
+        void    *(*mmap)(void *pAddr, size_t iLen, int iProt, int iFlags, int iFd, off_t iOff);
+        int     (*munmap)(void *pAddr, size_t iLen);
+    };
+
+    struct DEVICE_STAT{
+        unsigned int        numOfOpen;
+        unsigned int        numOfIoctl;
+        unsigned int        numOfSetFmt;
+        unsigned int        numOfReqbufs;
+        unsigned int        numOfQbuf;
+        unsigned int        numOfDqbuf;
+        unsigned int        numOfStreamOn;
+        unsigned int        numOfStreamOff;
+        unsigned long long  bytesMapped;
+    };
+
+    /* process wide, set before any instance is created. NULL restores the real node */
+    static void setDeviceOps(const struct DEVICE_OPS *pstOps);
+    static const struct DEVICE_OPS *getDeviceOps(void);
+    static void getDeviceStat(struct DEVICE_STAT *pstStat);
+    static void clearDeviceStat(void);
+
     int setSize(int iW, int iH);
     int setCache(int iValue);
     void *getJpegConfig(void);
     int selectJpegHW(int iSel);
     int ckeckJpegSelct(enum MODE eMode);
 
+    /*
+     * Non-blocking execute. After encodeSubmit()/decodeSubmit(), getPollFd()
+     * turns POLLIN when the job is done, then encodeReap()/decodeReap()
+     * collects it without blocking. waitDone() polls with a timeout
+     * (msec, -1 waits forever) and cancel() drops a submitted job.
+     * getPollFd() returns -1 when no job is on the node.
+     */
+    int getPollFd(void);
+    int waitDone(int iTimeoutMs);
+    int cancel(void);
+    bool isSubmitted(void);
+
+    /*
+     * Arbitration of the JPEG block between processes, see
+     * ExynosJpegArbiter.cpp. A job takes the block before it is queued and
+     * gives it back when it is reaped. Waiting jobs are served by priority,
+     * then by the share of block time each process has used. The queue is
+     * kept by the arbiter, which a trusted process (the camera HAL in the
+     * media server) runs with startArbiter().
+     */
+    enum PRIORITY {
+        PRIORITY_BACKGROUND = 0,    /* gallery, thumbnails, batch decode */
+        PRIORITY_NORMAL,
+        PRIORITY_CAMERA,            /* capture */
+        PRIORITY_MAX
+    };
+
+    struct ARBITER_STAT{
+        int                 numOfClients;       /* processes using the block */
+        int                 numOfWaiting;       /* jobs waiting, all processes */
+        long long           estimatedWaitUs;    /* for a job of this instance submitted now */
+        unsigned int        numOfJobs;          /* this process */
+        long long           busyUs;
+        long long           waitUs;
+        long long           maxWaitUs;
+        int                 sharePermille;      /* of the block time of all clients */
+    };
+
+    /* process wide, set before the first job. NULL turns the arbitration off */
+    static void setArbiterName(const char *pcName);
+    static int startArbiter(void);
+    int setPriority(int iPriority);
+    int getArbiterStat(struct ARBITER_STAT *pstStat);
+
 protected:
     bool t_bFlagCreate;
     bool t_bFlagCreateInBuf;
     bool t_bFlagCreateOutBuf;
     bool t_bFlagExcute;
     bool t_bFlagSelect;
+    bool t_bFlagSubmit;
     int t_iCacheValue;
     int t_iSelectNode;
     int t_iPlaneNum;
     int t_iJpegFd;
+    int t_iPriority;
+    int t_iArbiterFd;
+    bool t_bFlagArbiter;
 
     struct CONFIG t_stJpegConfig;
     struct BUFFER t_stJpegInbuf;
     struct BUFFER t_stJpegOutbuf;
 
+    static int t_devOpen(const char *pcPath, int iFlags);
+    static int t_devClose(int iFd);
+    static int t_devIoctl(int iFd, unsigned long ulReq, void *pArg);
+    static void *t_devMmap(void *pAddr, size_t iLen, int iProt, int iFlags, int iFd, off_t iOff);
+    static int t_devMunmap(void *pAddr, size_t iLen);
+
+    int t_arbiterAcquire(void);
+    void t_arbiterRelease(void);
+    bool t_arbiterYield(void);
+    void t_arbiterClose(void);
+
     int t_v4l2Querycap(int iFd);
     int t_v4l2SetJpegcomp(int iFd, int iQuality);
     int t_v4l2SetFmt(int iFd, enum v4l2_buf_type eType, struct CONFIG *pstConfig);
     int t_v4l2GetFmt(int iFd, enum v4l2_buf_type eType, struct CONFIG *pstConfig);
     int t_v4l2Reqbufs(int iFd, int iBufCount, struct BUF_INFO *pstBufInfo);
     int t_v4l2Querybuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFFER *pstBuf);
-    int t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFFER *pstBuf);
-    int t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_memory eMemory, int iNumPlanes);
+    int t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFFER *pstBuf, int iIndex = 0);
+    int t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_memory eMemory, int iNumPlanes,
+                    int *piIndex = NULL, bool *pbError = NULL);
     int t_v4l2StreamOn(int iFd, enum v4l2_buf_type eType);
     int t_v4l2StreamOff(int iFd, enum v4l2_buf_type eType);
     int t_v4l2SetCtrl(int iFd, int iCid, int iValue);
@@ -158,6 +262,8 @@ protected:
     int setBuf(struct BUFFER *pstBuf, char **pcBuf, int *iSize, int iPlaneNum);
     int updateConfig(enum MODE eMode, int iInBufs, int iOutBufs, int iInBufPlanes, int iOutBufPlanes);
     int execute(int iInBufPlanes, int iOutBufPlanes);
+    int submit(int iInBufPlanes, int iOutBufPlanes);
+    int reap(int iInBufPlanes, int iOutBufPlanes);
 };
 
 /*
@@ -208,6 +314,33 @@ public:
     int getJpegSize(void);
 
     int encode(void);
+    int encodeSubmit(void);
+    int encodeReap(void);
+
+    /*
+     * rate controlled encode, see ExynosJpegEncoderRateControl.cpp
+     * Called instead of encode() after updateConfig(). Picks the highest
+     * QUALITY_LEVEL_* whose JPEG fits in iMaxSize bytes and leaves that JPEG
+     * in the output buffer. ERROR_BUFFER_TOO_SMALL when QUALITY_LEVEL_6 does
+     * not fit either. At most JPEG_RC_MAX_ENCODE hardware encodes are run.
+     */
+    int encodeToSize(int iMaxSize, int *piQualityLevel);
+
+    /*
+     * software encode, see ExynosJpegEncoderSw.cpp
+     * For pictures the JPEG block can not take, such as panoramas. Restart
+     * interval stripes are encoded on iNumOfThreads threads, 0 means one per
+     * online core. The node is not opened while it is set.
+     */
+    int setSwEncode(int iNumOfThreads);
+    int clearSwEncode(void);
+
+private:
+    bool t_bFlagSwEncode;
+    int t_iSwThreads;
+    int t_iSwResult;
+
+    int encodeSw(void);
 };
 
 /*
@@ -246,7 +379,54 @@ public:
     int setScaledSize(int iW, int iH);
     int setJpegSize(int iJpegSize);
 
+    /* region-of-interest decode, see ExynosJpegDecoderRegion.cpp */
+    int setScaleDown(int iShift);
+    int setRegion(int iX, int iY, int iW, int iH);
+    int clearRegion(void);
+    int getRegionOutSize(int *piW, int *piH);
+
     int decode(void);
+    int decodeSubmit(void);
+    int decodeReap(void);
+
+    /* batch decode, see ExynosJpegDecoderBatch.cpp */
+    struct BATCH_JOB {
+        char    *pcJpeg;        /* user pointer, or */
+        int     iJpegFd;        /* dma-buf fd, used when >= 0, -1 for a user pointer */
+        int     iJpegSize;
+        char    *pcOut;
+        int     iOutFd;         /* as iJpegFd */
+        int     iOutSize;
+        int     iScaledW;
+        int     iScaledH;
+        int     iResult;        /* ERROR_NONE or the failure of this job */
+    };
+
+    struct BATCH_STAT {
+        int         numOfJobs;
+        int         numOfGroups;
+        int         numOfFail;
+        long long   durationUs;
+        int         imagesPerSec;
+    };
+
+    int decodeBatch(struct BATCH_JOB *pstJobs, int iNumOfJobs, struct BATCH_STAT *pstStat);
+
+private:
+    bool t_bFlagRegion;
+    int t_iRegionX;
+    int t_iRegionY;
+    int t_iRegionW;
+    int t_iRegionH;
+    int t_iScaleShift;
+    int t_iRegionResult;
+
+    int decodeRegion(void);
+
+    int startBatchGroup(struct BATCH_JOB *pstJobs, int *piOrder, int iNum,
+                        enum v4l2_memory eInMemory, enum v4l2_memory eOutMemory);
+    void stopBatchGroup(enum v4l2_memory eInMemory, enum v4l2_memory eOutMemory);
+    int runBatchGroup(struct BATCH_JOB *pstJobs, int *piOrder, int iNum, bool *pbHeld);
 };
 
 #endif /* __EXYNOS_JPEG_BASE_H__ */
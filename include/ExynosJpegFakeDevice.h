@@ -0,0 +1,38 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_JPEG_FAKE_DEVICE_H__
+#define __EXYNOS_JPEG_FAKE_DEVICE_H__
+
+#include "ExynosJpegApi.h"
+
+/*
+ * Fake V4L2 M2M JPEG node.
+ *
+ * Implements the subset of the V4L2 interface libhwjpeg uses (S_FMT, G_FMT,
+ * REQBUFS, QBUF, DQBUF, STREAMON/OFF, S_JPEGCOMP) and runs each job with the
+ * libjpeg software codec, so encode and decode work without the JPEG block.
+ * USERPTR and DMABUF memory are supported, MMAP memory is not.
+ *
+ * ExynosJpegBase::setDeviceOps(getJpegFakeDeviceOps());
+ */
+const struct ExynosJpegBase::DEVICE_OPS *getJpegFakeDeviceOps(void);
+
+/* extra time spent per job, to model the hardware latency (usec) */
+void setJpegFakeDeviceLatency(int iLatencyUs);
+
+#endif /* __EXYNOS_JPEG_FAKE_DEVICE_H__ */
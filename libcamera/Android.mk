@@ -49,6 +49,7 @@ LOCAL_SRC_FILES:= \
 	ExynosCameraVDis.cpp \
 	ExynosCamera.cpp \
 	ExynosJpegEncoderForCamera.cpp \
+	ExynosExifReader.cpp \
 	ExynosCameraHWImpl.cpp
 
 LOCAL_MODULE_TAGS := optional
@@ -3115,6 +3115,26 @@ bool ExynosCamera::putPreviewBuf(ExynosBuffer *buf)
     return true;
 }
 
+bool ExynosCamera::flagPreviewBufReady(void)
+{
+    struct pollfd events;
+
+    if (m_flagCreate == false
+        || m_camera_info[m_cameraMode].preview.flagStart == false
+        || m_camera_info[m_cameraMode].preview.fd < 0)
+        return false;
+
+    events.fd = m_camera_info[m_cameraMode].preview.fd;
+    events.events = POLLIN | POLLRDNORM;
+    events.revents = 0;
+
+    /* zero timeout : only peek, never wait for the next frame */
+    if (poll(&events, 1, 0) <= 0)
+        return false;
+
+    return (events.revents & POLLIN) ? true : false;
+}
+
 bool ExynosCamera::getIs3a0Buf(enum CAMERA_MODE cameraMode, ExynosBuffer *inBuf, ExynosBuffer *outBuf)
 {
     int srcIndex = 0;
@@ -5795,6 +5815,10 @@ bool ExynosCamera::stopPicture(void)
 
     if (m_camera_info[m_cameraMode].picture.flagStart == true) {
 
+        /* no encode may use the thumbnail buffers while they are freed */
+        yuv2JpegCancel();
+        m_jpegEnc.flushJpegMemoryCache();
+
         if (m_stopPicture() == false) {
             CLOGE("ERR(%s):m_stopPicture() fail", __func__);
             ret = false;
@@ -5899,13 +5923,26 @@ bool ExynosCamera::yuv2Jpeg(ExynosBuffer *yuvBuf,
                             ExynosBuffer *jpegBuf,
                             ExynosRect *rect)
 {
-    CLOGD("DEBUG(%s):in", __func__);
+    if (yuv2JpegSubmit(yuvBuf, jpegBuf, rect) == false)
+        return false;
+
+    return yuv2JpegReap(jpegBuf, -1);
+}
 
-    unsigned char *addr;
+bool ExynosCamera::yuv2JpegSubmit(ExynosBuffer *yuvBuf,
+                                  ExynosBuffer *jpegBuf,
+                                  ExynosRect *rect)
+{
+    CLOGD("DEBUG(%s):in", __func__);
 
-    ExynosJpegEncoderForCamera jpegEnc;
+    ExynosJpegEncoderForCamera &jpegEnc = m_jpegEnc;
     bool ret = false;
 
+    if (jpegEnc.flagCreate() == true) {
+        CLOGW("WARN(%s):previous jpeg is not reaped, cancel it", __func__);
+        yuv2JpegCancel();
+    }
+
     unsigned int *yuvSize = yuvBuf->size.extS;
 
     if (jpegEnc.create()) {
@@ -5975,8 +6012,8 @@ bool ExynosCamera::yuv2Jpeg(ExynosBuffer *yuvBuf,
         goto jpeg_encode_done;
     }
 
-    if (jpegEnc.encode((int *)&jpegBuf->size.s, &mExifInfo)) {
-        CLOGE("ERR(%s):jpegEnc.encode() fail", __func__);
+    if (jpegEnc.encodeSubmit()) {
+        CLOGE("ERR(%s):jpegEnc.encodeSubmit() fail", __func__);
         goto jpeg_encode_done;
     }
 
@@ -5993,12 +6030,45 @@ jpeg_encode_done:
             rect->w, rect->h, rect->colorFormat);
     }
 
-    if (jpegEnc.flagCreate() == true)
+    if (ret == false && jpegEnc.flagCreate() == true)
         jpegEnc.destroy();
 
     return ret;
 }
 
+int ExynosCamera::getJpegPollFd(void)
+{
+    return m_jpegEnc.getPollFd();
+}
+
+bool ExynosCamera::yuv2JpegReap(ExynosBuffer *jpegBuf, int timeoutMs)
+{
+    bool ret = true;
+
+    if (m_jpegEnc.flagCreate() == false) {
+        CLOGE("ERR(%s):no jpeg submitted", __func__);
+        return false;
+    }
+
+    if (m_jpegEnc.encodeReap((int *)&jpegBuf->size.s, &mExifInfo, timeoutMs)) {
+        CLOGE("ERR(%s):jpegEnc.encodeReap(%d msec) fail", __func__, timeoutMs);
+        ret = false;
+    }
+
+    m_jpegEnc.destroy();
+
+    return ret;
+}
+
+void ExynosCamera::yuv2JpegCancel(void)
+{
+    if (m_jpegEnc.flagCreate() == false)
+        return;
+
+    m_jpegEnc.encodeCancel();
+    m_jpegEnc.destroy();
+}
+
 bool ExynosCamera::autoFocus(void)
 {
     CLOGD("DEBUG(%s):(%d) focusMode : %d", __func__, __LINE__, m_curCameraInfo[m_cameraMode]->focusMode);
@@ -11239,6 +11309,10 @@ bool ExynosCamera::stopPictureReprocessing(void)
     }
 
     if (m_camera_info[CAMERA_MODE_REPROCESSING].picture.flagStart == true) {
+        /* no encode may use the thumbnail buffers while they are freed */
+        yuv2JpegCancel();
+        m_jpegEnc.flushJpegMemoryCache();
+
         if (m_stopPictureReprocessing() == false) {
             CLOGE("ERR(%s):m_stopPictureReprocessing() fail", __func__);
             ret = false;
@@ -691,6 +691,8 @@ public:
     bool            getPreviewBuf(ExynosBuffer *buf, bool *isValid, nsecs_t *timestamp);
     //! Put(dq) preview's buffer
     bool            putPreviewBuf(ExynosBuffer *buf);
+    //! Check whether a preview buffer is ready to dq, without blocking
+    bool            flagPreviewBufReady(void);
     //! Cancel preview's buffer
     bool            cancelPreviewBuf(int index);
     //! Deinitialize preview's buffer
@@ -857,6 +859,14 @@ public:
 
     //! Encode JPEG from YUV
     bool            yuv2Jpeg(ExynosBuffer *yuvBuf, ExynosBuffer *jpegBuf, ExynosRect *rect);
+    //! Starts JPEG encoding from YUV, without waiting for it
+    bool            yuv2JpegSubmit(ExynosBuffer *yuvBuf, ExynosBuffer *jpegBuf, ExynosRect *rect);
+    //! Gets the fd that turns POLLIN when the submitted JPEG is done (-1 : none)
+    int             getJpegPollFd(void);
+    //! Finishes the submitted JPEG (thumbnail, EXIF) and sets jpegBuf size
+    bool            yuv2JpegReap(ExynosBuffer *jpegBuf, int timeoutMs);
+    //! Drops the submitted JPEG
+    void            yuv2JpegCancel(void);
 
     //! Starts camera auto-focus and registers a callback function to run when the camera is focused.
     bool            autoFocus(void);
@@ -1316,6 +1326,7 @@ private:
     int              m_is3a1FrameCount;
 
     exif_attribute_t mExifInfo;
+    ExynosJpegEncoderForCamera m_jpegEnc;
     char             m_imageUniqueIdBuf[UNIQUE_ID_BUF_SIZE];
 
     ion_client       m_ionCameraClient;
@@ -0,0 +1,288 @@
+/*
+**
+** Copyright 2013, Samsung Electronics Co. LTD
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+/*!
+ * \file      ExynosCameraBufferTracker.h
+ * \brief     hearder file for ExynosCameraBufferTracker
+ *
+ * Records who owns each buffer of a pool (driver, HAL, display, client),
+ * how long it stays with each owner and the transitions that should never
+ * happen. The result is printed by dump(), so stuck or leaked buffers can
+ * be told apart from slow ones in a field log.
+ *
+ */
+
+#ifndef EXYNOS_CAMERA_BUFFER_TRACKER_H
+#define EXYNOS_CAMERA_BUFFER_TRACKER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <utils/threads.h>
+#include <utils/Timers.h>
+#include <utils/String8.h>
+
+#define BUFFER_TRACKER_MAX_BUF      (32)
+#define BUFFER_TRACKER_STUCK_TIME   (1000) /* msec */
+
+namespace android {
+
+class ExynosCameraBufferTracker {
+public:
+    enum OWNER {
+        OWNER_NONE = 0,
+        OWNER_DRIVER,
+        OWNER_HAL,
+        OWNER_DISPLAY,
+        OWNER_CLIENT,
+        OWNER_MAX,
+    };
+
+private:
+    ExynosCameraBufferTracker(void)
+    {}
+
+public:
+    inline ExynosCameraBufferTracker(const char *name)
+    {
+        m_name = name;
+        m_numOfBuf = 0;
+
+        for (int i = 0; i < OWNER_MAX; i++)
+            m_legalMask[i] = 0;
+
+        reset(0, OWNER_NONE);
+    }
+
+    inline virtual ~ExynosCameraBufferTracker()
+    {}
+
+    //! Allows the transition from -> to, anything else is counted as illegal
+    void allow(int from, int to)
+    {
+        Mutex::Autolock lock(m_lock);
+
+        if (m_checkOwner(from) == false || m_checkOwner(to) == false)
+            return;
+
+        m_legalMask[from] |= (1 << to);
+    }
+
+    //! Puts all buffers on owner and clears the statistics
+    void reset(int numOfBuf, int owner)
+    {
+        Mutex::Autolock lock(m_lock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        if (numOfBuf < 0 || BUFFER_TRACKER_MAX_BUF < numOfBuf)
+            numOfBuf = BUFFER_TRACKER_MAX_BUF;
+        if (m_checkOwner(owner) == false)
+            owner = OWNER_NONE;
+
+        m_numOfBuf = numOfBuf;
+
+        for (int i = 0; i < BUFFER_TRACKER_MAX_BUF; i++) {
+            m_owner[i] = owner;
+            m_since[i] = now;
+        }
+
+        for (int i = 0; i < OWNER_MAX; i++) {
+            m_enterCount[i] = 0;
+            m_dwellSum[i] = 0;
+            m_dwellMax[i] = 0;
+        }
+
+        m_reclaimCount = 0;
+        m_illegalCount = 0;
+        m_lastIllegalIndex = -1;
+        m_lastIllegalFrom = OWNER_NONE;
+        m_lastIllegalTo = OWNER_NONE;
+    }
+
+    //! Moves buffer index to owner. Returns false on an illegal transition (still recorded).
+    bool setOwner(int index, int owner)
+    {
+        Mutex::Autolock lock(m_lock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        nsecs_t dwell = 0;
+        int from = OWNER_NONE;
+        bool legal = true;
+
+        if (index < 0 || m_numOfBuf <= index || m_checkOwner(owner) == false) {
+            ALOGE("ERR(%s):%s invalid index(%d) owner(%d)", __func__, m_name, index, owner);
+            return false;
+        }
+
+        from = m_owner[index];
+        dwell = now - m_since[index];
+
+        if ((m_legalMask[from] & (1 << owner)) == 0) {
+            legal = false;
+
+            m_illegalCount++;
+            m_lastIllegalIndex = index;
+            m_lastIllegalFrom = from;
+            m_lastIllegalTo = owner;
+
+            ALOGW("WARN(%s):%s buf(%d) illegal transition %s -> %s",
+                __func__, m_name, index, m_ownerName(from), m_ownerName(owner));
+        }
+
+        m_dwellSum[from] += dwell;
+        if (m_dwellMax[from] < dwell)
+            m_dwellMax[from] = dwell;
+
+        m_enterCount[owner]++;
+        m_owner[index] = owner;
+        m_since[index] = now;
+
+        return legal;
+    }
+
+    //! Forces every buffer back to owner (stop path), counts the ones that never came back
+    void reclaimAll(int owner)
+    {
+        Mutex::Autolock lock(m_lock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+        if (m_checkOwner(owner) == false)
+            return;
+
+        for (int i = 0; i < m_numOfBuf; i++) {
+            if (m_owner[i] == owner)
+                continue;
+
+            m_reclaimCount++;
+
+            m_dwellSum[m_owner[i]] += now - m_since[i];
+            if (m_dwellMax[m_owner[i]] < now - m_since[i])
+                m_dwellMax[m_owner[i]] = now - m_since[i];
+
+            m_owner[i] = owner;
+            m_since[i] = now;
+        }
+    }
+
+    int getOwner(int index) const
+    {
+        Mutex::Autolock lock(m_lock);
+
+        if (index < 0 || m_numOfBuf <= index)
+            return OWNER_NONE;
+
+        return m_owner[index];
+    }
+
+    void dump(String8 *result) const
+    {
+        Mutex::Autolock lock(m_lock);
+        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        char buffer[128];
+        int held[OWNER_MAX];
+
+        for (int i = 0; i < OWNER_MAX; i++)
+            held[i] = 0;
+
+        snprintf(buffer, sizeof(buffer), " %s buffers(%d):", m_name, m_numOfBuf);
+        result->append(buffer);
+
+        for (int i = 0; i < m_numOfBuf; i++) {
+            int age = (int)ns2ms(now - m_since[i]);
+
+            held[m_owner[i]]++;
+
+            /* '!' : held by the same owner for too long, likely stuck */
+            snprintf(buffer, sizeof(buffer), " [%d]%s(%d)%s",
+                i, m_ownerName(m_owner[i]), age,
+                (BUFFER_TRACKER_STUCK_TIME < age) ? "!" : "");
+            result->append(buffer);
+        }
+        result->append("\n");
+
+        for (int i = 0; i < OWNER_MAX; i++) {
+            if (m_enterCount[i] == 0 && held[i] == 0)
+                continue;
+
+            snprintf(buffer, sizeof(buffer),
+                "  %-8s held(%d) enter(%d) dwell(msec) avg(%d) max(%d)\n",
+                m_ownerName(i), held[i], m_enterCount[i],
+                (m_enterCount[i] == 0) ? 0 : (int)ns2ms(m_dwellSum[i] / m_enterCount[i]),
+                (int)ns2ms(m_dwellMax[i]));
+            result->append(buffer);
+        }
+
+        if (0 < m_reclaimCount) {
+            snprintf(buffer, sizeof(buffer), "  reclaimed on stop(%d)\n", m_reclaimCount);
+            result->append(buffer);
+        }
+
+        if (0 < m_illegalCount) {
+            snprintf(buffer, sizeof(buffer), "  illegal transition(%d), last buf(%d) %s -> %s\n",
+                m_illegalCount, m_lastIllegalIndex,
+                m_ownerName(m_lastIllegalFrom), m_ownerName(m_lastIllegalTo));
+            result->append(buffer);
+        }
+    }
+
+private:
+    static bool m_checkOwner(int owner)
+    {
+        return (OWNER_NONE <= owner && owner < OWNER_MAX);
+    }
+
+    static const char *m_ownerName(int owner)
+    {
+        switch (owner) {
+        case OWNER_NONE:
+            return "free";
+        case OWNER_DRIVER:
+            return "driver";
+        case OWNER_HAL:
+            return "hal";
+        case OWNER_DISPLAY:
+            return "display";
+        case OWNER_CLIENT:
+            return "client";
+        default:
+            return "unknown";
+        }
+    }
+
+private:
+    mutable Mutex   m_lock;
+    const char     *m_name;
+    int             m_numOfBuf;
+    unsigned int    m_legalMask[OWNER_MAX];
+
+    int             m_owner[BUFFER_TRACKER_MAX_BUF];
+    nsecs_t         m_since[BUFFER_TRACKER_MAX_BUF];
+
+    unsigned int    m_enterCount[OWNER_MAX];
+    nsecs_t         m_dwellSum[OWNER_MAX];
+    nsecs_t         m_dwellMax[OWNER_MAX];
+
+    unsigned int    m_reclaimCount;
+    unsigned int    m_illegalCount;
+    int             m_lastIllegalIndex;
+    int             m_lastIllegalFrom;
+    int             m_lastIllegalTo;
+};
+
+}; // namespace android
+
+#endif // EXYNOS_CAMERA_BUFFER_TRACKER_H
@@ -86,11 +86,14 @@ ExynosCameraHWImpl::ExynosCameraHWImpl(int cameraId, camera_device_t *dev)
           m_captureInProgress(false),
           m_captureMode(false),
           m_waitForCapture(false),
+          m_lastShotFcount(0),
           m_flip_horizontal(0),
           m_faceDetected(false),
           m_fdThreshold(0),
           m_sensorErrCnt(0),
           m_skipFrame(0),
+          m_previewBufTracker("preview"),
+          m_recordingBufTracker("recording"),
           m_notifyCb(0),
           m_dataCb(0),
           m_dataCbTimestamp(0),
@@ -176,11 +179,16 @@ ExynosCameraHWImpl::ExynosCameraHWImpl(int cameraId, camera_device_t *dev)
 #endif
     m_previewStartDeferred = false;
     m_startComplete = THREAD_ID_ALL_CLEARED;
+    m_clearStartStage();
+    m_clearShotStat();
+    m_clearPreviewDropStat();
+    m_initBufTracker();
 
 #ifdef START_HW_THREAD_ENABLE
     m_exitStartThreadMain = false;
     m_exitStartThreadReprocessing = false;
     m_exitStartThreadBufAlloc = false;
+    m_startThreadBufAllocRequested = false;
     m_errorExistInStartThreadMain = false;
     m_errorExistInStartThreadReprocessing = false;
     m_errorExistInStartThreadBufAlloc = false;
@@ -231,6 +239,16 @@ ExynosCameraHWImpl::ExynosCameraHWImpl(int cameraId, camera_device_t *dev)
     isp_last_frame_cnt = 0;
 #ifdef SCALABLE_SENSOR
     m_13MCaptureStart = false;
+    for (int i = 0; i < 2; i++) {
+        m_scalableSwitchCount[i] = 0;
+        m_scalableSwitchLast[i] = 0;
+        m_scalableSwitchMax[i] = 0;
+        m_scalableSwitchSum[i] = 0;
+    }
+    m_scalableFreezeStart = 0;
+    m_scalableFreezeChecking = false;
+    m_scalableFreezeLast = 0;
+    m_scalableFreezeMax = 0;
 #endif
     m_forceAELock = false;
 #ifdef FORCE_LEADER_OFF
@@ -475,15 +493,35 @@ status_t ExynosCameraHWImpl::startPreview()
         m_previewBufStatus[i] = ON_SERVICE;
         m_previewBufRegistered[i] = false;
     }
+    m_previewBufTracker.reset(NUM_OF_PREVIEW_BUF, ExynosCameraBufferTracker::OWNER_DISPLAY);
     m_releasePreviewQ();
 
+    m_clearStartStage();
+    m_clearShotStat();
+    m_clearPreviewDropStat();
+    /* frame counts restart with the sensor */
+    m_lastShotFcount = 0;
+
+#ifdef START_HW_THREAD_ENABLE
+    /*
+     * gralloc dequeue and callback heap allocation do not touch the video nodes,
+     * so let them run while the sensor / ISP nodes are being opened.
+     */
+    m_kickStartThreadBufAlloc();
+#endif
+
     if (m_secCamera->flagOpen(m_cameraId) == false) {
         if (m_secCamera->openCamera(m_cameraId) == false) {
             CLOGE("ERR(%s):Fail to camera open", __func__);
+#ifdef START_HW_THREAD_ENABLE
+            m_waitStartThreadBufAlloc();
+            m_releaseBuffer();
+#endif
             ret = UNKNOWN_ERROR;
             goto err;
         }
     }
+    m_markStartStage(START_STAGE_OPEN_DONE);
 #ifdef USE_VDIS
     if ((m_secCamera->getRecordingHint() == true) &&
          (m_secCamera->getCameraMode() == ExynosCamera::CAMERA_MODE_BACK)) {
@@ -944,6 +982,9 @@ void ExynosCameraHWImpl::releaseRecordingFrame(const void *opaque)
         m_availableRecordingFrameCnt++;
         CLOGV("DEBUG(%s): found index[%d] availableCount(%d)", __func__, i, m_availableRecordingFrameCnt);
         m_recordingFrameAvailable[i] = true;
+        /* frames released after stopRecording() were already reclaimed */
+        if (m_videoRunning == true)
+            m_recordingBufTracker.setOwner(i, ExynosCameraBufferTracker::OWNER_NONE);
     } else {
         CLOGE("ERR(%s):no matched index(%p)", __func__, (char *)opaque);
     }
@@ -1018,6 +1059,10 @@ status_t ExynosCameraHWImpl::takePicture()
     if (m_videoRunning == false)
         m_captureMode = true;
 
+    m_shotStatLock.lock();
+    m_shotRequestTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    m_shotStatLock.unlock();
+
 #ifdef SCALABLE_SENSOR
 #ifdef SCALABLE_SENSOR_CHKTIME
     struct timeval start, end;
@@ -2556,6 +2601,14 @@ status_t ExynosCameraHWImpl::dump(int fd) const
         m_params.dump(fd, args);
         snprintf(buffer, 255, " preview running(%s)\n", m_previewRunning?"true": "false");
         result.append(buffer);
+        m_dumpStartStage(&result);
+        m_dumpShotStat(&result);
+        m_dumpPreviewDropStat(&result);
+        m_previewBufTracker.dump(&result);
+        m_recordingBufTracker.dump(&result);
+#ifdef SCALABLE_SENSOR
+        m_dumpScalableStat(&result);
+#endif
     } else {
         result.append("No camera client yet.\n");
     }
@@ -3686,24 +3739,32 @@ bool ExynosCameraHWImpl::m_startThreadFuncBufAlloc(void)
         return true;
     }
 
-    m_startThreadBufAllocCondition.wait(m_startThreadBufAllocLock);
+    /* the request may be posted before this thread reaches wait() */
+    if (m_startThreadBufAllocRequested == false)
+        m_startThreadBufAllocCondition.wait(m_startThreadBufAllocLock);
     /* check early exit request */
     if (m_exitStartThreadBufAlloc == true) {
         m_startThreadBufAllocLock.unlock();
         CLOGV("DEBUG(%s):exiting on request1", __func__);
         return true;
     }
+    if (m_startThreadBufAllocRequested == false) {
+        m_startThreadBufAllocLock.unlock();
+        CLOGV("DEBUG(%s):spurious wakeup", __func__);
+        return true;
+    }
+    m_startThreadBufAllocRequested = false;
     m_startThreadBufAllocLock.unlock();
 
     CLOGD("DEBUG(%s):(%d)", __func__, __LINE__);
 
-    m_startThreadBufAllocFinished = false;
     m_errorExistInStartThreadBufAlloc = false;
     if (m_getPreviewCallbackBuffer() == false) {
         CLOGE("ERR(%s):Fail on m_getPreviewCallbackBuffer()", __func__);
         m_errorExistInStartThreadBufAlloc = true;
         goto done;
     }
+    m_markStartStage(START_STAGE_BUF_ALLOC_DONE);
 
 done:
     m_startThreadBufAllocFinishLock.lock();
@@ -3718,6 +3779,34 @@ done:
     return true;
 }
 
+void ExynosCameraHWImpl::m_kickStartThreadBufAlloc(void)
+{
+    m_startThreadBufAllocFinishLock.lock();
+    m_startThreadBufAllocWaiting = false;
+    m_startThreadBufAllocFinished = false;
+    m_startThreadBufAllocFinishLock.unlock();
+
+    m_errorExistInStartThreadBufAlloc = false;
+
+    CLOGD("DEBUG(%s):before send signal to startThreadBufAlloc (%d)", __func__, __LINE__);
+    m_startThreadBufAllocLock.lock();
+    m_startThreadBufAllocRequested = true;
+    m_startThreadBufAllocCondition.signal();
+    m_startThreadBufAllocLock.unlock();
+}
+
+void ExynosCameraHWImpl::m_waitStartThreadBufAlloc(void)
+{
+    m_startThreadBufAllocFinishLock.lock();
+    if (m_startThreadBufAllocFinished == false) {
+        m_startThreadBufAllocWaiting = true;
+        CLOGD("DEBUG(%s):wait signal finished ThreadBufAlloc (%d)", __func__, __LINE__);
+        m_startThreadBufAllocFinishCondition.wait(m_startThreadBufAllocFinishLock);
+    }
+    m_startThreadBufAllocWaiting = false;
+    m_startThreadBufAllocFinishLock.unlock();
+}
+
 bool ExynosCameraHWImpl::m_startThreadFuncReprocessing(void)
 {
     CLOGD("DEBUG(%s):in", __func__);
@@ -3796,6 +3885,7 @@ bool ExynosCameraHWImpl::m_startThreadFuncReprocessing(void)
             goto done;
         }
     }
+    m_markStartStage(START_STAGE_REPROCESSING_DONE);
 
 done:
     m_startThreadReprocessingFinishLock.lock();
@@ -3856,6 +3946,7 @@ bool ExynosCameraHWImpl::m_startThreadFuncMain(void)
                 m_errorExistInStartThreadMain = true;
                 goto done;
             }
+            m_markStartStage(START_STAGE_ISP_DONE);
 
             CLOGD("DEBUG(%s):before send signal to startThreadReprocessing (%d)", __func__, __LINE__);
             m_startThreadReprocessingCondition.signal();
@@ -3892,6 +3983,7 @@ bool ExynosCameraHWImpl::m_startThreadFuncMain(void)
                 m_errorExistInStartThreadMain = true;
                 goto done;
             }
+            m_markStartStage(START_STAGE_ISP_DONE);
 
             CLOGD("DEBUG(%s):before send signal to startThreadReprocessing (%d)", __func__, __LINE__);
             m_startThreadReprocessingCondition.signal();
@@ -3912,16 +4004,10 @@ bool ExynosCameraHWImpl::m_startThreadFuncMain(void)
                 goto done;
             }
         }
+        m_markStartStage(START_STAGE_SENSOR_DONE);
 
-        m_startThreadBufAllocFinishLock.lock();
-        if (m_startThreadBufAllocFinished == false) {
-            m_startThreadBufAllocWaiting = true;
-            CLOGD("DEBUG(%s):wait signal finished ThreadBufAlloc (%d)", __func__, __LINE__);
-            m_startThreadBufAllocFinishCondition.wait(m_startThreadBufAllocFinishLock);
-
-        }
-        m_startThreadBufAllocWaiting = false;
-        m_startThreadBufAllocFinishLock.unlock();
+        /* preview node needs the gralloc buffers; this is the only join with BufAlloc */
+        m_waitStartThreadBufAlloc();
 
         if (m_errorExistInStartThreadReprocessing == false &&
             m_secCamera->startPreview() == false) {
@@ -3951,6 +4037,7 @@ bool ExynosCameraHWImpl::m_startThreadFuncMain(void)
             m_errorExistInStartThreadMain = true;
             goto done;
         }
+        m_markStartStage(START_STAGE_STREAM_ON);
 #if CAPTURE_BUF_GET
         if (((m_secCamera->getCameraMode() == ExynosCamera::CAMERA_MODE_BACK) ||
             (m_secCamera->getCameraMode() == ExynosCamera::CAMERA_MODE_FRONT)) &&
@@ -4034,12 +4121,7 @@ bool ExynosCameraHWImpl::m_startPreviewInternal(void)
     m_secCamera->notifyStop(false);
 
 #ifdef START_HW_THREAD_ENABLE
-    m_startThreadBufAllocWaiting = false;
-    m_startThreadBufAllocFinished = false;
-    m_errorExistInStartThreadBufAlloc = false;
-    CLOGD("DEBUG(%s):before send signal to startThreadBufAlloc (%d)", __func__, __LINE__);
-    m_startThreadBufAllocCondition.signal();
-
+    /* startThreadBufAlloc was already kicked by startPreview() before openCamera() */
     m_errorExistInStartThreadMain = false;
     m_startThreadReprocessingFinishWaiting = false;
     m_startThreadMainRunning = true;
@@ -4056,14 +4138,7 @@ bool ExynosCameraHWImpl::m_startPreviewInternal(void)
         || m_errorExistInStartThreadReprocessing == true
         || m_errorExistInStartThreadBufAlloc == true) {
 
-        m_startThreadBufAllocFinishLock.lock();
-        if (m_startThreadBufAllocFinished == false) {
-            m_startThreadBufAllocWaiting = true;
-            CLOGD("DEBUG(%s):wait signal finished ThreadBufAlloc (%d)", __func__, __LINE__);
-            m_startThreadBufAllocFinishCondition.wait(m_startThreadBufAllocFinishLock);
-        }
-        m_startThreadBufAllocWaiting = false;
-        m_startThreadBufAllocFinishLock.unlock();
+        m_waitStartThreadBufAlloc();
 
         m_startThreadReprocessingFinishLock.lock();
         if (m_startThreadReprocessingRunning == true && m_startThreadReprocessingFinished == false) {
@@ -4660,8 +4735,11 @@ bool ExynosCameraHWImpl::m_previewThreadFunc(void)
     doPutPreviewBuf = true;
     shouldEraseBack = true;
 
+    m_markStartStage(START_STAGE_FIRST_FRAME);
+
     if (isValid == false) {
         CLOGW("WARN(%s): Preview frame dropped", __func__);
+        m_countPreviewDrop(PREVIEW_DROP_INVALID);
         goto done;
     }
 
@@ -4673,6 +4751,7 @@ bool ExynosCameraHWImpl::m_previewThreadFunc(void)
 
     if (0 < skipFrameCount) {
         m_decSkipFrame();
+        m_countPreviewDrop(PREVIEW_DROP_SKIP);
         CLOGV("DEBUG(%s):skipping %d frame", __func__, previewBuf.reserved.p);
         goto done;
     }
@@ -4686,6 +4765,18 @@ bool ExynosCameraHWImpl::m_previewThreadFunc(void)
     }
 #endif //CHECK_TIME_START_PREVIEW
 
+    /* give up a late frame before face detection and CSC, a newer one is waiting */
+    if (m_videoRunning == false && m_checkStalePreview(previewBufTimestamp) == true) {
+        CLOGV("DEBUG(%s):drop stale frame(%d)", __func__, previewBuf.reserved.p);
+        m_countPreviewDrop(PREVIEW_DROP_STALE);
+        goto done;
+    }
+
+    m_markStartStage(START_STAGE_FIRST_DISPLAY);
+#ifdef SCALABLE_SENSOR
+    m_checkScalableFreeze();
+#endif
+
     m_secCamera->getPreviewSize(&previewW, &previewH);
 
     /* callback & face detection */
@@ -4797,7 +4888,11 @@ bool ExynosCameraHWImpl::m_previewThreadFunc(void)
         (m_msgEnabled & CAMERA_MSG_PREVIEW_FRAME)) {
          needCSC = m_secCamera->getCallbackCSC();
 
-         if (m_doPreviewToCallbackFunc(previewBuf, &callbackBuf, needCSC) == false) {
+         /* face detection took long enough for a newer frame : keep display, skip callback CSC */
+         if (m_videoRunning == false && m_checkStalePreview(previewBufTimestamp) == true) {
+             m_countPreviewDrop(PREVIEW_DROP_CALLBACK);
+             flagPreviewCallback = false;
+         } else if (m_doPreviewToCallbackFunc(previewBuf, &callbackBuf, needCSC) == false) {
              CLOGE("ERR(%s):Fail to doPreviewCallbackFunc", __func__);
              flagPreviewCallback = false;
          } else {
@@ -4812,11 +4907,14 @@ bool ExynosCameraHWImpl::m_previewThreadFunc(void)
                     m_videoBufTimestamp[previewBuf.reserved.p] = previewBufTimestamp;
                     m_pushVideoQ(&previewBuf);
                 }
-                else
+                else {
                     CLOGW("(%s): Dropping video frame(under processing) [%d]", __func__, previewBuf.reserved.p);
+                    m_countPreviewDrop(PREVIEW_DROP_VIDEO);
+                }
         } else {
                 CLOGW("(%s): Dropping video frame m_sizeOfVideoQ(%d), m_availableRecordingFrameCnt(%d)",
                     __func__, m_sizeOfVideoQ(), m_availableRecordingFrameCnt);
+                m_countPreviewDrop(PREVIEW_DROP_VIDEO);
         }
 
         m_videoLock.lock();
@@ -5407,6 +5505,7 @@ bool ExynosCameraHWImpl::m_videoThreadFunc(void)
                         (int)(timestamp) / (1000 * 1000),
                         (int)(systemTime(SYSTEM_TIME_MONOTONIC)) / (1000 * 1000));
 
+                    m_recordingBufTracker.setOwner(recordingFrameIndex, ExynosCameraBufferTracker::OWNER_CLIENT);
                     m_dataCbTimestamp(timestamp, CAMERA_MSG_VIDEO_FRAME,
                                       m_recordHeap, recordingFrameIndex, m_callbackCookie);
 
@@ -5621,6 +5720,7 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
     int cropX = 0, cropY = 0, cropW = 0, cropH = 0;
     bool doPutPictureBuf = false;
     bool flashTurnOnHere = false;
+    bool jpegSubmitted = false;
     int numOfPictureBuf = 1;
 
     ExynosBuffer pictureBuf;
@@ -5807,6 +5907,13 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
             unsigned int waitBayerFcount = 0;
             unsigned int normalCaptureFcount = 0;
 
+            /* a back-to-back shot must not reprocess the frame of the previous shot */
+            if (m_lastShotFcount != 0 &&
+                m_waitNewIspFrame(m_lastShotFcount) == false) {
+                CLOGE("ERR(%s):no new frame after frame(%d)", __func__, m_lastShotFcount);
+                goto out;
+            }
+
             int retry = 0;
             do {
 #ifdef DYNAMIC_BAYER_BACK_REC
@@ -5823,6 +5930,7 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
             } while (!m_checkPictureBufferVaild(&sensorBufReprocessing, retry++));
 
             normalCaptureFcount = ((camera2_shot_ext *)sensorBufReprocessing.virt.extP[1])->shot.dm.request.frameCount;
+            m_lastShotFcount = normalCaptureFcount;
 
             ExynosBuffer *tempBuf = NULL;
 
@@ -5916,6 +6024,16 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
 
         for (int k = 0; k < NUM_BAYER_BUFFERS; k++)
             m_secCamera->setBayerLockIndex(k, false);
+
+#ifdef SCALABLE_SENSOR
+        /*
+         * The bayer frame has been consumed by the reprocessing chain,
+         * so give the sensor back to preview now and let CSC / JPEG run
+         * while preview restarts, instead of after the encode.
+         */
+        if (m_restoreScalableSensorSize() == false)
+            CLOGE("ERR(%s):m_restoreScalableSensorSize() fail", __func__);
+#endif
     }
 
     if (!m_jpegHeap) {
@@ -6033,7 +6151,7 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
         CLOGV("(%s): pictureBuf.size.extS[%d] = %d", __func__, j, pictureBuf.size.extS[j]);
     }
 
-    if ((m_msgEnabled & CAMERA_MSG_COMPRESSED_IMAGE)) {
+    if (m_msgEnabled & CAMERA_MSG_COMPRESSED_IMAGE) {
         CLOGD("DEBUG(%s): time test  yuv2Jpeg - start %d\n", __func__, __LINE__);
 
         jpegBuf.virt.p = (char *)m_jpegHeap->data;
@@ -6045,8 +6163,8 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
         jpegRect.h = m_orgPictureRect.h;
         jpegRect.colorFormat = JPEG_INPUT_COLOR_FMT;
 
-        if (m_secCamera->yuv2Jpeg(&pictureBuf, &jpegBuf, &jpegRect) == false) {
-            CLOGE("ERR(%s):yuv2Jpeg() fail", __func__);
+        if (m_secCamera->yuv2JpegSubmit(&pictureBuf, &jpegBuf, &jpegRect) == false) {
+            CLOGE("ERR(%s):yuv2JpegSubmit() fail", __func__);
 
             {
                 m_stateLock.lock();
@@ -6063,30 +6181,13 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
             goto out;
         }
 
-        CLOGD("DEBUG(%s): time test  yuv2Jpeg - end %d\n", __func__, __LINE__);
-
-#ifdef CHECK_TIME_SHOT2SHOT
-        m_shot2ShotTimer.stop();
-        long long shot2ShotDurationTime = m_shot2ShotTimer.durationUsecs();
-        CLOGD("DEBUG(%s):CHECK_TIME_SHOT2SHOT : %d msec", __func__, (int)shot2ShotDurationTime / 1000);
-#endif //CHECK_TIME_SHOT2SHOT
+        jpegSubmitted = true;
     }
 
-    if (doPutPictureBuf == true) {
-        if (m_secCamera->putPictureBuf(&m_pictureBuf[0]) == false)
-            CLOGE("ERR(%s):putPictureBuf(%d) fail", __func__, m_pictureBuf[0].reserved.p);
-        else
-            doPutPictureBuf = false;
-    }
-
-    m_stateLock.lock();
-    m_waitForCapture = false;
-    m_stateLock.unlock();
-
-    m_pictureLock.lock();
-    m_pictureCondition.signal();
-    m_pictureLock.unlock();
-
+    /*
+     * The encode runs on the JPEG block while the shutter, raw and postview
+     * callbacks go out. They only read the picture, as the encoder does.
+     */
     if (m_msgEnabled & CAMERA_MSG_SHUTTER)
         m_notifyCb(CAMERA_MSG_SHUTTER, 0, 0, m_callbackCookie);
 
@@ -6110,6 +6211,51 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
         }
     }
 
+    if (jpegSubmitted == true) {
+        jpegSubmitted = false;
+
+        if (m_secCamera->yuv2JpegReap(&jpegBuf, JPEG_ENCODE_TIMEOUT) == false) {
+            CLOGE("ERR(%s):yuv2JpegReap() fail", __func__);
+
+            {
+                m_stateLock.lock();
+                m_captureInProgress = false;
+                m_waitForCapture = false;
+                {
+                    m_pictureLock.lock();
+                    m_pictureCondition.signal();
+                    m_pictureLock.unlock();
+                }
+                m_stateLock.unlock();
+            }
+
+            goto out;
+        }
+
+        CLOGD("DEBUG(%s): time test  yuv2Jpeg - end %d\n", __func__, __LINE__);
+
+#ifdef CHECK_TIME_SHOT2SHOT
+        m_shot2ShotTimer.stop();
+        long long shot2ShotDurationTime = m_shot2ShotTimer.durationUsecs();
+        CLOGD("DEBUG(%s):CHECK_TIME_SHOT2SHOT : %d msec", __func__, (int)shot2ShotDurationTime / 1000);
+#endif //CHECK_TIME_SHOT2SHOT
+    }
+
+    if (doPutPictureBuf == true) {
+        if (m_secCamera->putPictureBuf(&m_pictureBuf[0]) == false)
+            CLOGE("ERR(%s):putPictureBuf(%d) fail", __func__, m_pictureBuf[0].reserved.p);
+        else
+            doPutPictureBuf = false;
+    }
+
+    m_stateLock.lock();
+    m_waitForCapture = false;
+    m_stateLock.unlock();
+
+    m_pictureLock.lock();
+    m_pictureCondition.signal();
+    m_pictureLock.unlock();
+
     if (m_msgEnabled & CAMERA_MSG_COMPRESSED_IMAGE) {
         JpegHeapOut = m_getMemoryCb(-1, jpegBuf.size.s, 1, &JpegHeapOutFd);
         if (!JpegHeapOut || JpegHeapOutFd <= 0) {
@@ -6125,6 +6271,8 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
     }
     }
 
+    m_updateShotStat();
+
     flashTurnOnHere = false;
 
     ((ExynosCameraActivityFlash *)m_secCamera->getFlashMgr())
@@ -6143,6 +6291,9 @@ bool ExynosCameraHWImpl::m_pictureThreadFunc(void)
     ret = true;
 
 out:
+    if (jpegSubmitted == true)
+        m_secCamera->yuv2JpegCancel();
+
     if (JpegHeapOut) {
         JpegHeapOut->release(JpegHeapOut);
         JpegHeapOut = 0;
@@ -6161,14 +6312,9 @@ out:
     int sec, usec;
     gettimeofday(&start, NULL);
 #endif
-    if ((m_13MCaptureStart == true) &&
-        (m_secCamera->getScalableSensorStart()) &&
-        (m_secCamera->getCameraMode() == ExynosCamera::CAMERA_MODE_BACK)) {
-        if (m_chgScalableSensorSize(SCALABLE_SENSOR_SIZE_FHD) == false) {
-            CLOGE("ERR(%s):scalable sensor input change(SCALABLE_SENSOR_SIZE_FHD)!!", __func__);
-            ret = false;
-        }
-    }
+    /* normally already restored right after the bayer was consumed; this covers the error paths */
+    if (m_restoreScalableSensorSize() == false)
+        ret = false;
 #ifdef SCALABLE_SENSOR_CHKTIME
     gettimeofday(&end, NULL);
     CLOGD("DEBUG(%s):CHKTIME m_chgScalableSensorSize all done total [to preview size](%d)", __func__, (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec));
@@ -6300,6 +6446,92 @@ bool ExynosCameraHWImpl::m_stopPictureInternalReprocessing(void)
     return true;
 }
 
+/*
+ * m_sharedISPBuffer is replaced by the ISP thread on every preview frame.
+ * Poll it like m_checkPictureBufferVaild() until it holds a frame newer
+ * than lastFcount.
+ */
+bool ExynosCameraHWImpl::m_waitNewIspFrame(unsigned int lastFcount)
+{
+    for (int waitTime = 0; waitTime < SHOT_FRAME_WAIT_TIMEOUT; waitTime++) {
+        ExynosBuffer ispBuf = m_sharedISPBuffer;
+
+        if (0 <= ispBuf.reserved.p && ispBuf.virt.extP[1] != NULL &&
+            lastFcount < ((camera2_shot_ext *)ispBuf.virt.extP[1])->shot.dm.request.frameCount)
+            return true;
+
+        usleep(1000);
+    }
+
+    return false;
+}
+
+void ExynosCameraHWImpl::m_clearShotStat(void)
+{
+    Mutex::Autolock lock(m_shotStatLock);
+
+    m_shotRequestTime = 0;
+    m_lastShotDoneTime = 0;
+    m_shotCount = 0;
+    m_shotIntervalMin = 0;
+    m_shotIntervalMax = 0;
+    m_shotIntervalSum = 0;
+    m_shotLatencyMax = 0;
+    m_shotLatencySum = 0;
+}
+
+void ExynosCameraHWImpl::m_updateShotStat(void)
+{
+    Mutex::Autolock lock(m_shotStatLock);
+
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t latency = now - m_shotRequestTime;
+    nsecs_t interval = 0;
+
+    if (m_lastShotDoneTime != 0) {
+        interval = now - m_lastShotDoneTime;
+
+        if (m_shotIntervalMin == 0 || interval < m_shotIntervalMin)
+            m_shotIntervalMin = interval;
+        if (m_shotIntervalMax < interval)
+            m_shotIntervalMax = interval;
+        m_shotIntervalSum += interval;
+    }
+
+    if (m_shotLatencyMax < latency)
+        m_shotLatencyMax = latency;
+    m_shotLatencySum += latency;
+
+    m_lastShotDoneTime = now;
+    m_shotCount++;
+
+    CLOGD("DEBUG(%s):shot(%d) latency(%d msec) shot-to-shot(%d msec)",
+        __func__, m_shotCount, (int)ns2ms(latency), (int)ns2ms(interval));
+}
+
+void ExynosCameraHWImpl::m_dumpShotStat(String8 *result) const
+{
+    char buffer[128];
+
+    Mutex::Autolock lock(m_shotStatLock);
+
+    if (m_shotCount == 0) {
+        result->append(" shot-to-shot: no capture\n");
+        return;
+    }
+
+    snprintf(buffer, sizeof(buffer), " shot latency(msec): count(%d) avg(%d) max(%d)\n",
+        m_shotCount, (int)ns2ms(m_shotLatencySum / m_shotCount), (int)ns2ms(m_shotLatencyMax));
+    result->append(buffer);
+
+    if (1 < m_shotCount) {
+        snprintf(buffer, sizeof(buffer), " shot-to-shot(msec): min(%d) avg(%d) max(%d)\n",
+            (int)ns2ms(m_shotIntervalMin), (int)ns2ms(m_shotIntervalSum / (m_shotCount - 1)),
+            (int)ns2ms(m_shotIntervalMax));
+        result->append(buffer);
+    }
+}
+
 void ExynosCameraHWImpl::m_setSkipFrame(int frame)
 {
     Mutex::Autolock lock(m_skipFrameLock);
@@ -6323,6 +6555,103 @@ void ExynosCameraHWImpl::m_decSkipFrame()
     m_skipFrame--;
 }
 
+void ExynosCameraHWImpl::m_clearPreviewDropStat(void)
+{
+    Mutex::Autolock lock(m_previewDropLock);
+
+    m_previewFrameCount = 0;
+    for (int i = 0; i < PREVIEW_DROP_MAX; i++)
+        m_previewDropCount[i] = 0;
+    m_previewLastTimestamp = 0;
+    m_previewFrameInterval = 0;
+    m_previewLateMax = 0;
+}
+
+/*
+ * A frame is stale when it already waited more than PREVIEW_DROP_DEADLINE_FRAMES
+ * frame intervals since the sensor produced it. The interval follows the real
+ * frame rate (it stretches under low light), the fps range only seeds it.
+ * A stale frame is dropped only when a newer one is already waiting on the
+ * preview node, so the display always gets the newest frame.
+ */
+bool ExynosCameraHWImpl::m_checkStalePreview(nsecs_t timestamp)
+{
+    int minFps = 0;
+    int maxFps = 0;
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t age = now - timestamp;
+    nsecs_t interval = 0;
+
+    m_secCamera->getPreviewFpsRange(&minFps, &maxFps);
+
+    {
+        Mutex::Autolock lock(m_previewDropLock);
+
+        /* checked again before callback CSC : account each frame once */
+        if (m_previewLastTimestamp != timestamp) {
+            m_previewFrameCount++;
+
+            if (m_previewLastTimestamp != 0 && m_previewLastTimestamp < timestamp) {
+                interval = timestamp - m_previewLastTimestamp;
+
+                if (m_previewFrameInterval == 0)
+                    m_previewFrameInterval = interval;
+                else
+                    m_previewFrameInterval = (m_previewFrameInterval * 7 + interval) / 8;
+            }
+            m_previewLastTimestamp = timestamp;
+        }
+
+        interval = m_previewFrameInterval;
+        /* fps range is in 1/1000 fps unit */
+        if (interval == 0 && 0 < maxFps)
+            interval = 1000000000000LL / maxFps;
+
+        /* the timestamp is not on the monotonic clock, do not judge */
+        if (interval == 0 || age < 0 || s2ns(1) < age)
+            return false;
+
+        if (age <= interval * PREVIEW_DROP_DEADLINE_FRAMES)
+            return false;
+
+        if (m_previewLateMax < age)
+            m_previewLateMax = age;
+    }
+
+    return m_secCamera->flagPreviewBufReady();
+}
+
+void ExynosCameraHWImpl::m_countPreviewDrop(int stage)
+{
+    if (stage < 0 || PREVIEW_DROP_MAX <= stage)
+        return;
+
+    Mutex::Autolock lock(m_previewDropLock);
+
+    m_previewDropCount[stage]++;
+}
+
+void ExynosCameraHWImpl::m_dumpPreviewDropStat(String8 *result) const
+{
+    char buffer[160];
+
+    Mutex::Autolock lock(m_previewDropLock);
+
+    snprintf(buffer, sizeof(buffer),
+        " preview drop: frame(%d) invalid(%d) skip(%d) stale(%d) callback(%d) video(%d)\n",
+        m_previewFrameCount,
+        m_previewDropCount[PREVIEW_DROP_INVALID],
+        m_previewDropCount[PREVIEW_DROP_SKIP],
+        m_previewDropCount[PREVIEW_DROP_STALE],
+        m_previewDropCount[PREVIEW_DROP_CALLBACK],
+        m_previewDropCount[PREVIEW_DROP_VIDEO]);
+    result->append(buffer);
+
+    snprintf(buffer, sizeof(buffer), " preview frame interval(usec): %d, max late frame age(msec): %d\n",
+        (int)ns2us(m_previewFrameInterval), (int)ns2ms(m_previewLateMax));
+    result->append(buffer);
+}
+
 int ExynosCameraHWImpl::m_saveJpeg( unsigned char *real_jpeg, int jpeg_size)
 {
     FILE *yuv_fp = NULL;
@@ -7367,6 +7696,43 @@ void ExynosCameraHWImpl::m_releasePreviewQ(void)
 void ExynosCameraHWImpl::m_setPreviewBufStatus(int index, int status)
 {
     m_previewBufStatus[index] = status;
+
+    switch (status) {
+    case ON_SERVICE:
+        m_previewBufTracker.setOwner(index, ExynosCameraBufferTracker::OWNER_DISPLAY);
+        break;
+    case ON_HAL:
+        m_previewBufTracker.setOwner(index, ExynosCameraBufferTracker::OWNER_HAL);
+        break;
+    case ON_DRIVER:
+        m_previewBufTracker.setOwner(index, ExynosCameraBufferTracker::OWNER_DRIVER);
+        break;
+    default:
+        CLOGE("ERR(%s):invalid status(%d) on buf(%d)", __func__, status, index);
+        break;
+    }
+}
+
+void ExynosCameraHWImpl::m_initBufTracker(void)
+{
+    /*
+     * preview : display -> driver (start), driver -> hal (dq), hal -> driver (q),
+     * hal -> display (enqueue), display -> hal (dequeue), driver -> display (cancel)
+     */
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_DISPLAY, ExynosCameraBufferTracker::OWNER_DRIVER);
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_DISPLAY, ExynosCameraBufferTracker::OWNER_HAL);
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_DRIVER,  ExynosCameraBufferTracker::OWNER_HAL);
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_DRIVER,  ExynosCameraBufferTracker::OWNER_DISPLAY);
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_HAL,     ExynosCameraBufferTracker::OWNER_DRIVER);
+    m_previewBufTracker.allow(ExynosCameraBufferTracker::OWNER_HAL,     ExynosCameraBufferTracker::OWNER_DISPLAY);
+    m_previewBufTracker.reset(NUM_OF_PREVIEW_BUF, ExynosCameraBufferTracker::OWNER_DISPLAY);
+
+    /* recording : free -> hal (get), hal -> client (callback), client -> free (release), hal -> free (not sent) */
+    m_recordingBufTracker.allow(ExynosCameraBufferTracker::OWNER_NONE,   ExynosCameraBufferTracker::OWNER_HAL);
+    m_recordingBufTracker.allow(ExynosCameraBufferTracker::OWNER_HAL,    ExynosCameraBufferTracker::OWNER_CLIENT);
+    m_recordingBufTracker.allow(ExynosCameraBufferTracker::OWNER_HAL,    ExynosCameraBufferTracker::OWNER_NONE);
+    m_recordingBufTracker.allow(ExynosCameraBufferTracker::OWNER_CLIENT, ExynosCameraBufferTracker::OWNER_NONE);
+    m_recordingBufTracker.reset(NUM_OF_VIDEO_BUF, ExynosCameraBufferTracker::OWNER_NONE);
 }
 
 int ExynosCameraHWImpl::m_getRecordingFrame(void)
@@ -7383,6 +7749,7 @@ int ExynosCameraHWImpl::m_getRecordingFrame(void)
         if (m_recordingFrameAvailable[m_recordingFrameIndex] == true) {
             m_availableRecordingFrameCnt--;
             m_recordingFrameAvailable[m_recordingFrameIndex] = false;
+            m_recordingBufTracker.setOwner(m_recordingFrameIndex, ExynosCameraBufferTracker::OWNER_HAL);
             return m_recordingFrameIndex;
         }
     }
@@ -7401,6 +7768,7 @@ void ExynosCameraHWImpl::m_resetRecordingFrameStatus(void)
 
     for (int i = 0; i < NUM_OF_VIDEO_BUF; i++)
         m_recordingFrameAvailable[i] = true;
+    m_recordingBufTracker.reclaimAll(ExynosCameraBufferTracker::OWNER_NONE);
 
     m_availableRecordingFrameCnt = NUM_OF_VIDEO_BUF;
     m_recordingFrameIndex = 0;
@@ -7412,6 +7780,7 @@ void ExynosCameraHWImpl::m_freeRecordingFrame(int index)
 
     m_availableRecordingFrameCnt++;
     m_recordingFrameAvailable[index] = true;
+    m_recordingBufTracker.setOwner(index, ExynosCameraBufferTracker::OWNER_NONE);
 }
 
 void ExynosCameraHWImpl::m_setStartPreviewComplete(int threadId, bool toggle)
@@ -7437,6 +7806,59 @@ void ExynosCameraHWImpl::m_clearAllStartPreviewComplete(void)
     m_startComplete = THREAD_ID_ALL_CLEARED;
 }
 
+void ExynosCameraHWImpl::m_clearStartStage(void)
+{
+    Mutex::Autolock lock(m_startStageLock);
+
+    for (int i = 0; i < START_STAGE_MAX; i++)
+        m_startStageTime[i] = 0;
+
+    m_startStageTime[START_STAGE_BASE] = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+/* record only the first hit of each stage, and report when the first frame is displayed */
+void ExynosCameraHWImpl::m_markStartStage(int stage)
+{
+    if (stage <= START_STAGE_BASE || START_STAGE_MAX <= stage)
+        return;
+
+    m_startStageLock.lock();
+    if (m_startStageTime[stage] != 0) {
+        m_startStageLock.unlock();
+        return;
+    }
+    m_startStageTime[stage] = systemTime(SYSTEM_TIME_MONOTONIC);
+    m_startStageLock.unlock();
+
+    if (stage == START_STAGE_FIRST_DISPLAY) {
+        String8 result;
+        m_dumpStartStage(&result);
+        CLOGI("INFO(%s):%s", __func__, result.string());
+    }
+}
+
+void ExynosCameraHWImpl::m_dumpStartStage(String8 *result) const
+{
+    static const char *stageName[START_STAGE_MAX] = {
+        "request", "open", "bufAlloc", "sensor", "isp",
+        "reprocessing", "streamOn", "firstFrame", "firstDisplay",
+    };
+    char buffer[64];
+
+    Mutex::Autolock lock(m_startStageLock);
+
+    result->append(" launch-to-first-frame(msec):");
+    for (int i = START_STAGE_BASE + 1; i < START_STAGE_MAX; i++) {
+        if (m_startStageTime[i] == 0)
+            snprintf(buffer, sizeof(buffer), " %s(-)", stageName[i]);
+        else
+            snprintf(buffer, sizeof(buffer), " %s(%d)", stageName[i],
+                (int)ns2ms(m_startStageTime[i] - m_startStageTime[START_STAGE_BASE]));
+        result->append(buffer);
+    }
+    result->append("\n");
+}
+
 #ifdef SCALABLE_SENSOR
 bool ExynosCameraHWImpl::m_chgScalableSensorSize(enum SCALABLE_SENSOR_SIZE sizeMode)
 {
@@ -7447,6 +7869,7 @@ bool ExynosCameraHWImpl::m_chgScalableSensorSize(enum SCALABLE_SENSOR_SIZE sizeM
     struct timeval start, end;
     int sec, usec;
 #endif
+    nsecs_t switchStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
     CLOGD("DEBUG(%s):start", __func__);
 
     if (m_checkScalableSate(sizeMode) == false) {
@@ -7536,6 +7959,8 @@ bool ExynosCameraHWImpl::m_chgScalableSensorSize(enum SCALABLE_SENSOR_SIZE sizeM
         break;
     }
 
+    m_updateScalableStat(sizeMode, switchStartTime);
+
 #ifdef SCALABLE_SENSOR_CHKTIME
     gettimeofday(&end, NULL);
     CLOGD("DEBUG(%s):CHKTIME 3. restart sensor thread (%d)", __func__, (end.tv_sec - start.tv_sec)*1000000 + (end.tv_usec - start.tv_usec));
@@ -7602,6 +8027,86 @@ bool ExynosCameraHWImpl::m_checkAndWaitScalableSate(enum SCALABLE_SENSOR_SIZE si
     return ret;
 }
 
+bool ExynosCameraHWImpl::m_restoreScalableSensorSize(void)
+{
+    if ((m_13MCaptureStart == true) &&
+        (m_secCamera->getScalableSensorStart()) &&
+        (m_secCamera->getCameraMode() == ExynosCamera::CAMERA_MODE_BACK)) {
+        if (m_chgScalableSensorSize(SCALABLE_SENSOR_SIZE_FHD) == false) {
+            CLOGE("ERR(%s):scalable sensor input change(SCALABLE_SENSOR_SIZE_FHD)!!", __func__);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ExynosCameraHWImpl::m_updateScalableStat(enum SCALABLE_SENSOR_SIZE sizeMode, nsecs_t startTime)
+{
+    Mutex::Autolock lock(m_scalableStatLock);
+
+    int idx = (sizeMode == SCALABLE_SENSOR_SIZE_13M) ? 0 : 1;
+    nsecs_t duration = systemTime(SYSTEM_TIME_MONOTONIC) - startTime;
+
+    m_scalableSwitchCount[idx]++;
+    m_scalableSwitchLast[idx] = duration;
+    m_scalableSwitchSum[idx] += duration;
+    if (m_scalableSwitchMax[idx] < duration)
+        m_scalableSwitchMax[idx] = duration;
+
+    if (sizeMode == SCALABLE_SENSOR_SIZE_13M) {
+        m_scalableFreezeStart = startTime;
+        m_scalableFreezeChecking = false;
+    } else if (m_scalableFreezeStart != 0) {
+        m_scalableFreezeChecking = true;
+    }
+
+    CLOGD("DEBUG(%s):switch to %s took %d usec", __func__,
+        (idx == 0) ? "13M" : "FHD", (int)ns2us(duration));
+}
+
+void ExynosCameraHWImpl::m_checkScalableFreeze(void)
+{
+    Mutex::Autolock lock(m_scalableStatLock);
+
+    if (m_scalableFreezeChecking == false)
+        return;
+
+    m_scalableFreezeLast = systemTime(SYSTEM_TIME_MONOTONIC) - m_scalableFreezeStart;
+    if (m_scalableFreezeMax < m_scalableFreezeLast)
+        m_scalableFreezeMax = m_scalableFreezeLast;
+
+    m_scalableFreezeChecking = false;
+    m_scalableFreezeStart = 0;
+
+    CLOGD("DEBUG(%s):preview freeze %d msec", __func__, (int)ns2ms(m_scalableFreezeLast));
+}
+
+void ExynosCameraHWImpl::m_dumpScalableStat(String8 *result) const
+{
+    static const char *modeName[2] = { "13M", "FHD" };
+    char buffer[128];
+
+    Mutex::Autolock lock(m_scalableStatLock);
+
+    for (int i = 0; i < 2; i++) {
+        if (m_scalableSwitchCount[i] == 0)
+            continue;
+
+        snprintf(buffer, sizeof(buffer), " scalable sensor to %s(usec): count(%d) last(%d) avg(%d) max(%d)\n",
+            modeName[i], m_scalableSwitchCount[i], (int)ns2us(m_scalableSwitchLast[i]),
+            (int)ns2us(m_scalableSwitchSum[i] / m_scalableSwitchCount[i]),
+            (int)ns2us(m_scalableSwitchMax[i]));
+        result->append(buffer);
+    }
+
+    if (m_scalableFreezeMax != 0) {
+        snprintf(buffer, sizeof(buffer), " scalable sensor preview freeze(msec): last(%d) max(%d)\n",
+            (int)ns2ms(m_scalableFreezeLast), (int)ns2ms(m_scalableFreezeMax));
+        result->append(buffer);
+    }
+}
+
 #endif
 
 }; // namespace android
@@ -37,6 +37,7 @@
 #include "ExynosCameraVDis.h"
 #include "ExynosCameraList.h"
 #include "ExynosCameraAutoTimer.h"
+#include "ExynosCameraBufferTracker.h"
 
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -62,6 +63,9 @@
 #define  NUM_OF_DEQUEUED_BUFFER          (3)
 #define  NUM_OF_DETECTED_FACES           (16)
 #define  NUM_OF_DETECTED_FACES_THRESHOLD (0)
+#define  SHOT_FRAME_WAIT_TIMEOUT         (500) /* msec */
+#define  PREVIEW_DROP_DEADLINE_FRAMES    (2)
+#define  JPEG_ENCODE_TIMEOUT             (2000) /* msec */
 
 //#define  CHECK_TIME_START_PREVIEW
 //#define  CHECK_TIME_SHOT2SHOT
@@ -312,8 +316,14 @@ private:
     bool        m_startThreadFuncMain(void);
     bool        m_startThreadFuncReprocessing(void);
     bool        m_startThreadFuncBufAlloc(void);
+    void        m_kickStartThreadBufAlloc(void);
+    void        m_waitStartThreadBufAlloc(void);
 #endif
 
+    void        m_clearStartStage(void);
+    void        m_markStartStage(int stage);
+    void        m_dumpStartStage(String8 *result) const;
+
     void        m_releaseBuffer(void);
     bool        m_getPreviewCallbackBuffer(void);
     bool        m_startCameraHw(void);
@@ -360,6 +370,11 @@ private:
     int         m_getSkipFrame();
     void        m_decSkipFrame();
 
+    void        m_clearPreviewDropStat(void);
+    bool        m_checkStalePreview(nsecs_t timestamp);
+    void        m_countPreviewDrop(int stage);
+    void        m_dumpPreviewDropStat(String8 *result) const;
+
     bool        m_isSupportedPreviewSize(const int width, const int height);
     bool        m_isSupportedPictureSize(const int width, const int height) const;
     bool        m_isSupportedVideoSize(const int width, const int height) const;
@@ -378,6 +393,10 @@ private:
 
     bool        m_startPictureInternalReprocessing(void);
     bool        m_stopPictureInternalReprocessing(void);
+    bool        m_waitNewIspFrame(unsigned int lastFcount);
+    void        m_clearShotStat(void);
+    void        m_updateShotStat(void);
+    void        m_dumpShotStat(String8 *result) const;
     void        m_checkPreviewTime(void);
     void        m_checkRecordingTime(void);
 
@@ -399,6 +418,7 @@ private:
     bool        m_eraseBackPreviewQ(void);
 
     void        m_setPreviewBufStatus(int index, int status);
+    void        m_initBufTracker(void);
 
     bool        m_skipFrom3A1ToIsp(int skipCnt, int backFpsMin, int backFpsMax);
 
@@ -410,6 +430,10 @@ private:
     bool        m_chgScalableSensorSize(enum SCALABLE_SENSOR_SIZE sizeMode);
     bool        m_checkScalableSate(enum SCALABLE_SENSOR_SIZE sizeMode);
     bool        m_checkAndWaitScalableSate(enum SCALABLE_SENSOR_SIZE sizeMode);
+    bool        m_restoreScalableSensorSize(void);
+    void        m_updateScalableStat(enum SCALABLE_SENSOR_SIZE sizeMode, nsecs_t startTime);
+    void        m_checkScalableFreeze(void);
+    void        m_dumpScalableStat(String8 *result) const;
 #endif
 
 private:
@@ -419,6 +443,30 @@ private:
         MODE_VIDEO,
     };
 
+    /* launch-to-first-frame breakdown, see m_markStartStage() */
+    enum START_STAGE {
+        START_STAGE_BASE = 0,
+        START_STAGE_OPEN_DONE,
+        START_STAGE_BUF_ALLOC_DONE,
+        START_STAGE_SENSOR_DONE,
+        START_STAGE_ISP_DONE,
+        START_STAGE_REPROCESSING_DONE,
+        START_STAGE_STREAM_ON,
+        START_STAGE_FIRST_FRAME,
+        START_STAGE_FIRST_DISPLAY,
+        START_STAGE_MAX,
+    };
+
+    /* where in the preview path a frame was given up, see m_countPreviewDrop() */
+    enum PREVIEW_DROP_STAGE {
+        PREVIEW_DROP_INVALID = 0,
+        PREVIEW_DROP_SKIP,
+        PREVIEW_DROP_STALE,
+        PREVIEW_DROP_CALLBACK,
+        PREVIEW_DROP_VIDEO,
+        PREVIEW_DROP_MAX,
+    };
+
     enum THREAD_ID {
         THREAD_ID_ALL_CLEARED = 0,
         THREAD_ID_SENSOR      = 1 << 0,
@@ -465,6 +513,7 @@ private:
     mutable Mutex       m_startThreadBufAllocLock;
     mutable Condition   m_startThreadBufAllocCondition;
     bool                m_exitStartThreadBufAlloc;
+    bool                m_startThreadBufAllocRequested;
     bool                m_errorExistInStartThreadBufAlloc;
 
     mutable Mutex       m_startThreadBufAllocFinishLock;
@@ -519,6 +568,18 @@ private:
             bool        m_captureInProgress;
             bool        m_captureMode;
             bool        m_waitForCapture;
+    unsigned int        m_lastShotFcount;
+
+    /* shot-to-shot statistics, guarded by m_shotStatLock */
+    mutable Mutex       m_shotStatLock;
+    nsecs_t             m_shotRequestTime;
+    nsecs_t             m_lastShotDoneTime;
+    unsigned int        m_shotCount;
+    nsecs_t             m_shotIntervalMin;
+    nsecs_t             m_shotIntervalMax;
+    nsecs_t             m_shotIntervalSum;
+    nsecs_t             m_shotLatencyMax;
+    nsecs_t             m_shotLatencySum;
 
     ExynosRect          m_orgPreviewRect;
     ExynosRect          m_orgPictureRect;
@@ -593,6 +654,8 @@ private:
     Mutex               m_recordingFrameMutex;
 
     DurationTimer       m_startPreviewTimer;
+    mutable Mutex       m_startStageLock;
+    nsecs_t             m_startStageTime[START_STAGE_MAX];
     DurationTimer       m_shot2ShotTimer;
 
     DurationTimer       m_previewTimer;
@@ -612,6 +675,18 @@ private:
     mutable Mutex       m_skipFrameLock;
             int         m_skipFrame;
 
+    /* adaptive preview drop, guarded by m_previewDropLock */
+    mutable Mutex       m_previewDropLock;
+    unsigned int        m_previewFrameCount;
+    unsigned int        m_previewDropCount[PREVIEW_DROP_MAX];
+    nsecs_t             m_previewLastTimestamp;
+    nsecs_t             m_previewFrameInterval;
+    nsecs_t             m_previewLateMax;
+
+    /* buffer ownership, see m_initBufTracker() for the legal transitions */
+    ExynosCameraBufferTracker m_previewBufTracker;
+    ExynosCameraBufferTracker m_recordingBufTracker;
+
     camera_notify_callback     m_notifyCb;
     camera_data_callback       m_dataCb;
     camera_data_timestamp_callback m_dataCbTimestamp;
@@ -649,6 +724,18 @@ private:
 #endif
     bool         m_13MCaptureStart;
     Mutex        m_13MCaptureLock;
+
+    /* transition latency, [0] : to 13M, [1] : to FHD */
+    mutable Mutex m_scalableStatLock;
+    unsigned int m_scalableSwitchCount[2];
+    nsecs_t      m_scalableSwitchLast[2];
+    nsecs_t      m_scalableSwitchMax[2];
+    nsecs_t      m_scalableSwitchSum[2];
+    /* preview freeze : 13M switch start ~ first preview frame on FHD */
+    nsecs_t      m_scalableFreezeStart;
+    bool         m_scalableFreezeChecking;
+    nsecs_t      m_scalableFreezeLast;
+    nsecs_t      m_scalableFreezeMax;
 #endif
 
     bool         m_forceAELock;
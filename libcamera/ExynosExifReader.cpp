@@ -0,0 +1,572 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The review screen and the gallery only need the thumbnail makeExif()
+ * puts in APP1, a full decode of the picture is milliseconds of work for
+ * a 160x120 image. This walks the markers up to APP1, the TIFF IFDs it
+ * needs and the SOF of the thumbnail, reading the mapped file in place.
+ * Every offset is bound checked against the APP1, the file is not trusted.
+ */
+
+#define LOG_TAG "ExynosExifReader"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <utils/Log.h>
+
+#include "ExynosExifReader.h"
+
+#define JPEG_MARKER_SOI         (0xD8)
+#define JPEG_MARKER_EOI         (0xD9)
+#define JPEG_MARKER_SOS         (0xDA)
+#define JPEG_MARKER_APP1        (0xE1)
+#define JPEG_MARKER_SOF0        (0xC0)
+#define JPEG_MARKER_SOF2        (0xC2)
+
+#define EXIF_IDENTIFIER_SIZE    (6)
+#define TIFF_HEADER_SIZE        (8)
+
+enum {
+    EXIF_READ_IFD_0,
+    EXIF_READ_IFD_EXIF,
+    EXIF_READ_IFD_GPS,
+    EXIF_READ_IFD_1,
+};
+
+static const unsigned int exifTypeSize[] = {
+    0, 1, 1, 2, 4, 8, 0, 1, 0, 4, 8,
+};
+
+ExynosExifReader::ExynosExifReader()
+{
+    m_buf = NULL;
+    m_size = 0;
+    m_mapped = false;
+    close();
+}
+
+ExynosExifReader::~ExynosExifReader()
+{
+    close();
+}
+
+int ExynosExifReader::open(const char *path)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    close();
+
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        ALOGE("ERR(%s):Cannot open %s", __func__, path);
+        return ERROR_CANNOT_OPEN_FILE;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        ALOGE("ERR(%s):Cannot stat %s", __func__, path);
+        ::close(fd);
+        return ERROR_CANNOT_OPEN_FILE;
+    }
+
+    /* only the pages of the header and the thumbnail are ever read in */
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        ALOGE("ERR(%s):Cannot map %s", __func__, path);
+        return ERROR_CANNOT_OPEN_FILE;
+    }
+
+    m_buf = (const unsigned char *)map;
+    m_size = (int)st.st_size;
+    m_mapped = true;
+
+    return parse();
+}
+
+int ExynosExifReader::setBuf(const unsigned char *buf, int size)
+{
+    close();
+
+    if (buf == NULL || size <= 0)
+        return ERROR_NOT_JPEG;
+
+    m_buf = buf;
+    m_size = size;
+
+    return parse();
+}
+
+void ExynosExifReader::close(void)
+{
+    if (m_mapped == true)
+        munmap((void *)m_buf, m_size);
+
+    m_buf = NULL;
+    m_size = 0;
+    m_mapped = false;
+
+    m_tiff = NULL;
+    m_tiffSize = 0;
+    m_bigEndian = false;
+
+    memset(&m_exif, 0, sizeof(m_exif));
+
+    m_thumb = NULL;
+    m_thumbSize = 0;
+    m_thumbW = 0;
+    m_thumbH = 0;
+    m_thumbFormat = 0;
+}
+
+int ExynosExifReader::getExifInfo(exif_attribute_t *exifInfo)
+{
+    if (m_tiff == NULL)
+        return ERROR_NOT_YET_OPENED;
+
+    memcpy(exifInfo, &m_exif, sizeof(exif_attribute_t));
+
+    return ERROR_NONE;
+}
+
+int ExynosExifReader::getThumbnail(const unsigned char **buf, int *size)
+{
+    if (m_tiff == NULL)
+        return ERROR_NOT_YET_OPENED;
+
+    if (m_thumb == NULL)
+        return ERROR_NO_THUMBNAIL;
+
+    *buf = m_thumb;
+    *size = m_thumbSize;
+
+    return ERROR_NONE;
+}
+
+int ExynosExifReader::getThumbnailSize(int *w, int *h)
+{
+    if (m_tiff == NULL)
+        return ERROR_NOT_YET_OPENED;
+
+    if (m_thumb == NULL)
+        return ERROR_NO_THUMBNAIL;
+
+    *w = m_thumbW;
+    *h = m_thumbH;
+
+    return ERROR_NONE;
+}
+
+int ExynosExifReader::getThumbnailFormat(int *jpegFormat)
+{
+    if (m_tiff == NULL)
+        return ERROR_NOT_YET_OPENED;
+
+    if (m_thumb == NULL)
+        return ERROR_NO_THUMBNAIL;
+
+    *jpegFormat = m_thumbFormat;
+
+    return ERROR_NONE;
+}
+
+int ExynosExifReader::setThumbnailToDecoder(ExynosJpegDecoder *decoder)
+{
+    if (m_tiff == NULL)
+        return ERROR_NOT_YET_OPENED;
+
+    if (m_thumb == NULL)
+        return ERROR_NO_THUMBNAIL;
+
+    if (decoder->setJpegFormat(m_thumbFormat) != ExynosJpegBase::ERROR_NONE ||
+        decoder->setSize(m_thumbW, m_thumbH) != ExynosJpegBase::ERROR_NONE ||
+        decoder->setJpegSize(m_thumbSize) != ExynosJpegBase::ERROR_NONE ||
+        decoder->setInBuf((char *)m_thumb, m_thumbSize) != ExynosJpegBase::ERROR_NONE) {
+        ALOGE("ERR(%s):Cannot set %dx%d thumbnail to the decoder", __func__, m_thumbW, m_thumbH);
+        return ERROR_DECODER_SETUP_FAIL;
+    }
+
+    return ERROR_NONE;
+}
+
+/*
+ * private member functions
+*/
+int ExynosExifReader::parse(void)
+{
+    const unsigned char *p = m_buf;
+    const unsigned char *end = m_buf + m_size;
+    int ret;
+
+    if (m_size < 4 || p[0] != 0xFF || p[1] != JPEG_MARKER_SOI) {
+        ALOGE("ERR(%s):Not a JPEG", __func__);
+        return ERROR_NOT_JPEG;
+    }
+    p += 2;
+
+    while (p + 4 <= end) {
+        unsigned int len;
+
+        if (p[0] != 0xFF)
+            break;
+
+        /* fill bytes */
+        if (p[1] == 0xFF) {
+            p++;
+            continue;
+        }
+
+        if (p[1] == JPEG_MARKER_SOS || p[1] == JPEG_MARKER_EOI)
+            break;
+
+        len = (p[2] << 8) | p[3];
+        if (len < 2 || end < p + 2 + len)
+            break;
+
+        if (p[1] == JPEG_MARKER_APP1 && EXIF_IDENTIFIER_SIZE + TIFF_HEADER_SIZE <= len - 2 &&
+            memcmp(p + 4, "Exif\0\0", EXIF_IDENTIFIER_SIZE) == 0) {
+            ret = parseTiff(p + 4 + EXIF_IDENTIFIER_SIZE, len - 2 - EXIF_IDENTIFIER_SIZE);
+            if (ret != ERROR_NONE)
+                close();
+            return ret;
+        }
+
+        p += 2 + len;
+    }
+
+    return ERROR_NO_EXIF;
+}
+
+int ExynosExifReader::parseTiff(const unsigned char *tiff, unsigned int size)
+{
+    uint32_t ifd1;
+    int ret;
+
+    if (tiff[0] == 'I' && tiff[1] == 'I')
+        m_bigEndian = false;
+    else if (tiff[0] == 'M' && tiff[1] == 'M')
+        m_bigEndian = true;
+    else
+        return ERROR_INVALID_EXIF;
+
+    m_tiff = tiff;
+    m_tiffSize = size;
+
+    if (get16(tiff + 2) != 0x2A)
+        return ERROR_INVALID_EXIF;
+
+    ret = readIfd(get32(tiff + 4), EXIF_READ_IFD_0);
+    if (ret < 0)
+        return ERROR_INVALID_EXIF;
+
+    /* readIfd() leaves the next IFD offset, IFD1 is optional */
+    ifd1 = (uint32_t)ret;
+    if (ifd1 != 0 && readIfd(ifd1, EXIF_READ_IFD_1) < 0)
+        ALOGD("DEBUG(%s):IFD1 at %u is broken, no thumbnail", __func__, ifd1);
+
+    if (m_thumb != NULL && parseThumbnailSof() != ERROR_NONE) {
+        ALOGD("DEBUG(%s):Thumbnail has no usable SOF", __func__);
+        m_thumb = NULL;
+        m_thumbSize = 0;
+    }
+
+    m_exif.enableThumb = (m_thumb != NULL);
+
+    return ERROR_NONE;
+}
+
+int ExynosExifReader::parseThumbnailSof(void)
+{
+    const unsigned char *p = m_thumb;
+    const unsigned char *end = m_thumb + m_thumbSize;
+
+    if (m_thumbSize < 4 || p[0] != 0xFF || p[1] != JPEG_MARKER_SOI)
+        return ERROR_NOT_JPEG;
+    p += 2;
+
+    while (p + 4 <= end && p[0] == 0xFF) {
+        unsigned int len = (p[2] << 8) | p[3];
+
+        if (p[1] == JPEG_MARKER_SOS || len < 2 || end < p + 2 + len)
+            break;
+
+        if (JPEG_MARKER_SOF0 <= p[1] && p[1] <= JPEG_MARKER_SOF2 && 8 <= len) {
+            int comps = p[9];
+
+            m_thumbH = (p[5] << 8) | p[6];
+            m_thumbW = (p[7] << 8) | p[8];
+
+            if (comps == 1) {
+                m_thumbFormat = V4L2_PIX_FMT_JPEG_GRAY;
+            } else if (comps == 3 && 8 + 3 * 3 <= len) {
+                /* sampling of Y against 1x1 chroma */
+                switch (p[11]) {
+                case 0x22:
+                    m_thumbFormat = V4L2_PIX_FMT_JPEG_420;
+                    break;
+                case 0x21:
+                    m_thumbFormat = V4L2_PIX_FMT_JPEG_422;
+                    break;
+                case 0x11:
+                    m_thumbFormat = V4L2_PIX_FMT_JPEG_444;
+                    break;
+                default:
+                    return ERROR_NOT_JPEG;
+                }
+            } else {
+                return ERROR_NOT_JPEG;
+            }
+
+            return (m_thumbW > 0 && m_thumbH > 0) ? ERROR_NONE : ERROR_NOT_JPEG;
+        }
+
+        p += 2 + len;
+    }
+
+    return ERROR_NOT_JPEG;
+}
+
+uint16_t ExynosExifReader::get16(const unsigned char *p)
+{
+    if (m_bigEndian)
+        return (p[0] << 8) | p[1];
+
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t ExynosExifReader::get32(const unsigned char *p)
+{
+    if (m_bigEndian)
+        return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+const unsigned char *ExynosExifReader::entryValue(const unsigned char *entry, unsigned int *count)
+{
+    uint16_t type = get16(entry + 2);
+    uint32_t num = get32(entry + 4);
+    uint32_t offset;
+    uint64_t bytes;
+
+    if (type >= sizeof(exifTypeSize) / sizeof(exifTypeSize[0]) || exifTypeSize[type] == 0)
+        return NULL;
+
+    bytes = (uint64_t)exifTypeSize[type] * num;
+    *count = num;
+
+    /* up to 4 bytes are kept in the entry itself */
+    if (bytes <= OFFSET_SIZE)
+        return entry + 8;
+
+    offset = get32(entry + 8);
+    if (m_tiffSize < offset || m_tiffSize - offset < bytes)
+        return NULL;
+
+    return m_tiff + offset;
+}
+
+int ExynosExifReader::readIfd(uint32_t offset, int ifd)
+{
+    const unsigned char *p;
+    unsigned int num;
+
+    if (m_tiffSize < offset || m_tiffSize - offset < NUM_SIZE)
+        return -1;
+
+    p = m_tiff + offset;
+    num = get16(p);
+    p += NUM_SIZE;
+
+    if (m_tiffSize - offset - NUM_SIZE < num * IFD_SIZE + OFFSET_SIZE)
+        return -1;
+
+    for (unsigned int i = 0; i < num; i++, p += IFD_SIZE)
+        readEntry(p, ifd);
+
+    /* the offset of the next IFD, capped to stay a non negative int */
+    return (int)(get32(p) & 0x7FFFFFFF);
+}
+
+void ExynosExifReader::readEntry(const unsigned char *entry, int ifd)
+{
+    uint16_t tag = get16(entry);
+    uint16_t type = get16(entry + 2);
+    uint32_t value;
+
+    /* SHORT and LONG values, which is what the tags below are */
+    if (type == EXIF_TYPE_SHORT)
+        value = get16(entry + 8);
+    else
+        value = get32(entry + 8);
+
+    switch (ifd) {
+    case EXIF_READ_IFD_0:
+        switch (tag) {
+        case EXIF_TAG_IMAGE_WIDTH:
+            m_exif.width = value;
+            break;
+        case EXIF_TAG_IMAGE_HEIGHT:
+            m_exif.height = value;
+            break;
+        case EXIF_TAG_MAKE:
+            readAscii(entry, m_exif.maker, sizeof(m_exif.maker));
+            break;
+        case EXIF_TAG_MODEL:
+            readAscii(entry, m_exif.model, sizeof(m_exif.model));
+            break;
+        case EXIF_TAG_ORIENTATION:
+            m_exif.orientation = value;
+            break;
+        case EXIF_TAG_SOFTWARE:
+            readAscii(entry, m_exif.software, sizeof(m_exif.software));
+            break;
+        case EXIF_TAG_DATE_TIME:
+            readAscii(entry, m_exif.date_time, sizeof(m_exif.date_time));
+            break;
+        case EXIF_TAG_EXIF_IFD_POINTER:
+            readIfd(value, EXIF_READ_IFD_EXIF);
+            break;
+        case EXIF_TAG_GPS_IFD_POINTER:
+            m_exif.enableGps = (0 <= readIfd(value, EXIF_READ_IFD_GPS));
+            break;
+        }
+        break;
+    case EXIF_READ_IFD_EXIF:
+        switch (tag) {
+        case EXIF_TAG_EXPOSURE_TIME:
+            readRational(entry, &m_exif.exposure_time, 1);
+            break;
+        case EXIF_TAG_FNUMBER:
+            readRational(entry, &m_exif.fnumber, 1);
+            break;
+        case EXIF_TAG_ISO_SPEED_RATING:
+            m_exif.iso_speed_rating = value;
+            break;
+        case EXIF_TAG_FLASH:
+            m_exif.flash = value;
+            break;
+        case EXIF_TAG_FOCAL_LENGTH:
+            readRational(entry, &m_exif.focal_length, 1);
+            break;
+        case EXIF_TAG_WHITE_BALANCE:
+            m_exif.white_balance = value;
+            break;
+        case EXIF_TAG_PIXEL_X_DIMENSION:
+            if (m_exif.width == 0)
+                m_exif.width = value;
+            break;
+        case EXIF_TAG_PIXEL_Y_DIMENSION:
+            if (m_exif.height == 0)
+                m_exif.height = value;
+            break;
+        }
+        break;
+    case EXIF_READ_IFD_GPS:
+        switch (tag) {
+        case EXIF_TAG_GPS_LATITUDE_REF:
+            readAscii(entry, m_exif.gps_latitude_ref, sizeof(m_exif.gps_latitude_ref));
+            break;
+        case EXIF_TAG_GPS_LATITUDE:
+            readRational(entry, m_exif.gps_latitude, 3);
+            break;
+        case EXIF_TAG_GPS_LONGITUDE_REF:
+            readAscii(entry, m_exif.gps_longitude_ref, sizeof(m_exif.gps_longitude_ref));
+            break;
+        case EXIF_TAG_GPS_LONGITUDE:
+            readRational(entry, m_exif.gps_longitude, 3);
+            break;
+        case EXIF_TAG_GPS_ALTITUDE:
+            readRational(entry, &m_exif.gps_altitude, 1);
+            break;
+        }
+        break;
+    case EXIF_READ_IFD_1:
+        switch (tag) {
+        case EXIF_TAG_IMAGE_WIDTH:
+            m_exif.widthThumb = value;
+            break;
+        case EXIF_TAG_IMAGE_HEIGHT:
+            m_exif.heightThumb = value;
+            break;
+        case EXIF_TAG_COMPRESSION_SCHEME:
+            m_exif.compression_scheme = value;
+            break;
+        case EXIF_TAG_JPEG_INTERCHANGE_FORMAT:
+            if (value < m_tiffSize)
+                m_thumb = m_tiff + value;
+            break;
+        case EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LEN:
+            m_thumbSize = (int)value;
+            break;
+        }
+        break;
+    }
+
+    /* both tags are needed, in whatever order they come */
+    if (ifd == EXIF_READ_IFD_1 && m_thumb != NULL && 0 < m_thumbSize &&
+        m_tiffSize - (m_thumb - m_tiff) < (unsigned int)m_thumbSize) {
+        ALOGE("ERR(%s):Thumbnail of %d bytes overruns APP1", __func__, m_thumbSize);
+        m_thumb = NULL;
+        m_thumbSize = 0;
+    }
+}
+
+void ExynosExifReader::readAscii(const unsigned char *entry, unsigned char *dst, unsigned int dstSize)
+{
+    const unsigned char *src;
+    unsigned int count = 0;
+
+    if (get16(entry + 2) != EXIF_TYPE_ASCII)
+        return;
+
+    src = entryValue(entry, &count);
+    if (src == NULL)
+        return;
+
+    if (count > dstSize - 1)
+        count = dstSize - 1;
+
+    memcpy(dst, src, count);
+    dst[count] = '\0';
+}
+
+void ExynosExifReader::readRational(const unsigned char *entry, rational_t *dst, unsigned int num)
+{
+    const unsigned char *src;
+    unsigned int count = 0;
+    uint16_t type = get16(entry + 2);
+
+    if (type != EXIF_TYPE_RATIONAL && type != EXIF_TYPE_SRATIONAL)
+        return;
+
+    src = entryValue(entry, &count);
+    if (src == NULL)
+        return;
+
+    for (unsigned int i = 0; i < num && i < count; i++) {
+        dst[i].num = get32(src + i * 8);
+        dst[i].den = get32(src + i * 8 + 4);
+    }
+}
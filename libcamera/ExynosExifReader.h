@@ -0,0 +1,100 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EXYNOS_EXIF_READER_H_
+#define EXYNOS_EXIF_READER_H_
+
+#include <stdint.h>
+
+#include "ExynosExif.h"
+
+#include "ExynosJpegApi.h"
+
+/*
+ * Reads the EXIF of a JPEG (the APP1 makeExif() writes) without decoding
+ * the picture. The file is mapped and parsed in place : the thumbnail is
+ * returned as a pointer into the mapping, valid until close().
+ */
+class ExynosExifReader {
+public :
+    enum ERROR {
+        ERROR_CANNOT_OPEN_FILE = -0x300,
+        ERROR_NOT_JPEG,
+        ERROR_NO_EXIF,
+        ERROR_INVALID_EXIF,
+        ERROR_NO_THUMBNAIL,
+        ERROR_NOT_YET_OPENED,
+        ERROR_DECODER_SETUP_FAIL,
+        ERROR_NONE = 0
+    };
+
+    ExynosExifReader();
+    virtual ~ExynosExifReader();
+
+    /* maps and parses a file */
+    int     open(const char *path);
+    /* parses a JPEG already in memory, buf is not copied */
+    int     setBuf(const unsigned char *buf, int size);
+    void    close(void);
+
+    /* key tags of IFD0, the Exif IFD, the GPS IFD and IFD1 */
+    int     getExifInfo(exif_attribute_t *exifInfo);
+
+    int     getThumbnail(const unsigned char **buf, int *size);
+    /* size and V4L2_PIX_FMT_JPEG_* of the thumbnail, from its SOF */
+    int     getThumbnailSize(int *w, int *h);
+    int     getThumbnailFormat(int *jpegFormat);
+
+    /*
+     * Sets the thumbnail as the input of decoder (format, size, buffer).
+     * The caller sets the output and runs the decode.
+     */
+    int     setThumbnailToDecoder(ExynosJpegDecoder *decoder);
+
+private:
+    int     parse(void);
+    int     parseTiff(const unsigned char *tiff, unsigned int size);
+    int     parseThumbnailSof(void);
+
+    uint16_t    get16(const unsigned char *p);
+    uint32_t    get32(const unsigned char *p);
+    /* the value of an IFD entry, NULL when it is out of the TIFF */
+    const unsigned char *entryValue(const unsigned char *entry, unsigned int *count);
+    int     readIfd(uint32_t offset, int ifd);
+    void    readEntry(const unsigned char *entry, int ifd);
+    void    readAscii(const unsigned char *entry, unsigned char *dst, unsigned int dstSize);
+    void    readRational(const unsigned char *entry, rational_t *dst, unsigned int num);
+
+    const unsigned char *m_buf;
+    int     m_size;
+    bool    m_mapped;
+
+    /* TIFF header of the APP1 */
+    const unsigned char *m_tiff;
+    unsigned int m_tiffSize;
+    bool    m_bigEndian;
+
+    exif_attribute_t m_exif;
+
+    const unsigned char *m_thumb;
+    int     m_thumbSize;
+    int     m_thumbW;
+    int     m_thumbH;
+    int     m_thumbFormat;
+};
+
+#endif /* EXYNOS_EXIF_READER_H_ */
@@ -52,6 +52,8 @@ ExynosJpegEncoderForCamera::~ExynosJpegEncoderForCamera()
 {
     if (m_flagCreate == true)
         this->destroy();
+
+    flushJpegMemoryCache();
 }
 
 bool ExynosJpegEncoderForCamera::flagCreate(void)
@@ -77,6 +79,13 @@ int ExynosJpegEncoderForCamera::create(void)
         if (ret)
             return ret;
 
+        /*
+         * a capture is served before background jobs of other processes,
+         * the media server keeps the queue for all of them
+         */
+        ExynosJpegBase::startArbiter();
+        m_jpegMain->setPriority(ExynosJpegBase::PRIORITY_CAMERA);
+
         ret = m_jpegMain->setCache(JPEG_CACHE_ON);
 
         if (ret) {
@@ -107,13 +116,8 @@ int ExynosJpegEncoderForCamera::destroy(void)
         m_jpegMain = NULL;
     }
 
+    /* thumbnail buffers and the ion client stay for the next capture, see flushJpegMemoryCache() */
     if (m_jpegThumb != NULL) {
-        int iSize = sizeof(char)*m_thumbnailW*m_thumbnailH*4;
-
-        freeJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM);
-        freeJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM);
-        m_ionJpegClient = deleteIonClient(m_ionJpegClient);
-        m_stThumbInBuf.ionClient = m_stThumbOutBuf.ionClient = m_ionJpegClient;
         m_jpegThumb->destroy();
         delete m_jpegThumb;
         m_jpegThumb = NULL;
@@ -255,14 +259,77 @@ int  ExynosJpegEncoderForCamera::setOutBuf(char *buf, int size)
 }
 
 int ExynosJpegEncoderForCamera::encode(int *size, exif_attribute_t *exifInfo)
+{
+    int ret = encodeSubmit();
+    if (ret != ERROR_NONE)
+        return ret;
+
+    return encodeReap(size, exifInfo, -1);
+}
+
+int ExynosJpegEncoderForCamera::encodeSubmit(void)
+{
+    int ret = ERROR_NONE;
+
+    if (m_flagCreate == false)
+        return ERROR_NOT_YET_CREATED;
+
+    ret = m_jpegMain->encodeSubmit();
+    if (ret) {
+        ALOGE("ERR(%s):encodeSubmit failed(%d)", __func__, ret);
+        return ret;
+    }
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegEncoderForCamera::getPollFd(void)
+{
+    if (m_flagCreate == false)
+        return -1;
+
+    return m_jpegMain->getPollFd();
+}
+
+int ExynosJpegEncoderForCamera::encodeCancel(void)
+{
+    if (m_flagCreate == false)
+        return ERROR_NOT_YET_CREATED;
+
+    return m_jpegMain->cancel();
+}
+
+int ExynosJpegEncoderForCamera::encodeReap(int *size, exif_attribute_t *exifInfo, int timeoutMs)
 {
     int ret = ERROR_NONE;
     unsigned char *exifOut = NULL;
+    unsigned int thumbLen = 0;
 
     if (m_flagCreate == false)
         return ERROR_NOT_YET_CREATED;
 
-    ret = m_jpegMain->encode();
+    /* the thumbnail is scaled and encoded while the main image is still on the hardware */
+    if (exifInfo != NULL && exifInfo->enableThumb) {
+        if (encodeThumbnail(&thumbLen)) {
+            ALOGE("ERR(%s):encodeThumbnail() fail", __func__);
+            thumbLen = 0;
+            exifInfo->enableThumb = false;
+        } else if (thumbLen > EXIF_LIMIT_SIZE) {
+            ALOGE("ERR(%s):thumbLen(%d) is too bigger than EXIF_LIMIT_SIZE(%d)",
+                __func__, thumbLen, EXIF_LIMIT_SIZE);
+            thumbLen = 0;
+            exifInfo->enableThumb = false;
+        }
+    }
+
+    ret = m_jpegMain->waitDone(timeoutMs);
+    if (ret) {
+        ALOGE("ERR(%s):waitDone(%d msec) failed(%d), cancel", __func__, timeoutMs, ret);
+        m_jpegMain->cancel();
+        return ret;
+    }
+
+    ret = m_jpegMain->encodeReap();
     if (ret) {
         ALOGE("encode failed");
         return ret;
@@ -310,30 +377,13 @@ int ExynosJpegEncoderForCamera::encode(int *size, exif_attribute_t *exifInfo)
     }
 
     if (exifInfo != NULL) {
-        unsigned int thumbLen = 0;
         unsigned int exifLen = 0;
         unsigned int bufSize = 0;
 
-        if (exifInfo->enableThumb) {
-            if (encodeThumbnail(&thumbLen)) {
-                ALOGE("ERR(%s):encodeThumbnail() fail", __func__);
-                bufSize = EXIF_FILE_SIZE;
-                exifInfo->enableThumb = false;
-            } else {
-                if (thumbLen > EXIF_LIMIT_SIZE) {
-                    ALOGE("ERR(%s):thumbLen(%d) is too bigger than EXIF_LIMIT_SIZE(%d)",
-                        __func__, thumbLen, EXIF_LIMIT_SIZE);
-
-                    bufSize = EXIF_FILE_SIZE;
-                    exifInfo->enableThumb = false;
-                } else {
-                    bufSize = EXIF_FILE_SIZE + thumbLen;
-                }
-            }
-        } else {
+        if (exifInfo->enableThumb)
+            bufSize = EXIF_FILE_SIZE + thumbLen;
+        else
             bufSize = EXIF_FILE_SIZE;
-            exifInfo->enableThumb = false;
-        }
 
         exifOut = new unsigned char[bufSize];
         if (exifOut == NULL) {
@@ -944,6 +994,8 @@ int ExynosJpegEncoderForCamera::encodeThumbnail(unsigned int *size, bool useMain
         return ret;
     }
 
+    m_jpegThumb->setPriority(ExynosJpegBase::PRIORITY_CAMERA);
+
         ret = m_jpegThumb->setCache(JPEG_CACHE_ON);
     if (ret) {
         ALOGE("ERR(%s):Fail cache set", __func__);
@@ -968,19 +1020,28 @@ int ExynosJpegEncoderForCamera::encodeThumbnail(unsigned int *size, bool useMain
         return ret;
     }
 
-    freeJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM);
-    freeJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM);
+    int thumbInSize[MAX_IMAGE_PLANE_NUM];
+    int thumbOutSize = sizeof(char)*m_thumbnailW*m_thumbnailH*THUMBNAIL_IMAGE_PIXEL_SIZE;
 
-    if (m_jpegThumb->setColorBufSize(m_stThumbInBuf.iSize, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
+    if (m_jpegThumb->setColorBufSize(thumbInSize, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
         return ERROR_INVALID_COLOR_FORMAT;
 
-    m_stThumbOutBuf.iSize[0] = sizeof(char)*m_thumbnailW*m_thumbnailH*THUMBNAIL_IMAGE_PIXEL_SIZE;
+    /* the buffers of the previous capture are reused while the thumbnail size is the same */
+    if (m_stThumbOutBuf.ionBuffer[0] == -1 ||
+        m_stThumbOutBuf.iSize[0] != thumbOutSize ||
+        memcmp(m_stThumbInBuf.iSize, thumbInSize, sizeof(thumbInSize)) != 0) {
+        freeJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM);
+        freeJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM);
 
-    if (allocJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
-        return ERROR_MEM_ALLOC_FAIL;
+        memcpy(m_stThumbInBuf.iSize, thumbInSize, sizeof(thumbInSize));
+        m_stThumbOutBuf.iSize[0] = thumbOutSize;
 
-    if (allocJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
-        return ERROR_MEM_ALLOC_FAIL;
+        if (allocJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
+            return ERROR_MEM_ALLOC_FAIL;
+
+        if (allocJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM) != ERROR_NONE)
+            return ERROR_MEM_ALLOC_FAIL;
+    }
 
     /* Thumbnail InBuf is DMA_BUF */
     ret = m_jpegThumb->setInBuf(m_stThumbInBuf.ionBuffer, m_stThumbInBuf.iSize);
@@ -1332,3 +1393,15 @@ void ExynosJpegEncoderForCamera::unmapJpegMemory(int *iFd, char **ppcBuf, int *p
         piSize[i] = 0;
     }
 }
+
+void ExynosJpegEncoderForCamera::flushJpegMemoryCache(void)
+{
+    freeJpegMemory(&m_stThumbInBuf, MAX_IMAGE_PLANE_NUM);
+    freeJpegMemory(&m_stThumbOutBuf, MAX_IMAGE_PLANE_NUM);
+
+    /* create() takes the client again for the next capture */
+    if (m_flagCreate == false) {
+        m_ionJpegClient = deleteIonClient(m_ionJpegClient);
+        m_stThumbInBuf.ionClient = m_stThumbOutBuf.ionClient = m_ionJpegClient;
+    }
+}
@@ -93,6 +93,16 @@ public :
 
     int     encode(int *size, exif_attribute_t *exifInfo);
 
+    /*
+     * encode() in two steps. getPollFd() turns POLLIN when the main image
+     * is done. encodeReap() adds the thumbnail and EXIF, it waits up to
+     * timeoutMs (-1 : forever) and cancels the job on timeout.
+     */
+    int     encodeSubmit(void);
+    int     getPollFd(void);
+    int     encodeReap(int *size, exif_attribute_t *exifInfo, int timeoutMs);
+    int     encodeCancel(void);
+
     int     setThumbnailSize(int w, int h);
     int     setThumbnailQuality(int quality);
 
@@ -104,6 +114,12 @@ public :
     void    setInBufType(int sel);
     int     getInBufType(void);
 
+    /*
+     * Frees the thumbnail buffers kept between captures.
+     * Call it with no encode running (stream stop).
+     */
+    void    flushJpegMemoryCache(void);
+
 private:
     inline void writeExifIfd(unsigned char **pCur,
                                          unsigned short tag,
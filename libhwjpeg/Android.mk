@@ -23,7 +23,8 @@ LOCAL_C_INCLUDES := \
 	$(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include \
 	$(LOCAL_PATH)/../include \
 	$(TOP)/hardware/samsung_slsi/exynos/libexynosutils \
-	$(TOP)/hardware/samsung_slsi/exynos/include
+	$(TOP)/hardware/samsung_slsi/exynos/include \
+	$(TOP)/external/jpeg
 
 LOCAL_ADDITIONAL_DEPENDENCIES += \
 	$(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
@@ -31,13 +32,44 @@ LOCAL_ADDITIONAL_DEPENDENCIES += \
 LOCAL_SRC_FILES := \
 	ExynosJpegEncoder.cpp \
 	ExynosJpegDecoder.cpp \
+	ExynosJpegDecoderRegion.cpp \
+	ExynosJpegDecoderBatch.cpp \
+	ExynosJpegEncoderRateControl.cpp \
+	ExynosJpegEncoderSw.cpp \
 	ExynosJpegBase.cpp \
-	ExynosJpegBase_Dependence.cpp
+	ExynosJpegArbiter.cpp \
+	ExynosJpegBase_Dependence.cpp \
+	ExynosJpegDevice.cpp \
+	ExynosJpegSwCodec.cpp \
+	ExynosJpegFakeDevice.cpp
 
 LOCAL_SHARED_LIBRARIES := \
 	libutils \
 	liblog \
 	libexynosutils \
-	libion_exynos
+	libion_exynos \
+	libjpeg
 
 include $(BUILD_SHARED_LIBRARY)
+
+# Benchmark, libhwjpeg_bench -h for the options
+include $(CLEAR_VARS)
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_MODULE := libhwjpeg_bench
+
+LOCAL_C_INCLUDES := \
+	$(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr/include \
+	$(LOCAL_PATH)/../include
+
+LOCAL_ADDITIONAL_DEPENDENCIES += \
+	$(TARGET_OUT_INTERMEDIATES)/KERNEL_OBJ/usr
+
+LOCAL_SRC_FILES := \
+	ExynosJpegBench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	libhwjpeg
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,791 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Cross-process arbitration of the JPEG block.
+ *
+ * The queue lives in one trusted process: the camera HAL starts the arbiter
+ * in the media server with startArbiter(), and every process using
+ * libhwjpeg talks to it over an abstract socket, one connection per
+ * instance. No client can write the queue:
+ *  - a job is queued after the arbiter granted it the block and is
+ *    reported back when it is reaped. A connection that closes gives back
+ *    what it held, so a dead process never keeps the block.
+ *  - the pid and uid of a client come from SO_PEERCRED. Applications can
+ *    not ask for more than PRIORITY_NORMAL, and a client ignores an
+ *    arbiter run by an application uid.
+ *  - the owner is a process. Jobs of the owner process are let through, so
+ *    a process with two jobs in flight (the camera main image and its
+ *    thumbnail) never waits for itself. When a job of higher priority is
+ *    waiting, a new job of the owner hands the block over to it before
+ *    queueing: a thread that submits on a second instance before reaping
+ *    the first one never waits for its own release.
+ *  - the next owner is the waiting job of the highest priority, among
+ *    equal priorities the one of the client with the least virtual time
+ *    (block time used, a new client starts at the current minimum), then
+ *    the oldest.
+ *  - a job on the block for ARB_HOLD_MAX_MS stops keeping the others out,
+ *    and a job that waited ARB_WAIT_MAX_MS runs unarbitrated, so a stuck
+ *    or hostile client delays the others but never blocks them.
+ * The block is not preempted within a job. A camera job waits for at most
+ * the running job, a batch decode gives the block away between images when
+ * a job of higher priority is waiting.
+ * When no arbiter is running, jobs run unarbitrated, serialized by the
+ * driver as before.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <private/android_filesystem_config.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+#define JPEG_ARBITER_NAME           "hwjpeg_arbiter"
+#define ARB_MAX_CLIENT              (16)
+#define ARB_MAX_CONN                (32)
+#define ARB_WAIT_SLICE_MS           (20)
+#define ARB_WAIT_MAX_MS             (3000)
+#define ARB_HOLD_MAX_MS             (500)
+#define ARB_REPLY_TIMEOUT_MS        (100)
+/* weight of a new job in the average job time, 1/8 */
+#define ARB_AVG_SHIFT               (3)
+
+enum ARB_CMD {
+    ARB_CMD_ACQUIRE = 1,
+    ARB_CMD_RELEASE,
+    ARB_CMD_YIELD,
+    ARB_CMD_STAT
+};
+
+enum ARB_STATE {
+    ARB_STATE_IDLE = 0,
+    ARB_STATE_WAITING,
+    ARB_STATE_GRANTED,
+    ARB_STATE_DETACHED      /* still running, no longer keeps the others out */
+};
+
+struct ARB_REQUEST {
+    int                 cmd;
+    int                 priority;
+};
+
+struct ARB_REPLY {
+    int                 cmd;
+    int                 result;         /* granted, or yield */
+    struct ExynosJpegBase::ARBITER_STAT stat;
+};
+
+/* the arbiter side, only touched by the arbiter thread */
+struct ARB_CLIENT {
+    pid_t               pid;
+    int                 numOfConns;
+    unsigned int        numOfJobs;
+    long long           vtimeUs;
+    long long           busyUs;
+    long long           waitUs;
+    long long           maxWaitUs;
+};
+
+struct ARB_CONN {
+    int                 fd;
+    pid_t               pid;
+    uid_t               uid;
+    int                 client;
+    int                 state;
+    int                 priority;
+    long long           ticket;
+    long long           enqueueUs;
+    long long           startUs;
+};
+
+static struct ARB_CLIENT arbClient[ARB_MAX_CLIENT];
+static struct ARB_CONN arbConn[ARB_MAX_CONN];
+static pid_t arbOwnerPid = 0;
+static long long arbTicket = 0;
+static long long arbAvgJobUs[ExynosJpegBase::PRIORITY_MAX];
+
+static pthread_mutex_t arbLock = PTHREAD_MUTEX_INITIALIZER;
+static const char *arbName = JPEG_ARBITER_NAME;
+static bool arbRunning = false;
+
+static long long arbNowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* abstract socket address of pcName */
+static socklen_t arbAddr(const char *pcName, struct sockaddr_un *pstAddr)
+{
+    size_t iLen = strlen(pcName);
+
+    if (sizeof(pstAddr->sun_path) - 1 < iLen)
+        iLen = sizeof(pstAddr->sun_path) - 1;
+
+    memset(pstAddr, 0, sizeof(struct sockaddr_un));
+    pstAddr->sun_family = AF_UNIX;
+    memcpy(pstAddr->sun_path + 1, pcName, iLen);
+
+    return offsetof(struct sockaddr_un, sun_path) + 1 + iLen;
+}
+
+/* slot of process pid, -1 when the table is full */
+static int arbSrvClient(pid_t pid)
+{
+    long long llMinVtime = LLONG_MAX;
+    int iFree = -1;
+
+    for (int i = 0; i < ARB_MAX_CLIENT; i++) {
+        if (arbClient[i].pid == pid)
+            return i;
+
+        if (arbClient[i].pid == 0) {
+            if (iFree < 0)
+                iFree = i;
+        } else if (arbClient[i].vtimeUs < llMinVtime) {
+            llMinVtime = arbClient[i].vtimeUs;
+        }
+    }
+
+    if (iFree < 0)
+        return -1;
+
+    /* a newcomer neither starves the others nor is starved by its past */
+    memset(&arbClient[iFree], 0, sizeof(struct ARB_CLIENT));
+    arbClient[iFree].pid = pid;
+    arbClient[iFree].vtimeUs = (llMinVtime == LLONG_MAX) ? 0 : llMinVtime;
+
+    return iFree;
+}
+
+static long long arbVtime(int iClient)
+{
+    return (iClient < 0) ? 0 : arbClient[iClient].vtimeUs;
+}
+
+/* true when waiter A goes before waiter B */
+static bool arbBefore(const struct ARB_CONN *pA, const struct ARB_CONN *pB)
+{
+    if (pA->priority != pB->priority)
+        return pA->priority > pB->priority;
+
+    if (arbVtime(pA->client) != arbVtime(pB->client))
+        return arbVtime(pA->client) < arbVtime(pB->client);
+
+    return pA->ticket < pB->ticket;
+}
+
+/* the waiter to be served next, -1 when none */
+static int arbNext(void)
+{
+    int iBest = -1;
+
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        if (arbConn[i].state != ARB_STATE_WAITING)
+            continue;
+
+        if (iBest < 0 || arbBefore(&arbConn[i], &arbConn[iBest]) == true)
+            iBest = i;
+    }
+
+    return iBest;
+}
+
+/* true when a job of a priority above iPriority is queued */
+static bool arbHigherWaiting(int iPriority)
+{
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        if (arbConn[i].state == ARB_STATE_WAITING && arbConn[i].priority > iPriority)
+            return true;
+    }
+
+    return false;
+}
+
+/* jobs keeping the others out */
+static int arbOwnerJobs(void)
+{
+    int iJobs = 0;
+
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        if (arbConn[i].state == ARB_STATE_GRANTED)
+            iJobs++;
+    }
+
+    return iJobs;
+}
+
+static void arbSend(struct ARB_CONN *pConn, struct ARB_REPLY *pstReply)
+{
+    /* never blocks the arbiter, a client that does not read loses the answer */
+    send(pConn->fd, pstReply, sizeof(struct ARB_REPLY), MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+static void arbGrant(struct ARB_CONN *pConn, bool bArbitrated)
+{
+    struct ARB_REPLY stReply;
+    long long llNow = arbNowUs();
+
+    memset(&stReply, 0, sizeof(struct ARB_REPLY));
+    stReply.cmd = ARB_CMD_ACQUIRE;
+    stReply.result = bArbitrated;
+
+    if (bArbitrated == true) {
+        pConn->state = ARB_STATE_GRANTED;
+        pConn->startUs = llNow;
+        arbOwnerPid = pConn->pid;
+
+        if (0 <= pConn->client) {
+            struct ARB_CLIENT *pClient = &arbClient[pConn->client];
+            long long llWaitUs = llNow - pConn->enqueueUs;
+
+            pClient->numOfJobs++;
+            pClient->waitUs += llWaitUs;
+            if (pClient->maxWaitUs < llWaitUs)
+                pClient->maxWaitUs = llWaitUs;
+        }
+    } else {
+        pConn->state = ARB_STATE_IDLE;
+    }
+
+    arbSend(pConn, &stReply);
+}
+
+/* the job of pConn is done, or its client is gone */
+static void arbEnd(struct ARB_CONN *pConn)
+{
+    if (pConn->state == ARB_STATE_GRANTED || pConn->state == ARB_STATE_DETACHED) {
+        long long llBusy = arbNowUs() - pConn->startUs;
+        int iPriority = pConn->priority;
+
+        if (0 <= pConn->client) {
+            arbClient[pConn->client].busyUs += llBusy;
+            arbClient[pConn->client].vtimeUs += llBusy;
+        }
+
+        if (arbAvgJobUs[iPriority] == 0)
+            arbAvgJobUs[iPriority] = llBusy;
+        else
+            arbAvgJobUs[iPriority] += (llBusy - arbAvgJobUs[iPriority]) >> ARB_AVG_SHIFT;
+    }
+
+    pConn->state = ARB_STATE_IDLE;
+
+    if (arbOwnerJobs() == 0)
+        arbOwnerPid = 0;
+}
+
+/* grants every waiter that may run now */
+static void arbSchedule(void)
+{
+    bool bGranted;
+
+    do {
+        bGranted = false;
+
+        for (int i = 0; i < ARB_MAX_CONN; i++) {
+            struct ARB_CONN *pConn = &arbConn[i];
+
+            if (pConn->state != ARB_STATE_WAITING)
+                continue;
+
+            if ((arbOwnerJobs() == 0 && arbNext() == i) ||
+                (arbOwnerPid == pConn->pid && arbHigherWaiting(pConn->priority) == false)) {
+                arbGrant(pConn, true);
+                bGranted = true;
+            }
+        }
+    } while (bGranted == true);
+}
+
+static void arbAcquire(struct ARB_CONN *pConn, int iPriority)
+{
+    if (iPriority < ExynosJpegBase::PRIORITY_BACKGROUND)
+        iPriority = ExynosJpegBase::PRIORITY_BACKGROUND;
+    if (ExynosJpegBase::PRIORITY_MAX <= iPriority)
+        iPriority = ExynosJpegBase::PRIORITY_MAX - 1;
+
+    /* applications can not push the camera back */
+    if (AID_APP <= pConn->uid && ExynosJpegBase::PRIORITY_NORMAL < iPriority)
+        iPriority = ExynosJpegBase::PRIORITY_NORMAL;
+
+    /* one job per instance, a new request ends the previous one */
+    arbEnd(pConn);
+
+    pConn->state = ARB_STATE_WAITING;
+    pConn->priority = iPriority;
+    pConn->ticket = ++arbTicket;
+    pConn->enqueueUs = arbNowUs();
+
+    /*
+     * The owner queues behind a more urgent job: hand the block over first,
+     * the thread may still hold a job of the owner it reaps only after this
+     * one was queued.
+     */
+    if (arbOwnerPid == pConn->pid && arbHigherWaiting(iPriority) == true) {
+        for (int i = 0; i < ARB_MAX_CONN; i++) {
+            if (arbConn[i].state == ARB_STATE_GRANTED)
+                arbConn[i].state = ARB_STATE_DETACHED;
+        }
+        arbOwnerPid = 0;
+    }
+
+    arbSchedule();
+}
+
+static void arbStat(struct ARB_CONN *pConn, struct ExynosJpegBase::ARBITER_STAT *pstStat)
+{
+    long long llTotalBusy = 0;
+    long long llNow = arbNowUs();
+
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        struct ARB_CONN *pOther = &arbConn[i];
+
+        /* what is left of the running jobs */
+        if (pOther->state == ARB_STATE_GRANTED) {
+            long long llLeft = arbAvgJobUs[pOther->priority] - (llNow - pOther->startUs);
+            if (0 < llLeft)
+                pstStat->estimatedWaitUs += llLeft;
+        }
+
+        /* and every queued job that would go before ours */
+        if (pOther->state == ARB_STATE_WAITING) {
+            pstStat->numOfWaiting++;
+            if (pOther->priority >= pConn->priority)
+                pstStat->estimatedWaitUs += arbAvgJobUs[pOther->priority];
+        }
+    }
+
+    for (int i = 0; i < ARB_MAX_CLIENT; i++) {
+        if (arbClient[i].pid != 0) {
+            pstStat->numOfClients++;
+            llTotalBusy += arbClient[i].busyUs;
+        }
+    }
+
+    if (0 <= pConn->client) {
+        struct ARB_CLIENT *pClient = &arbClient[pConn->client];
+
+        pstStat->numOfJobs = pClient->numOfJobs;
+        pstStat->busyUs = pClient->busyUs;
+        pstStat->waitUs = pClient->waitUs;
+        pstStat->maxWaitUs = pClient->maxWaitUs;
+        if (0 < llTotalBusy)
+            pstStat->sharePermille = (int)(pClient->busyUs * 1000 / llTotalBusy);
+    }
+}
+
+static void arbRequest(struct ARB_CONN *pConn, struct ARB_REQUEST *pstReq)
+{
+    struct ARB_REPLY stReply;
+
+    memset(&stReply, 0, sizeof(struct ARB_REPLY));
+    stReply.cmd = pstReq->cmd;
+
+    switch (pstReq->cmd) {
+    case ARB_CMD_ACQUIRE:
+        arbAcquire(pConn, pstReq->priority);
+        break;
+    case ARB_CMD_RELEASE:
+        arbEnd(pConn);
+        arbSchedule();
+        break;
+    case ARB_CMD_YIELD:
+        stReply.result = (pConn->state == ARB_STATE_GRANTED &&
+                          arbHigherWaiting(pConn->priority) == true);
+        arbSend(pConn, &stReply);
+        break;
+    case ARB_CMD_STAT:
+        arbStat(pConn, &stReply.stat);
+        arbSend(pConn, &stReply);
+        break;
+    default:
+        break;
+    }
+}
+
+static void arbAccept(int iListenFd)
+{
+    struct ARB_CONN *pConn = NULL;
+    struct ucred stCred;
+    socklen_t iLen = sizeof(struct ucred);
+    int iFd;
+
+    iFd = accept(iListenFd, NULL, NULL);
+    if (iFd < 0)
+        return;
+
+    if (getsockopt(iFd, SOL_SOCKET, SO_PEERCRED, &stCred, &iLen) < 0) {
+        close(iFd);
+        return;
+    }
+
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        if (arbConn[i].fd < 0) {
+            pConn = &arbConn[i];
+            break;
+        }
+    }
+
+    /* the client runs unarbitrated */
+    if (pConn == NULL) {
+        JPEG_ERROR_LOG("[%s]: no connection left for pid %d\n", __func__, stCred.pid);
+        close(iFd);
+        return;
+    }
+
+    memset(pConn, 0, sizeof(struct ARB_CONN));
+    pConn->fd = iFd;
+    pConn->pid = stCred.pid;
+    pConn->uid = stCred.uid;
+    pConn->client = arbSrvClient(stCred.pid);
+    if (0 <= pConn->client)
+        arbClient[pConn->client].numOfConns++;
+}
+
+static void arbClose(struct ARB_CONN *pConn)
+{
+    arbEnd(pConn);
+
+    if (0 <= pConn->client && --arbClient[pConn->client].numOfConns == 0)
+        memset(&arbClient[pConn->client], 0, sizeof(struct ARB_CLIENT));
+
+    close(pConn->fd);
+    memset(pConn, 0, sizeof(struct ARB_CONN));
+    pConn->fd = -1;
+}
+
+/* true while a deadline is pending */
+static bool arbDeadlines(void)
+{
+    long long llNow = arbNowUs();
+    bool bPending = false;
+
+    for (int i = 0; i < ARB_MAX_CONN; i++) {
+        struct ARB_CONN *pConn = &arbConn[i];
+
+        if (pConn->state == ARB_STATE_GRANTED) {
+            if (llNow - pConn->startUs >= ARB_HOLD_MAX_MS * 1000LL) {
+                ALOGD("[%s]: pid %d holds the block for %d ms", __func__, pConn->pid, ARB_HOLD_MAX_MS);
+                pConn->state = ARB_STATE_DETACHED;
+                if (arbOwnerJobs() == 0)
+                    arbOwnerPid = 0;
+            } else {
+                bPending = true;
+            }
+        } else if (pConn->state == ARB_STATE_WAITING) {
+            if (llNow - pConn->enqueueUs >= ARB_WAIT_MAX_MS * 1000LL) {
+                JPEG_ERROR_LOG("[%s]: pid %d waited %d ms, not arbitrated\n",
+                               __func__, pConn->pid, ARB_WAIT_MAX_MS);
+                arbGrant(pConn, false);
+            } else {
+                bPending = true;
+            }
+        }
+    }
+
+    return bPending;
+}
+
+static void *arbMain(void *pArg)
+{
+    int iListenFd = (int)(long)pArg;
+    struct pollfd astPoll[ARB_MAX_CONN + 1];
+    bool bPending = false;
+
+    for (int i = 0; i < ARB_MAX_CONN; i++)
+        arbConn[i].fd = -1;
+
+    while (1) {
+        astPoll[0].fd = iListenFd;
+        astPoll[0].events = POLLIN;
+        astPoll[0].revents = 0;
+        for (int i = 0; i < ARB_MAX_CONN; i++) {
+            astPoll[i + 1].fd = arbConn[i].fd;
+            astPoll[i + 1].events = POLLIN;
+            astPoll[i + 1].revents = 0;
+        }
+
+        if (poll(astPoll, ARB_MAX_CONN + 1, bPending ? ARB_WAIT_SLICE_MS : -1) < 0 && errno != EINTR) {
+            JPEG_ERROR_LOG("[%s]: poll failed(%s)\n", __func__, strerror(errno));
+            usleep(ARB_WAIT_SLICE_MS * 1000);
+        }
+
+        for (int i = 0; i < ARB_MAX_CONN; i++) {
+            struct ARB_REQUEST stReq;
+
+            if (astPoll[i + 1].revents == 0)
+                continue;
+
+            if ((astPoll[i + 1].revents & POLLIN) &&
+                recv(arbConn[i].fd, &stReq, sizeof(stReq), MSG_DONTWAIT) == sizeof(stReq)) {
+                arbRequest(&arbConn[i], &stReq);
+                continue;
+            }
+
+            /* gone, or not talking our protocol */
+            arbClose(&arbConn[i]);
+            arbSchedule();
+        }
+
+        if (astPoll[0].revents & POLLIN)
+            arbAccept(iListenFd);
+
+        bPending = arbDeadlines();
+        arbSchedule();
+    }
+
+    return NULL;
+}
+
+/* the client side: connects to the arbiter, -1 when there is none */
+static int arbConnect(void)
+{
+    struct sockaddr_un stAddr;
+    struct ucred stCred;
+    socklen_t iLen = sizeof(struct ucred);
+    socklen_t iAddrLen;
+    int iFd;
+
+    pthread_mutex_lock(&arbLock);
+    if (arbName == NULL) {
+        pthread_mutex_unlock(&arbLock);
+        return -1;
+    }
+    iAddrLen = arbAddr(arbName, &stAddr);
+    pthread_mutex_unlock(&arbLock);
+
+    iFd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (iFd < 0)
+        return -1;
+
+    fcntl(iFd, F_SETFD, FD_CLOEXEC);
+
+    if (connect(iFd, (struct sockaddr *)&stAddr, iAddrLen) < 0) {
+        close(iFd);
+        return -1;
+    }
+
+    /* anybody may bind the name first, only a system process is obeyed */
+    if (getsockopt(iFd, SOL_SOCKET, SO_PEERCRED, &stCred, &iLen) < 0 || AID_APP <= stCred.uid) {
+        JPEG_ERROR_LOG("[%s]: arbiter is not a system process, not arbitrated\n", __func__);
+        close(iFd);
+        return -1;
+    }
+
+    return iFd;
+}
+
+/* sends a request and waits for its answer when pstReply is set */
+static int arbCall(int iFd, int iCmd, int iPriority, struct ARB_REPLY *pstReply, int iTimeoutMs)
+{
+    struct ARB_REQUEST stReq;
+    struct pollfd stPoll;
+    int iRet;
+
+    stReq.cmd = iCmd;
+    stReq.priority = iPriority;
+
+    if (send(iFd, &stReq, sizeof(stReq), MSG_NOSIGNAL) != sizeof(stReq))
+        return -1;
+
+    if (pstReply == NULL)
+        return 0;
+
+    stPoll.fd = iFd;
+    stPoll.events = POLLIN;
+    stPoll.revents = 0;
+
+    do {
+        iRet = poll(&stPoll, 1, iTimeoutMs);
+    } while (iRet < 0 && errno == EINTR);
+
+    if (iRet <= 0 ||
+        recv(iFd, pstReply, sizeof(struct ARB_REPLY), 0) != sizeof(struct ARB_REPLY) ||
+        pstReply->cmd != iCmd)
+        return -1;
+
+    return 0;
+}
+
+void ExynosJpegBase::setArbiterName(const char *pcName)
+{
+    pthread_mutex_lock(&arbLock);
+    arbName = pcName;
+    pthread_mutex_unlock(&arbLock);
+}
+
+int ExynosJpegBase::startArbiter(void)
+{
+    struct sockaddr_un stAddr;
+    pthread_attr_t stAttr;
+    pthread_t thread;
+    int iFd;
+
+    pthread_mutex_lock(&arbLock);
+
+    if (arbRunning == true || arbName == NULL) {
+        pthread_mutex_unlock(&arbLock);
+        return (arbRunning == true) ? ERROR_NONE : ERROR_FAIL;
+    }
+
+    iFd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (iFd < 0) {
+        JPEG_ERROR_LOG("[%s]: socket failed(%s)\n", __func__, strerror(errno));
+        pthread_mutex_unlock(&arbLock);
+        return ERROR_FAIL;
+    }
+
+    fcntl(iFd, F_SETFD, FD_CLOEXEC);
+
+    if (bind(iFd, (struct sockaddr *)&stAddr, arbAddr(arbName, &stAddr)) < 0 ||
+        listen(iFd, ARB_MAX_CONN) < 0) {
+        JPEG_ERROR_LOG("[%s]: %s: %s\n", __func__, arbName, strerror(errno));
+        close(iFd);
+        pthread_mutex_unlock(&arbLock);
+        return ERROR_FAIL;
+    }
+
+    pthread_attr_init(&stAttr);
+    pthread_attr_setdetachstate(&stAttr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &stAttr, arbMain, (void *)(long)iFd) != 0) {
+        JPEG_ERROR_LOG("[%s]: pthread_create failed\n", __func__);
+        pthread_attr_destroy(&stAttr);
+        close(iFd);
+        pthread_mutex_unlock(&arbLock);
+        return ERROR_FAIL;
+    }
+    pthread_attr_destroy(&stAttr);
+
+    arbRunning = true;
+
+    pthread_mutex_unlock(&arbLock);
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegBase::setPriority(int iPriority)
+{
+    if (iPriority < PRIORITY_BACKGROUND || PRIORITY_MAX <= iPriority)
+        return ERROR_INVALID_JPEG_CONFIG;
+
+    t_iPriority = iPriority;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegBase::t_arbiterAcquire(void)
+{
+    struct ARB_REPLY stReply;
+
+    if (t_bFlagArbiter == true)
+        return ERROR_NONE;
+
+    if (t_iArbiterFd < 0) {
+        t_iArbiterFd = arbConnect();
+        if (t_iArbiterFd < 0)
+            return ERROR_NONE;
+    }
+
+    /* the arbiter answers within ARB_WAIT_MAX_MS, one slice more for the answer itself */
+    if (arbCall(t_iArbiterFd, ARB_CMD_ACQUIRE, t_iPriority, &stReply,
+                ARB_WAIT_MAX_MS + ARB_WAIT_SLICE_MS) < 0) {
+        JPEG_ERROR_LOG("[%s]: no answer from the arbiter, not arbitrated\n", __func__);
+        t_arbiterClose();
+        return ERROR_NONE;
+    }
+
+    t_bFlagArbiter = (stReply.result != 0);
+
+    return ERROR_NONE;
+}
+
+void ExynosJpegBase::t_arbiterRelease(void)
+{
+    if (t_bFlagArbiter == false)
+        return;
+
+    t_bFlagArbiter = false;
+
+    if (arbCall(t_iArbiterFd, ARB_CMD_RELEASE, 0, NULL, 0) < 0)
+        t_arbiterClose();
+}
+
+bool ExynosJpegBase::t_arbiterYield(void)
+{
+    struct ARB_REPLY stReply;
+
+    if (t_bFlagArbiter == false)
+        return false;
+
+    if (arbCall(t_iArbiterFd, ARB_CMD_YIELD, 0, &stReply, ARB_REPLY_TIMEOUT_MS) < 0) {
+        /* the closed connection gives the block back */
+        t_arbiterClose();
+        return false;
+    }
+
+    return (stReply.result != 0);
+}
+
+void ExynosJpegBase::t_arbiterClose(void)
+{
+    if (0 <= t_iArbiterFd)
+        close(t_iArbiterFd);
+
+    t_iArbiterFd = -1;
+    t_bFlagArbiter = false;
+}
+
+int ExynosJpegBase::getArbiterStat(struct ARBITER_STAT *pstStat)
+{
+    struct ARB_REPLY stReply;
+
+    memset(pstStat, 0, sizeof(struct ARBITER_STAT));
+
+    if (t_iArbiterFd < 0)
+        t_iArbiterFd = arbConnect();
+
+    if (t_iArbiterFd < 0)
+        return ERROR_FAIL;
+
+    if (arbCall(t_iArbiterFd, ARB_CMD_STAT, t_iPriority, &stReply, ARB_REPLY_TIMEOUT_MS) < 0) {
+        t_arbiterClose();
+        return ERROR_FAIL;
+    }
+
+    memcpy(pstStat, &stReply.stat, sizeof(struct ARBITER_STAT));
+
+    return ERROR_NONE;
+}
@@ -48,10 +48,14 @@ ExynosJpegBase::ExynosJpegBase()
     t_bFlagCreateOutBuf = false;
     t_bFlagExcute = false;
     t_bFlagSelect = false;
+    t_bFlagSubmit = false;
     t_iCacheValue = 0;
     t_iSelectNode = 0; // 0:jpeg2 hx , 1:jpeg2 hx , 2:jpeg hx;
     t_iPlaneNum = 0;
     t_iJpegFd = 0;
+    t_iPriority = PRIORITY_NORMAL;
+    t_iArbiterFd = -1;
+    t_bFlagArbiter = false;
 }
 
 ExynosJpegBase::~ExynosJpegBase()
@@ -63,7 +67,7 @@ int ExynosJpegBase::t_v4l2Querycap(int iFd)
     struct v4l2_capability cap;
     int iRet = ERROR_NONE;
 
-    iRet = ioctl(iFd, VIDIOC_QUERYCAP, &cap);
+    iRet = t_devIoctl(iFd, VIDIOC_QUERYCAP, &cap);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_QUERYCAP failed\n", __func__, iRet);
         return iRet;
@@ -79,7 +83,7 @@ int ExynosJpegBase::t_v4l2SetJpegcomp(int iFd, int iQuality)
 
     arg.quality = iQuality;
 
-    iRet = ioctl(iFd, VIDIOC_S_JPEGCOMP, &arg);
+    iRet = t_devIoctl(iFd, VIDIOC_S_JPEGCOMP, &arg);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_S_JPEGCOMP failed\n", __func__, iRet);
         return iRet;
@@ -128,7 +132,7 @@ int ExynosJpegBase::t_v4l2SetFmt(int iFd, enum v4l2_buf_type eType, struct CONFI
         return ERROR_INVALID_V4l2_BUF_TYPE;
     }
 
-    iRet = ioctl(iFd, VIDIOC_S_FMT, &fmt);
+    iRet = t_devIoctl(iFd, VIDIOC_S_FMT, &fmt);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_S_FMT failed\n", __func__, iRet);
         return iRet;
@@ -143,7 +147,7 @@ int ExynosJpegBase::t_v4l2GetFmt(int iFd, enum v4l2_buf_type eType, struct CONFI
     int iRet = ERROR_NONE;
 
     fmt.type = eType;
-    iRet = ioctl(iFd, VIDIOC_G_FMT, &fmt);
+    iRet = t_devIoctl(iFd, VIDIOC_G_FMT, &fmt);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_G_FMT failed\n", __func__, iRet);
         return iRet;
@@ -189,7 +193,7 @@ int ExynosJpegBase::t_v4l2Reqbufs(int iFd, int iBufCount, struct BUF_INFO *pstBu
     req.memory = pstBufInfo->memory;
     req.count = iBufCount;
 
-    iRet = ioctl(iFd, VIDIOC_REQBUFS, &req);
+    iRet = t_devIoctl(iFd, VIDIOC_REQBUFS, &req);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_REQBUFS failed\n", __func__, iRet);
         return iRet;
@@ -212,7 +216,7 @@ int ExynosJpegBase::t_v4l2Querybuf(int iFd, struct BUF_INFO *pstBufInfo, struct
     v4l2_buf.length = pstBufInfo->numOfPlanes;
     v4l2_buf.m.planes = plane;
 
-    iRet = ioctl(iFd, VIDIOC_QUERYBUF, &v4l2_buf);
+    iRet = t_devIoctl(iFd, VIDIOC_QUERYBUF, &v4l2_buf);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: VIDIOC_QUERYBUF failed\n", __func__, iRet);
         return iRet;
@@ -220,7 +224,7 @@ int ExynosJpegBase::t_v4l2Querybuf(int iFd, struct BUF_INFO *pstBufInfo, struct
 
     for (unsigned int i= 0; i < v4l2_buf.length; i++) {
         pstBuf->size[i] = v4l2_buf.m.planes[i].length;
-        pstBuf->c_addr[i] = (char *)mmap(0, pstBuf->size[i],
+        pstBuf->c_addr[i] = (char *)t_devMmap(0, pstBuf->size[i],
                         PROT_READ | PROT_WRITE, MAP_SHARED, iFd,
                         v4l2_buf.m.planes[i].m.mem_offset);
 
@@ -235,7 +239,7 @@ int ExynosJpegBase::t_v4l2Querybuf(int iFd, struct BUF_INFO *pstBufInfo, struct
     return iRet;
 }
 
-int ExynosJpegBase::t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFFER *pstBuf)
+int ExynosJpegBase::t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFFER *pstBuf, int iIndex)
 {
     struct v4l2_buffer v4l2_buf;
     struct v4l2_plane plane[JPEG_MAX_PLANE_CNT];
@@ -244,7 +248,7 @@ int ExynosJpegBase::t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFF
     memset(&v4l2_buf, 0, sizeof(struct v4l2_buffer));
     memset(plane, 0, (int)JPEG_MAX_PLANE_CNT * sizeof(struct v4l2_plane));
 
-    v4l2_buf.index = 0;
+    v4l2_buf.index = iIndex;
     v4l2_buf.type = pstBufInfo->buf_type;
     v4l2_buf.memory = pstBufInfo->memory;
     v4l2_buf.field = V4L2_FIELD_ANY;
@@ -265,7 +269,7 @@ int ExynosJpegBase::t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFF
         }
     }
 
-    iRet = ioctl(iFd, VIDIOC_QBUF, &v4l2_buf);
+    iRet = t_devIoctl(iFd, VIDIOC_QBUF, &v4l2_buf);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d] VIDIOC_QBUF failed\n", __func__, iRet);
         pstBuf->numOfPlanes = 0;
@@ -275,7 +279,8 @@ int ExynosJpegBase::t_v4l2Qbuf(int iFd, struct BUF_INFO *pstBufInfo, struct BUFF
     return iRet;
 }
 
-int ExynosJpegBase::t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_memory eMemory, int iNumPlanes)
+int ExynosJpegBase::t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_memory eMemory, int iNumPlanes,
+                                int *piIndex, bool *pbError)
 {
     struct v4l2_buffer buf;
     struct v4l2_plane planes[3];
@@ -289,7 +294,7 @@ int ExynosJpegBase::t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_mem
     buf.length = iNumPlanes;
     buf.m.planes = planes;
 
-    iRet = ioctl(iFd, VIDIOC_DQBUF, &buf);
+    iRet = t_devIoctl(iFd, VIDIOC_DQBUF, &buf);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d] VIDIOC_DQBUF failed\n", __func__, iRet);
         return iRet;
@@ -298,6 +303,11 @@ int ExynosJpegBase::t_v4l2Dqbuf(int iFd, enum v4l2_buf_type eType, enum v4l2_mem
     if (buf.flags & V4L2_BUF_FLAG_ERROR)
         JPEG_ERROR_LOG("[%s:%d] Buffer status is error\n", __func__, buf.flags);
 
+    if (piIndex != NULL)
+        *piIndex = buf.index;
+    if (pbError != NULL)
+        *pbError = (buf.flags & V4L2_BUF_FLAG_ERROR) ? true : false;
+
     if ((eType == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) && (t_stJpegConfig.mode == MODE_ENCODE))
         t_stJpegConfig.sizeJpeg = buf.m.planes[0].bytesused;
 
@@ -308,7 +318,7 @@ int ExynosJpegBase::t_v4l2StreamOn(int iFd, enum v4l2_buf_type eType)
 {
     int iRet = ERROR_NONE;
 
-    iRet = ioctl(iFd, VIDIOC_STREAMON, &eType);
+    iRet = t_devIoctl(iFd, VIDIOC_STREAMON, &eType);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d] VIDIOC_STREAMON failed\n", __func__, iRet);
         return iRet;
@@ -321,7 +331,7 @@ int ExynosJpegBase::t_v4l2StreamOff(int iFd, enum v4l2_buf_type eType)
 {
     int iRet = ERROR_NONE;
 
-    iRet = ioctl(iFd, VIDIOC_STREAMOFF, &eType);
+    iRet = t_devIoctl(iFd, VIDIOC_STREAMOFF, &eType);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d] VIDIOC_STREAMOFF failed\n", __func__, iRet);
         return iRet;
@@ -338,7 +348,7 @@ int ExynosJpegBase::t_v4l2SetCtrl(int iFd, int iCid, int iValue)
     vc.id = iCid;
     vc.value = iValue;
 
-    iRet = ioctl(iFd, VIDIOC_S_CTRL, &vc);
+    iRet = t_devIoctl(iFd, VIDIOC_S_CTRL, &vc);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s] VIDIOC_S_CTRL failed : cid(%d), value(%d)\n", __func__, iCid, iValue);
         return iRet;
@@ -354,7 +364,7 @@ int ExynosJpegBase::t_v4l2GetCtrl(int iFd, int iCid)
 
     ctrl.id = iCid;
 
-    iRet = ioctl(iFd, VIDIOC_G_CTRL, &ctrl);
+    iRet = t_devIoctl(iFd, VIDIOC_G_CTRL, &ctrl);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s] VIDIOC_G_CTRL failed : cid(%d)\n", __func__, ctrl.id);
         return iRet;
@@ -378,6 +388,7 @@ int ExynosJpegBase::create(enum MODE eMode)
     t_bFlagCreateOutBuf = false;
     t_bFlagExcute = false;
     t_bFlagSelect = false;
+    t_bFlagSubmit = false;
     t_iCacheValue = 0;
     t_iSelectNode = 0;
     t_iPlaneNum = 0;
@@ -396,7 +407,7 @@ int ExynosJpegBase::openJpeg(enum MODE eMode)
     iRet = t_v4l2Querycap(t_iJpegFd);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s]: QUERYCAP failed\n", __func__);
-        close(t_iJpegFd);
+        t_devClose(t_iJpegFd);
         return ERROR_CANNOT_OPEN_JPEG_DEVICE;
     }
 
@@ -428,11 +439,15 @@ int ExynosJpegBase::destroy(int iInBufs, int iOutBufs)
             t_v4l2Reqbufs(t_iJpegFd, 0, &stBufInfo);
         }
 
-        close(t_iJpegFd);
+        t_devClose(t_iJpegFd);
     }
 
+    /* the closed connection gives the block back */
+    t_arbiterClose();
+
     t_iJpegFd = -1;
     t_bFlagCreate = false;
+    t_bFlagSubmit = false;
     return ERROR_NONE;
 }
 
@@ -798,13 +813,32 @@ int ExynosJpegBase::updateConfig(enum MODE eMode, int iInBufs, int iOutBufs, int
 }
 
 int ExynosJpegBase::execute(int iInBufPlanes, int iOutBufPlanes)
+{
+    int iRet = submit(iInBufPlanes, iOutBufPlanes);
+    if (iRet != ERROR_NONE)
+        return iRet;
+
+    return reap(iInBufPlanes, iOutBufPlanes);
+}
+
+int ExynosJpegBase::submit(int iInBufPlanes, int iOutBufPlanes)
 {
     if (t_bFlagCreate == false)
         return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
 
+    if (t_bFlagSubmit == true) {
+        JPEG_ERROR_LOG("[%s]: previous job is not reaped yet\n", __func__);
+        return ERROR_EXCUTE_FAIL;
+    }
+
     struct BUF_INFO stBufInfo;
     int iRet = ERROR_NONE;
 
+    /* blocks while a job of another client is on the block */
+    iRet = t_arbiterAcquire();
+    if (iRet != ERROR_NONE)
+        return iRet;
+
     t_bFlagExcute = true;
 
     stBufInfo.numOfPlanes = iInBufPlanes;
@@ -814,7 +848,7 @@ int ExynosJpegBase::execute(int iInBufPlanes, int iOutBufPlanes)
     iRet = t_v4l2Qbuf(t_iJpegFd, &stBufInfo, &t_stJpegInbuf);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: Input QBUF failed\n", __func__, iRet);
-        return ERROR_EXCUTE_FAIL;
+        goto fail;
     }
 
     stBufInfo.numOfPlanes = iOutBufPlanes;
@@ -824,26 +858,53 @@ int ExynosJpegBase::execute(int iInBufPlanes, int iOutBufPlanes)
     iRet = t_v4l2Qbuf(t_iJpegFd, &stBufInfo, &t_stJpegOutbuf);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: Output QBUF failed\n", __func__, iRet);
-        return ERROR_EXCUTE_FAIL;
+        goto fail;
     }
 
     iRet = t_v4l2StreamOn(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: input stream on failed\n", __func__, iRet);
-        return ERROR_EXCUTE_FAIL;
+        goto fail;
     }
     iRet = t_v4l2StreamOn(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: output stream on failed\n", __func__, iRet);
-        return ERROR_EXCUTE_FAIL;
+        goto fail;
     }
 
+    t_bFlagSubmit = true;
+
+    return ERROR_NONE;
+
+fail:
+    t_arbiterRelease();
+
+    return ERROR_EXCUTE_FAIL;
+}
+
+int ExynosJpegBase::reap(int iInBufPlanes, int iOutBufPlanes)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagSubmit == false)
+        return ERROR_EXCUTE_FAIL;
+
+    int iRet = ERROR_NONE;
+
+    t_bFlagSubmit = false;
+
     iRet = t_v4l2Dqbuf(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, V4L2_MEMORY_MMAP, iInBufPlanes);
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: Intput DQBUF failed\n", __func__, iRet);
+        t_arbiterRelease();
         return ERROR_EXCUTE_FAIL;
     }
     iRet = t_v4l2Dqbuf(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, V4L2_MEMORY_MMAP, iOutBufPlanes);
+
+    /* the block is free once the result is back */
+    t_arbiterRelease();
+
     if (iRet < 0) {
         JPEG_ERROR_LOG("[%s:%d]: Output DQBUF failed\n", __func__, iRet);
         return ERROR_EXCUTE_FAIL;
@@ -852,3 +913,66 @@ int ExynosJpegBase::execute(int iInBufPlanes, int iOutBufPlanes)
     return ERROR_NONE;
 }
 
+int ExynosJpegBase::getPollFd(void)
+{
+    if (t_bFlagCreate == false || t_bFlagSubmit == false)
+        return -1;
+
+    return t_iJpegFd;
+}
+
+bool ExynosJpegBase::isSubmitted(void)
+{
+    return t_bFlagSubmit;
+}
+
+int ExynosJpegBase::waitDone(int iTimeoutMs)
+{
+    struct pollfd stPoll;
+    int iRet = 0;
+
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    /* nothing on the node, reap returns at once */
+    if (t_bFlagSubmit == false)
+        return ERROR_NONE;
+
+    stPoll.fd = t_iJpegFd;
+    stPoll.events = POLLIN | POLLRDNORM;
+    stPoll.revents = 0;
+
+    do {
+        iRet = poll(&stPoll, 1, iTimeoutMs);
+    } while (iRet < 0 && errno == EINTR);
+
+    if (iRet == 0) {
+        JPEG_ERROR_LOG("[%s]: timeout(%d msec)\n", __func__, iTimeoutMs);
+        return ERROR_EXCUTE_TIMEOUT;
+    }
+
+    if (iRet < 0 || (stPoll.revents & (POLLERR | POLLNVAL))) {
+        JPEG_ERROR_LOG("[%s]: poll failed(%d), revents(0x%x)\n", __func__, iRet, stPoll.revents);
+        return ERROR_EXCUTE_FAIL;
+    }
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegBase::cancel(void)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagSubmit == false)
+        return ERROR_NONE;
+
+    /* STREAMOFF waits for the running job and returns both buffers to us */
+    t_v4l2StreamOff(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+    t_v4l2StreamOff(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+
+    t_bFlagSubmit = false;
+    t_arbiterRelease();
+
+    return ERROR_NONE;
+}
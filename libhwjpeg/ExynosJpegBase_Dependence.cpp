@@ -101,10 +101,10 @@ int ExynosJpegBase::openNode(enum MODE eMode)
     case 1:
         switch (eMode) {
         case MODE_ENCODE:
-            t_iJpegFd = open(JPEG_ENC_NODE, O_RDWR, 0);
+            t_iJpegFd = t_devOpen(JPEG_ENC_NODE, O_RDWR);
             break;
         case MODE_DECODE:
-            t_iJpegFd = open(JPEG_DEC_NODE, O_RDWR, 0);
+            t_iJpegFd = t_devOpen(JPEG_DEC_NODE, O_RDWR);
             break;
         default:
             break;
@@ -113,10 +113,10 @@ int ExynosJpegBase::openNode(enum MODE eMode)
     case 2:
         switch (eMode) {
         case MODE_ENCODE:
-            t_iJpegFd = open(JPEG2_ENC_NODE, O_RDWR, 0);
+            t_iJpegFd = t_devOpen(JPEG2_ENC_NODE, O_RDWR);
             break;
         case MODE_DECODE:
-            t_iJpegFd = open(JPEG2_DEC_NODE, O_RDWR, 0);
+            t_iJpegFd = t_devOpen(JPEG2_DEC_NODE, O_RDWR);
             break;
         default:
             break;
@@ -0,0 +1,619 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * libhwjpeg benchmark.
+ *
+ * Sweeps resolution x color format x quality over encode and decode, in
+ * two session modes:
+ *  - cold : every call is create, configure, encode/decode and destroy,
+ *           as a one-shot user (capture, share) sees it.
+ *  - warm : one configured session, only encode()/decode() is timed, as a
+ *           user that keeps the encoder around sees it.
+ * For each case the per-call latency percentiles, throughput and the
+ * device layer counters (ioctls, bytes mapped) per call are written as
+ * JSON, one object per case, for regression tracking.
+ *
+ * -f runs against the fake M2M device, so the numbers of the library
+ * overhead can be tracked on any board, or on a host build.
+ *
+ * libhwjpeg_bench [-f] [-l latency_us] [-n iterations] [-w warmup]
+ *                 [-o enc|dec] [-m cold|warm] [-r vga,720p,...]
+ *                 [-c yuyv,nv21,...] [-q 96,92,...] [-j out.json]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegFakeDevice.h"
+
+#define BENCH_MAX_QUALITY       (8)
+#define BENCH_MAX_SAMPLE        (10000)
+
+struct BENCH_RES {
+    const char  *name;
+    int         width;
+    int         height;
+};
+
+struct BENCH_FMT {
+    const char  *name;
+    int         format;
+    int         jpegFormat;     /* subsampling the encode of this format uses */
+};
+
+static const struct BENCH_RES benchRes[] = {
+    { "vga",    640,  480  },
+    { "720p",   1280, 720  },
+    { "1080p",  1920, 1080 },
+    { "5mp",    2560, 1920 },
+    { "8mp",    3264, 2448 },
+    { "13mp",   4128, 3096 },
+};
+
+static const struct BENCH_FMT benchFmt[] = {
+    { "yuyv",   V4L2_PIX_FMT_YUYV,   V4L2_PIX_FMT_JPEG_422 },
+    { "nv21",   V4L2_PIX_FMT_NV21,   V4L2_PIX_FMT_JPEG_420 },
+    { "nv12",   V4L2_PIX_FMT_NV12,   V4L2_PIX_FMT_JPEG_420 },
+    { "yuv420", V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_JPEG_420 },
+    { "rgb32",  V4L2_PIX_FMT_RGB32,  V4L2_PIX_FMT_JPEG_422 },
+};
+
+#define BENCH_NUM_RES   (int)(sizeof(benchRes) / sizeof(benchRes[0]))
+#define BENCH_NUM_FMT   (int)(sizeof(benchFmt) / sizeof(benchFmt[0]))
+
+/* one per reachable ExynosJpegEncoder::setQuality() level */
+static const int benchDefaultQuality[] = { 96, 92, 75, 34, 20 };
+
+struct BENCH_OPT {
+    bool    bFake;
+    int     iFakeLatencyUs;
+    int     iIter;
+    int     iWarmup;
+    bool    bEncode;
+    bool    bDecode;
+    bool    bCold;
+    bool    bWarm;
+    bool    bRes[BENCH_NUM_RES];
+    bool    bFmt[BENCH_NUM_FMT];
+    int     iQuality[BENCH_MAX_QUALITY];
+    int     iNumOfQuality;
+    FILE    *pOut;
+};
+
+struct BENCH_CASE {
+    bool                    bDecode;
+    bool                    bWarm;
+    const struct BENCH_RES  *pstRes;
+    const struct BENCH_FMT  *pstFmt;
+    int                     iQuality;
+};
+
+struct BENCH_RESULT {
+    int         iStatus;
+    int         iJpegSize;
+    int         iNumOfSample;
+    long long   llSampleUs[BENCH_MAX_SAMPLE];
+    long long   llTotalUs;
+    struct ExynosJpegBase::DEVICE_STAT stStat;
+};
+
+/* buffers of one case */
+struct BENCH_BUF {
+    char    *pcRaw;
+    int     iRawSize;
+    char    *pcJpeg;
+    int     iJpegBufSize;
+    int     iJpegSize;
+};
+
+static long long benchNowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/* gradient with noise, compresses like a camera frame rather than flat */
+static void benchFillPattern(char *pcBuf, int iSize, int iW)
+{
+    unsigned int uSeed = 0x12345678;
+
+    for (int i = 0; i < iSize; i++) {
+        uSeed = uSeed * 1103515245 + 12345;
+        pcBuf[i] = (char)((((i % iW) + (i / iW)) >> 2) + ((uSeed >> 16) & 0x0F));
+    }
+}
+
+static int benchRawSize(int iFormat, int iW, int iH)
+{
+    switch (iFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        return iW * iH * 2;
+    case V4L2_PIX_FMT_RGB32:
+        return iW * iH * 4;
+    default:
+        return (iW * iH * 3) >> 1;
+    }
+}
+
+static int benchEncodeOpen(ExynosJpegEncoder *pEnc, const struct BENCH_CASE *pstCase,
+                           int iFormat, int iJpegFormat, struct BENCH_BUF *pstBuf)
+{
+    char *pcIn[1] = { pstBuf->pcRaw };
+    int iInSize[1] = { benchRawSize(iFormat, pstCase->pstRes->width, pstCase->pstRes->height) };
+    int iRet;
+
+    if ((iRet = pEnc->create()) != ExynosJpegBase::ERROR_NONE)
+        return iRet;
+
+    if ((iRet = pEnc->setColorFormat(iFormat)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->setJpegFormat(iJpegFormat)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->setSize(pstCase->pstRes->width, pstCase->pstRes->height)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->setQuality(pstCase->iQuality)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->setInBuf(pcIn, iInSize)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->setOutBuf(pstBuf->pcJpeg, pstBuf->iJpegBufSize)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pEnc->updateConfig()) != ExynosJpegBase::ERROR_NONE) {
+        pEnc->destroy();
+        return iRet;
+    }
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+static int benchDecodeOpen(ExynosJpegDecoder *pDec, const struct BENCH_CASE *pstCase,
+                           struct BENCH_BUF *pstBuf)
+{
+    char *pcOut[1] = { pstBuf->pcRaw };
+    int iOutSize[1] = { pstBuf->iRawSize };
+    int iW = pstCase->pstRes->width;
+    int iH = pstCase->pstRes->height;
+    int iRet;
+
+    if ((iRet = pDec->create()) != ExynosJpegBase::ERROR_NONE)
+        return iRet;
+
+    if ((iRet = pDec->setColorFormat(pstCase->pstFmt->format)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setJpegFormat(V4L2_PIX_FMT_JPEG_420)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setSize(iW, iH)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setScaledSize(iW, iH)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setJpegSize(pstBuf->iJpegSize)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setInBuf(pstBuf->pcJpeg, pstBuf->iJpegSize)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->setOutBuf(pcOut, iOutSize)) != ExynosJpegBase::ERROR_NONE ||
+        (iRet = pDec->updateConfig()) != ExynosJpegBase::ERROR_NONE) {
+        pDec->destroy();
+        return iRet;
+    }
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+/* one timed call, cold calls include the session setup and teardown */
+static int benchRunOnce(const struct BENCH_CASE *pstCase, struct BENCH_BUF *pstBuf,
+                        ExynosJpegEncoder *pEnc, ExynosJpegDecoder *pDec)
+{
+    int iRet;
+
+    if (pstCase->bDecode == false) {
+        if (pstCase->bWarm == false) {
+            iRet = benchEncodeOpen(pEnc, pstCase, pstCase->pstFmt->format,
+                                   pstCase->pstFmt->jpegFormat, pstBuf);
+            if (iRet != ExynosJpegBase::ERROR_NONE)
+                return iRet;
+        }
+
+        iRet = pEnc->encode();
+        pstBuf->iJpegSize = pEnc->getJpegSize();
+
+        if (pstCase->bWarm == false)
+            pEnc->destroy();
+    } else {
+        if (pstCase->bWarm == false) {
+            iRet = benchDecodeOpen(pDec, pstCase, pstBuf);
+            if (iRet != ExynosJpegBase::ERROR_NONE)
+                return iRet;
+        }
+
+        iRet = pDec->decode();
+
+        if (pstCase->bWarm == false)
+            pDec->destroy();
+    }
+
+    return iRet;
+}
+
+static void benchStatDiff(struct ExynosJpegBase::DEVICE_STAT *pstDst,
+                          const struct ExynosJpegBase::DEVICE_STAT *pstA,
+                          const struct ExynosJpegBase::DEVICE_STAT *pstB)
+{
+    pstDst->numOfOpen = pstB->numOfOpen - pstA->numOfOpen;
+    pstDst->numOfIoctl = pstB->numOfIoctl - pstA->numOfIoctl;
+    pstDst->numOfSetFmt = pstB->numOfSetFmt - pstA->numOfSetFmt;
+    pstDst->numOfReqbufs = pstB->numOfReqbufs - pstA->numOfReqbufs;
+    pstDst->numOfQbuf = pstB->numOfQbuf - pstA->numOfQbuf;
+    pstDst->numOfDqbuf = pstB->numOfDqbuf - pstA->numOfDqbuf;
+    pstDst->numOfStreamOn = pstB->numOfStreamOn - pstA->numOfStreamOn;
+    pstDst->numOfStreamOff = pstB->numOfStreamOff - pstA->numOfStreamOff;
+    pstDst->bytesMapped = pstB->bytesMapped - pstA->bytesMapped;
+}
+
+static void benchRunCase(const struct BENCH_OPT *pstOpt, const struct BENCH_CASE *pstCase,
+                         struct BENCH_RESULT *pstResult)
+{
+    ExynosJpegEncoder enc;
+    ExynosJpegDecoder dec;
+    struct ExynosJpegBase::DEVICE_STAT stBefore, stAfter;
+    struct BENCH_BUF stBuf;
+    int iW = pstCase->pstRes->width;
+    int iH = pstCase->pstRes->height;
+    int iRet = ExynosJpegBase::ERROR_NONE;
+    long long llStart;
+
+    memset(pstResult, 0, sizeof(struct BENCH_RESULT));
+    memset(&stBuf, 0, sizeof(struct BENCH_BUF));
+
+    stBuf.iRawSize = benchRawSize(pstCase->pstFmt->format, iW, iH);
+    stBuf.iJpegBufSize = iW * iH * 2;
+    stBuf.pcRaw = (char *)malloc(stBuf.iRawSize);
+    stBuf.pcJpeg = (char *)malloc(stBuf.iJpegBufSize);
+    if (stBuf.pcRaw == NULL || stBuf.pcJpeg == NULL) {
+        pstResult->iStatus = ExynosJpegBase::ERROR_OUT_BUFFER_CREATE_FAIL;
+        goto done;
+    }
+
+    /* decode input is a 4:2:0 picture of the same pattern at the case quality */
+    if (pstCase->bDecode == true) {
+        char *pcSrc = (char *)malloc(benchRawSize(V4L2_PIX_FMT_NV21, iW, iH));
+        struct BENCH_BUF stSrc = stBuf;
+
+        if (pcSrc == NULL) {
+            pstResult->iStatus = ExynosJpegBase::ERROR_IN_BUFFER_CREATE_FAIL;
+            goto done;
+        }
+
+        benchFillPattern(pcSrc, benchRawSize(V4L2_PIX_FMT_NV21, iW, iH), iW);
+        stSrc.pcRaw = pcSrc;
+
+        iRet = benchEncodeOpen(&enc, pstCase, V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_JPEG_420, &stSrc);
+        if (iRet == ExynosJpegBase::ERROR_NONE) {
+            iRet = enc.encode();
+            stBuf.iJpegSize = enc.getJpegSize();
+            enc.destroy();
+        }
+        free(pcSrc);
+
+        if (iRet != ExynosJpegBase::ERROR_NONE || stBuf.iJpegSize <= 0) {
+            pstResult->iStatus = (iRet != ExynosJpegBase::ERROR_NONE) ? iRet : ExynosJpegBase::ERROR_EXCUTE_FAIL;
+            goto done;
+        }
+    } else {
+        benchFillPattern(stBuf.pcRaw, stBuf.iRawSize, iW);
+    }
+
+    if (pstCase->bWarm == true) {
+        if (pstCase->bDecode == false)
+            iRet = benchEncodeOpen(&enc, pstCase, pstCase->pstFmt->format,
+                                   pstCase->pstFmt->jpegFormat, &stBuf);
+        else
+            iRet = benchDecodeOpen(&dec, pstCase, &stBuf);
+
+        if (iRet != ExynosJpegBase::ERROR_NONE) {
+            pstResult->iStatus = iRet;
+            goto done;
+        }
+    }
+
+    for (int i = 0; i < pstOpt->iWarmup; i++) {
+        iRet = benchRunOnce(pstCase, &stBuf, &enc, &dec);
+        if (iRet != ExynosJpegBase::ERROR_NONE) {
+            pstResult->iStatus = iRet;
+            goto close;
+        }
+    }
+
+    ExynosJpegBase::getDeviceStat(&stBefore);
+    llStart = benchNowUs();
+
+    for (int i = 0; i < pstOpt->iIter; i++) {
+        long long llCall = benchNowUs();
+
+        iRet = benchRunOnce(pstCase, &stBuf, &enc, &dec);
+        if (iRet != ExynosJpegBase::ERROR_NONE) {
+            pstResult->iStatus = iRet;
+            break;
+        }
+
+        pstResult->llSampleUs[pstResult->iNumOfSample++] = benchNowUs() - llCall;
+    }
+
+    pstResult->llTotalUs = benchNowUs() - llStart;
+    ExynosJpegBase::getDeviceStat(&stAfter);
+    benchStatDiff(&pstResult->stStat, &stBefore, &stAfter);
+
+    pstResult->iJpegSize = stBuf.iJpegSize;
+
+close:
+    if (pstCase->bWarm == true) {
+        if (pstCase->bDecode == false)
+            enc.destroy();
+        else
+            dec.destroy();
+    }
+
+done:
+    free(stBuf.pcRaw);
+    free(stBuf.pcJpeg);
+}
+
+static int benchCompare(const void *pA, const void *pB)
+{
+    long long llA = *(const long long *)pA;
+    long long llB = *(const long long *)pB;
+
+    return (llA < llB) ? -1 : (llA > llB) ? 1 : 0;
+}
+
+/* nearest rank, samples sorted */
+static long long benchPercentile(const struct BENCH_RESULT *pstResult, int iPercent)
+{
+    int iRank = (pstResult->iNumOfSample * iPercent + 99) / 100;
+
+    if (pstResult->iNumOfSample == 0)
+        return 0;
+
+    if (iRank < 1)
+        iRank = 1;
+
+    return pstResult->llSampleUs[iRank - 1];
+}
+
+static void benchPrintResult(const struct BENCH_OPT *pstOpt, const struct BENCH_CASE *pstCase,
+                             struct BENCH_RESULT *pstResult, bool bFirst)
+{
+    const struct ExynosJpegBase::DEVICE_STAT *pstStat = &pstResult->stStat;
+    int iN = pstResult->iNumOfSample;
+    double dMpix = (double)pstCase->pstRes->width * pstCase->pstRes->height / 1000000.0;
+    double dSec = (double)pstResult->llTotalUs / 1000000.0;
+    long long llSum = 0;
+
+    qsort(pstResult->llSampleUs, iN, sizeof(long long), benchCompare);
+    for (int i = 0; i < iN; i++)
+        llSum += pstResult->llSampleUs[i];
+
+    fprintf(pstOpt->pOut,
+        "%s    {\"op\": \"%s\", \"mode\": \"%s\", \"resolution\": \"%s\", \"width\": %d, \"height\": %d, "
+        "\"format\": \"%s\", \"quality\": %d, \"status\": %d, \"jpeg_size\": %d, \"calls\": %d,\n"
+        "     \"latency_us\": {\"mean\": %lld, \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"max\": %lld},\n"
+        "     \"calls_per_sec\": %.2f, \"mpix_per_sec\": %.2f,\n"
+        "     \"per_call\": {\"open\": %.2f, \"ioctl\": %.2f, \"s_fmt\": %.2f, \"reqbufs\": %.2f, "
+        "\"qbuf\": %.2f, \"dqbuf\": %.2f, \"streamon\": %.2f, \"streamoff\": %.2f},\n"
+        "     \"bytes_mapped\": %llu}",
+        bFirst ? "" : ",\n",
+        pstCase->bDecode ? "decode" : "encode", pstCase->bWarm ? "warm" : "cold",
+        pstCase->pstRes->name, pstCase->pstRes->width, pstCase->pstRes->height,
+        pstCase->pstFmt->name, pstCase->iQuality, pstResult->iStatus, pstResult->iJpegSize, iN,
+        iN ? llSum / iN : 0,
+        benchPercentile(pstResult, 50), benchPercentile(pstResult, 90),
+        benchPercentile(pstResult, 99), iN ? pstResult->llSampleUs[iN - 1] : 0,
+        (0 < dSec) ? iN / dSec : 0.0, (0 < dSec) ? iN * dMpix / dSec : 0.0,
+        iN ? (double)pstStat->numOfOpen / iN : 0.0,
+        iN ? (double)pstStat->numOfIoctl / iN : 0.0,
+        iN ? (double)pstStat->numOfSetFmt / iN : 0.0,
+        iN ? (double)pstStat->numOfReqbufs / iN : 0.0,
+        iN ? (double)pstStat->numOfQbuf / iN : 0.0,
+        iN ? (double)pstStat->numOfDqbuf / iN : 0.0,
+        iN ? (double)pstStat->numOfStreamOn / iN : 0.0,
+        iN ? (double)pstStat->numOfStreamOff / iN : 0.0,
+        pstStat->bytesMapped);
+
+    /* progress on stderr, stdout may be the JSON */
+    fprintf(stderr, "%-6s %-4s %-5s %-6s q%-3d : %s p50 %lld us p99 %lld us, %.1f Mpix/s\n",
+        pstCase->bDecode ? "decode" : "encode", pstCase->bWarm ? "warm" : "cold",
+        pstCase->pstRes->name, pstCase->pstFmt->name, pstCase->iQuality,
+        pstResult->iStatus == ExynosJpegBase::ERROR_NONE ? "ok" : "FAIL",
+        benchPercentile(pstResult, 50), benchPercentile(pstResult, 99),
+        (0 < dSec) ? iN * dMpix / dSec : 0.0);
+}
+
+/* comma separated names, false on an unknown one */
+static bool benchParseNames(char *pcArg, bool *pbSel, int iNum, const char *(*getName)(int))
+{
+    char *pcSave = NULL;
+
+    memset(pbSel, 0, sizeof(bool) * iNum);
+
+    for (char *pcTok = strtok_r(pcArg, ",", &pcSave); pcTok != NULL; pcTok = strtok_r(NULL, ",", &pcSave)) {
+        int i;
+
+        for (i = 0; i < iNum; i++) {
+            if (strcmp(pcTok, getName(i)) == 0)
+                break;
+        }
+
+        if (i == iNum) {
+            fprintf(stderr, "unknown name : %s\n", pcTok);
+            return false;
+        }
+
+        pbSel[i] = true;
+    }
+
+    return true;
+}
+
+static const char *benchResName(int i)
+{
+    return benchRes[i].name;
+}
+
+static const char *benchFmtName(int i)
+{
+    return benchFmt[i].name;
+}
+
+static void benchUsage(const char *pcName)
+{
+    fprintf(stderr,
+        "usage: %s [-f] [-l latency_us] [-n iterations] [-w warmup] [-o enc|dec]\n"
+        "          [-m cold|warm] [-r res,...] [-c format,...] [-q quality,...] [-j file]\n"
+        "  -f  fake M2M device instead of the JPEG node\n"
+        "  -l  fake device latency per job (usec)\n"
+        "  resolutions : vga 720p 1080p 5mp 8mp 13mp\n"
+        "  formats     : yuyv nv21 nv12 yuv420 rgb32\n",
+        pcName);
+}
+
+int main(int argc, char **argv)
+{
+    struct BENCH_OPT stOpt;
+    struct BENCH_RESULT *pstResult;
+    bool bFirst = true;
+    int iOpt;
+
+    memset(&stOpt, 0, sizeof(struct BENCH_OPT));
+    stOpt.iIter = 20;
+    stOpt.iWarmup = 2;
+    stOpt.bEncode = stOpt.bDecode = true;
+    stOpt.bCold = stOpt.bWarm = true;
+    for (int i = 0; i < BENCH_NUM_RES; i++)
+        stOpt.bRes[i] = true;
+    for (int i = 0; i < BENCH_NUM_FMT; i++)
+        stOpt.bFmt[i] = true;
+    stOpt.iNumOfQuality = sizeof(benchDefaultQuality) / sizeof(int);
+    memcpy(stOpt.iQuality, benchDefaultQuality, sizeof(benchDefaultQuality));
+    stOpt.pOut = stdout;
+
+    while ((iOpt = getopt(argc, argv, "fl:n:w:o:m:r:c:q:j:h")) != -1) {
+        switch (iOpt) {
+        case 'f':
+            stOpt.bFake = true;
+            break;
+        case 'l':
+            stOpt.iFakeLatencyUs = atoi(optarg);
+            break;
+        case 'n':
+            stOpt.iIter = atoi(optarg);
+            break;
+        case 'w':
+            stOpt.iWarmup = atoi(optarg);
+            break;
+        case 'o':
+            stOpt.bEncode = (strcmp(optarg, "enc") == 0);
+            stOpt.bDecode = (strcmp(optarg, "dec") == 0);
+            break;
+        case 'm':
+            stOpt.bCold = (strcmp(optarg, "cold") == 0);
+            stOpt.bWarm = (strcmp(optarg, "warm") == 0);
+            break;
+        case 'r':
+            if (benchParseNames(optarg, stOpt.bRes, BENCH_NUM_RES, benchResName) == false)
+                return 1;
+            break;
+        case 'c':
+            if (benchParseNames(optarg, stOpt.bFmt, BENCH_NUM_FMT, benchFmtName) == false)
+                return 1;
+            break;
+        case 'q': {
+            char *pcSave = NULL;
+
+            stOpt.iNumOfQuality = 0;
+            for (char *pcTok = strtok_r(optarg, ",", &pcSave);
+                 pcTok != NULL && stOpt.iNumOfQuality < BENCH_MAX_QUALITY;
+                 pcTok = strtok_r(NULL, ",", &pcSave))
+                stOpt.iQuality[stOpt.iNumOfQuality++] = atoi(pcTok);
+            break;
+        }
+        case 'j':
+            stOpt.pOut = fopen(optarg, "w");
+            if (stOpt.pOut == NULL) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            benchUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (stOpt.iIter <= 0 || BENCH_MAX_SAMPLE < stOpt.iIter || stOpt.iWarmup < 0 ||
+        (stOpt.bEncode == false && stOpt.bDecode == false) ||
+        (stOpt.bCold == false && stOpt.bWarm == false)) {
+        benchUsage(argv[0]);
+        return 1;
+    }
+
+    if (stOpt.bFake == true) {
+        ExynosJpegBase::setDeviceOps(getJpegFakeDeviceOps());
+        setJpegFakeDeviceLatency(stOpt.iFakeLatencyUs);
+    }
+
+    /* the sample array is too big for the stack */
+    pstResult = (struct BENCH_RESULT *)malloc(sizeof(struct BENCH_RESULT));
+    if (pstResult == NULL)
+        return 1;
+
+    fprintf(stOpt.pOut, "{\"device\": \"%s\", \"iterations\": %d, \"warmup\": %d, \"results\": [\n",
+        ExynosJpegBase::getDeviceOps()->name, stOpt.iIter, stOpt.iWarmup);
+
+    for (int iOp = 0; iOp < 2; iOp++) {
+        if ((iOp == 0 && stOpt.bEncode == false) || (iOp == 1 && stOpt.bDecode == false))
+            continue;
+
+        for (int iMode = 0; iMode < 2; iMode++) {
+            if ((iMode == 0 && stOpt.bCold == false) || (iMode == 1 && stOpt.bWarm == false))
+                continue;
+
+            for (int iRes = 0; iRes < BENCH_NUM_RES; iRes++) {
+                for (int iFmt = 0; iFmt < BENCH_NUM_FMT; iFmt++) {
+                    for (int iQ = 0; iQ < stOpt.iNumOfQuality; iQ++) {
+                        struct BENCH_CASE stCase;
+
+                        if (stOpt.bRes[iRes] == false || stOpt.bFmt[iFmt] == false)
+                            continue;
+
+                        stCase.bDecode = (iOp == 1);
+                        stCase.bWarm = (iMode == 1);
+                        stCase.pstRes = &benchRes[iRes];
+                        stCase.pstFmt = &benchFmt[iFmt];
+                        stCase.iQuality = stOpt.iQuality[iQ];
+
+                        benchRunCase(&stOpt, &stCase, pstResult);
+                        benchPrintResult(&stOpt, &stCase, pstResult, bFirst);
+                        bFirst = false;
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf(stOpt.pOut, "\n]}\n");
+
+    if (stOpt.pOut != stdout)
+        fclose(stOpt.pOut);
+
+    free(pstResult);
+
+    return 0;
+}
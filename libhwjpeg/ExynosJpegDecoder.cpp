@@ -47,6 +47,13 @@ ExynosJpegDecoder::ExynosJpegDecoder()
 {
     t_iJpegFd = -1;
     t_bFlagCreate = false;
+    t_bFlagRegion = false;
+    t_iRegionX = 0;
+    t_iRegionY = 0;
+    t_iRegionW = 0;
+    t_iRegionH = 0;
+    t_iScaleShift = 0;
+    t_iRegionResult = ERROR_NONE;
 }
 
 ExynosJpegDecoder::~ExynosJpegDecoder()
@@ -57,7 +64,14 @@ ExynosJpegDecoder::~ExynosJpegDecoder()
 
 int ExynosJpegDecoder::create(void)
 {
-    return ExynosJpegBase::create(MODE_DECODE);
+    int iRet = ExynosJpegBase::create(MODE_DECODE);
+
+    if (iRet == ERROR_NONE) {
+        clearRegion();
+        t_iScaleShift = 0;
+    }
+
+    return iRet;
 }
 
 int ExynosJpegDecoder::destroy(void)
@@ -175,6 +189,18 @@ int ExynosJpegDecoder::setJpegFormat(int iV4l2JpegFormat)
 
 int ExynosJpegDecoder::updateConfig(void)
 {
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    /* region decode runs in software, the node is not needed */
+    if (t_bFlagRegion == true)
+        return ERROR_NONE;
+
+    if (0 < t_iScaleShift) {
+        t_stJpegConfig.scaled_width = t_stJpegConfig.width >> t_iScaleShift;
+        t_stJpegConfig.scaled_height = t_stJpegConfig.height >> t_iScaleShift;
+    }
+
     return ExynosJpegBase::updateConfig(MODE_DECODE,
                     NUM_JPEG_DEC_IN_BUFS, NUM_JPEG_DEC_OUT_BUFS,
                     NUM_JPEG_DEC_IN_PLANES, NUM_JPEG_DEC_OUT_PLANES);
@@ -223,7 +249,70 @@ int ExynosJpegDecoder::setJpegSize(int iJpegSize)
     return ERROR_NONE;
 }
 
+int ExynosJpegDecoder::setScaleDown(int iShift)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (iShift < 0 || JPEG_MAX_SCALE_DOWN_SHIFT < iShift)
+        return ERROR_INVALID_JPEG_CONFIG;
+
+    t_iScaleShift = iShift;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegDecoder::setRegion(int iX, int iY, int iW, int iH)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (iX < 0 || iY < 0 || iW <= 0 || iH <= 0)
+        return ERROR_INVALID_IMAGE_SIZE;
+
+    t_iRegionX = iX;
+    t_iRegionY = iY;
+    t_iRegionW = iW;
+    t_iRegionH = iH;
+    t_bFlagRegion = true;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegDecoder::clearRegion(void)
+{
+    t_bFlagRegion = false;
+    t_iRegionX = 0;
+    t_iRegionY = 0;
+    t_iRegionW = 0;
+    t_iRegionH = 0;
+
+    return ERROR_NONE;
+}
+
 int ExynosJpegDecoder::decode(void)
 {
+    if (t_bFlagRegion == true)
+        return decodeRegion();
+
     return ExynosJpegBase::execute(NUM_JPEG_DEC_OUT_PLANES, t_iPlaneNum);
 }
+
+int ExynosJpegDecoder::decodeSubmit(void)
+{
+    /* region decode has no node, it is done here and decodeReap() returns the result */
+    if (t_bFlagRegion == true) {
+        t_iRegionResult = decodeRegion();
+        return ERROR_NONE;
+    }
+
+    return ExynosJpegBase::submit(NUM_JPEG_DEC_OUT_PLANES, t_iPlaneNum);
+}
+
+int ExynosJpegDecoder::decodeReap(void)
+{
+    if (t_bFlagRegion == true)
+        return t_iRegionResult;
+
+    return ExynosJpegBase::reap(NUM_JPEG_DEC_OUT_PLANES, t_iPlaneNum);
+}
@@ -0,0 +1,364 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Batch decode.
+ *
+ * decode() pays open, S_FMT, REQBUFS and STREAMON for every image. A batch
+ * is split into groups of jobs sharing the output geometry and the buffer
+ * types; each group is configured once, keeps the node streaming and keeps
+ * JPEG_BATCH_DEPTH jobs queued, so the next image is already in the queue
+ * while the current one is dequeued.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+#define NUM_JPEG_DEC_IN_PLANES (1)
+
+static enum v4l2_memory batchMemory(int iFd)
+{
+    return (0 <= iFd) ? V4L2_MEMORY_DMABUF : V4L2_MEMORY_USERPTR;
+}
+
+static void batchSetBuf(struct ExynosJpegBase::BUFFER *pstBuf, char *pcAddr, int iFd, int iSize)
+{
+    memset(pstBuf, 0, sizeof(struct ExynosJpegBase::BUFFER));
+
+    if (0 <= iFd)
+        pstBuf->i_addr[0] = iFd;
+    else
+        pstBuf->c_addr[0] = pcAddr;
+    pstBuf->size[0] = iSize;
+    pstBuf->numOfPlanes = 1;
+}
+
+static long long batchNowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static bool batchSameGroup(struct ExynosJpegDecoder::BATCH_JOB *pstA, struct ExynosJpegDecoder::BATCH_JOB *pstB)
+{
+    return (pstA->iScaledW == pstB->iScaledW &&
+            pstA->iScaledH == pstB->iScaledH &&
+            batchMemory(pstA->iJpegFd) == batchMemory(pstB->iJpegFd) &&
+            batchMemory(pstA->iOutFd) == batchMemory(pstB->iOutFd));
+}
+
+int ExynosJpegDecoder::startBatchGroup(struct BATCH_JOB *pstJobs, int *piOrder, int iNum,
+                                       enum v4l2_memory eInMemory, enum v4l2_memory eOutMemory)
+{
+    struct BUF_INFO stBufInfo;
+    int iMaxJpegSize = 0;
+    int iRet = ERROR_NONE;
+
+    for (int i = 0; i < iNum; i++) {
+        if (iMaxJpegSize < pstJobs[piOrder[i]].iJpegSize)
+            iMaxJpegSize = pstJobs[piOrder[i]].iJpegSize;
+    }
+
+    t_stJpegConfig.mode = MODE_DECODE;
+    t_stJpegConfig.scaled_width = pstJobs[piOrder[0]].iScaledW;
+    t_stJpegConfig.scaled_height = pstJobs[piOrder[0]].iScaledH;
+    t_stJpegConfig.sizeJpeg = iMaxJpegSize;
+
+    /* the source size comes from each header, only a placeholder is needed */
+    if (t_stJpegConfig.width == 0 || t_stJpegConfig.height == 0) {
+        t_stJpegConfig.width = t_stJpegConfig.scaled_width;
+        t_stJpegConfig.height = t_stJpegConfig.scaled_height;
+    }
+
+    t_stJpegConfig.numOfPlanes = NUM_JPEG_DEC_IN_PLANES;
+    iRet = t_v4l2SetFmt(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, &t_stJpegConfig);
+    if (iRet < 0) {
+        JPEG_ERROR_LOG("[%s,%d]: jpeg input S_FMT failed\n", __func__, iRet);
+        return ERROR_INVALID_JPEG_CONFIG;
+    }
+
+    stBufInfo.numOfPlanes = NUM_JPEG_DEC_IN_PLANES;
+    stBufInfo.buf_type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    stBufInfo.memory = eInMemory;
+    iRet = t_v4l2Reqbufs(t_iJpegFd, JPEG_BATCH_DEPTH, &stBufInfo);
+    if (iRet < 0) {
+        JPEG_ERROR_LOG("[%s:%d]: Input REQBUFS failed\n", __func__, iRet);
+        return ERROR_REQBUF_FAIL;
+    }
+
+    t_stJpegConfig.numOfPlanes = t_iPlaneNum;
+    iRet = t_v4l2SetFmt(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, &t_stJpegConfig);
+    if (iRet < 0) {
+        JPEG_ERROR_LOG("[%s,%d]: jpeg output S_FMT failed\n", __func__, iRet);
+        return ERROR_INVALID_JPEG_CONFIG;
+    }
+
+    stBufInfo.numOfPlanes = t_iPlaneNum;
+    stBufInfo.buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    stBufInfo.memory = eOutMemory;
+    iRet = t_v4l2Reqbufs(t_iJpegFd, JPEG_BATCH_DEPTH, &stBufInfo);
+    if (iRet < 0) {
+        JPEG_ERROR_LOG("[%s:%d]: Output REQBUFS failed\n", __func__, iRet);
+        return ERROR_REQBUF_FAIL;
+    }
+
+    return ERROR_NONE;
+}
+
+void ExynosJpegDecoder::stopBatchGroup(enum v4l2_memory eInMemory, enum v4l2_memory eOutMemory)
+{
+    struct BUF_INFO stBufInfo;
+
+    t_v4l2StreamOff(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE);
+    t_v4l2StreamOff(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE);
+
+    stBufInfo.numOfPlanes = NUM_JPEG_DEC_IN_PLANES;
+    stBufInfo.buf_type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    stBufInfo.memory = eInMemory;
+    t_v4l2Reqbufs(t_iJpegFd, 0, &stBufInfo);
+
+    stBufInfo.numOfPlanes = t_iPlaneNum;
+    stBufInfo.buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    stBufInfo.memory = eOutMemory;
+    t_v4l2Reqbufs(t_iJpegFd, 0, &stBufInfo);
+}
+
+int ExynosJpegDecoder::runBatchGroup(struct BATCH_JOB *pstJobs, int *piOrder, int iNum, bool *pbHeld)
+{
+    struct BUF_INFO stInInfo;
+    struct BUF_INFO stOutInfo;
+    struct BUFFER stInBuf;
+    struct BUFFER stOutBuf;
+    struct BATCH_JOB *pstJob = NULL;
+    int iQueued = 0;
+    int iDone = 0;
+    int iIndex = 0;
+    bool bInError = false;
+    bool bOutError = false;
+    bool bStreamOn = false;
+
+    stInInfo.numOfPlanes = NUM_JPEG_DEC_IN_PLANES;
+    stInInfo.buf_type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+    stInInfo.memory = batchMemory(pstJobs[piOrder[0]].iJpegFd);
+
+    stOutInfo.numOfPlanes = t_iPlaneNum;
+    stOutInfo.buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    stOutInfo.memory = batchMemory(pstJobs[piOrder[0]].iOutFd);
+
+    while (iDone < iNum) {
+        /* drained for a job of higher priority, let it run and queue up again */
+        if (iQueued == iDone && t_arbiterYield() == true) {
+            t_arbiterRelease();
+            if (t_arbiterAcquire() != ERROR_NONE) {
+                /* the block is not ours any more, the caller must not release it */
+                *pbHeld = false;
+                goto fail;
+            }
+        }
+
+        /* keep the queue full, the next image is decoded while this one is reaped */
+        while (iQueued < iNum && iQueued - iDone < JPEG_BATCH_DEPTH &&
+               (iQueued == iDone || t_arbiterYield() == false)) {
+            pstJob = &pstJobs[piOrder[iQueued]];
+
+            batchSetBuf(&stInBuf, pstJob->pcJpeg, pstJob->iJpegFd, pstJob->iJpegSize);
+            if (t_v4l2Qbuf(t_iJpegFd, &stInInfo, &stInBuf, iQueued % JPEG_BATCH_DEPTH) < 0) {
+                JPEG_ERROR_LOG("[%s]: Input QBUF failed(job %d)\n", __func__, piOrder[iQueued]);
+                goto fail;
+            }
+
+            batchSetBuf(&stOutBuf, pstJob->pcOut, pstJob->iOutFd, pstJob->iOutSize);
+            if (t_v4l2Qbuf(t_iJpegFd, &stOutInfo, &stOutBuf, iQueued % JPEG_BATCH_DEPTH) < 0) {
+                JPEG_ERROR_LOG("[%s]: Output QBUF failed(job %d)\n", __func__, piOrder[iQueued]);
+                goto fail;
+            }
+
+            iQueued++;
+        }
+
+        if (bStreamOn == false) {
+            if (t_v4l2StreamOn(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) < 0 ||
+                t_v4l2StreamOn(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) < 0)
+                goto fail;
+            bStreamOn = true;
+        }
+
+        if (t_v4l2Dqbuf(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE, stInInfo.memory,
+                        NUM_JPEG_DEC_IN_PLANES, &iIndex, &bInError) < 0) {
+            JPEG_ERROR_LOG("[%s]: Input DQBUF failed(job %d)\n", __func__, piOrder[iDone]);
+            goto fail;
+        }
+
+        if (t_v4l2Dqbuf(t_iJpegFd, V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE, stOutInfo.memory,
+                        t_iPlaneNum, &iIndex, &bOutError) < 0) {
+            JPEG_ERROR_LOG("[%s]: Output DQBUF failed(job %d)\n", __func__, piOrder[iDone]);
+            goto fail;
+        }
+
+        /* m2m completes in queue order */
+        pstJobs[piOrder[iDone]].iResult = (bInError == true || bOutError == true) ?
+                                          ERROR_EXCUTE_FAIL : ERROR_NONE;
+        iDone++;
+    }
+
+    return ERROR_NONE;
+
+fail:
+    for (int i = iDone; i < iNum; i++)
+        pstJobs[piOrder[i]].iResult = ERROR_EXCUTE_FAIL;
+
+    return ERROR_EXCUTE_FAIL;
+}
+
+int ExynosJpegDecoder::decodeBatch(struct BATCH_JOB *pstJobs, int iNumOfJobs, struct BATCH_STAT *pstStat)
+{
+    struct CONFIG stSavedConfig;
+    int *piOrder = NULL;
+    bool *pbGrouped = NULL;
+    int iNumOfGroups = 0;
+    int iNumOfFail = 0;
+    long long llStart = 0;
+    long long llDuration = 0;
+    int iRet = ERROR_NONE;
+
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (pstJobs == NULL || iNumOfJobs <= 0)
+        return ERROR_BUFFR_IS_NULL;
+
+    /* region decode is done in software, one image at a time */
+    if (t_bFlagRegion == true)
+        return ERROR_INVALID_JPEG_CONFIG;
+
+    if (t_iPlaneNum <= 0)
+        return ERROR_INVALID_COLOR_FORMAT;
+
+    piOrder = (int *)malloc(sizeof(int) * iNumOfJobs);
+    pbGrouped = (bool *)malloc(sizeof(bool) * iNumOfJobs);
+    if (piOrder == NULL || pbGrouped == NULL) {
+        iRet = ERROR_FAIL;
+        goto done;
+    }
+
+    for (int i = 0; i < iNumOfJobs; i++) {
+        struct BATCH_JOB *pstJob = &pstJobs[i];
+
+        pbGrouped[i] = false;
+        pstJob->iResult = ERROR_NONE;
+
+        if ((pstJob->pcJpeg == NULL && pstJob->iJpegFd < 0) ||
+            (pstJob->pcOut == NULL && pstJob->iOutFd < 0))
+            pstJob->iResult = ERROR_BUFFR_IS_NULL;
+        else if (pstJob->iJpegSize <= 0 || pstJob->iOutSize <= 0)
+            pstJob->iResult = ERROR_BUFFER_TOO_SMALL;
+        else if (pstJob->iScaledW <= 0 || pstJob->iScaledH <= 0)
+            pstJob->iResult = ERROR_INVALID_IMAGE_SIZE;
+
+        if (pstJob->iResult != ERROR_NONE)
+            pbGrouped[i] = true;
+    }
+
+    memcpy(&stSavedConfig, &t_stJpegConfig, sizeof(struct CONFIG));
+    llStart = batchNowUs();
+
+    if (t_iJpegFd < 0) {
+        iRet = openJpeg(MODE_DECODE);
+        if (iRet != ERROR_NONE)
+            goto done;
+    } else {
+        /* a previous decode() left the node configured, release it first */
+        stopBatchGroup((enum v4l2_memory)getBufType(&t_stJpegInbuf),
+                       (enum v4l2_memory)getBufType(&t_stJpegOutbuf));
+        t_bFlagExcute = false;
+    }
+
+    for (int i = 0; i < iNumOfJobs; i++) {
+        int iNum = 0;
+        bool bHeld = false;
+        enum v4l2_memory eInMemory;
+        enum v4l2_memory eOutMemory;
+
+        if (pbGrouped[i] == true)
+            continue;
+
+        for (int j = i; j < iNumOfJobs; j++) {
+            if (pbGrouped[j] == false && batchSameGroup(&pstJobs[i], &pstJobs[j]) == true) {
+                piOrder[iNum++] = j;
+                pbGrouped[j] = true;
+            }
+        }
+
+        iNumOfGroups++;
+        eInMemory = batchMemory(pstJobs[i].iJpegFd);
+        eOutMemory = batchMemory(pstJobs[i].iOutFd);
+
+        /* the block is held for the group, runBatchGroup() yields it between images */
+        bHeld = (t_arbiterAcquire() == ERROR_NONE);
+        if (bHeld == true &&
+            startBatchGroup(pstJobs, piOrder, iNum, eInMemory, eOutMemory) == ERROR_NONE) {
+            runBatchGroup(pstJobs, piOrder, iNum, &bHeld);
+        } else {
+            for (int j = 0; j < iNum; j++)
+                pstJobs[piOrder[j]].iResult = ERROR_INVALID_JPEG_CONFIG;
+        }
+
+        stopBatchGroup(eInMemory, eOutMemory);
+        /* a failed acquire, also the one after a yield, leaves nothing to release */
+        if (bHeld == true)
+            t_arbiterRelease();
+    }
+
+    llDuration = batchNowUs() - llStart;
+    memcpy(&t_stJpegConfig, &stSavedConfig, sizeof(struct CONFIG));
+
+    for (int i = 0; i < iNumOfJobs; i++) {
+        if (pstJobs[i].iResult != ERROR_NONE)
+            iNumOfFail++;
+    }
+
+    if (pstStat != NULL) {
+        pstStat->numOfJobs = iNumOfJobs;
+        pstStat->numOfGroups = iNumOfGroups;
+        pstStat->numOfFail = iNumOfFail;
+        pstStat->durationUs = llDuration;
+        pstStat->imagesPerSec = (0 < llDuration) ?
+            (int)((long long)(iNumOfJobs - iNumOfFail) * 1000000LL / llDuration) : 0;
+    }
+
+    if (0 < iNumOfFail)
+        iRet = ERROR_EXCUTE_FAIL;
+
+done:
+    if (piOrder != NULL)
+        free(piOrder);
+    if (pbGrouped != NULL)
+        free(pbGrouped);
+
+    return iRet;
+}
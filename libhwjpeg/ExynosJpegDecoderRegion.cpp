@@ -0,0 +1,164 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Region-of-interest decode.
+ *
+ * The JPEG block has no crop on its capture queue, so a region is decoded
+ * in software with libjpeg:
+ *  - the power-of-two scale is done in the IDCT (1/2, 1/4, 1/8), which
+ *    shrinks the per-block work instead of scaling a full size output.
+ *  - decoding stops at the last MCU row of the region, rows below it are
+ *    never entropy decoded.
+ *  - only the region columns are packed into the output buffer.
+ * The node is not opened on this path, so it also runs where the JPEG
+ * block is not present.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegSwCodec.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+static char *regionMapBuf(struct ExynosJpegBase::BUFFER *pstBuf, int iProt, bool *pbMapped)
+{
+    char *pcAddr = NULL;
+
+    *pbMapped = false;
+
+    if (pstBuf->i_addr[0] > 0) {
+        pcAddr = (char *)mmap(0, pstBuf->size[0], iProt, MAP_SHARED, pstBuf->i_addr[0], 0);
+        if (pcAddr == MAP_FAILED) {
+            JPEG_ERROR_LOG("[%s]: mmap(%d) failed\n", __func__, pstBuf->i_addr[0]);
+            return NULL;
+        }
+        *pbMapped = true;
+        return pcAddr;
+    }
+
+    if ((int)pstBuf->c_addr[0] != 0 && (int)pstBuf->c_addr[0] != -1)
+        return pstBuf->c_addr[0];
+
+    return NULL;
+}
+
+int ExynosJpegDecoder::getRegionOutSize(int *piW, int *piH)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagRegion == false)
+        return ERROR_SIZE_NOT_SET_YET;
+
+    int iW = t_iRegionW >> t_iScaleShift;
+    int iH = t_iRegionH >> t_iScaleShift;
+
+    /* subsampled output keeps even width, 4:2:0 output keeps even height */
+    switch (t_stJpegConfig.pix.dec_fmt.out_fmt) {
+    case V4L2_PIX_FMT_YUYV:
+        iW &= ~1;
+        break;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_YUV420:
+        iW &= ~1;
+        iH &= ~1;
+        break;
+    default:
+        break;
+    }
+
+    if (iW <= 0 || iH <= 0)
+        return ERROR_INVALID_IMAGE_SIZE;
+
+    *piW = iW;
+    *piH = iH;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegDecoder::decodeRegion(void)
+{
+    char *pcIn = NULL;
+    char *pcOut = NULL;
+    bool bInMapped = false;
+    bool bOutMapped = false;
+    int iFormat = t_stJpegConfig.pix.dec_fmt.out_fmt;
+    int iInSize = 0;
+    int iOutW = 0, iOutH = 0;
+    int iOutSize = 0;
+    int iImageW = 0, iImageH = 0;
+    int iRet = ERROR_NONE;
+
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagCreateInBuf == false || t_bFlagCreateOutBuf == false)
+        return ERROR_BUF_NOT_SET_YET;
+
+    iRet = getRegionOutSize(&iOutW, &iOutH);
+    if (iRet != ERROR_NONE)
+        return iRet;
+
+    setColorBufSize(iFormat, &iOutSize, 1, iOutW, iOutH);
+    if (t_stJpegOutbuf.size[0] < iOutSize) {
+        JPEG_ERROR_LOG("[%s]: output buffer(%d) is smaller than region(%dx%d, %d)\n",
+            __func__, t_stJpegOutbuf.size[0], iOutW, iOutH, iOutSize);
+        return ERROR_BUFFER_TOO_SMALL;
+    }
+
+    iInSize = (0 < t_stJpegConfig.sizeJpeg) ? t_stJpegConfig.sizeJpeg : t_stJpegInbuf.size[0];
+
+    pcIn = regionMapBuf(&t_stJpegInbuf, PROT_READ, &bInMapped);
+    pcOut = regionMapBuf(&t_stJpegOutbuf, PROT_READ | PROT_WRITE, &bOutMapped);
+    if (pcIn == NULL || pcOut == NULL) {
+        iRet = ERROR_BUFFR_IS_NULL;
+        goto done;
+    }
+
+    /*
+     * the source is trimmed to exactly (out << shift), so the software codec
+     * picks t_iScaleShift for the IDCT and copies the region without resampling
+     */
+    iRet = jpegSwDecode(pcIn, iInSize, iFormat, pcOut,
+                        t_iRegionX, t_iRegionY, iOutW << t_iScaleShift, iOutH << t_iScaleShift,
+                        iOutW, iOutH, &iImageW, &iImageH);
+    if (iImageW != 0 && iImageH != 0) {
+        t_stJpegConfig.width = iImageW;
+        t_stJpegConfig.height = iImageH;
+    }
+    if (iRet != ERROR_NONE)
+        goto done;
+
+    t_stJpegConfig.scaled_width = iOutW;
+    t_stJpegConfig.scaled_height = iOutH;
+
+done:
+    if (bInMapped == true)
+        munmap(pcIn, t_stJpegInbuf.size[0]);
+    if (bOutMapped == true)
+        munmap(pcOut, t_stJpegOutbuf.size[0]);
+
+    return iRet;
+}
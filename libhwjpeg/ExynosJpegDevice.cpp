@@ -0,0 +1,153 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Device layer of libhwjpeg.
+ *
+ * Every syscall the library makes on the JPEG node goes through here, so the
+ * node can be swapped for another implementation (ExynosJpegFakeDevice) and
+ * the calls can be counted. The counters are what the benchmark reports as
+ * ioctl counts and bytes mapped.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+
+static int devRealOpen(const char *pcPath, int iFlags)
+{
+    return open(pcPath, iFlags, 0);
+}
+
+static int devRealClose(int iFd)
+{
+    return close(iFd);
+}
+
+static int devRealIoctl(int iFd, unsigned long ulReq, void *pArg)
+{
+    return ioctl(iFd, ulReq, pArg);
+}
+
+static void *devRealMmap(void *pAddr, size_t iLen, int iProt, int iFlags, int iFd, off_t iOff)
+{
+    return mmap(pAddr, iLen, iProt, iFlags, iFd, iOff);
+}
+
+static int devRealMunmap(void *pAddr, size_t iLen)
+{
+    return munmap(pAddr, iLen);
+}
+
+static const struct ExynosJpegBase::DEVICE_OPS devRealOps = {
+    "v4l2",
+    devRealOpen,
+    devRealClose,
+    devRealIoctl,
+    devRealMmap,
+    devRealMunmap,
+};
+
+static const struct ExynosJpegBase::DEVICE_OPS *devOps = &devRealOps;
+static struct ExynosJpegBase::DEVICE_STAT devStat;
+
+void ExynosJpegBase::setDeviceOps(const struct DEVICE_OPS *pstOps)
+{
+    devOps = (pstOps == NULL) ? &devRealOps : pstOps;
+
+    ALOGD("[%s]: device(%s)", __func__, devOps->name);
+}
+
+const struct ExynosJpegBase::DEVICE_OPS *ExynosJpegBase::getDeviceOps(void)
+{
+    return devOps;
+}
+
+void ExynosJpegBase::getDeviceStat(struct DEVICE_STAT *pstStat)
+{
+    /* counters are bumped without a lock, a snapshot may be off by one call */
+    memcpy(pstStat, &devStat, sizeof(struct DEVICE_STAT));
+}
+
+void ExynosJpegBase::clearDeviceStat(void)
+{
+    memset(&devStat, 0, sizeof(struct DEVICE_STAT));
+}
+
+int ExynosJpegBase::t_devOpen(const char *pcPath, int iFlags)
+{
+    __sync_fetch_and_add(&devStat.numOfOpen, 1);
+
+    return devOps->open(pcPath, iFlags);
+}
+
+int ExynosJpegBase::t_devClose(int iFd)
+{
+    return devOps->close(iFd);
+}
+
+int ExynosJpegBase::t_devIoctl(int iFd, unsigned long ulReq, void *pArg)
+{
+    __sync_fetch_and_add(&devStat.numOfIoctl, 1);
+
+    switch (ulReq) {
+    case VIDIOC_S_FMT:
+        __sync_fetch_and_add(&devStat.numOfSetFmt, 1);
+        break;
+    case VIDIOC_REQBUFS:
+        __sync_fetch_and_add(&devStat.numOfReqbufs, 1);
+        break;
+    case VIDIOC_QBUF:
+        __sync_fetch_and_add(&devStat.numOfQbuf, 1);
+        break;
+    case VIDIOC_DQBUF:
+        __sync_fetch_and_add(&devStat.numOfDqbuf, 1);
+        break;
+    case VIDIOC_STREAMON:
+        __sync_fetch_and_add(&devStat.numOfStreamOn, 1);
+        break;
+    case VIDIOC_STREAMOFF:
+        __sync_fetch_and_add(&devStat.numOfStreamOff, 1);
+        break;
+    default:
+        break;
+    }
+
+    return devOps->ioctl(iFd, ulReq, pArg);
+}
+
+void *ExynosJpegBase::t_devMmap(void *pAddr, size_t iLen, int iProt, int iFlags, int iFd, off_t iOff)
+{
+    void *pRet = devOps->mmap(pAddr, iLen, iProt, iFlags, iFd, iOff);
+
+    if (pRet != MAP_FAILED)
+        __sync_fetch_and_add(&devStat.bytesMapped, (unsigned long long)iLen);
+
+    return pRet;
+}
+
+int ExynosJpegBase::t_devMunmap(void *pAddr, size_t iLen)
+{
+    return devOps->munmap(pAddr, iLen);
+}
@@ -45,6 +45,9 @@ ExynosJpegEncoder::ExynosJpegEncoder()
 {
     t_iJpegFd = -1;
     t_bFlagCreate = false;
+    t_bFlagSwEncode = false;
+    t_iSwThreads = 0;
+    t_iSwResult = ERROR_NONE;
 }
 
 ExynosJpegEncoder::~ExynosJpegEncoder()
@@ -55,7 +58,12 @@ ExynosJpegEncoder::~ExynosJpegEncoder()
 
 int ExynosJpegEncoder::create(void)
 {
-    return ExynosJpegBase::create(MODE_ENCODE);
+    int iRet = ExynosJpegBase::create(MODE_ENCODE);
+
+    if (iRet == ERROR_NONE)
+        clearSwEncode();
+
+    return iRet;
 }
 
 int ExynosJpegEncoder::destroy(void)
@@ -180,6 +188,13 @@ int ExynosJpegEncoder::setColorBufSize(int *piBufSize, int iSize)
 
 int ExynosJpegEncoder::updateConfig(void)
 {
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    /* software encode runs on the CPU, the node is not needed */
+    if (t_bFlagSwEncode == true)
+        return ERROR_NONE;
+
     return ExynosJpegBase::updateConfig(MODE_ENCODE,
                     NUM_JPEG_ENC_IN_BUFS, NUM_JPEG_ENC_OUT_BUFS,
                     NUM_JPEG_ENC_IN_PLANES, NUM_JPEG_ENC_OUT_PLANES);
@@ -222,5 +237,27 @@ int ExynosJpegEncoder::getJpegSize(void)
 
 int ExynosJpegEncoder::encode(void)
 {
+    if (t_bFlagSwEncode == true)
+        return encodeSw();
+
     return ExynosJpegBase::execute(t_iPlaneNum, NUM_JPEG_ENC_OUT_PLANES);
 }
+
+int ExynosJpegEncoder::encodeSubmit(void)
+{
+    /* software encode has no node, it is done here and encodeReap() returns the result */
+    if (t_bFlagSwEncode == true) {
+        t_iSwResult = encodeSw();
+        return ERROR_NONE;
+    }
+
+    return ExynosJpegBase::submit(t_iPlaneNum, NUM_JPEG_ENC_OUT_PLANES);
+}
+
+int ExynosJpegEncoder::encodeReap(void)
+{
+    if (t_bFlagSwEncode == true)
+        return t_iSwResult;
+
+    return ExynosJpegBase::reap(t_iPlaneNum, NUM_JPEG_ENC_OUT_PLANES);
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Target-size encode.
+ *
+ * The JPEG block has six quality levels and no rate control, so the size of
+ * a level is only known after encoding it. To keep the number of hardware
+ * encodes small:
+ *  - every level is first probe encoded in software on a 1/4 x 1/4
+ *    subsample of the source, one thread per level. The probe sizes scaled
+ *    by 16 give an estimate for each level.
+ *  - the hardware encodes the highest level estimated to fit. Its real size
+ *    calibrates the estimates of the remaining levels, and the next level is
+ *    picked from the calibrated estimates inside the range still open.
+ *  - at most JPEG_RC_MAX_ENCODE hardware encodes are run. A fitting result
+ *    is kept aside while a higher level is tried, and put back if that one
+ *    does not fit.
+ * When the source format has no software path, the levels are binary
+ * searched, which also covers the six levels in three encodes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegSwCodec.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+#define JPEG_RC_NUM_LEVEL       (ExynosJpegEncoder::QUALITY_LEVEL_6 + 1)
+#define JPEG_RC_PROBE_STEP      (4)
+#define JPEG_RC_PROBE_MIN_W     (64)
+/* markers and tables, not scaled with the picture */
+#define JPEG_RC_HEADER_SIZE     (600)
+
+struct RC_PROBE {
+    const char  *pcIn;
+    int         iFormat;
+    int         iW;
+    int         iH;
+    int         iStep;
+    int         iJpegFormat;
+    int         iLevel;
+    char        *pcJpeg;
+    int         iJpegBufSize;
+    int         iEstimate;      /* -1 when the probe failed */
+};
+
+static void *rcProbeThread(void *pArg)
+{
+    struct RC_PROBE *pstProbe = (struct RC_PROBE *)pArg;
+    int iSize = 0;
+    int iRet;
+
+    pstProbe->iEstimate = -1;
+
+    iRet = jpegSwEncodeSubsampled(pstProbe->pcIn, pstProbe->iFormat, pstProbe->iW, pstProbe->iH,
+                                  pstProbe->iStep, pstProbe->iJpegFormat,
+                                  jpegSwQualityOfLevel(pstProbe->iLevel),
+                                  pstProbe->pcJpeg, pstProbe->iJpegBufSize, &iSize);
+    if (iRet != ExynosJpegBase::ERROR_NONE)
+        return NULL;
+
+    if (iSize < JPEG_RC_HEADER_SIZE)
+        iSize = JPEG_RC_HEADER_SIZE;
+
+    pstProbe->iEstimate = JPEG_RC_HEADER_SIZE +
+            (iSize - JPEG_RC_HEADER_SIZE) * pstProbe->iStep * pstProbe->iStep;
+
+    return NULL;
+}
+
+/* fills piEstimate[level], false when the source has no software path */
+static bool rcProbe(const char *pcIn, int iFormat, int iW, int iH, int iJpegFormat, int *piEstimate)
+{
+    struct RC_PROBE stProbe[JPEG_RC_NUM_LEVEL];
+    pthread_t thread[JPEG_RC_NUM_LEVEL];
+    bool bThread[JPEG_RC_NUM_LEVEL];
+    int iStep = JPEG_RC_PROBE_STEP;
+    int iBufSize;
+    bool bRet = true;
+
+    while (1 < iStep && iW / iStep < JPEG_RC_PROBE_MIN_W)
+        iStep >>= 1;
+
+    /* raw 4:4:4 of the subsample, a probe never gets bigger than that */
+    iBufSize = (iW / iStep) * (iH / iStep) * 3 + JPEG_RC_HEADER_SIZE * 2;
+
+    for (int i = 0; i < JPEG_RC_NUM_LEVEL; i++) {
+        stProbe[i].pcIn = pcIn;
+        stProbe[i].iFormat = iFormat;
+        stProbe[i].iW = iW;
+        stProbe[i].iH = iH;
+        stProbe[i].iStep = iStep;
+        stProbe[i].iJpegFormat = iJpegFormat;
+        stProbe[i].iLevel = i;
+        stProbe[i].iJpegBufSize = iBufSize;
+        stProbe[i].iEstimate = -1;
+        stProbe[i].pcJpeg = (char *)malloc(iBufSize);
+        bThread[i] = false;
+
+        if (stProbe[i].pcJpeg == NULL)
+            continue;
+
+        if (pthread_create(&thread[i], NULL, rcProbeThread, &stProbe[i]) == 0)
+            bThread[i] = true;
+        else
+            rcProbeThread(&stProbe[i]);
+    }
+
+    for (int i = 0; i < JPEG_RC_NUM_LEVEL; i++) {
+        if (bThread[i] == true)
+            pthread_join(thread[i], NULL);
+
+        free(stProbe[i].pcJpeg);
+
+        piEstimate[i] = stProbe[i].iEstimate;
+        if (piEstimate[i] < 0)
+            bRet = false;
+    }
+
+    return bRet;
+}
+
+/* highest level in [iLo, iHi] predicted to fit, -1 when none is */
+static int rcPickLevel(int *piEstimate, double dRatio, int iLo, int iHi, int iMaxSize)
+{
+    for (int i = iLo; i <= iHi; i++) {
+        if ((double)piEstimate[i] * dRatio <= (double)iMaxSize)
+            return i;
+    }
+
+    return -1;
+}
+
+int ExynosJpegEncoder::encodeToSize(int iMaxSize, int *piQualityLevel)
+{
+    int iEstimate[JPEG_RC_NUM_LEVEL];
+    bool bEstimate = false;
+    double dRatio = 1.0;
+    char *pcIn = NULL;
+    char *pcOut = NULL;
+    char *pcKeep = NULL;
+    bool bInAlloc = false;
+    bool bOutAlloc = false;
+    int iKeepSize = 0;
+    int iLo = QUALITY_LEVEL_1;
+    int iHi = QUALITY_LEVEL_6;
+    int iBest = -1;
+    int iLevel;
+    int iSize;
+    int iRet = ERROR_NONE;
+
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagCreateInBuf == false || t_bFlagCreateOutBuf == false)
+        return ERROR_BUF_NOT_SET_YET;
+
+    if (iMaxSize <= 0)
+        return ERROR_BUFFER_TOO_SMALL;
+
+    pcIn = jpegSwMapBuf(&t_stJpegInbuf, t_iPlaneNum, PROT_READ, &bInAlloc);
+    if (pcIn != NULL) {
+        bEstimate = rcProbe(pcIn, t_stJpegConfig.pix.enc_fmt.in_fmt,
+                            t_stJpegConfig.width, t_stJpegConfig.height,
+                            t_stJpegConfig.pix.enc_fmt.out_fmt, iEstimate);
+        jpegSwUnmapBuf(&t_stJpegInbuf, pcIn, bInAlloc);
+    }
+
+    if (bEstimate == true) {
+        iLevel = rcPickLevel(iEstimate, dRatio, iLo, iHi, iMaxSize);
+        if (iLevel < 0)
+            iLevel = iHi;
+    } else {
+        ALOGD("[%s]: no software probe for format(0x%x), binary search",
+            __func__, t_stJpegConfig.pix.enc_fmt.in_fmt);
+        iLevel = (iLo + iHi) / 2;
+    }
+
+    for (int n = 0; n < JPEG_RC_MAX_ENCODE; n++) {
+        t_stJpegConfig.enc_qual = iLevel;
+
+        if (t_bFlagSwEncode == false)
+            iRet = t_v4l2SetJpegcomp(t_iJpegFd, iLevel);
+        if (iRet < 0) {
+            JPEG_ERROR_LOG("[%s,%d]: S_JPEGCOMP(%d) failed\n", __func__, iRet, iLevel);
+            iRet = ERROR_INVALID_JPEG_CONFIG;
+            goto done;
+        }
+
+        iRet = encode();
+        if (iRet != ERROR_NONE)
+            goto done;
+
+        iSize = t_stJpegConfig.sizeJpeg;
+
+        if (iSize <= iMaxSize) {
+            iBest = iLevel;
+            iHi = iLevel - 1;
+        } else {
+            iLo = iLevel + 1;
+        }
+
+        if (iHi < iLo || n + 1 == JPEG_RC_MAX_ENCODE)
+            break;
+
+        if (bEstimate == true) {
+            dRatio = (double)iSize / (double)iEstimate[iLevel];
+            iLevel = rcPickLevel(iEstimate, dRatio, iLo, iHi, iMaxSize);
+            if (iLevel < 0) {
+                /* nothing better is predicted to fit */
+                if (iBest >= 0)
+                    break;
+                iLevel = iHi;
+            }
+        } else {
+            iLevel = (iLo + iHi) / 2;
+        }
+
+        /* a fitting result is overwritten by the next try, keep it aside */
+        if (iSize <= iMaxSize) {
+            pcOut = jpegSwMapBuf(&t_stJpegOutbuf, 1, PROT_READ, &bOutAlloc);
+            if (pcOut == NULL) {
+                /* no way to go back, settle with what we have */
+                break;
+            }
+
+            free(pcKeep);
+            pcKeep = (char *)malloc(iSize);
+            if (pcKeep != NULL) {
+                memcpy(pcKeep, pcOut, iSize);
+                iKeepSize = iSize;
+            }
+            jpegSwUnmapBuf(&t_stJpegOutbuf, pcOut, bOutAlloc);
+
+            if (pcKeep == NULL)
+                break;
+        }
+    }
+
+    if (iBest < 0) {
+        JPEG_ERROR_LOG("[%s]: %d bytes do not fit in %d bytes at the lowest quality\n",
+            __func__, t_stJpegConfig.sizeJpeg, iMaxSize);
+        iRet = ERROR_BUFFER_TOO_SMALL;
+        goto done;
+    }
+
+    /* the last encode overshot, put the kept result back */
+    if (t_stJpegConfig.sizeJpeg > iMaxSize) {
+        pcOut = jpegSwMapBuf(&t_stJpegOutbuf, 1, PROT_READ | PROT_WRITE, &bOutAlloc);
+        if (pcOut == NULL || pcKeep == NULL) {
+            if (pcOut != NULL)
+                jpegSwUnmapBuf(&t_stJpegOutbuf, pcOut, bOutAlloc);
+            iRet = ERROR_BUFFR_IS_NULL;
+            goto done;
+        }
+
+        memcpy(pcOut, pcKeep, iKeepSize);
+        jpegSwUnmapBuf(&t_stJpegOutbuf, pcOut, bOutAlloc);
+        t_stJpegConfig.sizeJpeg = iKeepSize;
+    }
+
+    t_stJpegConfig.enc_qual = iBest;
+    if (piQualityLevel != NULL)
+        *piQualityLevel = iBest;
+
+    iRet = ERROR_NONE;
+
+done:
+    free(pcKeep);
+
+    return iRet;
+}
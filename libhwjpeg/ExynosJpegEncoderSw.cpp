@@ -0,0 +1,117 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Software encode.
+ *
+ * The JPEG block encodes one picture at a time and has a size limit, which
+ * stitched panoramas go past. This path encodes on the CPU instead: the
+ * picture is cut into stripes of whole MCU rows, each stripe is encoded on
+ * its own thread and the stripes are joined as restart intervals (see
+ * jpegSwEncodeParallel()), so the time goes down with the number of cores
+ * and the size is only bound by the JPEG format.
+ * The output is a baseline JPEG with a DRI marker, which the JPEG block
+ * and every libjpeg decode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegSwCodec.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+int ExynosJpegEncoder::setSwEncode(int iNumOfThreads)
+{
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (iNumOfThreads < 0)
+        return ERROR_INVALID_JPEG_CONFIG;
+
+    t_iSwThreads = iNumOfThreads;
+    t_bFlagSwEncode = true;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegEncoder::clearSwEncode(void)
+{
+    t_bFlagSwEncode = false;
+    t_iSwThreads = 0;
+    t_iSwResult = ERROR_NONE;
+
+    return ERROR_NONE;
+}
+
+int ExynosJpegEncoder::encodeSw(void)
+{
+    char *pcIn = NULL;
+    char *pcOut = NULL;
+    bool bInAlloc = false;
+    bool bOutAlloc = false;
+    int iThreads = t_iSwThreads;
+    int iQuality;
+    int iSize = 0;
+    int iRet = ERROR_NONE;
+
+    if (t_bFlagCreate == false)
+        return ERROR_JPEG_DEVICE_NOT_CREATE_YET;
+
+    if (t_bFlagCreateInBuf == false || t_bFlagCreateOutBuf == false)
+        return ERROR_BUF_NOT_SET_YET;
+
+    iQuality = jpegSwQualityOfLevel(t_stJpegConfig.enc_qual);
+    if (iQuality < 0)
+        return ERROR_INVALID_JPEG_CONFIG;
+
+    if (iThreads == 0)
+        iThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    pcIn = jpegSwMapBuf(&t_stJpegInbuf, t_iPlaneNum, PROT_READ, &bInAlloc);
+    pcOut = jpegSwMapBuf(&t_stJpegOutbuf, 1, PROT_READ | PROT_WRITE, &bOutAlloc);
+    if (pcIn == NULL || pcOut == NULL) {
+        iRet = ERROR_BUFFR_IS_NULL;
+        goto done;
+    }
+
+    iRet = jpegSwEncodeParallel(pcIn, t_stJpegConfig.pix.enc_fmt.in_fmt,
+                                t_stJpegConfig.width, t_stJpegConfig.height,
+                                t_stJpegConfig.pix.enc_fmt.out_fmt, iQuality, iThreads,
+                                pcOut, t_stJpegOutbuf.size[0], &iSize);
+    if (iRet != ERROR_NONE) {
+        JPEG_ERROR_LOG("[%s]: %dx%d on %d threads failed(%d)\n", __func__,
+            t_stJpegConfig.width, t_stJpegConfig.height, iThreads, iRet);
+        goto done;
+    }
+
+    t_stJpegConfig.sizeJpeg = iSize;
+
+done:
+    if (pcIn != NULL)
+        jpegSwUnmapBuf(&t_stJpegInbuf, pcIn, bInAlloc);
+    if (pcOut != NULL)
+        jpegSwUnmapBuf(&t_stJpegOutbuf, pcOut, bOutAlloc);
+
+    return iRet;
+}
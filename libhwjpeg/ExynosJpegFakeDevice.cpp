@@ -0,0 +1,665 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Fake M2M loopback for the JPEG node.
+ *
+ * Each open() gets an instance with one FIFO per queue, and an eventfd as
+ * its handle. One worker thread plays the single JPEG block: it takes the
+ * jobs of all instances in turn, one at a time, whenever both queues of an
+ * instance are streaming with a buffer queued. The heads of the OUTPUT
+ * (source) and CAPTURE (result) FIFOs are paired and the software codec
+ * fills the result. Encode or decode is decided by the OUTPUT format, as on
+ * the real node, where a JPEG source means decode.
+ *
+ * The configured latency is spent by the worker after each job, so jobs of
+ * all instances are serialized with it. A finished job signals the eventfd,
+ * which poll() reports until its buffers are dequeued. DQBUF blocks until a
+ * job is done and STREAMOFF waits for the running one, like on the node.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegFakeDevice.h"
+#include "ExynosJpegSwCodec.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+#define FAKE_MAX_INSTANCE   (8)
+#define FAKE_MAX_QUEUED     (8)
+
+struct FAKE_BUF {
+    int             index;
+    int             memory;
+    int             numOfPlanes;
+    unsigned long   addr[JPEG_MAX_PLANE_CNT];   /* userptr or dmabuf fd */
+    int             length[JPEG_MAX_PLANE_CNT];
+    int             bytesused;
+    bool            error;
+};
+
+struct FAKE_QUEUE {
+    int             format;
+    int             width;
+    int             height;
+    int             sizeimage;
+    bool            streaming;
+    int             numOfQueued;
+    int             numOfDone;
+    struct FAKE_BUF queued[FAKE_MAX_QUEUED];
+    struct FAKE_BUF done[FAKE_MAX_QUEUED];
+};
+
+struct FAKE_INSTANCE {
+    bool                used;
+    bool                running;    /* a job is on the worker */
+    int                 fd;         /* eventfd, readable while a job is done */
+    int                 quality;
+    int                 imageW;
+    int                 imageH;
+    struct FAKE_QUEUE   src;    /* V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE */
+    struct FAKE_QUEUE   dst;    /* V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE */
+};
+
+static pthread_mutex_t fakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fakeCond = PTHREAD_COND_INITIALIZER;
+static struct FAKE_INSTANCE fakeInstance[FAKE_MAX_INSTANCE];
+static bool fakeWorkerStarted = false;
+static int fakeNext = 0;
+static int fakeLatencyUs = 0;
+
+static int fakeFail(int iErrno)
+{
+    errno = iErrno;
+    return -1;
+}
+
+static bool fakeIsJpeg(int iFormat)
+{
+    switch (iFormat) {
+    case V4L2_PIX_FMT_JPEG:
+    case V4L2_PIX_FMT_JPEG_444:
+    case V4L2_PIX_FMT_JPEG_422:
+    case V4L2_PIX_FMT_JPEG_420:
+    case V4L2_PIX_FMT_JPEG_GRAY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static int fakeFrameSize(int iFormat, int iW, int iH)
+{
+    switch (iFormat) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_RGB565X:
+        return iW * iH * 2;
+    case V4L2_PIX_FMT_RGB32:
+    case V4L2_PIX_FMT_BGR32:
+        return iW * iH * 4;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_YUV420:
+        return (iW * iH * 3) >> 1;
+    default:
+        return 0;
+    }
+}
+
+static struct FAKE_INSTANCE *fakeFind(int iFd)
+{
+    for (int i = 0; i < FAKE_MAX_INSTANCE; i++) {
+        if (fakeInstance[i].used == true && fakeInstance[i].fd == iFd)
+            return &fakeInstance[i];
+    }
+
+    return NULL;
+}
+
+static struct FAKE_QUEUE *fakeQueue(struct FAKE_INSTANCE *pInst, int iType)
+{
+    switch (iType) {
+    case V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE:
+        return &pInst->src;
+    case V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE:
+        return &pInst->dst;
+    default:
+        return NULL;
+    }
+}
+
+static void fakeFlush(struct FAKE_INSTANCE *pInst, struct FAKE_QUEUE *pQueue)
+{
+    eventfd_t ullCount;
+
+    pQueue->numOfQueued = 0;
+    pQueue->numOfDone = 0;
+
+    if (pInst->src.numOfDone == 0 && pInst->dst.numOfDone == 0)
+        eventfd_read(pInst->fd, &ullCount);
+}
+
+static bool fakeRunnable(struct FAKE_INSTANCE *pInst)
+{
+    return (pInst->used == true && pInst->running == false &&
+            pInst->src.streaming == true && pInst->dst.streaming == true &&
+            0 < pInst->src.numOfQueued && 0 < pInst->dst.numOfQueued);
+}
+
+/* the buffer as ExynosJpegBase sees it, for jpegSwMapBuf() */
+static void fakeToBuffer(struct FAKE_BUF *pBuf, struct ExynosJpegBase::BUFFER *pstBuf)
+{
+    memset(pstBuf, 0, sizeof(struct ExynosJpegBase::BUFFER));
+
+    pstBuf->numOfPlanes = pBuf->numOfPlanes;
+    for (int i = 0; i < pBuf->numOfPlanes; i++) {
+        if (pBuf->memory == V4L2_MEMORY_DMABUF)
+            pstBuf->i_addr[i] = (int)pBuf->addr[i];
+        else
+            pstBuf->c_addr[i] = (char *)pBuf->addr[i];
+        pstBuf->size[i] = pBuf->length[i];
+    }
+}
+
+static int fakeBufSize(struct FAKE_BUF *pBuf)
+{
+    int iSize = 0;
+
+    for (int i = 0; i < pBuf->numOfPlanes; i++)
+        iSize += pBuf->length[i];
+
+    return iSize;
+}
+
+/* runs the job on the heads of the queues, without fakeLock */
+static void fakeRunJob(struct FAKE_INSTANCE *pInst, struct FAKE_BUF *pSrc, struct FAKE_BUF *pDst,
+                       int *piImageW, int *piImageH)
+{
+    struct ExynosJpegBase::BUFFER stSrc;
+    struct ExynosJpegBase::BUFFER stDst;
+    char *pcSrc = NULL;
+    char *pcDst = NULL;
+    bool bSrcAlloc = false;
+    bool bDstAlloc = false;
+    int iSrcSize = 0;
+    int iDstSize = 0;
+    int iRet = ExynosJpegBase::ERROR_NONE;
+
+    pSrc->bytesused = 0;
+    pDst->bytesused = 0;
+
+    /*
+     * planes are gathered into one allocation as for the software encoder,
+     * a gathered result is scattered back to its planes when done
+     */
+    fakeToBuffer(pSrc, &stSrc);
+    fakeToBuffer(pDst, &stDst);
+    iSrcSize = fakeBufSize(pSrc);
+    iDstSize = fakeBufSize(pDst);
+    pcSrc = jpegSwMapBuf(&stSrc, stSrc.numOfPlanes, PROT_READ, &bSrcAlloc);
+    pcDst = jpegSwMapBuf(&stDst, stDst.numOfPlanes, PROT_READ | PROT_WRITE, &bDstAlloc);
+
+    if (pcSrc == NULL || pcDst == NULL) {
+        iRet = ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+        goto done;
+    }
+
+    if (fakeIsJpeg(pInst->src.format) == true) {
+        int iOutW = pInst->dst.width;
+        int iOutH = pInst->dst.height;
+        int iJpegSize = (0 < pInst->src.sizeimage && pInst->src.sizeimage < iSrcSize) ?
+                        pInst->src.sizeimage : iSrcSize;
+
+        if (iOutW <= 0 || iOutH <= 0) {
+            iRet = jpegSwGetSize(pcSrc, iJpegSize, &iOutW, &iOutH);
+            if (iRet != ExynosJpegBase::ERROR_NONE)
+                goto done;
+        }
+
+        if (iDstSize < fakeFrameSize(pInst->dst.format, iOutW, iOutH)) {
+            iRet = ExynosJpegBase::ERROR_BUFFER_TOO_SMALL;
+            goto done;
+        }
+
+        iRet = jpegSwDecode(pcSrc, iJpegSize, pInst->dst.format, pcDst,
+                            0, 0, 0, 0, iOutW, iOutH, piImageW, piImageH);
+        if (iRet == ExynosJpegBase::ERROR_NONE)
+            pDst->bytesused = fakeFrameSize(pInst->dst.format, iOutW, iOutH);
+    } else {
+        int iJpegSize = 0;
+
+        if (iSrcSize < fakeFrameSize(pInst->src.format, pInst->src.width, pInst->src.height)) {
+            iRet = ExynosJpegBase::ERROR_BUFFER_TOO_SMALL;
+            goto done;
+        }
+
+        iRet = jpegSwEncode(pcSrc, pInst->src.format, pInst->src.width, pInst->src.height,
+                            pInst->dst.format, pInst->quality, pcDst, iDstSize, &iJpegSize);
+        if (iRet == ExynosJpegBase::ERROR_NONE)
+            pDst->bytesused = iJpegSize;
+    }
+
+done:
+    if (iRet != ExynosJpegBase::ERROR_NONE) {
+        JPEG_ERROR_LOG("[%s]: job failed(%d)\n", __func__, iRet);
+        pSrc->error = true;
+        pDst->error = true;
+    }
+
+    if (pcDst != NULL && bDstAlloc == true && iRet == ExynosJpegBase::ERROR_NONE &&
+        jpegSwScatterBuf(&stDst, stDst.numOfPlanes, pcDst) != ExynosJpegBase::ERROR_NONE) {
+        pSrc->error = true;
+        pDst->error = true;
+    }
+
+    if (pcSrc != NULL)
+        jpegSwUnmapBuf(&stSrc, pcSrc, bSrcAlloc);
+    if (pcDst != NULL)
+        jpegSwUnmapBuf(&stDst, pcDst, bDstAlloc);
+}
+
+/* the JPEG block : one job of any instance at a time */
+static void *fakeWorker(void *pArg)
+{
+    pthread_mutex_lock(&fakeLock);
+
+    while (1) {
+        struct FAKE_INSTANCE *pInst = NULL;
+        struct FAKE_BUF stSrc;
+        struct FAKE_BUF stDst;
+        int iImageW = 0;
+        int iImageH = 0;
+
+        /* the instances take turns */
+        for (int i = 0; i < FAKE_MAX_INSTANCE && pInst == NULL; i++) {
+            int iIndex = (fakeNext + i) % FAKE_MAX_INSTANCE;
+
+            if (fakeRunnable(&fakeInstance[iIndex]) == true) {
+                pInst = &fakeInstance[iIndex];
+                fakeNext = iIndex + 1;
+            }
+        }
+
+        if (pInst == NULL) {
+            pthread_cond_wait(&fakeCond, &fakeLock);
+            continue;
+        }
+
+        stSrc = pInst->src.queued[0];
+        stDst = pInst->dst.queued[0];
+        memmove(&pInst->src.queued[0], &pInst->src.queued[1],
+                (pInst->src.numOfQueued - 1) * sizeof(struct FAKE_BUF));
+        memmove(&pInst->dst.queued[0], &pInst->dst.queued[1],
+                (pInst->dst.numOfQueued - 1) * sizeof(struct FAKE_BUF));
+        pInst->src.numOfQueued--;
+        pInst->dst.numOfQueued--;
+        pInst->running = true;
+
+        /* the formats do not change while streaming, STREAMOFF waits for us */
+        pthread_mutex_unlock(&fakeLock);
+
+        fakeRunJob(pInst, &stSrc, &stDst, &iImageW, &iImageH);
+        if (0 < fakeLatencyUs)
+            usleep(fakeLatencyUs);
+
+        pthread_mutex_lock(&fakeLock);
+
+        pInst->running = false;
+        if (0 < iImageW) {
+            pInst->imageW = iImageW;
+            pInst->imageH = iImageH;
+        }
+
+        pInst->src.done[pInst->src.numOfDone++] = stSrc;
+        pInst->dst.done[pInst->dst.numOfDone++] = stDst;
+        eventfd_write(pInst->fd, 1);
+
+        pthread_cond_broadcast(&fakeCond);
+    }
+
+    pthread_mutex_unlock(&fakeLock);
+
+    return NULL;
+}
+
+static int fakeSetFmt(struct FAKE_INSTANCE *pInst, struct v4l2_format *pFmt)
+{
+    struct FAKE_QUEUE *pQueue = fakeQueue(pInst, pFmt->type);
+
+    if (pQueue == NULL)
+        return fakeFail(EINVAL);
+
+    if (pQueue->streaming == true)
+        return fakeFail(EBUSY);
+
+    pQueue->format = pFmt->fmt.pix_mp.pixelformat;
+    pQueue->width = pFmt->fmt.pix_mp.width;
+    pQueue->height = pFmt->fmt.pix_mp.height;
+    pQueue->sizeimage = pFmt->fmt.pix_mp.plane_fmt[0].sizeimage;
+
+    pInst->imageW = 0;
+    pInst->imageH = 0;
+
+    return 0;
+}
+
+static int fakeGetFmt(struct FAKE_INSTANCE *pInst, struct v4l2_format *pFmt)
+{
+    struct FAKE_QUEUE *pQueue = fakeQueue(pInst, pFmt->type);
+
+    if (pQueue == NULL)
+        return fakeFail(EINVAL);
+
+    pFmt->fmt.pix_mp.pixelformat = pQueue->format;
+    pFmt->fmt.pix_mp.width = pQueue->width;
+    pFmt->fmt.pix_mp.height = pQueue->height;
+
+    /* after a decode the node reports the size of the decoded image */
+    if (pQueue == &pInst->dst && fakeIsJpeg(pInst->src.format) == true && 0 < pInst->imageW) {
+        pFmt->fmt.pix_mp.width = pInst->imageW;
+        pFmt->fmt.pix_mp.height = pInst->imageH;
+    }
+
+    return 0;
+}
+
+static int fakeQbuf(struct FAKE_INSTANCE *pInst, struct v4l2_buffer *pBuf)
+{
+    struct FAKE_QUEUE *pQueue = fakeQueue(pInst, pBuf->type);
+    struct FAKE_BUF *pFake = NULL;
+
+    if (pQueue == NULL || pBuf->m.planes == NULL ||
+        pBuf->length <= 0 || JPEG_MAX_PLANE_CNT < pBuf->length)
+        return fakeFail(EINVAL);
+
+    if (pBuf->memory != V4L2_MEMORY_USERPTR && pBuf->memory != V4L2_MEMORY_DMABUF)
+        return fakeFail(EINVAL);
+
+    if (FAKE_MAX_QUEUED <= pQueue->numOfQueued + pQueue->numOfDone)
+        return fakeFail(EBUSY);
+
+    pFake = &pQueue->queued[pQueue->numOfQueued];
+    memset(pFake, 0, sizeof(struct FAKE_BUF));
+
+    pFake->index = pBuf->index;
+    pFake->memory = pBuf->memory;
+    pFake->numOfPlanes = pBuf->length;
+    for (unsigned int i = 0; i < pBuf->length; i++) {
+        if (pBuf->memory == V4L2_MEMORY_DMABUF)
+            pFake->addr[i] = (unsigned long)pBuf->m.planes[i].m.fd;
+        else
+            pFake->addr[i] = pBuf->m.planes[i].m.userptr;
+        pFake->length[i] = pBuf->m.planes[i].length;
+
+        /* fd 0 is a valid dma-buf, a null user pointer is not */
+        if (pBuf->memory == V4L2_MEMORY_DMABUF && (int)pFake->addr[i] < 0)
+            return fakeFail(EINVAL);
+        if (pBuf->memory == V4L2_MEMORY_USERPTR && pFake->addr[i] == 0)
+            return fakeFail(EINVAL);
+        if (pFake->length[i] <= 0)
+            return fakeFail(EINVAL);
+    }
+
+    pQueue->numOfQueued++;
+
+    return 0;
+}
+
+/* called with fakeLock held, blocks until a job is done */
+static int fakeDqbuf(struct FAKE_INSTANCE *pInst, struct v4l2_buffer *pBuf)
+{
+    struct FAKE_QUEUE *pQueue = fakeQueue(pInst, pBuf->type);
+    struct FAKE_BUF stDone;
+    eventfd_t ullCount;
+
+    if (pQueue == NULL)
+        return fakeFail(EINVAL);
+
+    while (pQueue->numOfDone == 0) {
+        if (pInst->running == false &&
+            (pInst->src.streaming == false || pInst->dst.streaming == false ||
+             pInst->src.numOfQueued == 0 || pInst->dst.numOfQueued == 0)) {
+            /* the real node would block forever here */
+            JPEG_ERROR_LOG("[%s]: nothing to run\n", __func__);
+            return fakeFail(EINVAL);
+        }
+
+        pthread_cond_wait(&fakeCond, &fakeLock);
+    }
+
+    stDone = pQueue->done[0];
+    memmove(&pQueue->done[0], &pQueue->done[1], (pQueue->numOfDone - 1) * sizeof(struct FAKE_BUF));
+    pQueue->numOfDone--;
+
+    /* poll() reports the instance until all of its results are dequeued */
+    if (pInst->src.numOfDone == 0 && pInst->dst.numOfDone == 0)
+        eventfd_read(pInst->fd, &ullCount);
+
+    pBuf->index = stDone.index;
+    pBuf->flags = (stDone.error == true) ? V4L2_BUF_FLAG_ERROR : 0;
+    if (pBuf->m.planes != NULL && 0 < pBuf->length)
+        pBuf->m.planes[0].bytesused = stDone.bytesused;
+
+    return 0;
+}
+
+static int fakeOpen(const char *pcPath, int iFlags)
+{
+    struct FAKE_INSTANCE *pInst = NULL;
+    int iFd = -1;
+
+    pthread_mutex_lock(&fakeLock);
+
+    if (fakeWorkerStarted == false) {
+        pthread_t worker;
+
+        if (pthread_create(&worker, NULL, fakeWorker, NULL) != 0) {
+            pthread_mutex_unlock(&fakeLock);
+            JPEG_ERROR_LOG("[%s]: no worker thread\n", __func__);
+            return fakeFail(ENOMEM);
+        }
+        pthread_detach(worker);
+        fakeWorkerStarted = true;
+    }
+
+    for (int i = 0; i < FAKE_MAX_INSTANCE; i++) {
+        if (fakeInstance[i].used == false) {
+            pInst = &fakeInstance[i];
+            break;
+        }
+    }
+
+    if (pInst == NULL) {
+        pthread_mutex_unlock(&fakeLock);
+        JPEG_ERROR_LOG("[%s]: too many instances(%s)\n", __func__, pcPath);
+        return fakeFail(EBUSY);
+    }
+
+    /* poll() on the handle waits for the worker */
+    iFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (0 <= iFd) {
+        memset(pInst, 0, sizeof(struct FAKE_INSTANCE));
+        pInst->used = true;
+        pInst->fd = iFd;
+        pInst->quality = jpegSwQualityOfLevel(0);
+    }
+
+    pthread_mutex_unlock(&fakeLock);
+
+    return iFd;
+}
+
+static int fakeClose(int iFd)
+{
+    struct FAKE_INSTANCE *pInst = NULL;
+
+    pthread_mutex_lock(&fakeLock);
+
+    pInst = fakeFind(iFd);
+    if (pInst != NULL) {
+        /* the buffers of a running job are the caller's */
+        while (pInst->running == true)
+            pthread_cond_wait(&fakeCond, &fakeLock);
+        pInst->used = false;
+    }
+
+    pthread_mutex_unlock(&fakeLock);
+
+    if (pInst == NULL)
+        return fakeFail(EBADF);
+
+    return close(iFd);
+}
+
+static int fakeIoctl(int iFd, unsigned long ulReq, void *pArg)
+{
+    struct FAKE_INSTANCE *pInst = NULL;
+    struct FAKE_QUEUE *pQueue = NULL;
+    int iRet = 0;
+
+    pthread_mutex_lock(&fakeLock);
+
+    pInst = fakeFind(iFd);
+    if (pInst == NULL) {
+        pthread_mutex_unlock(&fakeLock);
+        return fakeFail(EBADF);
+    }
+
+    switch (ulReq) {
+    case VIDIOC_QUERYCAP:
+    {
+        struct v4l2_capability *pCap = (struct v4l2_capability *)pArg;
+
+        memset(pCap, 0, sizeof(struct v4l2_capability));
+        strncpy((char *)pCap->driver, "jpeg-fake", sizeof(pCap->driver) - 1);
+        strncpy((char *)pCap->card, "jpeg-fake", sizeof(pCap->card) - 1);
+        pCap->capabilities = V4L2_CAP_VIDEO_M2M_MPLANE | V4L2_CAP_STREAMING;
+        break;
+    }
+    case VIDIOC_S_JPEGCOMP:
+    {
+        /* S_JPEGCOMP carries ExynosJpegEncoder::QUALITY_LEVEL_* */
+        int iQuality = jpegSwQualityOfLevel(((struct v4l2_jpegcompression *)pArg)->quality);
+
+        if (iQuality < 0)
+            iRet = fakeFail(EINVAL);
+        else
+            pInst->quality = iQuality;
+        break;
+    }
+    case VIDIOC_S_FMT:
+        iRet = fakeSetFmt(pInst, (struct v4l2_format *)pArg);
+        break;
+    case VIDIOC_G_FMT:
+        iRet = fakeGetFmt(pInst, (struct v4l2_format *)pArg);
+        break;
+    case VIDIOC_REQBUFS:
+    {
+        struct v4l2_requestbuffers *pReq = (struct v4l2_requestbuffers *)pArg;
+
+        pQueue = fakeQueue(pInst, pReq->type);
+        if (pQueue == NULL || pQueue->streaming == true) {
+            iRet = fakeFail((pQueue == NULL) ? EINVAL : EBUSY);
+            break;
+        }
+
+        fakeFlush(pInst, pQueue);
+        if (FAKE_MAX_QUEUED < pReq->count)
+            pReq->count = FAKE_MAX_QUEUED;
+        break;
+    }
+    case VIDIOC_QBUF:
+        iRet = fakeQbuf(pInst, (struct v4l2_buffer *)pArg);
+        pthread_cond_broadcast(&fakeCond);
+        break;
+    case VIDIOC_DQBUF:
+        iRet = fakeDqbuf(pInst, (struct v4l2_buffer *)pArg);
+        break;
+    case VIDIOC_STREAMON:
+    case VIDIOC_STREAMOFF:
+        pQueue = fakeQueue(pInst, *(int *)pArg);
+        if (pQueue == NULL) {
+            iRet = fakeFail(EINVAL);
+            break;
+        }
+
+        /* STREAMOFF waits for the running job and returns its buffers */
+        while (ulReq == VIDIOC_STREAMOFF && pInst->running == true)
+            pthread_cond_wait(&fakeCond, &fakeLock);
+
+        pQueue->streaming = (ulReq == VIDIOC_STREAMON);
+        if (pQueue->streaming == false)
+            fakeFlush(pInst, pQueue);
+        pthread_cond_broadcast(&fakeCond);
+        break;
+    case VIDIOC_S_CTRL:
+        break;
+    case VIDIOC_G_CTRL:
+        ((struct v4l2_control *)pArg)->value = 0;
+        break;
+    default:
+        /* QUERYBUF : MMAP memory is not supported */
+        iRet = fakeFail(ENOTTY);
+        break;
+    }
+
+    pthread_mutex_unlock(&fakeLock);
+
+    return iRet;
+}
+
+static void *fakeMmap(void *pAddr, size_t iLen, int iProt, int iFlags, int iFd, off_t iOff)
+{
+    errno = ENODEV;
+
+    return MAP_FAILED;
+}
+
+static int fakeMunmap(void *pAddr, size_t iLen)
+{
+    return munmap(pAddr, iLen);
+}
+
+static const struct ExynosJpegBase::DEVICE_OPS fakeOps = {
+    "fake",
+    fakeOpen,
+    fakeClose,
+    fakeIoctl,
+    fakeMmap,
+    fakeMunmap,
+};
+
+const struct ExynosJpegBase::DEVICE_OPS *getJpegFakeDeviceOps(void)
+{
+    return &fakeOps;
+}
+
+void setJpegFakeDeviceLatency(int iLatencyUs)
+{
+    fakeLatencyUs = (iLatencyUs < 0) ? 0 : iLatencyUs;
+}
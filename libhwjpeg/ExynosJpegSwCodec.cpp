@@ -0,0 +1,995 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <cutils/log.h>
+#include <utils/Log.h>
+
+extern "C" {
+#include "jpeglib.h"
+#include "jerror.h"
+}
+
+#include "ExynosJpegApi.h"
+#include "ExynosJpegSwCodec.h"
+
+#define JPEG_ERROR_LOG(fmt,...) ALOGE(fmt,##__VA_ARGS__)
+
+struct SW_ERR {
+    struct jpeg_error_mgr pub;
+    jmp_buf jmp;
+};
+
+static void swErrorExit(j_common_ptr cinfo)
+{
+    char msg[JMSG_LENGTH_MAX];
+    struct SW_ERR *err = (struct SW_ERR *)cinfo->err;
+
+    (*cinfo->err->format_message)(cinfo, msg);
+    JPEG_ERROR_LOG("[%s]: %s\n", __func__, msg);
+
+    longjmp(err->jmp, 1);
+}
+
+/* memory source, libjpeg 6b has no jpeg_mem_src() */
+static void swInitSource(j_decompress_ptr cinfo)
+{
+}
+
+static boolean swFillInputBuffer(j_decompress_ptr cinfo)
+{
+    static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+
+    /* truncated stream : feed EOI, libjpeg finishes with a warning */
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+
+    return TRUE;
+}
+
+static void swSkipInputData(j_decompress_ptr cinfo, long num_bytes)
+{
+    if (num_bytes <= 0)
+        return;
+
+    if ((size_t)num_bytes > cinfo->src->bytes_in_buffer) {
+        swFillInputBuffer(cinfo);
+        return;
+    }
+
+    cinfo->src->next_input_byte += num_bytes;
+    cinfo->src->bytes_in_buffer -= num_bytes;
+}
+
+static void swTermSource(j_decompress_ptr cinfo)
+{
+}
+
+static void swSetSource(j_decompress_ptr cinfo, struct jpeg_source_mgr *pSrc,
+                        const char *pcJpeg, int iJpegSize)
+{
+    pSrc->init_source = swInitSource;
+    pSrc->fill_input_buffer = swFillInputBuffer;
+    pSrc->skip_input_data = swSkipInputData;
+    pSrc->resync_to_restart = jpeg_resync_to_restart;
+    pSrc->term_source = swTermSource;
+    pSrc->next_input_byte = (const JOCTET *)pcJpeg;
+    pSrc->bytes_in_buffer = iJpegSize;
+    cinfo->src = pSrc;
+}
+
+/* memory destination, running out of room is an error */
+static void swInitDestination(j_compress_ptr cinfo)
+{
+}
+
+static boolean swEmptyOutputBuffer(j_compress_ptr cinfo)
+{
+    ERREXIT(cinfo, JERR_BUFFER_SIZE);
+
+    return FALSE;
+}
+
+static void swTermDestination(j_compress_ptr cinfo)
+{
+}
+
+static bool swIsRgb(int iFormat)
+{
+    switch (iFormat) {
+    case V4L2_PIX_FMT_RGB565X:
+    case V4L2_PIX_FMT_RGB32:
+    case V4L2_PIX_FMT_BGR32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool swIsSupported(int iFormat)
+{
+    switch (iFormat) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_RGB565X:
+    case V4L2_PIX_FMT_RGB32:
+    case V4L2_PIX_FMT_BGR32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void swGetPixel(const JSAMPLE *pSrc, int iComps, bool bRgb,
+                       int *piY, int *piCb, int *piCr, int *piR, int *piG, int *piB)
+{
+    if (iComps == 1) {
+        *piY = *piR = *piG = *piB = pSrc[0];
+        *piCb = *piCr = 128;
+    } else if (bRgb == true) {
+        *piR = pSrc[0];
+        *piG = pSrc[1];
+        *piB = pSrc[2];
+    } else {
+        *piY = pSrc[0];
+        *piCb = pSrc[1];
+        *piCr = pSrc[2];
+    }
+}
+
+/* packs output row iRow from pixels already picked for the output columns */
+static void swPackRow(int iFormat, char *pcOut, int iOutW, int iOutH, int iRow,
+                      const JSAMPLE *pSrc, int iComps)
+{
+    bool bRgb = swIsRgb(iFormat);
+    int y = 0, cb = 128, cr = 128, r = 0, g = 0, b = 0;
+    unsigned char *pDst = NULL;
+
+    switch (iFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        pDst = (unsigned char *)pcOut + iRow * iOutW * 2;
+        for (int i = 0; i < iOutW; i++) {
+            swGetPixel(pSrc + i * iComps, iComps, bRgb, &y, &cb, &cr, &r, &g, &b);
+            pDst[i * 2] = y;
+            pDst[i * 2 + 1] = (i & 1) ? cr : cb;
+        }
+        break;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_YUV420:
+        pDst = (unsigned char *)pcOut + iRow * iOutW;
+        for (int i = 0; i < iOutW; i++) {
+            swGetPixel(pSrc + i * iComps, iComps, bRgb, &y, &cb, &cr, &r, &g, &b);
+            pDst[i] = y;
+        }
+
+        /* chroma is taken from the even rows */
+        if (iRow & 1)
+            break;
+
+        for (int i = 0; i < iOutW; i += 2) {
+            unsigned char *pC = (unsigned char *)pcOut + iOutW * iOutH;
+
+            swGetPixel(pSrc + i * iComps, iComps, bRgb, &y, &cb, &cr, &r, &g, &b);
+
+            if (iFormat == V4L2_PIX_FMT_YUV420) {
+                pC[(iRow >> 1) * (iOutW >> 1) + (i >> 1)] = cb;
+                pC[((iOutW * iOutH) >> 2) + (iRow >> 1) * (iOutW >> 1) + (i >> 1)] = cr;
+            } else {
+                pC += (iRow >> 1) * iOutW + i;
+                pC[0] = (iFormat == V4L2_PIX_FMT_NV12) ? cb : cr;
+                pC[1] = (iFormat == V4L2_PIX_FMT_NV12) ? cr : cb;
+            }
+        }
+        break;
+    case V4L2_PIX_FMT_RGB565X:
+        pDst = (unsigned char *)pcOut + iRow * iOutW * 2;
+        for (int i = 0; i < iOutW; i++) {
+            swGetPixel(pSrc + i * iComps, iComps, bRgb, &y, &cb, &cr, &r, &g, &b);
+            pDst[i * 2] = (r & 0xF8) | (g >> 5);
+            pDst[i * 2 + 1] = ((g << 3) & 0xE0) | (b >> 3);
+        }
+        break;
+    case V4L2_PIX_FMT_RGB32:
+    case V4L2_PIX_FMT_BGR32:
+        pDst = (unsigned char *)pcOut + iRow * iOutW * 4;
+        for (int i = 0; i < iOutW; i++) {
+            swGetPixel(pSrc + i * iComps, iComps, bRgb, &y, &cb, &cr, &r, &g, &b);
+            if (iFormat == V4L2_PIX_FMT_RGB32) {
+                pDst[i * 4] = 0xFF;
+                pDst[i * 4 + 1] = r;
+                pDst[i * 4 + 2] = g;
+                pDst[i * 4 + 3] = b;
+            } else {
+                pDst[i * 4] = b;
+                pDst[i * 4 + 1] = g;
+                pDst[i * 4 + 2] = r;
+                pDst[i * 4 + 3] = 0xFF;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* unpacks input row iRow into YCbCr (yuv formats) or RGB (rgb formats) triplets */
+static void swUnpackRow(int iFormat, const char *pcIn, int iW, int iH, int iRow, JSAMPLE *pDst)
+{
+    const unsigned char *pSrc = (const unsigned char *)pcIn;
+    const unsigned char *pC = NULL;
+
+    switch (iFormat) {
+    case V4L2_PIX_FMT_YUYV:
+        pSrc += iRow * iW * 2;
+        for (int i = 0; i < iW; i++) {
+            pDst[i * 3] = pSrc[i * 2];
+            pDst[i * 3 + 1] = pSrc[(i & ~1) * 2 + 1];
+            /* with an odd width the last pixel has no Cr, it takes the one of the pair before */
+            if ((i | 1) < iW)
+                pDst[i * 3 + 2] = pSrc[(i & ~1) * 2 + 3];
+            else
+                pDst[i * 3 + 2] = (2 <= i) ? pSrc[(i - 2) * 2 + 3] : 128;
+        }
+        break;
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+        pC = pSrc + iW * iH + (iRow >> 1) * iW;
+        pSrc += iRow * iW;
+        for (int i = 0; i < iW; i++) {
+            pDst[i * 3] = pSrc[i];
+            pDst[i * 3 + 1] = pC[(i & ~1) + ((iFormat == V4L2_PIX_FMT_NV12) ? 0 : 1)];
+            pDst[i * 3 + 2] = pC[(i & ~1) + ((iFormat == V4L2_PIX_FMT_NV12) ? 1 : 0)];
+        }
+        break;
+    case V4L2_PIX_FMT_YUV420:
+        pC = pSrc + iW * iH + (iRow >> 1) * (iW >> 1);
+        pSrc += iRow * iW;
+        for (int i = 0; i < iW; i++) {
+            pDst[i * 3] = pSrc[i];
+            pDst[i * 3 + 1] = pC[i >> 1];
+            pDst[i * 3 + 2] = pC[((iW * iH) >> 2) + (i >> 1)];
+        }
+        break;
+    case V4L2_PIX_FMT_RGB565X:
+        pSrc += iRow * iW * 2;
+        for (int i = 0; i < iW; i++) {
+            int v = (pSrc[i * 2] << 8) | pSrc[i * 2 + 1];
+            pDst[i * 3] = ((v >> 11) & 0x1F) << 3;
+            pDst[i * 3 + 1] = ((v >> 5) & 0x3F) << 2;
+            pDst[i * 3 + 2] = (v & 0x1F) << 3;
+        }
+        break;
+    case V4L2_PIX_FMT_RGB32:
+        pSrc += iRow * iW * 4;
+        for (int i = 0; i < iW; i++) {
+            pDst[i * 3] = pSrc[i * 4 + 1];
+            pDst[i * 3 + 1] = pSrc[i * 4 + 2];
+            pDst[i * 3 + 2] = pSrc[i * 4 + 3];
+        }
+        break;
+    case V4L2_PIX_FMT_BGR32:
+        pSrc += iRow * iW * 4;
+        for (int i = 0; i < iW; i++) {
+            pDst[i * 3] = pSrc[i * 4 + 2];
+            pDst[i * 3 + 1] = pSrc[i * 4 + 1];
+            pDst[i * 3 + 2] = pSrc[i * 4];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+int jpegSwGetSize(const char *pcJpeg, int iJpegSize, int *piW, int *piH)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_source_mgr src;
+    struct SW_ERR jerr;
+
+    if (pcJpeg == NULL || iJpegSize <= 0)
+        return ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = swErrorExit;
+
+    if (setjmp(jerr.jmp)) {
+        jpeg_destroy_decompress(&cinfo);
+        return ExynosJpegBase::ERROR_INVALID_JPEG_FORMAT;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    swSetSource(&cinfo, &src, pcJpeg, iJpegSize);
+    jpeg_read_header(&cinfo, TRUE);
+
+    *piW = cinfo.image_width;
+    *piH = cinfo.image_height;
+
+    jpeg_destroy_decompress(&cinfo);
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+int jpegSwDecode(const char *pcJpeg, int iJpegSize, int iFormat, char *pcOut,
+                 int iSrcX, int iSrcY, int iSrcW, int iSrcH, int iOutW, int iOutH,
+                 int *piImageW, int *piImageH)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_source_mgr src;
+    struct SW_ERR jerr;
+    /* volatile : must survive the longjmp from swErrorExit() */
+    JSAMPLE * volatile pRow = NULL;
+    JSAMPLE * volatile pPicked = NULL;
+    int iShift = 0;
+    int iX = 0, iY = 0, iW = 0, iH = 0;
+    int iComps = 0;
+    int iOutRow = 0;
+
+    if (pcJpeg == NULL || pcOut == NULL || iJpegSize <= 0)
+        return ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+
+    if (swIsSupported(iFormat) == false)
+        return ExynosJpegBase::ERROR_INVALID_COLOR_FORMAT;
+
+    if (iOutW <= 0 || iOutH <= 0)
+        return ExynosJpegBase::ERROR_INVALID_IMAGE_SIZE;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = swErrorExit;
+
+    if (setjmp(jerr.jmp)) {
+        jpeg_destroy_decompress(&cinfo);
+        if (pRow != NULL)
+            free(pRow);
+        if (pPicked != NULL)
+            free(pPicked);
+        return ExynosJpegBase::ERROR_EXCUTE_FAIL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    swSetSource(&cinfo, &src, pcJpeg, iJpegSize);
+    jpeg_read_header(&cinfo, TRUE);
+
+    if (piImageW != NULL)
+        *piImageW = cinfo.image_width;
+    if (piImageH != NULL)
+        *piImageH = cinfo.image_height;
+
+    if (iSrcW == 0 || iSrcH == 0) {
+        iSrcX = 0;
+        iSrcY = 0;
+        iSrcW = cinfo.image_width;
+        iSrcH = cinfo.image_height;
+    }
+
+    if (iSrcX < 0 || iSrcY < 0 ||
+        cinfo.image_width < (JDIMENSION)(iSrcX + iSrcW) ||
+        cinfo.image_height < (JDIMENSION)(iSrcY + iSrcH)) {
+        JPEG_ERROR_LOG("[%s]: source(%d,%d %dx%d) is out of image(%dx%d)\n", __func__,
+            iSrcX, iSrcY, iSrcW, iSrcH, cinfo.image_width, cinfo.image_height);
+        jpeg_destroy_decompress(&cinfo);
+        return ExynosJpegBase::ERROR_INVALID_IMAGE_SIZE;
+    }
+
+    /* the smallest IDCT output that still covers the requested size */
+    while (iShift < 3 &&
+           iOutW <= (iSrcW >> (iShift + 1)) &&
+           iOutH <= (iSrcH >> (iShift + 1)))
+        iShift++;
+
+    if (cinfo.jpeg_color_space == JCS_GRAYSCALE)
+        cinfo.out_color_space = JCS_GRAYSCALE;
+    else
+        cinfo.out_color_space = (swIsRgb(iFormat) == true) ? JCS_RGB : JCS_YCbCr;
+
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1 << iShift;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+
+    jpeg_start_decompress(&cinfo);
+
+    iComps = cinfo.output_components;
+    iX = iSrcX >> iShift;
+    iY = iSrcY >> iShift;
+    iW = iSrcW >> iShift;
+    iH = iSrcH >> iShift;
+    if (cinfo.output_width < (JDIMENSION)(iX + iW))
+        iW = cinfo.output_width - iX;
+    if (cinfo.output_height < (JDIMENSION)(iY + iH))
+        iH = cinfo.output_height - iY;
+
+    pRow = (JSAMPLE *)malloc(cinfo.output_width * iComps);
+    pPicked = (JSAMPLE *)malloc(iOutW * iComps);
+    if (pRow == NULL || pPicked == NULL) {
+        jpeg_destroy_decompress(&cinfo);
+        if (pRow != NULL)
+            free(pRow);
+        if (pPicked != NULL)
+            free(pPicked);
+        return ExynosJpegBase::ERROR_OUT_BUFFER_CREATE_FAIL;
+    }
+
+    /* output row r comes from scaled row iY + r * iH / iOutH, the same for columns */
+    while (iOutRow < iOutH) {
+        JSAMPROW pRowPtr = pRow;
+        int iLine = cinfo.output_scanline;
+
+        jpeg_read_scanlines(&cinfo, &pRowPtr, 1);
+
+        while (iOutRow < iOutH && iY + iOutRow * iH / iOutH == iLine) {
+            if (iW == iOutW) {
+                memcpy(pPicked, pRow + iX * iComps, iOutW * iComps);
+            } else {
+                for (int i = 0; i < iOutW; i++)
+                    memcpy(pPicked + i * iComps, pRow + (iX + i * iW / iOutW) * iComps, iComps);
+            }
+
+            swPackRow(iFormat, pcOut, iOutW, iOutH, iOutRow, pPicked, iComps);
+            iOutRow++;
+        }
+    }
+
+    /* the rows below the last one needed are never decoded */
+    jpeg_abort_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    free(pRow);
+    free(pPicked);
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+/* rows [iRowStart, iRowStart + iRows) of the source, as a picture of its own */
+static int swEncodeRows(const char *pcIn, int iFormat, int iW, int iH, int iStep,
+                        int iRowStart, int iRows, int iJpegFormat, int iQuality,
+                        char *pcJpeg, int iJpegBufSize, int *piJpegSize)
+{
+    struct jpeg_compress_struct cinfo;
+    struct jpeg_destination_mgr dest;
+    struct SW_ERR jerr;
+    /* volatile : must survive the longjmp from swErrorExit() */
+    JSAMPLE * volatile pRow = NULL;
+
+    if (pcIn == NULL || pcJpeg == NULL || iJpegBufSize <= 0)
+        return ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+
+    if (swIsSupported(iFormat) == false)
+        return ExynosJpegBase::ERROR_INVALID_COLOR_FORMAT;
+
+    if (iW <= 0 || iH <= 0 || iStep <= 0 || iW < iStep || iRows < iStep ||
+        iRowStart < 0 || iH < iRowStart + iRows)
+        return ExynosJpegBase::ERROR_INVALID_IMAGE_SIZE;
+
+    pRow = (JSAMPLE *)malloc(iW * 3);
+    if (pRow == NULL)
+        return ExynosJpegBase::ERROR_OUT_BUFFER_CREATE_FAIL;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = swErrorExit;
+
+    if (setjmp(jerr.jmp)) {
+        jpeg_destroy_compress(&cinfo);
+        free(pRow);
+        return ExynosJpegBase::ERROR_EXCUTE_FAIL;
+    }
+
+    jpeg_create_compress(&cinfo);
+
+    dest.init_destination = swInitDestination;
+    dest.empty_output_buffer = swEmptyOutputBuffer;
+    dest.term_destination = swTermDestination;
+    dest.next_output_byte = (JOCTET *)pcJpeg;
+    dest.free_in_buffer = iJpegBufSize;
+    cinfo.dest = &dest;
+
+    cinfo.image_width = iW / iStep;
+    cinfo.image_height = iRows / iStep;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = (swIsRgb(iFormat) == true) ? JCS_RGB : JCS_YCbCr;
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, iQuality, TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+
+    switch (iJpegFormat) {
+    case V4L2_PIX_FMT_JPEG_GRAY:
+        jpeg_set_colorspace(&cinfo, JCS_GRAYSCALE);
+        break;
+    case V4L2_PIX_FMT_JPEG_444:
+        cinfo.comp_info[0].h_samp_factor = 1;
+        cinfo.comp_info[0].v_samp_factor = 1;
+        break;
+    case V4L2_PIX_FMT_JPEG_422:
+        cinfo.comp_info[0].h_samp_factor = 2;
+        cinfo.comp_info[0].v_samp_factor = 1;
+        break;
+    case V4L2_PIX_FMT_JPEG_420:
+    default:
+        cinfo.comp_info[0].h_samp_factor = 2;
+        cinfo.comp_info[0].v_samp_factor = 2;
+        break;
+    }
+
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW pRowPtr = pRow;
+
+        swUnpackRow(iFormat, pcIn, iW, iH, iRowStart + cinfo.next_scanline * iStep, pRow);
+
+        /* in place, the picked pixel is never behind the one written */
+        for (JDIMENSION i = 1; 1 < iStep && i < cinfo.image_width; i++)
+            memcpy(pRow + i * 3, pRow + i * iStep * 3, 3);
+
+        jpeg_write_scanlines(&cinfo, &pRowPtr, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+
+    *piJpegSize = iJpegBufSize - dest.free_in_buffer;
+
+    jpeg_destroy_compress(&cinfo);
+    free(pRow);
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+int jpegSwQualityOfLevel(int iLevel)
+{
+    /* close to the quantization tables the JPEG block uses for each level */
+    static const int iQualityTable[] = { 96, 92, 80, 50, 34, 20 };
+
+    if (iLevel < 0 || (int)(sizeof(iQualityTable) / sizeof(int)) <= iLevel)
+        return -1;
+
+    return iQualityTable[iLevel];
+}
+
+int jpegSwEncode(const char *pcIn, int iFormat, int iW, int iH, int iJpegFormat, int iQuality,
+                 char *pcJpeg, int iJpegBufSize, int *piJpegSize)
+{
+    return jpegSwEncodeSubsampled(pcIn, iFormat, iW, iH, 1, iJpegFormat, iQuality,
+                                  pcJpeg, iJpegBufSize, piJpegSize);
+}
+
+int jpegSwEncodeSubsampled(const char *pcIn, int iFormat, int iW, int iH, int iStep,
+                           int iJpegFormat, int iQuality,
+                           char *pcJpeg, int iJpegBufSize, int *piJpegSize)
+{
+    return swEncodeRows(pcIn, iFormat, iW, iH, iStep, 0, iH, iJpegFormat, iQuality,
+                        pcJpeg, iJpegBufSize, piJpegSize);
+}
+
+/*
+ * Striped parallel encode.
+ *
+ * Stripes are whole MCU rows, so each one is a complete picture for libjpeg
+ * with the same tables and no padding inside the image. Every stripe ends
+ * the way a restart interval ends (byte aligned, DC predictors reset), so
+ * the entropy coded data of the stripes joined with RSTn markers, under the
+ * header of the first stripe with a DRI of one stripe and the full height,
+ * is the restart coded JPEG of the whole picture.
+ *
+ * Workers take stripes in order. A finished stripe is appended as soon as
+ * all stripes above it are. Until then it stays buffered, so a slow stripe
+ * holds back every stripe finished after it, up to the whole picture.
+ */
+#define SW_MAX_THREAD           (16)
+#define SW_STRIPE_PER_THREAD    (4)
+#define SW_STRIPE_MAX_ROWS      (256)
+
+/* jpeglib.h only names RST0 and EOI */
+#define SW_M_SOF0               (0xC0)
+#define SW_M_SOF1               (0xC1)
+#define SW_M_SOS                (0xDA)
+#define SW_M_DRI                (0xDD)
+
+struct SW_STRIPE {
+    char    *pcJpeg;
+    int     iJpegSize;
+    int     iRet;
+    bool    bDone;
+};
+
+struct SW_PARALLEL {
+    const char          *pcIn;
+    int                 iFormat;
+    int                 iW;
+    int                 iH;
+    int                 iJpegFormat;
+    int                 iQuality;
+    int                 iStripeRows;
+    int                 iNumOfStripe;
+    int                 iInterval;      /* MCUs of a stripe, DRI */
+    struct SW_STRIPE    *pstStripe;
+    int                 iNext;          /* next stripe to encode */
+    int                 iCommit;        /* next stripe to append */
+    char                *pcJpeg;
+    int                 iJpegBufSize;
+    int                 iJpegSize;
+    int                 iRet;
+    pthread_mutex_t     lock;
+};
+
+static int swGetBE16(const char *pcBuf)
+{
+    return (((unsigned char)pcBuf[0]) << 8) | ((unsigned char)pcBuf[1]);
+}
+
+static void swSetBE16(char *pcBuf, int iValue)
+{
+    pcBuf[0] = (char)((iValue >> 8) & 0xFF);
+    pcBuf[1] = (char)(iValue & 0xFF);
+}
+
+/* offsets of the frame header and of the entropy coded data, false when malformed */
+static bool swFindSegments(const char *pcJpeg, int iJpegSize, int *piSof, int *piSos, int *piData)
+{
+    int iOff = 2;
+
+    *piSof = -1;
+
+    while (iOff + 4 <= iJpegSize) {
+        int iMarker = (unsigned char)pcJpeg[iOff + 1];
+        int iLen = swGetBE16(pcJpeg + iOff + 2);
+
+        if ((unsigned char)pcJpeg[iOff] != 0xFF)
+            return false;
+
+        if (iMarker == SW_M_SOF0 || iMarker == SW_M_SOF1)
+            *piSof = iOff;
+
+        if (iMarker == SW_M_SOS) {
+            *piSos = iOff;
+            *piData = iOff + 2 + iLen;
+            return (0 <= *piSof && *piData + 2 <= iJpegSize);
+        }
+
+        iOff += 2 + iLen;
+    }
+
+    return false;
+}
+
+/* called with lock held, appends every finished stripe that is next in line */
+static void swCommitStripes(struct SW_PARALLEL *pstPar)
+{
+    while (pstPar->iCommit < pstPar->iNumOfStripe && pstPar->iRet == ExynosJpegBase::ERROR_NONE) {
+        struct SW_STRIPE *pstStripe = &pstPar->pstStripe[pstPar->iCommit];
+        const char *pcData;
+        int iSof, iSos, iData, iDataSize;
+        char *pcDst = pstPar->pcJpeg + pstPar->iJpegSize;
+        int iNeed;
+
+        if (pstStripe->bDone == false)
+            break;
+
+        if (pstStripe->iRet != ExynosJpegBase::ERROR_NONE) {
+            pstPar->iRet = pstStripe->iRet;
+            break;
+        }
+
+        if (swFindSegments(pstStripe->pcJpeg, pstStripe->iJpegSize, &iSof, &iSos, &iData) == false) {
+            JPEG_ERROR_LOG("[%s]: stripe %d is malformed\n", __func__, pstPar->iCommit);
+            pstPar->iRet = ExynosJpegBase::ERROR_EXCUTE_FAIL;
+            break;
+        }
+
+        /* entropy coded data, EOI stripped */
+        pcData = pstStripe->pcJpeg + iData;
+        iDataSize = pstStripe->iJpegSize - iData - 2;
+
+        /* header + DRI for the first stripe, RSTn for the others, EOI after the last */
+        iNeed = iDataSize + 2;
+        if (pstPar->iCommit == 0)
+            iNeed += iData + 6;
+        if (pstPar->iCommit == pstPar->iNumOfStripe - 1)
+            iNeed += 2;
+
+        if (pstPar->iJpegBufSize - pstPar->iJpegSize < iNeed) {
+            JPEG_ERROR_LOG("[%s]: output buffer(%d) is too small\n", __func__, pstPar->iJpegBufSize);
+            pstPar->iRet = ExynosJpegBase::ERROR_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        if (pstPar->iCommit == 0) {
+            memcpy(pcDst, pstStripe->pcJpeg, iSos);
+            swSetBE16(pcDst + iSof + 5, pstPar->iH);
+            pcDst += iSos;
+
+            pcDst[0] = (char)0xFF;
+            pcDst[1] = (char)SW_M_DRI;
+            swSetBE16(pcDst + 2, 4);
+            swSetBE16(pcDst + 4, pstPar->iInterval);
+            pcDst += 6;
+
+            memcpy(pcDst, pstStripe->pcJpeg + iSos, iData - iSos);
+            pcDst += iData - iSos;
+        } else {
+            pcDst[0] = (char)0xFF;
+            pcDst[1] = (char)(JPEG_RST0 + ((pstPar->iCommit - 1) & 7));
+            pcDst += 2;
+        }
+
+        memcpy(pcDst, pcData, iDataSize);
+        pcDst += iDataSize;
+
+        if (pstPar->iCommit == pstPar->iNumOfStripe - 1) {
+            pcDst[0] = (char)0xFF;
+            pcDst[1] = (char)JPEG_EOI;
+            pcDst += 2;
+        }
+
+        pstPar->iJpegSize = pcDst - pstPar->pcJpeg;
+
+        free(pstStripe->pcJpeg);
+        pstStripe->pcJpeg = NULL;
+        pstPar->iCommit++;
+    }
+}
+
+static void *swStripeThread(void *pArg)
+{
+    struct SW_PARALLEL *pstPar = (struct SW_PARALLEL *)pArg;
+
+    while (1) {
+        struct SW_STRIPE *pstStripe;
+        int iIndex, iRowStart, iRows, iBufSize;
+
+        pthread_mutex_lock(&pstPar->lock);
+        iIndex = pstPar->iNext;
+        if (iIndex < pstPar->iNumOfStripe && pstPar->iRet == ExynosJpegBase::ERROR_NONE)
+            pstPar->iNext++;
+        else
+            iIndex = -1;
+        pthread_mutex_unlock(&pstPar->lock);
+
+        if (iIndex < 0)
+            break;
+
+        pstStripe = &pstPar->pstStripe[iIndex];
+        iRowStart = iIndex * pstPar->iStripeRows;
+        iRows = pstPar->iH - iRowStart;
+        if (pstPar->iStripeRows < iRows)
+            iRows = pstPar->iStripeRows;
+
+        /* 4:4:4 raw size of the stripe, plus the header */
+        iBufSize = pstPar->iW * iRows * 3 + 4096;
+
+        pstStripe->pcJpeg = (char *)malloc(iBufSize);
+        if (pstStripe->pcJpeg == NULL)
+            pstStripe->iRet = ExynosJpegBase::ERROR_OUT_BUFFER_CREATE_FAIL;
+        else
+            pstStripe->iRet = swEncodeRows(pstPar->pcIn, pstPar->iFormat, pstPar->iW, pstPar->iH, 1,
+                                           iRowStart, iRows, pstPar->iJpegFormat, pstPar->iQuality,
+                                           pstStripe->pcJpeg, iBufSize, &pstStripe->iJpegSize);
+
+        pthread_mutex_lock(&pstPar->lock);
+        pstStripe->bDone = true;
+        swCommitStripes(pstPar);
+        pthread_mutex_unlock(&pstPar->lock);
+    }
+
+    return NULL;
+}
+
+int jpegSwEncodeParallel(const char *pcIn, int iFormat, int iW, int iH, int iJpegFormat, int iQuality,
+                         int iNumOfThreads, char *pcJpeg, int iJpegBufSize, int *piJpegSize)
+{
+    struct SW_PARALLEL stPar;
+    pthread_t thread[SW_MAX_THREAD];
+    int iNumOfThread = 0;
+    int iMcuW = 8, iMcuH = 8;
+    int iMcuPerRow, iMcuRows, iStripeMcuRows, iNumOfStripe;
+
+    if (pcIn == NULL || pcJpeg == NULL || iJpegBufSize <= 0)
+        return ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+
+    if (swIsSupported(iFormat) == false)
+        return ExynosJpegBase::ERROR_INVALID_COLOR_FORMAT;
+
+    if (iW <= 0 || iH <= 0)
+        return ExynosJpegBase::ERROR_INVALID_IMAGE_SIZE;
+
+    if (iNumOfThreads <= 0)
+        iNumOfThreads = 1;
+    if (SW_MAX_THREAD < iNumOfThreads)
+        iNumOfThreads = SW_MAX_THREAD;
+
+    switch (iJpegFormat) {
+    case V4L2_PIX_FMT_JPEG_422:
+        iMcuW = 16;
+        break;
+    case V4L2_PIX_FMT_JPEG_420:
+        iMcuW = 16;
+        iMcuH = 16;
+        break;
+    default:
+        break;
+    }
+
+    iMcuPerRow = (iW + iMcuW - 1) / iMcuW;
+    iMcuRows = (iH + iMcuH - 1) / iMcuH;
+
+    /* enough stripes to balance the workers, few enough rows to bound the memory */
+    iNumOfStripe = iNumOfThreads * SW_STRIPE_PER_THREAD;
+    if (iNumOfStripe < (iH + SW_STRIPE_MAX_ROWS - 1) / SW_STRIPE_MAX_ROWS)
+        iNumOfStripe = (iH + SW_STRIPE_MAX_ROWS - 1) / SW_STRIPE_MAX_ROWS;
+
+    iStripeMcuRows = (iMcuRows + iNumOfStripe - 1) / iNumOfStripe;
+
+    /* the restart interval is 16 bits */
+    if (65535 < iStripeMcuRows * iMcuPerRow)
+        iStripeMcuRows = 65535 / iMcuPerRow;
+    if (iStripeMcuRows <= 0)
+        return ExynosJpegBase::ERROR_INVALID_IMAGE_SIZE;
+
+    iNumOfStripe = (iMcuRows + iStripeMcuRows - 1) / iStripeMcuRows;
+
+    if (iNumOfThreads == 1 || iNumOfStripe == 1)
+        return jpegSwEncode(pcIn, iFormat, iW, iH, iJpegFormat, iQuality,
+                            pcJpeg, iJpegBufSize, piJpegSize);
+
+    memset(&stPar, 0, sizeof(struct SW_PARALLEL));
+    stPar.pcIn = pcIn;
+    stPar.iFormat = iFormat;
+    stPar.iW = iW;
+    stPar.iH = iH;
+    stPar.iJpegFormat = iJpegFormat;
+    stPar.iQuality = iQuality;
+    stPar.iStripeRows = iStripeMcuRows * iMcuH;
+    stPar.iNumOfStripe = iNumOfStripe;
+    stPar.iInterval = iStripeMcuRows * iMcuPerRow;
+    stPar.pcJpeg = pcJpeg;
+    stPar.iJpegBufSize = iJpegBufSize;
+    stPar.iRet = ExynosJpegBase::ERROR_NONE;
+
+    stPar.pstStripe = (struct SW_STRIPE *)calloc(iNumOfStripe, sizeof(struct SW_STRIPE));
+    if (stPar.pstStripe == NULL)
+        return ExynosJpegBase::ERROR_OUT_BUFFER_CREATE_FAIL;
+
+    pthread_mutex_init(&stPar.lock, NULL);
+
+    if (iNumOfStripe < iNumOfThreads)
+        iNumOfThreads = iNumOfStripe;
+
+    /* the caller is one of the workers */
+    for (int i = 0; i < iNumOfThreads - 1; i++) {
+        if (pthread_create(&thread[iNumOfThread], NULL, swStripeThread, &stPar) == 0)
+            iNumOfThread++;
+    }
+
+    swStripeThread(&stPar);
+
+    for (int i = 0; i < iNumOfThread; i++)
+        pthread_join(thread[i], NULL);
+
+    pthread_mutex_destroy(&stPar.lock);
+
+    for (int i = 0; i < iNumOfStripe; i++)
+        free(stPar.pstStripe[i].pcJpeg);
+    free(stPar.pstStripe);
+
+    if (stPar.iRet != ExynosJpegBase::ERROR_NONE)
+        return stPar.iRet;
+
+    *piJpegSize = stPar.iJpegSize;
+
+    return ExynosJpegBase::ERROR_NONE;
+}
+
+/* a plane is a dma-buf fd, fd 0 included, unless it carries a user pointer */
+static bool swIsFd(struct ExynosJpegBase::BUFFER *pstBuf, int i)
+{
+    if (0 < pstBuf->i_addr[i])
+        return true;
+
+    return (pstBuf->i_addr[i] == 0 &&
+            (pstBuf->c_addr[i] == NULL || pstBuf->c_addr[i] == (char *)-1));
+}
+
+char *jpegSwMapBuf(struct ExynosJpegBase::BUFFER *pstBuf, int iPlanes, int iProt, bool *pbAlloc)
+{
+    char *pcPlane[JPEG_MAX_PLANE_CNT];
+    bool bMapped[JPEG_MAX_PLANE_CNT];
+    char *pcAddr = NULL;
+    int iSize = 0;
+
+    *pbAlloc = false;
+
+    for (int i = 0; i < iPlanes; i++) {
+        bMapped[i] = false;
+
+        if (swIsFd(pstBuf, i) == true) {
+            pcPlane[i] = (char *)mmap(0, pstBuf->size[i], iProt, MAP_SHARED, pstBuf->i_addr[i], 0);
+            if (pcPlane[i] == MAP_FAILED) {
+                JPEG_ERROR_LOG("[%s]: mmap(%d) failed\n", __func__, pstBuf->i_addr[i]);
+                pcPlane[i] = NULL;
+            } else {
+                bMapped[i] = true;
+            }
+        } else if ((int)pstBuf->c_addr[i] != 0 && (int)pstBuf->c_addr[i] != -1) {
+            pcPlane[i] = pstBuf->c_addr[i];
+        } else {
+            pcPlane[i] = NULL;
+        }
+
+        if (pcPlane[i] == NULL) {
+            for (int j = 0; j < i; j++) {
+                if (bMapped[j] == true)
+                    munmap(pcPlane[j], pstBuf->size[j]);
+            }
+            return NULL;
+        }
+
+        iSize += pstBuf->size[i];
+    }
+
+    if (iPlanes == 1)
+        return pcPlane[0];
+
+    pcAddr = (char *)malloc(iSize);
+    if (pcAddr != NULL) {
+        *pbAlloc = true;
+        for (int i = 0, iOff = 0; i < iPlanes; iOff += pstBuf->size[i], i++)
+            memcpy(pcAddr + iOff, pcPlane[i], pstBuf->size[i]);
+    }
+
+    for (int i = 0; i < iPlanes; i++) {
+        if (bMapped[i] == true)
+            munmap(pcPlane[i], pstBuf->size[i]);
+    }
+
+    return pcAddr;
+}
+
+void jpegSwUnmapBuf(struct ExynosJpegBase::BUFFER *pstBuf, char *pcAddr, bool bAlloc)
+{
+    if (bAlloc == true)
+        free(pcAddr);
+    else if (swIsFd(pstBuf, 0) == true)
+        munmap(pcAddr, pstBuf->size[0]);
+}
+
+int jpegSwScatterBuf(struct ExynosJpegBase::BUFFER *pstBuf, int iPlanes, const char *pcAddr)
+{
+    for (int i = 0, iOff = 0; i < iPlanes; iOff += pstBuf->size[i], i++) {
+        char *pcPlane = NULL;
+
+        if (swIsFd(pstBuf, i) == true) {
+            pcPlane = (char *)mmap(0, pstBuf->size[i], PROT_WRITE, MAP_SHARED, pstBuf->i_addr[i], 0);
+            if (pcPlane == MAP_FAILED) {
+                JPEG_ERROR_LOG("[%s]: mmap(%d) failed\n", __func__, pstBuf->i_addr[i]);
+                return ExynosJpegBase::ERROR_BUFFR_IS_NULL;
+            }
+            memcpy(pcPlane, pcAddr + iOff, pstBuf->size[i]);
+            munmap(pcPlane, pstBuf->size[i]);
+        } else {
+            memcpy(pstBuf->c_addr[i], pcAddr + iOff, pstBuf->size[i]);
+        }
+    }
+
+    return ExynosJpegBase::ERROR_NONE;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright Samsung Electronics Co.,LTD.
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EXYNOS_JPEG_SW_CODEC_H__
+#define __EXYNOS_JPEG_SW_CODEC_H__
+
+/*
+ * Reference software codec on libjpeg, shared by the region decoder and the
+ * fake M2M device. Buffers are single plane, in the V4L2 formats the JPEG
+ * block accepts. Return values are ExynosJpegBase::ERROR_*.
+ */
+
+/*
+ * Decodes the source rectangle (iSrcX, iSrcY, iSrcW, iSrcH) into iOutW x iOutH.
+ * iSrcW or iSrcH of 0 means the whole image. The largest IDCT scale that still
+ * covers the output is used, decoding stops after the last row needed.
+ */
+int jpegSwDecode(const char *pcJpeg, int iJpegSize, int iFormat, char *pcOut,
+                 int iSrcX, int iSrcY, int iSrcW, int iSrcH, int iOutW, int iOutH,
+                 int *piImageW, int *piImageH);
+
+/* iJpegFormat is V4L2_PIX_FMT_JPEG_444/422/420/GRAY, iQuality is 1 ~ 100 */
+int jpegSwEncode(const char *pcIn, int iFormat, int iW, int iH, int iJpegFormat, int iQuality,
+                 char *pcJpeg, int iJpegBufSize, int *piJpegSize);
+
+/* encodes every iStep-th pixel of every iStep-th row, (iW / iStep) x (iH / iStep) */
+int jpegSwEncodeSubsampled(const char *pcIn, int iFormat, int iW, int iH, int iStep,
+                           int iJpegFormat, int iQuality,
+                           char *pcJpeg, int iJpegBufSize, int *piJpegSize);
+
+/*
+ * Encodes MCU row stripes on up to iNumOfThreads threads and joins them with
+ * restart markers, one restart interval per stripe. Falls back to
+ * jpegSwEncode() for one thread or one stripe.
+ */
+int jpegSwEncodeParallel(const char *pcIn, int iFormat, int iW, int iH, int iJpegFormat, int iQuality,
+                         int iNumOfThreads, char *pcJpeg, int iJpegBufSize, int *piJpegSize);
+
+/* libjpeg quality of ExynosJpegEncoder::QUALITY_LEVEL_*, -1 when out of range */
+int jpegSwQualityOfLevel(int iLevel);
+
+int jpegSwGetSize(const char *pcJpeg, int iJpegSize, int *piW, int *piH);
+
+/*
+ * CPU view of a libhwjpeg buffer: dma-buf planes are mapped, user pointers
+ * used as they are, and more than one plane is gathered into one allocation.
+ */
+char *jpegSwMapBuf(struct ExynosJpegBase::BUFFER *pstBuf, int iPlanes, int iProt, bool *pbAlloc);
+void jpegSwUnmapBuf(struct ExynosJpegBase::BUFFER *pstBuf, char *pcAddr, bool bAlloc);
+/* copies a gathered buffer written by the CPU back to its planes */
+int jpegSwScatterBuf(struct ExynosJpegBase::BUFFER *pstBuf, int iPlanes, const char *pcAddr);
+
+#endif /* __EXYNOS_JPEG_SW_CODEC_H__ */
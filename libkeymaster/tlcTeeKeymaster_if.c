@@ -44,15 +44,28 @@ static const mcUuid_t gUuid = TEE_KEYMASTER_TL_UUID;
 /**
  * TEE_Open
  *
- * Open session to the TEE Keymaster trustlet
+ * Open session to the TEE Keymaster trustlet and map the buffers of the
+ * command to it, all in one request to the daemon
  *
  * @param  pSessionHandle  [out] Return pointer to the session handle
+ * @param  bufs            [in]  Buffers to map
+ * @param  bufLens         [in]  Buffer lengths
+ * @param  mapInfos        [out] Mapping info of each buffer
+ * @param  numBufs         [in]  Number of buffers
+ * @param  pMcRet          [out] Result of the failed MobiCore call
  */
 static tciMessage_ptr TEE_Open(
-    mcSessionHandle_t *pSessionHandle
+    mcSessionHandle_t *pSessionHandle,
+    void              **bufs,
+    uint32_t          *bufLens,
+    mcBulkMap_t       **mapInfos,
+    uint32_t          numBufs,
+    mcResult_t        *pMcRet
 ){
     tciMessage_ptr pTci = NULL;
-    mcResult_t     mcRet;
+    mcResult_t     mcRet = MC_DRV_OK;
+    mcBulkMap_t    maps[MC_MAX_SESSION_MAPS];
+    uint32_t       i;
 
     do
     {
@@ -61,6 +74,7 @@ static tciMessage_ptr TEE_Open(
         if (!pSessionHandle)
         {
             LOG_E("TEE_Open(): Invalid session handle\n");
+            mcRet = MC_DRV_ERR_INVALID_PARAMETER;
             break;
         }
 
@@ -83,24 +97,60 @@ static tciMessage_ptr TEE_Open(
             break;
         }
 
-        /* Open session the TEE Keymaster trustlet */
+        /* Open session the TEE Keymaster trustlet and map the buffers */
         pSessionHandle->deviceId = gDeviceId;
-        mcRet = mcOpenSession(pSessionHandle,
-                              &gUuid,
-                              (uint8_t *) pTci,
-                              (uint32_t) sizeof(tciMessage_t));
+        mcRet = mcOpenSessionEx(pSessionHandle,
+                                &gUuid,
+                                (uint8_t *) pTci,
+                                (uint32_t) sizeof(tciMessage_t),
+                                bufs,
+                                bufLens,
+                                numBufs,
+                                maps);
         if (MC_DRV_OK != mcRet)
         {
-            LOG_E("TEE_Open(): mcOpenSession returned: %d\n", mcRet);
+            LOG_E("TEE_Open(): mcOpenSessionEx returned: %d\n", mcRet);
+            mcFreeWsm(gDeviceId, (uint8_t *) pTci);
+            pTci = NULL;
+            mcCloseDevice(gDeviceId);
             break;
         }
 
+        for (i = 0; i < numBufs; i++)
+        {
+            *mapInfos[i] = maps[i];
+        }
+
     } while (false);
 
+    *pMcRet = mcRet;
+
     return pTci;
 }
 
 
+/**
+ * TEE_OpenError
+ *
+ * Error of a failed TEE_Open(). A buffer that could not be mapped is
+ * reported as a mapping error, as when it was mapped after the open.
+ *
+ * @param  mcRet  [in] Result of the failed MobiCore call
+ */
+static teeResult_t TEE_OpenError(
+    mcResult_t mcRet
+){
+    switch (MC_DRV_ERROR_MAJOR(mcRet))
+    {
+    case MC_DRV_ERR_BULK_MAPPING:
+    case MC_DRV_ERR_WSM_NOT_FOUND:
+        return TEE_ERR_MAP;
+    default:
+        return TEE_ERR_MEMORY;
+    }
+}
+
+
 /**
  * TEE_Close
  *
@@ -169,20 +219,19 @@ teeResult_t TEE_RSAGenerateKeyPair(
     mcSessionHandle_t   sessionHandle;
     mcBulkMap_t         mapInfo;
     mcResult_t          mcRet;
+    void                *bufs[1];
+    uint32_t            bufLens[1];
+    mcBulkMap_t         *mapInfos[1];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &mapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 1, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, keyData, keyDataLength, &mapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -266,32 +315,25 @@ teeResult_t TEE_RSASign(
     mcBulkMap_t        plainMapInfo;
     mcBulkMap_t        signatureMapInfo;
     mcResult_t         mcRet;
+    void               *bufs[3];
+    uint32_t           bufLens[3];
+    mcBulkMap_t        *mapInfos[3];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)plainData;
+        bufLens[1]  = plainDataLength;
+        mapInfos[1] = &plainMapInfo;
+        bufs[2]     = (void*)signatureData;
+        bufLens[2]  = *signatureDataLength;
+        mapInfos[2] = &signatureMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 3, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)plainData, plainDataLength, &plainMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)signatureData, *signatureDataLength, &signatureMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -396,32 +438,25 @@ teeResult_t TEE_RSAVerify(
     mcBulkMap_t        plainMapInfo;
     mcBulkMap_t        signatureMapInfo;
     mcResult_t         mcRet;
+    void               *bufs[3];
+    uint32_t           bufLens[3];
+    mcBulkMap_t        *mapInfos[3];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)plainData;
+        bufLens[1]  = plainDataLength;
+        mapInfos[1] = &plainMapInfo;
+        bufs[2]     = (void*)signatureData;
+        bufLens[2]  = signatureDataLength;
+        mapInfos[2] = &signatureMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 3, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)plainData, plainDataLength, &plainMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)signatureData, signatureDataLength, &signatureMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -515,20 +550,19 @@ teeResult_t TEE_HMACKeyGenerate(
     mcSessionHandle_t  sessionHandle;
     mcBulkMap_t        keyMapInfo;
     mcResult_t         mcRet;
+    void               *bufs[1];
+    uint32_t           bufLens[1];
+    mcBulkMap_t        *mapInfos[1];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 1, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -607,32 +641,25 @@ teeResult_t TEE_HMACSign(
     mcBulkMap_t        plainMapInfo;
     mcBulkMap_t        signatureMapInfo;
     mcResult_t         mcRet;
+    void               *bufs[3];
+    uint32_t           bufLens[3];
+    mcBulkMap_t        *mapInfos[3];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)plainData;
+        bufLens[1]  = plainDataLength;
+        mapInfos[1] = &plainMapInfo;
+        bufs[2]     = (void*)signatureData;
+        bufLens[2]  = *signatureDataLength;
+        mapInfos[2] = &signatureMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 3, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)plainData, plainDataLength, &plainMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)signatureData, *signatureDataLength, &signatureMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -735,32 +762,25 @@ teeResult_t TEE_HMACVerify(
     mcBulkMap_t        plainMapInfo;
     mcBulkMap_t        signatureMapInfo;
     mcResult_t         mcRet;
+    void               *bufs[3];
+    uint32_t           bufLens[3];
+    mcBulkMap_t        *mapInfos[3];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)plainData;
+        bufLens[1]  = plainDataLength;
+        mapInfos[1] = &plainMapInfo;
+        bufs[2]     = (void*)signatureData;
+        bufLens[2]  = signatureDataLength;
+        mapInfos[2] = &signatureMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 3, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)plainData, plainDataLength, &plainMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)signatureData, signatureDataLength, &signatureMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -871,26 +891,22 @@ teeResult_t TEE_KeyImport(
     mcBulkMap_t         keyMapInfo;
     mcBulkMap_t         soMapInfo;
     mcResult_t          mcRet;
+    void                *bufs[2];
+    uint32_t            bufLens[2];
+    mcBulkMap_t         *mapInfos[2];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)soData;
+        bufLens[1]  = *soDataLength;
+        mapInfos[1] = &soMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 2, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)soData, *soDataLength, &soMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
@@ -977,32 +993,25 @@ teeResult_t TEE_GetPubKey(
     mcBulkMap_t         modMapInfo;
     mcBulkMap_t         expMapInfo;
     mcResult_t          mcRet;
+    void                *bufs[3];
+    uint32_t            bufLens[3];
+    mcBulkMap_t         *mapInfos[3];
 
     do {
 
-        /* Open session to the trustlet */
-        pTci = TEE_Open(&sessionHandle);
+        /* Open session to the trustlet, with the buffers mapped to it */
+        bufs[0]     = (void*)keyData;
+        bufLens[0]  = keyDataLength;
+        mapInfos[0] = &keyMapInfo;
+        bufs[1]     = (void*)modulus;
+        bufLens[1]  = *modulusLength;
+        mapInfos[1] = &modMapInfo;
+        bufs[2]     = (void*)exponent;
+        bufLens[2]  = *exponentLength;
+        mapInfos[2] = &expMapInfo;
+        pTci = TEE_Open(&sessionHandle, bufs, bufLens, mapInfos, 3, &mcRet);
         if (!pTci) {
-            ret = TEE_ERR_MEMORY;
-            break;
-        }
-
-        /* Map memory to the secure world */
-        mcRet = mcMap(&sessionHandle, (void*)keyData, keyDataLength, &keyMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)modulus, *modulusLength, &modMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
-            break;
-        }
-
-        mcRet = mcMap(&sessionHandle, (void*)exponent, *exponentLength, &expMapInfo);
-        if (MC_DRV_OK != mcRet) {
-            ret = TEE_ERR_MAP;
+            ret = TEE_OpenError(mcRet);
             break;
         }
 
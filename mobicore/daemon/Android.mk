@@ -84,6 +84,22 @@ LOCAL_CFLAGS += -DLOG_ANDROID
 
 include $(BUILD_EXECUTABLE)
 
+# Daemon Statistics Tool
+# =============================================================================
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := mcDriverStats
+LOCAL_VENDOR_MODULE := true
+LOCAL_MODULE_TAGS := optional
+LOCAL_C_INCLUDES += $(GLOBAL_INCLUDES)
+LOCAL_SHARED_LIBRARIES += $(GLOBAL_LIBRARIES) libMcClient
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/ClientLib/public
+
+LOCAL_SRC_FILES += Tools/mcDriverStats.cpp
+
+include $(BUILD_EXECUTABLE)
+
 # Registry Shared Library
 # =============================================================================
 include $(CLEAR_VARS)
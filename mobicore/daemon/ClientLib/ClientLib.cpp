@@ -182,6 +182,45 @@ bool removeDevice(uint32_t deviceId)
     } \
 }
 
+//------------------------------------------------------------------------------
+/**
+ * Map the daemon response of a failed open session to the client API codes.
+ */
+static mcResult_t openSessionError(mcResult_t mcResult)
+{
+    if (MC_DRV_ERROR_MAJOR(mcResult) != MC_DRV_ERR_MCP_ERROR) {
+        LOG_E("Daemon could not open session, responseId %d.", mcResult);
+        return mcResult;
+    }
+
+    uint32_t mcpResult = MC_DRV_ERROR_MCP(mcResult);
+    LOG_E("MobiCore reported failing of MC_MCP_CMD_OPEN_SESSION command, mcpResult %d.", mcpResult);
+
+    // IMPROVEMENT-2012-09-03-haenellu: Remove this switch case and use MCP code in tests.
+    switch (mcpResult) {
+    case MC_MCP_RET_ERR_WRONG_PUBLIC_KEY:
+        return MC_DRV_ERR_WRONG_PUBLIC_KEY;
+    case MC_MCP_RET_ERR_CONTAINER_TYPE_MISMATCH:
+        return MC_DRV_ERR_CONTAINER_TYPE_MISMATCH;
+    case MC_MCP_RET_ERR_CONTAINER_LOCKED:
+        return MC_DRV_ERR_CONTAINER_LOCKED;
+    case MC_MCP_RET_ERR_SP_NO_CHILD:
+        return MC_DRV_ERR_SP_NO_CHILD;
+    case MC_MCP_RET_ERR_TL_NO_CHILD:
+        return MC_DRV_ERR_TL_NO_CHILD;
+    case MC_MCP_RET_ERR_UNWRAP_ROOT_FAILED:
+        return MC_DRV_ERR_UNWRAP_ROOT_FAILED;
+    case MC_MCP_RET_ERR_UNWRAP_SP_FAILED:
+        return MC_DRV_ERR_UNWRAP_SP_FAILED;
+    case MC_MCP_RET_ERR_UNWRAP_TRUSTLET_FAILED:
+        return MC_DRV_ERR_UNWRAP_TRUSTLET_FAILED;
+    default:
+        // TODO-2012-09-06-haenellu: Remove line and adapt codes in tests.
+        return MC_DRV_ERR_MCP_ERROR;
+    }
+}
+
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcOpenDevice(uint32_t deviceId)
 {
@@ -240,6 +279,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenDevice(uint32_t deviceId)
         // there is no payload to read
 
         device = new Device(deviceId, devCon);
+        device->daemonVersion = version;
         mcResult = device->open("/dev/" MC_USER_DEVNODE);
         if (mcResult != MC_DRV_OK) {
             delete device;
@@ -382,45 +422,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenSession(
 
         if (mcResult != MC_DRV_OK) {
             // TODO-2012-09-06-haenellu: Remove this code once tests can handle it
-
-            if (MC_DRV_ERROR_MAJOR(mcResult) != MC_DRV_ERR_MCP_ERROR) {
-                LOG_E("Daemon could not open session, responseId %d.", mcResult);
-            } else {
-                uint32_t mcpResult = MC_DRV_ERROR_MCP(mcResult);
-                LOG_E("MobiCore reported failing of MC_MCP_CMD_OPEN_SESSION command, mcpResult %d.", mcpResult);
-
-                // IMPROVEMENT-2012-09-03-haenellu: Remove this switch case and use MCP code in tests.
-                switch (mcpResult) {
-                case MC_MCP_RET_ERR_WRONG_PUBLIC_KEY:
-                    mcResult = MC_DRV_ERR_WRONG_PUBLIC_KEY;
-                    break;
-                case MC_MCP_RET_ERR_CONTAINER_TYPE_MISMATCH:
-                    mcResult = MC_DRV_ERR_CONTAINER_TYPE_MISMATCH;
-                    break;
-                case MC_MCP_RET_ERR_CONTAINER_LOCKED:
-                    mcResult = MC_DRV_ERR_CONTAINER_LOCKED;
-                    break;
-                case MC_MCP_RET_ERR_SP_NO_CHILD:
-                    mcResult = MC_DRV_ERR_SP_NO_CHILD;
-                    break;
-                case MC_MCP_RET_ERR_TL_NO_CHILD:
-                    mcResult = MC_DRV_ERR_TL_NO_CHILD;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_ROOT_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_ROOT_FAILED;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_SP_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_SP_FAILED;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_TRUSTLET_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_TRUSTLET_FAILED;
-                    break;
-                default:
-                    // TODO-2012-09-06-haenellu: Remove line and adapt codes in tests.
-                    mcResult = MC_DRV_ERR_MCP_ERROR;
-                    break;
-                }
-            }
+            mcResult = openSessionError(mcResult);
             break; // loading of Trustlet failed, unlock mutex and return
         }
 
@@ -567,45 +569,7 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenTrustlet(
 
         if (mcResult != MC_DRV_OK) {
             // TODO-2012-09-06-haenellu: Remove this code once tests can handle it
-
-            if (MC_DRV_ERROR_MAJOR(mcResult) != MC_DRV_ERR_MCP_ERROR) {
-                LOG_E("Daemon could not open session, responseId %d.", mcResult);
-            } else {
-                uint32_t mcpResult = MC_DRV_ERROR_MCP(mcResult);
-                LOG_E("MobiCore reported failing of MC_MCP_CMD_OPEN_SESSION command, mcpResult %d.", mcpResult);
-
-                // IMPROVEMENT-2012-09-03-haenellu: Remove this switch case and use MCP code in tests.
-                switch (mcpResult) {
-                case MC_MCP_RET_ERR_WRONG_PUBLIC_KEY:
-                    mcResult = MC_DRV_ERR_WRONG_PUBLIC_KEY;
-                    break;
-                case MC_MCP_RET_ERR_CONTAINER_TYPE_MISMATCH:
-                    mcResult = MC_DRV_ERR_CONTAINER_TYPE_MISMATCH;
-                    break;
-                case MC_MCP_RET_ERR_CONTAINER_LOCKED:
-                    mcResult = MC_DRV_ERR_CONTAINER_LOCKED;
-                    break;
-                case MC_MCP_RET_ERR_SP_NO_CHILD:
-                    mcResult = MC_DRV_ERR_SP_NO_CHILD;
-                    break;
-                case MC_MCP_RET_ERR_TL_NO_CHILD:
-                    mcResult = MC_DRV_ERR_TL_NO_CHILD;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_ROOT_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_ROOT_FAILED;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_SP_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_SP_FAILED;
-                    break;
-                case MC_MCP_RET_ERR_UNWRAP_TRUSTLET_FAILED:
-                    mcResult = MC_DRV_ERR_UNWRAP_TRUSTLET_FAILED;
-                    break;
-                default:
-                    // TODO-2012-09-06-haenellu: Remove line and adapt codes in tests.
-                    mcResult = MC_DRV_ERR_MCP_ERROR;
-                    break;
-                }
-            }
+            mcResult = openSessionError(mcResult);
             break; // loading of Trustlet failed, unlock mutex and return
         }
 
@@ -675,6 +639,243 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenTrustlet(
     return mcResult;
 }
 
+//------------------------------------------------------------------------------
+/**
+ * mcOpenSessionEx() for a daemon without MC_DRV_CMD_OPEN_SESSION_EX, which
+ * would drop the connection on the unknown command.
+ * Must be called without devMutex held.
+ */
+static mcResult_t openSessionThenMap(
+    mcSessionHandle_t  *session,
+    const mcUuid_t     *uuid,
+    uint8_t            *tci,
+    uint32_t           tciLen,
+    void               **bufs,
+    uint32_t           *bufLens,
+    uint32_t           numBufs,
+    mcBulkMap_t        *mapInfos
+)
+{
+    mcResult_t mcResult = mcOpenSession(session, uuid, tci, tciLen);
+    if (mcResult != MC_DRV_OK) {
+        return mcResult;
+    }
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        mcResult = mcMap(session, bufs[i], bufLens[i], &mapInfos[i]);
+        if (mcResult != MC_DRV_OK) {
+            // Closing the session releases the buffers mapped so far
+            mcCloseSession(session);
+            break;
+        }
+    }
+
+    return mcResult;
+}
+
+
+//------------------------------------------------------------------------------
+__MC_CLIENT_LIB_API mcResult_t mcOpenSessionEx(
+    mcSessionHandle_t  *session,
+    const mcUuid_t     *uuid,
+    uint8_t            *tci,
+    uint32_t           len,
+    void               **bufs,
+    uint32_t           *bufLens,
+    uint32_t           numBufs,
+    mcBulkMap_t        *mapInfos
+)
+{
+    mcResult_t mcResult = MC_DRV_OK;
+    Device *device = NULL;
+    BulkBufferDescriptor *bulkBuf = NULL;
+    BulkBufferDescriptor *mapBufs[MC_MAX_SESSION_MAPS] = { NULL };
+    bool legacyDaemon = false;
+
+    devMutex.lock();
+    LOG_I("===%s()===", __FUNCTION__);
+
+    do {
+        uint32_t handle = 0;
+        CHECK_NOT_NULL(session);
+        CHECK_NOT_NULL(uuid);
+        CHECK_NOT_NULL(tci);
+        if (numBufs > 0) {
+            CHECK_NOT_NULL(bufs);
+            CHECK_NOT_NULL(bufLens);
+            CHECK_NOT_NULL(mapInfos);
+        }
+
+        if (len > MC_MAX_TCI_LEN) {
+            LOG_E("TCI length is longer than %d", MC_MAX_TCI_LEN);
+            mcResult = MC_DRV_ERR_TCI_TOO_BIG;
+            break;
+        }
+
+        if (numBufs > MC_MAX_SESSION_MAPS) {
+            LOG_E("Cannot map more than %d buffers with a session", MC_MAX_SESSION_MAPS);
+            mcResult = MC_DRV_ERR_INVALID_PARAMETER;
+            break;
+        }
+
+        // Get the device associated with the given session
+        device = resolveDeviceId(session->deviceId);
+        CHECK_DEVICE(device);
+
+        if (device->daemonVersion < MC_MAKE_VERSION(0, 3)) {
+            legacyDaemon = true;
+            break;
+        }
+
+        Connection *devCon = device->connection;
+
+        // First assume the TCI is a contiguous buffer
+        // Get the physical address of the given TCI
+        CWsm_ptr pWsm = device->findContiguousWsm(tci);
+        if (pWsm == NULL) {
+            // Then assume it's a normal buffer that needs to be mapped
+            mcResult = device->mapBulkBuf(tci, len, &bulkBuf);
+            if (mcResult != MC_DRV_OK) {
+                bulkBuf = NULL;
+                LOG_E("Registering buffer failed. ret=%x", mcResult);
+                mcResult = MC_DRV_ERR_WSM_NOT_FOUND;
+                break;
+            }
+            handle = bulkBuf->handle;
+        } else {
+            if (pWsm->len < len) {
+                LOG_E("mcOpenSessionEx(): length is more than allocated TCI");
+                mcResult = MC_DRV_ERR_TCI_GREATER_THAN_WSM;
+                break;
+            }
+            handle = pWsm->handle;
+        }
+
+        MC_DRV_CMD_OPEN_SESSION_EX_struct cmd;
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.commandId = MC_DRV_CMD_OPEN_SESSION_EX;
+        cmd.deviceId = session->deviceId;
+        cmd.uuid = *uuid;
+        cmd.tci = (uint32_t)(tci) & 0xFFF;
+        cmd.handle = handle;
+        cmd.len = len;
+        cmd.numMaps = numBufs;
+
+        // Register the bulk buffers to Kernel Module, the daemon maps them
+        for (uint32_t i = 0; i < numBufs; i++) {
+            mcResult = device->mapBulkBuf((addr_t)bufs[i], bufLens[i], &mapBufs[i]);
+            if (mcResult != MC_DRV_OK) {
+                mapBufs[i] = NULL;
+                LOG_E("Registering buffer failed. ret=%x", mcResult);
+                break;
+            }
+            cmd.maps[i].handle = mapBufs[i]->handle;
+            cmd.maps[i].offsetPayload = (uint32_t)(bufs[i]) & 0xFFF;
+            cmd.maps[i].lenBulkMem = bufLens[i];
+        }
+        if (mcResult != MC_DRV_OK) {
+            break;
+        }
+
+        if (devCon->writeData(&cmd, sizeof(cmd)) < 0) {
+            LOG_E("sending to Daemon failed.");
+            mcResult = MC_DRV_ERR_SOCKET_WRITE;
+            break;
+        }
+
+        // Read command response
+        RECV_FROM_DAEMON(devCon, &mcResult);
+
+        if (mcResult != MC_DRV_OK) {
+            mcResult = openSessionError(mcResult);
+            break; // nothing is left open, unlock mutex and return
+        }
+
+        // read payload
+        mcDrvRspOpenSessionExPayload_t rspOpenSessionExPayload;
+        RECV_FROM_DAEMON(devCon, &rspOpenSessionExPayload);
+
+        // Register session with handle
+        session->sessionId = rspOpenSessionExPayload.session.sessionId;
+
+        LOG_I(" Service is started. Setting up channel for notifications.");
+
+        // Set up second channel for notifications
+        Connection *sessionConnection = new Connection();
+        if (!sessionConnection->connect(SOCK_PATH)) {
+            LOG_E("Could not connect to %s", SOCK_PATH);
+            mcResult = MC_DRV_ERR_SOCKET_CONNECT;
+        } else do {
+            SEND_TO_DAEMON(sessionConnection, MC_DRV_CMD_NQ_CONNECT,
+                           session->deviceId,
+                           session->sessionId,
+                           rspOpenSessionExPayload.session.deviceSessionId,
+                           rspOpenSessionExPayload.session.sessionMagic);
+
+            RECV_FROM_DAEMON(sessionConnection, &mcResult);
+
+            if (mcResult != MC_DRV_OK) {
+                LOG_E("CMD_NQ_CONNECT failed, respId=%d", mcResult);
+                break;
+            }
+
+        } while (0);
+
+        if (mcResult != MC_DRV_OK) {
+            delete sessionConnection;
+            // Close the session again, the daemon releases the buffers
+            mcResult_t nqResult = mcResult;
+            do {
+                SEND_TO_DAEMON(devCon, MC_DRV_CMD_CLOSE_SESSION, session->sessionId);
+                RECV_FROM_DAEMON(devCon, &mcResult);
+            } while (0);
+            mcResult = nqResult;
+            break; // unlock mutex and return
+        }
+
+        // Session has been established, new session object must be created
+        Session *sessionObj = device->createNewSession(session->sessionId, sessionConnection);
+        // If the session tci was a mapped buffer then register it
+        if (bulkBuf) {
+            sessionObj->addBulkBuf(bulkBuf);
+            bulkBuf = NULL;
+        }
+        for (uint32_t i = 0; i < numBufs; i++) {
+            // Set mapping info for internal structures
+            mapBufs[i]->sVirtualAddr = (addr_t)rspOpenSessionExPayload.secureVirtualAdr[i];
+            sessionObj->addBulkBuf(mapBufs[i]);
+            mapBufs[i] = NULL;
+            // Set mapping info for Trustlet
+            mapInfos[i].sVirtualAddr = (void *)rspOpenSessionExPayload.secureVirtualAdr[i];
+            mapInfos[i].sVirtualLen = bufLens[i];
+        }
+
+        LOG_I(" Successfully opened session %d with %d buffers.", session->sessionId, numBufs);
+
+    } while (false);
+
+    // Buffers not handed to a session are registered in vain
+    if (device != NULL) {
+        if (bulkBuf) {
+            device->unmapBulkBuf(bulkBuf);
+        }
+        for (uint32_t i = 0; i < MC_MAX_SESSION_MAPS; i++) {
+            if (mapBufs[i]) {
+                device->unmapBulkBuf(mapBufs[i]);
+            }
+        }
+    }
+
+    devMutex.unlock();
+
+    if (legacyDaemon) {
+        LOG_I(" Daemon cannot map buffers with the session, opening and mapping one by one.");
+        return openSessionThenMap(session, uuid, tci, len, bufs, bufLens, numBufs, mapInfos);
+    }
+
+    return mcResult;
+}
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcCloseSession(mcSessionHandle_t *session)
 {
@@ -886,6 +1087,46 @@ __MC_CLIENT_LIB_API mcResult_t mcMallocWsm(
 }
 
 
+//------------------------------------------------------------------------------
+/**
+ * Send a mapping cache operation of a session to the daemon.
+ */
+static mcResult_t mapCacheCommand(Connection *devCon, uint32_t sessionId,
+                                  uint32_t operation, uint32_t param)
+{
+    mcResult_t mcResult = MC_DRV_OK;
+
+    do {
+        SEND_TO_DAEMON(devCon, MC_DRV_CMD_MAP_CACHE, sessionId, operation, param);
+
+        RECV_FROM_DAEMON(devCon, &mcResult);
+
+        if (mcResult != MC_DRV_OK) {
+            LOG_E("MC_DRV_CMD_MAP_CACHE failed, respId=%d", mcResult);
+        }
+    } while (false);
+
+    return mcResult;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Really unmap the buffers of the mapping caches within a memory area, before
+ * it is freed.
+ */
+static void invalidateCachedBulkBufs(Device *device, addr_t buf, uint32_t len)
+{
+    BulkBufferDescriptor *bulkBuf;
+    Session *session;
+
+    while ((bulkBuf = device->takeCachedBulkBuf(buf, len, &session)) != NULL) {
+        // Given up even if the daemon failed, closing the session unmaps it anyway
+        mapCacheCommand(device->connection, session->sessionId,
+                        MC_DRV_MAP_CACHE_INVALIDATE, bulkBuf->handle);
+        session->releaseBulkBuf(bulkBuf);
+    }
+}
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcFreeWsm(
     uint32_t    deviceId,
@@ -918,6 +1159,9 @@ __MC_CLIENT_LIB_API mcResult_t mcFreeWsm(
             break;
         }
 
+        // A buffer kept mapped by a session must not outlive the memory
+        invalidateCachedBulkBufs(device, pWsm->virtAddr, pWsm->len);
+
         // Free the given virtual address
         mcResult = device->freeContiguousWsm(pWsm);
         if (mcResult != MC_DRV_OK) {
@@ -969,12 +1213,24 @@ __MC_CLIENT_LIB_API mcResult_t mcMap(
 
         LOG_I(" Mapping %p to session %d.", buf, sessionHandle->sessionId);
 
-        // Register mapped bulk buffer to Kernel Module and keep mapped bulk buffer in mind
-        BulkBufferDescriptor *bulkBuf;
-        mcResult = session->addBulkBuf(buf, bufLen, &bulkBuf);
-        if (mcResult != MC_DRV_OK) {
-            LOG_E("Registering buffer failed. ret=%x", mcResult);
-            break;
+        // A buffer of the mapping cache is still registered and the daemon
+        // finds its mapping by the handle
+        BulkBufferDescriptor *bulkBuf = session->takeCachedBulkBuf(buf);
+        if (bulkBuf != NULL && bulkBuf->len != bufLen) {
+            mapCacheCommand(devCon, session->sessionId, MC_DRV_MAP_CACHE_INVALIDATE, bulkBuf->handle);
+            session->releaseBulkBuf(bulkBuf);
+            bulkBuf = NULL;
+        }
+
+        if (bulkBuf != NULL) {
+            session->addBulkBuf(bulkBuf);
+        } else {
+            // Register mapped bulk buffer to Kernel Module and keep mapped bulk buffer in mind
+            mcResult = session->addBulkBuf(buf, bufLen, &bulkBuf);
+            if (mcResult != MC_DRV_OK) {
+                LOG_E("Registering buffer failed. ret=%x", mcResult);
+                break;
+            }
         }
 
         SEND_TO_DAEMON(devCon, MC_DRV_CMD_MAP_BULK_BUF,
@@ -1081,6 +1337,17 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
             break;
         }
 
+        // The daemon keeps the buffer mapped, so it stays registered
+        if (session->maxCachedBulkBufs > 0) {
+            BulkBufferDescriptor *evicted = session->cacheBulkBuf(buf);
+            if (evicted != NULL) {
+                mapCacheCommand(devCon, session->sessionId, MC_DRV_MAP_CACHE_INVALIDATE, evicted->handle);
+                session->releaseBulkBuf(evicted);
+            }
+            mcResult = MC_DRV_OK;
+            break;
+        }
+
         // Unregister mapped bulk buffer from Kernel Module and remove mapped
         // bulk buffer from session maintenance
         mcResult = session->removeBulkBuf(buf);
@@ -1104,6 +1371,123 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
 }
 
 
+//------------------------------------------------------------------------------
+__MC_CLIENT_LIB_API mcResult_t mcSetMapCache(
+    mcSessionHandle_t  *sessionHandle,
+    uint32_t           maxEntries
+)
+{
+    mcResult_t mcResult = MC_DRV_ERR_UNKNOWN;
+
+    LOG_I("===%s(%u)===", __FUNCTION__, maxEntries);
+
+    devMutex.lock();
+
+    do {
+        CHECK_NOT_NULL(sessionHandle);
+
+        if (maxEntries > MC_MAX_MAP_CACHE_SIZE) {
+            LOG_E("Mapping cache of %u buffers too large", maxEntries);
+            mcResult = MC_DRV_ERR_INVALID_PARAMETER;
+            break;
+        }
+
+        // Determine device the session belongs to
+        Device *device = resolveDeviceId(sessionHandle->deviceId);
+        // Is the device known
+        CHECK_DEVICE(device);
+
+        // Is the device opened.
+        CHECK_DEVICE_CLOSED(device, sessionHandle->deviceId)
+
+        if (device->daemonVersion < MC_MAKE_VERSION(0, 5)) {
+            LOG_E("Daemon has no mapping cache");
+            mcResult = MC_DRV_ERR_NOT_IMPLEMENTED;
+            break;
+        }
+
+        // Get session
+        Session *session = device->resolveSessionId(sessionHandle->sessionId);
+        CHECK_SESSION(session, sessionHandle->sessionId);
+
+        mcResult = mapCacheCommand(device->connection, session->sessionId,
+                                   MC_DRV_MAP_CACHE_SET_SIZE, maxEntries);
+        if (mcResult != MC_DRV_OK) {
+            break;
+        }
+
+        // The daemon unmapped the buffers kept so far
+        BulkBufferDescriptor *bulkBuf;
+        while ((bulkBuf = session->takeCachedBulkBuf(NULL)) != NULL) {
+            session->releaseBulkBuf(bulkBuf);
+        }
+        session->maxCachedBulkBufs = maxEntries;
+
+    } while (false);
+
+    devMutex.unlock();
+
+    return mcResult;
+}
+
+//------------------------------------------------------------------------------
+__MC_CLIENT_LIB_API mcResult_t mcInvalidateMapCache(
+    mcSessionHandle_t  *sessionHandle,
+    void               *buf
+)
+{
+    mcResult_t mcResult = MC_DRV_ERR_UNKNOWN;
+
+    LOG_I("===%s(%p)===", __FUNCTION__, buf);
+
+    devMutex.lock();
+
+    do {
+        CHECK_NOT_NULL(sessionHandle);
+
+        // Determine device the session belongs to
+        Device *device = resolveDeviceId(sessionHandle->deviceId);
+        // Is the device known
+        CHECK_DEVICE(device);
+
+        // Is the device opened.
+        CHECK_DEVICE_CLOSED(device, sessionHandle->deviceId)
+
+        // Get session
+        Session *session = device->resolveSessionId(sessionHandle->sessionId);
+        CHECK_SESSION(session, sessionHandle->sessionId);
+
+        mcResult = MC_DRV_OK;
+
+        BulkBufferDescriptor *bulkBuf = session->takeCachedBulkBuf(buf);
+        if (bulkBuf == NULL) {
+            break;
+        }
+
+        // Handle 0 invalidates all buffers of the session
+        mcResult = mapCacheCommand(device->connection, session->sessionId,
+                                   MC_DRV_MAP_CACHE_INVALIDATE,
+                                   (buf == NULL) ? 0 : bulkBuf->handle);
+
+        // The buffers are given up even if the daemon failed, closing the
+        // session unmaps them anyway
+        do {
+            session->releaseBulkBuf(bulkBuf);
+        } while (buf == NULL && (bulkBuf = session->takeCachedBulkBuf(NULL)) != NULL);
+
+    } while (false);
+
+    if (mcResult == MC_DRV_ERR_SOCKET_WRITE || mcResult == MC_DRV_ERR_SOCKET_READ) {
+        LOG_E("Connection is dead, removing device.");
+        removeDevice(sessionHandle->deviceId);
+    }
+
+    devMutex.unlock();
+
+    return mcResult;
+}
+
+
 //------------------------------------------------------------------------------
 __MC_CLIENT_LIB_API mcResult_t mcGetSessionErrorCode(
     mcSessionHandle_t   *session,
@@ -1201,6 +1585,60 @@ __MC_CLIENT_LIB_API mcResult_t mcGetMobiCoreVersion(
 }
 
 
+//------------------------------------------------------------------------------
+__MC_CLIENT_LIB_API mcResult_t mcGetDaemonStats(
+    uint32_t  deviceId,
+    mcDaemonStats_t *stats
+)
+{
+    mcResult_t mcResult = MC_DRV_OK;
+
+    devMutex.lock();
+    LOG_I("===%s()===", __FUNCTION__);
+
+    do {
+        Device *device = resolveDeviceId(deviceId);
+
+        // Is the device known
+        CHECK_DEVICE(device);
+
+        // Is the device opened.
+        CHECK_DEVICE_CLOSED(device, deviceId)
+
+        CHECK_NOT_NULL(stats);
+
+        if (device->daemonVersion < MC_MAKE_VERSION(0, 4)) {
+            LOG_E("Daemon does not count statistics");
+            mcResult = MC_DRV_ERR_NOT_IMPLEMENTED;
+            break;
+        }
+
+        Connection *devCon = device->connection;
+
+        SEND_TO_DAEMON(devCon, MC_DRV_CMD_GET_STATS);
+
+        // Read GET STATS response.
+
+        RECV_FROM_DAEMON(devCon, &mcResult);
+
+        if (mcResult != MC_DRV_OK) {
+            LOG_E("MC_DRV_CMD_GET_STATS bad response, respId=%d", mcResult);
+            break;
+        }
+
+        // Read payload.
+        mcDaemonStats_t stats_socket;
+        RECV_FROM_DAEMON(devCon, &stats_socket);
+
+        *stats = stats_socket;
+
+    } while (0);
+
+    devMutex.unlock();
+    return mcResult;
+}
+
+
 //------------------------------------------------------------------------------
 // Only called by mcOpenDevice()
 // Must be taken with devMutex locked.
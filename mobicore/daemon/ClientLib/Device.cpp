@@ -47,6 +47,7 @@ Device::Device(uint32_t deviceId, Connection *connection)
 {
     this->deviceId = deviceId;
     this->connection = connection;
+    this->daemonVersion = 0;
 
     pMcKMod = new CMcKMod();
 }
@@ -148,6 +149,22 @@ Session *Device::resolveSessionId(uint32_t sessionId)
 }
 
 
+//------------------------------------------------------------------------------
+BulkBufferDescriptor *Device::takeCachedBulkBuf(addr_t buf, uint32_t len, Session **session)
+{
+    for ( sessionIterator_t interator = sessionList.begin();
+            interator != sessionList.end();
+            ++interator) {
+        BulkBufferDescriptor *blkBuf = (*interator)->takeCachedBulkBuf(buf, len);
+        if (blkBuf != NULL) {
+            *session = *interator;
+            return blkBuf;
+        }
+    }
+    return NULL;
+}
+
+
 //------------------------------------------------------------------------------
 mcResult_t Device::allocateContiguousWsm(uint32_t len, CWsm **wsm)
 {
@@ -253,4 +270,16 @@ mcResult_t Device::mapBulkBuf(addr_t buf, uint32_t len, BulkBufferDescriptor **b
     return MC_DRV_OK;
 }
 
+
+//------------------------------------------------------------------------------
+void Device::unmapBulkBuf(BulkBufferDescriptor *blkBuf)
+{
+    // ignore any error, as we cannot do anything in this case.
+    int ret = pMcKMod->unregisterWsmL2(blkBuf->handle);
+    if (ret != 0) {
+        LOG_E("unmapBulkBuf(): mcKModUnregisterWsmL2 failed: %d", ret);
+    }
+    delete blkBuf;
+}
+
 /** @} */
@@ -54,6 +54,7 @@ private:
 public:
     uint32_t     deviceId; /**< Device identifier */
     Connection   *connection; /**< The device connection */
+    uint32_t     daemonVersion; /**< Version of the daemon behind the connection */
     CMcKMod_ptr  pMcKMod;
 
     Device(
@@ -120,6 +121,19 @@ public:
         uint32_t sessionId
     );
 
+    /**
+     * Take a buffer within a memory area out of the mapping cache of any session.
+     * @param buf Start of the memory area.
+     * @param len Length of the memory area.
+     * @param session The session that kept the buffer.
+     * @return The descriptor of a cached buffer overlapping the area, NULL if there is none.
+     */
+    BulkBufferDescriptor *takeCachedBulkBuf(
+        addr_t      buf,
+        uint32_t    len,
+        Session     **session
+    );
+
     /**
      * Allocate a block of contiguous WSM.
      * @param len The virtual address to be registered.
@@ -162,6 +176,14 @@ public:
         BulkBufferDescriptor **blkBuf
     );
 
+    /**
+     * Undo mapBulkBuf() for a buffer not added to a session.
+     * @param blkBuf The buffer object, it is deleted.
+     */
+    void unmapBulkBuf(
+        BulkBufferDescriptor *blkBuf
+    );
+
 };
 
 #endif /* DEVICE_H_ */
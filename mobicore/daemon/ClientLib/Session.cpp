@@ -47,6 +47,7 @@ Session::Session(
     this->sessionId = sessionId;
     this->mcKMod = mcKMod;
     this->notificationConnection = connection;
+    this->maxCachedBulkBufs = 0;
 
     sessionInfo.lastErr = SESSION_ERR_NO;
     sessionInfo.state = SESSION_STATE_INITIAL;
@@ -78,6 +79,11 @@ Session::~Session(void)
         delete(pBlkBufDescr);
     }
 
+    // The secure world dropped the cached mappings with the session
+    while ((pBlkBufDescr = takeCachedBulkBuf(NULL)) != NULL) {
+        releaseBulkBuf(pBlkBufDescr);
+    }
+
     // Finally delete notification connection
     delete notificationConnection;
 
@@ -165,6 +171,71 @@ uint32_t Session::getBufHandle(addr_t sVirtAddr)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+BulkBufferDescriptor *Session::cacheBulkBuf(addr_t buf)
+{
+    for ( bulkBufferDescrIterator_t iterator = bulkBufferDescriptors.begin();
+            iterator != bulkBufferDescriptors.end();
+            ++iterator ) {
+        if ((*iterator)->virtAddr == buf) {
+            cachedBulkBuffers.push_front(*iterator);
+            bulkBufferDescriptors.erase(iterator);
+            break;
+        }
+    }
+
+    if (cachedBulkBuffers.size() <= maxCachedBulkBufs) {
+        return NULL;
+    }
+    BulkBufferDescriptor *pBlkBufDescr = cachedBulkBuffers.back();
+    cachedBulkBuffers.pop_back();
+    return pBlkBufDescr;
+}
+
+//------------------------------------------------------------------------------
+BulkBufferDescriptor *Session::takeCachedBulkBuf(addr_t buf)
+{
+    for ( bulkBufferDescrIterator_t iterator = cachedBulkBuffers.begin();
+            iterator != cachedBulkBuffers.end();
+            ++iterator ) {
+        if (buf == NULL || (*iterator)->virtAddr == buf) {
+            BulkBufferDescriptor *pBlkBufDescr = *iterator;
+            cachedBulkBuffers.erase(iterator);
+            return pBlkBufDescr;
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+BulkBufferDescriptor *Session::takeCachedBulkBuf(addr_t buf, uint32_t len)
+{
+    for ( bulkBufferDescrIterator_t iterator = cachedBulkBuffers.begin();
+            iterator != cachedBulkBuffers.end();
+            ++iterator ) {
+        uint8_t *start = (uint8_t *)(*iterator)->virtAddr;
+        if (start < (uint8_t *)buf + len && (uint8_t *)buf < start + (*iterator)->len) {
+            BulkBufferDescriptor *pBlkBufDescr = *iterator;
+            cachedBulkBuffers.erase(iterator);
+            return pBlkBufDescr;
+        }
+    }
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+mcResult_t Session::releaseBulkBuf(BulkBufferDescriptor *blkBuf)
+{
+    LOG_V("releaseBulkBuf():handle=%u", blkBuf->handle);
+
+    mcResult_t ret = mcKMod->unregisterWsmL2(blkBuf->handle);
+    if (ret != MC_DRV_OK) {
+        LOG_E("mcKMod->unregisterWsmL2 failed: %x", ret);
+    }
+    delete blkBuf;
+    return ret;
+}
+
 //------------------------------------------------------------------------------
 mcResult_t Session::removeBulkBuf(addr_t virtAddr)
 {
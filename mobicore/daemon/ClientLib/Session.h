@@ -95,10 +95,12 @@ private:
     CMcKMod *mcKMod;
     CMutex workLock;
     bulkBufferDescrList_t bulkBufferDescriptors; /**< Descriptors of additional bulk buffer of a session */
+    bulkBufferDescrList_t cachedBulkBuffers; /**< Unmapped buffers still registered, most recently unmapped first */
     sessionInformation_t sessionInfo; /**< Informations about session */
 public:
     uint32_t sessionId;
     Connection *notificationConnection;
+    uint32_t maxCachedBulkBufs; /**< Size of the mapping cache, 0 if it is disabled */
 
     Session(uint32_t sessionId, CMcKMod *mcKMod, Connection *connection);
 
@@ -148,6 +150,43 @@ public:
      */
     uint32_t getBufHandle(addr_t sVirtualAddr);
 
+    /**
+     * Keep an unmapped bulk buffer registered in kernel module, the daemon
+     * keeps it mapped to the Trustlet.
+     *
+     * @param buf The virtual address of the bulk buffer.
+     *
+     * @return The least recently unmapped buffer if the cache overflows, the
+     *         caller invalidates and releases it. NULL otherwise.
+     */
+    BulkBufferDescriptor *cacheBulkBuf(addr_t buf);
+
+    /**
+     * Take an unmapped bulk buffer out of the cache.
+     *
+     * @param buf The virtual address of the bulk buffer, NULL for any.
+     *
+     * @return The descriptor or NULL if the buffer is not cached.
+     */
+    BulkBufferDescriptor *takeCachedBulkBuf(addr_t buf);
+
+    /**
+     * Take an unmapped bulk buffer within a memory area out of the cache.
+     *
+     * @param buf Start of the memory area.
+     * @param len Length of the memory area.
+     *
+     * @return The descriptor of a cached buffer overlapping the area, NULL if there is none.
+     */
+    BulkBufferDescriptor *takeCachedBulkBuf(addr_t buf, uint32_t len);
+
+    /**
+     * Unregister a bulk buffer taken out of the session from kernel module.
+     *
+     * @param blkBuf The descriptor, deleted.
+     */
+    mcResult_t releaseBulkBuf(BulkBufferDescriptor *blkBuf);
+
     /**
      * Set additional error information of the last error that occured.
      *
@@ -166,11 +166,48 @@ typedef struct {
     uint32_t sVirtualLen;       /**< Length of the mapped Bulk buffer */
 } mcBulkMap_t;
 
+#define MC_STATS_NUM_BUCKETS       16  /**< Buckets of a latency histogram */
+#define MC_STATS_NUM_COMMANDS      16  /**< Daemon commands with own latency statistics */
+
+/** Latency histogram. Bucket 0 counts latencies below 2us, bucket n those
+ * from 2^n us to below 2^(n+1) us, the last bucket all longer ones.
+ */
+typedef struct {
+    uint32_t count;             /**< Latencies measured */
+    uint32_t maxUs;             /**< Longest latency in us */
+    uint64_t totalUs;           /**< Sum of all latencies in us */
+    uint32_t buckets[MC_STATS_NUM_BUCKETS]; /**< Histogram */
+} mcLatencyStats_t;
+
+/** Performance counters of the MobiCore driver daemon, counted since it started.
+ */
+typedef struct {
+    mcLatencyStats_t command[MC_STATS_NUM_COMMANDS]; /**< Handling of daemon commands, by command ID */
+    mcLatencyStats_t registry;  /**< Handling of registry commands */
+    mcLatencyStats_t mcpRoundTrip; /**< MCP commands, from notifying MobiCore to its answer */
+    uint32_t ssiqCount;         /**< S-SIQ interrupts received */
+    uint32_t notificationsIn;   /**< Notifications received from MobiCore */
+    uint32_t notificationsOut;  /**< Notifications sent to MobiCore */
+    uint32_t nqOverflows;       /**< Notifications to MobiCore dropped because the queue was full */
+    uint32_t sessions;          /**< Open sessions */
+    uint32_t queuedNotifications; /**< Notifications waiting for the notification connection of their session */
+    uint32_t maxQueuedNotifications; /**< Most notifications waiting for one session */
+    uint32_t unknownNotifications; /**< Notifications waiting for a session being opened */
+    uint32_t blobCacheHits;     /**< Service blobs served by the registry cache */
+    uint32_t blobCacheMisses;   /**< Service blobs the registry assembled */
+    uint32_t blobCacheEvictions; /**< Service blobs dropped to make room */
+    uint32_t blobCacheInvalidations; /**< Registry writes which emptied the cache */
+    uint32_t blobCacheEntries;  /**< Service blobs cached */
+    uint32_t blobCacheSize;     /**< Bytes of the cached service blobs */
+} mcDaemonStats_t;
+
 
 #define MC_DEVICE_ID_DEFAULT       0 /**< The default device ID */
 #define MC_INFINITE_TIMEOUT        ((int32_t)(-1)) /**< Wait infinite for a response of the MC. */
 #define MC_NO_TIMEOUT              0   /**< Do not wait for a response of the MC. */
 #define MC_MAX_TCI_LEN             0x100000 /**< TCI/DCI must not exceed 1MiB */
+#define MC_MAX_SESSION_MAPS        4   /**< Bulk buffers mcOpenSessionEx() maps at most */
+#define MC_MAX_MAP_CACHE_SIZE      16  /**< Unmapped buffers mcSetMapCache() keeps mapped at most */
 
 /* Mark only the following functions for export */
 #pragma GCC visibility push(default)
@@ -268,6 +305,40 @@ __MC_CLIENT_LIB_API mcResult_t mcOpenTrustlet(
     uint32_t           tciLen
 );
 
+/** Open a new session to a Trustlet and map bulk buffers to it.
+ *
+ * Same as mcOpenSession() followed by mcMap() for each buffer, but done in a
+ * single request to the daemon, which hands all MCP commands to MobiCore at
+ * once. Either the session is opened and all buffers are mapped, or nothing is.
+ *
+ * @param [in,out] session On success, the session data will be returned. Note that session.deviceId has to be the device id of an opened device.
+ * @param [in] uuid UUID of the Trustlet to be opened.
+ * @param [in] tci TCI buffer for communicating with the trustlet.
+ * @param [in] tciLen Length of the TCI buffer. Maximum allowed value is MC_MAX_TCI_LEN.
+ * @param [in] bufs Virtual addresses of the buffers to share with the Trustlet.
+ * @param [in] bufLens Lengths of the buffers in bytes.
+ * @param [in] numBufs Number of buffers. Maximum allowed value is MC_MAX_SESSION_MAPS.
+ * @param [out] mapInfos Information about each mapped buffer, as returned by mcMap().
+ *
+ * @return MC_DRV_OK if operation has been successfully completed.
+ * @return MC_DRV_INVALID_PARAMETER if a parameter is invalid.
+ * @return MC_DRV_ERR_UNKNOWN_DEVICE when device id is invalid.
+ * @return MC_DRV_ERR_DAEMON_UNREACHABLE when problems with daemon socket occur.
+ * @return MC_DRV_ERR_BULK_MAPPING when registering a buffer failed.
+ *
+ * Uses a Mutex.
+ */
+__MC_CLIENT_LIB_API mcResult_t mcOpenSessionEx(
+    mcSessionHandle_t  *session,
+    const mcUuid_t     *uuid,
+    uint8_t            *tci,
+    uint32_t           tciLen,
+    void               **bufs,
+    uint32_t           *bufLens,
+    uint32_t           numBufs,
+    mcBulkMap_t        *mapInfos
+);
+
 
 /** Close a Trustlet session.
  *
@@ -442,6 +513,56 @@ __MC_CLIENT_LIB_API mcResult_t mcUnmap(
     mcBulkMap_t        *mapInfo
 );
 
+/**
+ * Keep bulk buffers mapped to the Trustlet after mcUnmap().
+ * Mapping the same buffer with the same length again then costs no world
+ * switch, which pays off for TLCs mapping the same buffers for every command.
+ * The least recently unmapped buffers are really unmapped when more than
+ * maxEntries are kept, or when the Trustlet runs out of virtual address space.
+ *
+ * @attention The Trustlet can still access a kept buffer after mcUnmap().
+ * @attention A kept buffer stays locked in memory. mcFreeWsm() and closing the
+ * session unmap it. Any other buffer, e.g. from the heap, is kept by its address:
+ * mcInvalidateMapCache() must be called before it is freed, or a buffer allocated
+ * later at the same address is mapped to the pages of the freed one.
+ *
+ * @param [in] session Session handle with information of the deviceId and the sessionId.
+ * @param [in] maxEntries Number of buffers to keep mapped, 0 disables the cache.
+ * Maximum allowed value is MC_MAX_MAP_CACHE_SIZE. Buffers kept so far are unmapped.
+ *
+ * @return MC_DRV_OK if operation has been successfully completed.
+ * @return MC_DRV_INVALID_PARAMETER if a parameter is invalid.
+ * @return MC_DRV_ERR_UNKNOWN_SESSION when session id is invalid.
+ * @return MC_DRV_ERR_UNKNOWN_DEVICE when device id of session is invalid.
+ * @return MC_DRV_ERR_NOT_IMPLEMENTED if the daemon has no mapping cache.
+ * @return MC_DRV_ERR_DAEMON_UNREACHABLE when problems with daemon occur.
+ *
+ * Uses a Mutex.
+ */
+__MC_CLIENT_LIB_API mcResult_t mcSetMapCache(
+    mcSessionHandle_t  *session,
+    uint32_t           maxEntries
+);
+
+/**
+ * Really unmap bulk buffers kept mapped by mcSetMapCache().
+ *
+ * @param [in] session Session handle with information of the deviceId and the sessionId.
+ * @param [in] buf Virtual address given to mcUnmap(), NULL for all buffers of the session.
+ *
+ * @return MC_DRV_OK if operation has been successfully completed, also if buf is not kept.
+ * @return MC_DRV_INVALID_PARAMETER if a parameter is invalid.
+ * @return MC_DRV_ERR_UNKNOWN_SESSION when session id is invalid.
+ * @return MC_DRV_ERR_UNKNOWN_DEVICE when device id of session is invalid.
+ * @return MC_DRV_ERR_DAEMON_UNREACHABLE when problems with daemon occur.
+ *
+ * Uses a Mutex.
+ */
+__MC_CLIENT_LIB_API mcResult_t mcInvalidateMapCache(
+    mcSessionHandle_t  *session,
+    void               *buf
+);
+
 
 /**
  * @attention: Not implemented.
@@ -495,6 +616,25 @@ __MC_CLIENT_LIB_API mcResult_t mcGetMobiCoreVersion(
     uint32_t  deviceId,
     mcVersionInfo_t *versionInfo
 );
+
+/**
+ * Get the performance counters of the MobiCore driver daemon.
+ * Counting costs the daemon a few atomic increments per command, the
+ * counters cannot be turned off or reset.
+ *
+ * @param [in] deviceId of an open device.
+ * @param [out] stats Daemon performance counters.
+ *
+ * @return MC_DRV_OK if operation has been successfully completed.
+ * @return MC_DRV_ERR_UNKNOWN_DEVICE when device is not open.
+ * @return MC_DRV_INVALID_PARAMETER if a parameter is invalid.
+ * @return MC_DRV_ERR_NOT_IMPLEMENTED if the daemon does not count.
+ * @return MC_DRV_ERR_DAEMON_UNREACHABLE when problems with daemon occur.
+ */
+__MC_CLIENT_LIB_API mcResult_t mcGetDaemonStats(
+    uint32_t  deviceId,
+    mcDaemonStats_t *stats
+);
 #pragma GCC visibility pop
 #endif /** MCDRIVER_H_ */
 
@@ -88,6 +88,20 @@ bool CSemaphore::wait(int sec)
 }
 
 
+//------------------------------------------------------------------------------
+bool CSemaphore::tryWait()
+{
+    bool ret = false;
+    pthread_mutex_lock(&m_mutex);
+    if ( m_count > 0 ) {
+        m_count --;
+        ret = true;
+    }
+    pthread_mutex_unlock(&m_mutex);
+    return ret;
+}
+
+
 //------------------------------------------------------------------------------
 bool CSemaphore::wouldWait()
 {
@@ -53,6 +53,12 @@ public:
     void wait(void);
     bool wait(int sec);
 
+    /**
+     * Take the semaphore if that does not block.
+     * @return true if it was taken.
+     */
+    bool tryWait(void);
+
     bool wouldWait(void);
 
     void signal(void);
@@ -40,6 +40,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <poll.h>
+#include <time.h>
 
 //#define LOG_VERBOSE
 #include "log.h"
@@ -49,6 +50,9 @@
 Connection::Connection(void)
 {
     connectionData = NULL;
+    detached = false;
+    readStart = 0;
+    readEnd = 0;
     // Set invalid socketDescriptor
     socketDescriptor = -1;
 }
@@ -63,6 +67,9 @@ Connection::Connection(int socketDescriptor, sockaddr_un *remote)
     this->socketDescriptor = socketDescriptor;
     this->remote = *remote;
     connectionData = NULL;
+    detached = false;
+    readStart = 0;
+    readEnd = 0;
 }
 
 
@@ -114,53 +121,96 @@ size_t Connection::readData(void *buffer, uint32_t len)
 
 
 //------------------------------------------------------------------------------
-size_t Connection::readData(void *buffer, uint32_t len, int32_t timeout)
+static int32_t timeLeft(const struct timespec *deadline)
 {
-    size_t ret = 0;
-    struct timeval tv;
-    struct timeval *ptv = NULL;
-    fd_set readfds;
-
-    assert(NULL != buffer);
-    assert(socketDescriptor != -1);
+    struct timespec now;
+    int64_t left;
 
-    if (timeout >= 0) {
-        // Calculate timeout value
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout - (tv.tv_sec * 1000)) * 1000;
-        ptv = &tv;
-    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left = (int64_t)(deadline->tv_sec - now.tv_sec) * 1000 +
+           (deadline->tv_nsec - now.tv_nsec) / 1000000;
 
-    FD_ZERO(&readfds);
-    FD_SET(socketDescriptor, &readfds);
-    ret = select(socketDescriptor + 1, &readfds, NULL, NULL, ptv);
+    return (left < 0) ? 0 : (int32_t)left;
+}
 
-    // check for read error
-    if ((int)ret == -1) {
-        LOG_ERRNO("select");
-        return -1;
-    }
 
-    // Handle case of no descriptor ready
-    if (ret == 0) {
-        LOG_W(" Timeout during select() / No more notifications.");
-        return -2;
-    }
+//------------------------------------------------------------------------------
+size_t Connection::readData(void *buffer, uint32_t len, int32_t timeout)
+{
+    uint8_t *dst = (uint8_t *)buffer;
+    uint32_t got = 0;
+    struct timespec deadline;
 
-    // one or more descriptors are ready
+    assert(NULL != buffer);
+    assert(socketDescriptor != -1);
 
-    // finally check if fd has been selected -> must socketDescriptor
-    if (!FD_ISSET(socketDescriptor, &readfds)) {
-        LOG_ERRNO("no fd is set, select");
-        return ret;
+    if (timeout >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
     }
 
-    ret = recv(socketDescriptor, buffer, len, MSG_DONTWAIT);
-    if (ret == 0) {
-        LOG_V(" readData(): peer orderly closed connection.");
+    while (got < len) {
+        ssize_t ret;
+
+        // Serve what was read ahead first
+        if (readStart < readEnd) {
+            uint32_t n = readEnd - readStart;
+            if (n > len - got) {
+                n = len - got;
+            }
+            memcpy(dst + got, readBuffer + readStart, n);
+            readStart += n;
+            got += n;
+            continue;
+        }
+
+        // Big reads go straight to the caller, small ones through the buffer
+        if (len - got >= sizeof(readBuffer)) {
+            ret = recv(socketDescriptor, dst + got, len - got, MSG_DONTWAIT);
+            if (ret > 0) {
+                got += ret;
+                continue;
+            }
+        } else {
+            ret = recv(socketDescriptor, readBuffer, sizeof(readBuffer), MSG_DONTWAIT);
+            if (ret > 0) {
+                readStart = 0;
+                readEnd = ret;
+                continue;
+            }
+        }
+
+        if (ret == 0) {
+            LOG_V(" readData(): peer orderly closed connection.");
+            break;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERRNO("recv");
+            return (got > 0) ? got : -1;
+        }
+
+        // Nothing there yet
+        ret = waitSocket((timeout >= 0) ? timeLeft(&deadline) : -1);
+        if (ret < 0) {
+            return (got > 0) ? got : -1;
+        }
+        if (ret == 0) {
+            LOG_W(" Timeout during poll() / No more notifications.");
+            return (got > 0) ? got : -2;
+        }
     }
 
-    return ret;
+    return got;
 }
 
 
@@ -184,36 +234,70 @@ size_t Connection::writeData(void *buffer, uint32_t len)
 //------------------------------------------------------------------------------
 int Connection::waitData(int32_t timeout)
 {
-    size_t ret;
-    struct timeval tv;
-    struct timeval *ptv = NULL;
-    fd_set readfds;
+    int ret;
 
     assert(socketDescriptor != -1);
 
-    if (timeout >= 0) {
-        // Calculate timeout value
-        tv.tv_sec = timeout / 1000;
-        tv.tv_usec = (timeout - (tv.tv_sec * 1000)) * 1000;
-        ptv = &tv;
+    if (readStart < readEnd) {
+        return 0;
     }
 
-    FD_ZERO(&readfds);
-    FD_SET(socketDescriptor, &readfds);
-    ret = select(socketDescriptor + 1, &readfds, NULL, NULL, ptv);
-
-    // check for read error
-    if ((int)ret == -1) {
-        LOG_ERRNO("select");
+    ret = waitSocket(timeout);
+    if (ret < 0) {
         return ret;
     } else if (ret == 0) {
-        LOG_E("select() timed out");
+        LOG_E("poll() timed out");
         return -1;
     }
 
     return 0;
 }
 
+//------------------------------------------------------------------------------
+bool Connection::isDataPending(void)
+{
+    ssize_t ret;
+
+    assert(socketDescriptor != -1);
+
+    if (readStart < readEnd) {
+        return true;
+    }
+
+    do {
+        ret = recv(socketDescriptor, readBuffer, sizeof(readBuffer), MSG_DONTWAIT);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret > 0) {
+        readStart = 0;
+        readEnd = ret;
+        return true;
+    }
+
+    // A closed or failed socket is pending too, the next read reports it
+    return (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+}
+
+//------------------------------------------------------------------------------
+int Connection::waitSocket(int32_t timeout)
+{
+    struct pollfd ufds[1];
+    int ret;
+
+    ufds[0].fd = socketDescriptor;
+    ufds[0].events = POLLIN;
+
+    do {
+        ret = poll(ufds, 1, timeout);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        LOG_ERRNO("poll");
+    }
+
+    return ret;
+}
+
 //------------------------------------------------------------------------------
 bool Connection::isConnectionAlive(void)
 {
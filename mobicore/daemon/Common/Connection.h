@@ -42,6 +42,9 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+/** Bytes read ahead from the socket of a connection. Holds a command header
+ * with its payload, so that a command costs one recv(). */
+#define CONNECTION_READ_BUFFER_SIZE (1024)
 
 class Connection
 {
@@ -67,12 +70,14 @@ public:
 
     /**
      * Read bytes from the connection.
+     * Reads until len bytes are there, the peer closes or the timeout expires.
+     * Only waits when nothing is buffered or pending on the socket.
      *
      * @param buffer    Pointer to destination buffer.
      * @param len       Number of bytes to read.
      * @param timeout   Timeout in milliseconds
-     * @return Number of bytes read.
-     * @return -1 if select() failed (returned -1)
+     * @return Number of bytes read, less than len if the peer closed.
+     * @return -1 if the socket failed
      * @return -2 if no data available, i.e. timeout
      */
     virtual size_t readData(void *buffer, uint32_t len, int32_t timeout);
@@ -105,6 +110,14 @@ public:
      */
     virtual int waitData(int32_t timeout);
 
+    /**
+     * Check if a read would return without waiting.
+     * Reads ahead from the socket when nothing is buffered.
+     *
+     * @return true if data is buffered, or the socket has data, was closed or failed.
+     */
+    virtual bool isDataPending(void);
+
     /*
      * Checks if the socket is  still connected to the daemon
      *
@@ -119,6 +132,18 @@ public:
      */
     virtual bool getPeerCredentials(struct ucred &cr);
 
+private:
+    uint8_t readBuffer[CONNECTION_READ_BUFFER_SIZE]; /**< Data read ahead */
+    uint32_t readStart; /**< First byte not yet returned */
+    uint32_t readEnd; /**< End of the data in readBuffer */
+
+    /**
+     * Wait for the socket to become readable.
+     *
+     * @param timeout   Timeout in milliseconds, -1 to wait forever
+     * @return 1 if readable, 0 on timeout, -1 on error
+     */
+    int waitSocket(int32_t timeout);
 };
 
 typedef std::list<Connection *>         connectionList_t;
@@ -32,6 +32,7 @@
  */
 
 #include <cstdlib>
+#include <cstring>
 #include <pthread.h>
 #include "McTypes.h"
 
@@ -54,6 +55,14 @@
 MobiCoreDevice::MobiCoreDevice()
 {
     mcFault = false;
+    mcVersionInfo = NULL;
+    nq = NULL;
+    mcpMessage = NULL;
+    mcpSubmitTime = 0;
+    memset(&mcpRoundTrip, 0, sizeof(mcpRoundTrip));
+    ssiqCount = 0;
+    notificationsIn = 0;
+    notificationsOut = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -65,6 +74,16 @@ MobiCoreDevice::~MobiCoreDevice()
 
 //------------------------------------------------------------------------------
 TrustletSession *MobiCoreDevice::getTrustletSession(uint32_t sessionId)
+{
+    sessionMutex.lock();
+    TrustletSession *ts = findTrustletSession(sessionId);
+    sessionMutex.unlock();
+    return ts;
+}
+
+
+//------------------------------------------------------------------------------
+TrustletSession *MobiCoreDevice::findTrustletSession(uint32_t sessionId)
 {
     for (trustletSessionIterator_t session = trustletSessions.begin();
             session != trustletSessions.end();
@@ -91,15 +110,17 @@ void MobiCoreDevice::cleanSessionBuffers(TrustletSession *session)
 //------------------------------------------------------------------------------
 void MobiCoreDevice::removeTrustletSession(uint32_t sessionId)
 {
+    sessionMutex.lock();
     for (trustletSessionIterator_t session = trustletSessions.begin();
             session != trustletSessions.end();
             ++session) {
         if ((*session)->sessionId == sessionId) {
             cleanSessionBuffers(*session);
             trustletSessions.erase(session);
-            return;
+            break;
         }
     }
+    sessionMutex.unlock();
 }
 //------------------------------------------------------------------------------
 Connection *MobiCoreDevice::getSessionConnection(uint32_t sessionId, notification_t *notification)
@@ -107,7 +128,7 @@ Connection *MobiCoreDevice::getSessionConnection(uint32_t sessionId, notificatio
     Connection *con = NULL;
     TrustletSession *ts = NULL;
 
-    ts = getTrustletSession(sessionId);
+    ts = findTrustletSession(sessionId);
     if (ts == NULL) {
         return NULL;
     }
@@ -142,24 +163,28 @@ bool MobiCoreDevice::open(Connection *connection)
 void MobiCoreDevice::close(Connection *connection)
 {
     trustletSessionList_t::reverse_iterator interator;
-    static CMutex mutex;
+    std::vector<uint32_t> sessionIds;
     // 1. Iterate through device session to find connection
     // 2. Decide what to do with open Trustlet sessions
     // 3. Remove & delete deviceSession from vector
 
-    // Enter critical section
-    mutex.lock();
+    // Collect the sessions first, the list must not stay locked while
+    // waiting for MobiCore: the IRQ handler needs it to deliver the response
+    sessionMutex.lock();
     for (interator = trustletSessions.rbegin();
             interator != trustletSessions.rend();
             interator++) {
         TrustletSession *ts = *interator;
 
         if (ts->deviceConnection == connection) {
-            closeSession(connection, ts->sessionId);
+            sessionIds.push_back(ts->sessionId);
         }
     }
-    // Leave critical section
-    mutex.unlock();
+    sessionMutex.unlock();
+
+    for (size_t i = 0; i < sessionIds.size(); i++) {
+        closeSession(connection, sessionIds[i]);
+    }
 
     // After the trustlet is done make sure to tell the driver to cleanup
     // all the orphaned drivers
@@ -189,9 +214,18 @@ void MobiCoreDevice::start(void)
 }
 
 
+//------------------------------------------------------------------------------
+void MobiCoreDevice::notifyMcp(void)
+{
+    mcpSubmitTime = statsTimeUs();
+    notify(SID_MCP);
+}
+
+
 //------------------------------------------------------------------------------
 void MobiCoreDevice::signalMcpNotification(void)
 {
+    statsAddLatency(&mcpRoundTrip, mcpSubmitTime);
     mcpSessionNotification.signal();
 }
 
@@ -213,12 +247,12 @@ bool MobiCoreDevice::waitMcpNotification(void)
             if (getMobicoreStatus() == MC_STATUS_HALT) {
                 dumpMobicoreStatus();
                 mcFault = true;
-                return false;
+                    return false;
             } else {
                 counter--;
                 if (counter < 1) {
                     mcFault = true;
-                    return false;
+                            return false;
                 }
             }
         } else {
@@ -255,6 +289,7 @@ mcResult_t MobiCoreDevice::openSession(
     uint32_t                        tciOffset,
     mcDrvRspOpenSessionPayload_ptr  pRspOpenSessionPayload)
 {
+    mcpMutex.lock();
     do {
         addr_t tci;
         uint32_t len;
@@ -275,18 +310,21 @@ mcResult_t MobiCoreDevice::openSession(
         }
         else {
             LOG_E("Failed to find contiguous WSM %u", tciHandle);
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_WSM_HANDLE_NOT_FOUND;
         }
 
 
         if (!lockWsmL2(tciHandle)) {
             LOG_E("Failed to lock contiguous WSM %u", tciHandle);
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_WSM_HANDLE_NOT_FOUND;
         }
 
         if (tciLen == 0 ||  tciLen > len) {
             LOG_E("Invalid TCI len from client %u, driver = %u",
                   pLoadDataOpenSession->len, len);
+            mcpMutex.unlock();
             return MC_DRV_ERR_TCI_GREATER_THAN_WSM;
         }
 
@@ -306,14 +344,18 @@ mcResult_t MobiCoreDevice::openSession(
 
         // Clear the notifications queue. We asume the race condition we have
         // seen in openSession never happens elsewhere
+        sessionMutex.lock();
         notifications = std::queue<notification_t>();
+        sessionMutex.unlock();
         // Notify MC about a new command inside the MCP buffer
-        notify(SID_MCP);
+        notifyMcp();
 
         // Wait till response from MC is available
         if (!waitMcpNotification()) {
             // Here Mobicore can be considered dead.
             unlockWsmL2(tciHandle);
+            endOpenSession(NULL);
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_MCI_ERROR;
         }
 
@@ -323,6 +365,8 @@ mcResult_t MobiCoreDevice::openSession(
             // Something is messing with our MCI memory, we cannot know if the Trustlet was loaded.
             // Had in been loaded, we are loosing track of it here.
             unlockWsmL2(tciHandle);
+            endOpenSession(NULL);
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_MCI_ERROR;
         }
 
@@ -331,11 +375,11 @@ mcResult_t MobiCoreDevice::openSession(
         if (mcRet != MC_MCP_RET_OK) {
             LOG_E("MCP OPEN returned code %d.", mcRet);
             unlockWsmL2(tciHandle);
+            endOpenSession(NULL);
+            mcpMutex.unlock();
             return MAKE_MC_DRV_MCP_ERROR(mcRet);
         }
 
-        LOG_I(" After MCP OPEN, we have %d queued notifications",
-              notifications.size());
         // Read MC answer from MCP buffer
         TrustletSession *trustletSession = new TrustletSession(
             deviceConnection,
@@ -345,19 +389,42 @@ mcResult_t MobiCoreDevice::openSession(
         pRspOpenSessionPayload->deviceSessionId = (uint32_t)trustletSession;
         pRspOpenSessionPayload->sessionMagic = trustletSession->sessionMagic;
 
-        trustletSessions.push_back(trustletSession);
-
         trustletSession->addBulkBuff(new CWsm((void *)pLoadDataOpenSession->offs, pLoadDataOpenSession->len, tciHandle, 0));
 
+        endOpenSession(trustletSession);
+
+    } while (0);
+    mcpMutex.unlock();
+    return MC_DRV_OK;
+}
+
+
+//------------------------------------------------------------------------------
+void MobiCoreDevice::endOpenSession(TrustletSession *trustletSession)
+{
+    std::queue<notification_t> others;
+
+    // The IRQ handler queues notifications of the new session until it
+    // is in the list
+    sessionMutex.lock();
+    if (trustletSession != NULL) {
+        LOG_I(" After MCP OPEN, we have %d queued notifications",
+              notifications.size());
+        trustletSessions.push_back(trustletSession);
+
         // We have some queued notifications and we need to send them to them
         // trustlet session
         while (!notifications.empty()) {
-            trustletSession->queueNotification(&notifications.front());
+            if (notifications.front().sessionId == trustletSession->sessionId) {
+                trustletSession->queueNotification(&notifications.front());
+            } else {
+                others.push(notifications.front());
+            }
             notifications.pop();
         }
-
-    } while (0);
-    return MC_DRV_OK;
+        notifications = others;
+    }
+    sessionMutex.unlock();
 }
 
 
@@ -373,6 +440,7 @@ TrustletSession *MobiCoreDevice::registerTrustletConnection(
           cmdNqConnect->sessionId,
           cmdNqConnect->sessionMagic);
 
+    sessionMutex.lock();
     for (trustletSessionIterator_t iterator = trustletSessions.begin();
             iterator != trustletSessions.end();
             ++iterator) {
@@ -391,8 +459,15 @@ TrustletSession *MobiCoreDevice::registerTrustletConnection(
 
         LOG_I(" Found Service session, registered connection.");
 
+        // Nothing may be forwarded before the result
+        mcResult_t mcResult = MC_DRV_OK;
+        connection->writeData(&mcResult, sizeof(mcResult));
+        ts->processQueuedNotifications();
+        sessionMutex.unlock();
+
         return ts;
     }
+    sessionMutex.unlock();
 
     LOG_I("registerTrustletConnection(): search failed");
     return NULL;
@@ -404,21 +479,24 @@ mcResult_t MobiCoreDevice::closeSession(uint32_t sessionId)
 {
     LOG_I(" Write MCP CLOSE message to MCI, notify and wait");
 
+    mcpMutex.lock();
     // Write MCP close message to buffer
     mcpMessage->cmdClose.cmdHeader.cmdId = MC_MCP_CMD_CLOSE_SESSION;
     mcpMessage->cmdClose.sessionId = sessionId;
 
     // Notify MC about the availability of a new command inside the MCP buffer
-    notify(SID_MCP);
+    notifyMcp();
 
     // Wait till response from MSH is available
     if (!waitMcpNotification()) {
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
     // Check if the command response ID is correct
     if ((MC_MCP_CMD_CLOSE_SESSION | FLAG_RESPONSE) != mcpMessage->rspHeader.rspId) {
         LOG_E("CMD_CLOSE_SESSION got invalid MCP response");
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
@@ -427,9 +505,11 @@ mcResult_t MobiCoreDevice::closeSession(uint32_t sessionId)
 
     if (mcRet != MC_MCP_RET_OK) {
         LOG_E("CMD_CLOSE_SESSION error %d", mcRet);
+        mcpMutex.unlock();
         return MAKE_MC_DRV_MCP_ERROR(mcRet);
     }
 
+    mcpMutex.unlock();
     return MC_DRV_OK;
 }
 
@@ -466,22 +546,10 @@ mcResult_t MobiCoreDevice::closeSession(Connection *deviceConnection, uint32_t s
 
 
 //------------------------------------------------------------------------------
-mcResult_t MobiCoreDevice::mapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle, uint32_t pAddrL2,
-                                   uint32_t offsetPayload, uint32_t lenBulkMem, uint32_t *secureVirtualAdr)
+mcResult_t MobiCoreDevice::mcpMap(uint32_t sessionId, uint32_t pAddrL2, uint32_t offsetPayload,
+                                  uint32_t lenBulkMem, uint32_t *secureVirtualAdr)
 {
-    TrustletSession *ts = getTrustletSession(sessionId);
-    if (ts == NULL) {
-        LOG_E("no session found with id=%d", sessionId);
-        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
-    }
-    /* The connection does not own this session ID! */
-    if(ts->deviceConnection != deviceConnection) {
-        LOG_E("no session found with id=%d", sessionId);
-        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
-    }
-
-    // TODO-2012-09-06-haenellu: Think about not ignoring the error case, ClientLib does not allow this.
-    ts->addBulkBuff(new CWsm((void *)offsetPayload, lenBulkMem, handle, (void *)pAddrL2));
+    mcpMutex.lock();
     // Write MCP map message to buffer
     mcpMessage->cmdMap.cmdHeader.cmdId = MC_MCP_CMD_MAP;
     mcpMessage->cmdMap.sessionId = sessionId;
@@ -491,16 +559,18 @@ mcResult_t MobiCoreDevice::mapBulk(Connection *deviceConnection, uint32_t sessio
     mcpMessage->cmdMap.lenBuffer = lenBulkMem;
 
     // Notify MC about the availability of a new command inside the MCP buffer
-    notify(SID_MCP);
+    notifyMcp();
 
     // Wait till response from MC is available
     if (!waitMcpNotification()) {
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
     // Check if the command response ID is correct
     if (mcpMessage->rspHeader.rspId != (MC_MCP_CMD_MAP | FLAG_RESPONSE)) {
         LOG_E("CMD_MAP got invalid MCP response");
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
@@ -508,29 +578,20 @@ mcResult_t MobiCoreDevice::mapBulk(Connection *deviceConnection, uint32_t sessio
 
     if (mcRet != MC_MCP_RET_OK) {
         LOG_E("MCP MAP returned code %d.", mcRet);
+        mcpMutex.unlock();
         return MAKE_MC_DRV_MCP_ERROR(mcRet);
     }
 
     *secureVirtualAdr = mcpMessage->rspMap.secureVirtualAdr;
+    mcpMutex.unlock();
     return MC_DRV_OK;
 }
 
 
 //------------------------------------------------------------------------------
-mcResult_t MobiCoreDevice::unmapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle,
-                                     uint32_t secureVirtualAdr, uint32_t lenBulkMem)
+mcResult_t MobiCoreDevice::mcpUnmap(uint32_t sessionId, uint32_t secureVirtualAdr, uint32_t lenBulkMem)
 {
-    TrustletSession *ts = getTrustletSession(sessionId);
-    if (ts == NULL) {
-        LOG_E("no session found with id=%d", sessionId);
-        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
-    }
-    /* The connection does not own this session ID! */
-    if(ts->deviceConnection != deviceConnection) {
-        LOG_E("no session found with id=%d", sessionId);
-        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
-    }
-
+    mcpMutex.lock();
     // Write MCP unmap command to buffer
     mcpMessage->cmdUnmap.cmdHeader.cmdId = MC_MCP_CMD_UNMAP;
     mcpMessage->cmdUnmap.sessionId = sessionId;
@@ -539,35 +600,213 @@ mcResult_t MobiCoreDevice::unmapBulk(Connection *deviceConnection, uint32_t sess
     mcpMessage->cmdUnmap.lenVirtualBuffer = lenBulkMem;
 
     // Notify MC about the availability of a new command inside the MCP buffer
-    notify(SID_MCP);
+    notifyMcp();
 
     // Wait till response from MC is available
     if (!waitMcpNotification()) {
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
     // Check if the command response ID is correct
     if (mcpMessage->rspHeader.rspId != (MC_MCP_CMD_UNMAP | FLAG_RESPONSE)) {
-        LOG_E("CMD_OPEN_SESSION got invalid MCP response");
+        LOG_E("CMD_UNMAP got invalid MCP response");
+        mcpMutex.unlock();
         return MC_DRV_ERR_DAEMON_MCI_ERROR;
     }
 
     uint32_t mcRet = mcpMessage->rspUnmap.rspHeader.result;
+    mcpMutex.unlock();
 
     if (mcRet != MC_MCP_RET_OK) {
         LOG_E("MCP UNMAP returned code %d.", mcRet);
         return MAKE_MC_DRV_MCP_ERROR(mcRet);
-    } else {
-        // Just remove the buffer
-        // TODO-2012-09-06-haenellu: Haven't we removed it already?
-        if (!ts->removeBulkBuff(handle))
-            LOG_I("unmapBulk(): no buffer found found with handle=%u", handle);
     }
+    return MC_DRV_OK;
+}
+
+
+//------------------------------------------------------------------------------
+uint32_t MobiCoreDevice::unmapIdleMaps(TrustletSession *ts, idleMapList_t *maps)
+{
+    uint32_t unmapped = 0;
+
+    for (idleMapList_t::iterator it = maps->begin(); it != maps->end(); ++it) {
+        // A buffer the secure world refuses to unmap stays locked until the
+        // session is closed
+        if (mcpUnmap(ts->sessionId, it->secureVirtualAdr, it->lenBulkMem) != MC_DRV_OK) {
+            continue;
+        }
+        ts->removeBulkBuff(it->handle);
+        unlockWsmL2(it->handle);
+        unmapped++;
+    }
+    maps->clear();
+    return unmapped;
+}
+
+
+//------------------------------------------------------------------------------
+bool MobiCoreDevice::mapCachedBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle,
+                                   uint32_t offsetPayload, uint32_t lenBulkMem, uint32_t *secureVirtualAdr)
+{
+    TrustletSession *ts = getTrustletSession(sessionId);
+    if (ts == NULL || ts->deviceConnection != deviceConnection) {
+        return false;
+    }
+    return ts->reuseIdleMap(handle, offsetPayload, lenBulkMem, secureVirtualAdr);
+}
+
+
+//------------------------------------------------------------------------------
+mcResult_t MobiCoreDevice::mapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle, uint32_t pAddrL2,
+                                   uint32_t offsetPayload, uint32_t lenBulkMem, uint32_t *secureVirtualAdr)
+{
+    TrustletSession *ts = getTrustletSession(sessionId);
+    if (ts == NULL) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+    /* The connection does not own this session ID! */
+    if(ts->deviceConnection != deviceConnection) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+
+    // TODO-2012-09-06-haenellu: Think about not ignoring the error case, ClientLib does not allow this.
+    ts->addBulkBuff(new CWsm((void *)offsetPayload, lenBulkMem, handle, (void *)pAddrL2));
+
+    mcResult_t mcRet = mcpMap(sessionId, pAddrL2, offsetPayload, lenBulkMem, secureVirtualAdr);
+
+    // Cached mappings are the first to give way when the Trustlet runs out
+    // of virtual address space
+    if (mcRet == MAKE_MC_DRV_MCP_ERROR(MC_MCP_RET_ERR_OUT_OF_RESOURCES)) {
+        idleMapList_t maps;
+        ts->takeIdleMaps(0, &maps);
+        if (unmapIdleMaps(ts, &maps) > 0) {
+            LOG_I("mapBulk(): dropped cached mappings of session %u", sessionId);
+            mcRet = mcpMap(sessionId, pAddrL2, offsetPayload, lenBulkMem, secureVirtualAdr);
+        }
+    }
+
+    return mcRet;
+}
+
+
+//------------------------------------------------------------------------------
+mcResult_t MobiCoreDevice::mapBulks(Connection *deviceConnection, uint32_t sessionId,
+                                    bulkMap_ptr maps, uint32_t numMaps)
+{
+    TrustletSession *ts = getTrustletSession(sessionId);
+    if (ts == NULL) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+    /* The connection does not own this session ID! */
+    if (ts->deviceConnection != deviceConnection) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+
+    if (numMaps > MC_DRV_MAX_SESSION_MAPS) {
+        LOG_E("cannot map %u buffers at once", numMaps);
+        return MC_DRV_ERR_INVALID_PARAMETER;
+    }
+
+    for (uint32_t i = 0; i < numMaps; i++) {
+        ts->addBulkBuff(new CWsm((void *)maps[i].offsetPayload, maps[i].lenBulkMem,
+                                 maps[i].handle, (void *)maps[i].pAddrL2));
+    }
+
+    // A failure stops the remaining maps
+    mcResult_t ret = MC_DRV_OK;
+    for (uint32_t i = 0; i < numMaps && ret == MC_DRV_OK; i++) {
+        ret = mcpMap(sessionId, maps[i].pAddrL2, maps[i].offsetPayload,
+                     maps[i].lenBulkMem, &maps[i].secureVirtualAdr);
+    }
+
+    return ret;
+}
+
+
+//------------------------------------------------------------------------------
+mcResult_t MobiCoreDevice::unmapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle,
+                                     uint32_t secureVirtualAdr, uint32_t lenBulkMem)
+{
+    TrustletSession *ts = getTrustletSession(sessionId);
+    if (ts == NULL) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+    /* The connection does not own this session ID! */
+    if(ts->deviceConnection != deviceConnection) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+
+    // With the mapping cache enabled the buffer stays mapped and locked
+    // until it is reused, invalidated or evicted
+    CWsm_ptr pWsm = ts->findBulkBuff(handle);
+    if (pWsm != NULL) {
+        idleMap_t map = { handle, (uint32_t)pWsm->virtAddr, lenBulkMem, secureVirtualAdr };
+        idleMapList_t evicted;
+        if (ts->parkIdleMap(&map, &evicted)) {
+            unmapIdleMaps(ts, &evicted);
+            return MC_DRV_OK;
+        }
+    }
+
+    mcResult_t mcRet = mcpUnmap(sessionId, secureVirtualAdr, lenBulkMem);
+    if (mcRet != MC_DRV_OK) {
+        return mcRet;
+    }
+
+    // Just remove the buffer
+    if (!ts->removeBulkBuff(handle))
+        LOG_I("unmapBulk(): no buffer found found with handle=%u", handle);
+
+    // TODO-2012-09-06-haenellu: Think about not ignoring the error case.
+    unlockWsmL2(handle);
 
     return MC_DRV_OK;
 }
 
 
+//------------------------------------------------------------------------------
+mcResult_t MobiCoreDevice::setMapCache(Connection *deviceConnection, uint32_t sessionId,
+                                       uint32_t operation, uint32_t param)
+{
+    TrustletSession *ts = getTrustletSession(sessionId);
+    if (ts == NULL || ts->deviceConnection != deviceConnection) {
+        LOG_E("no session found with id=%d", sessionId);
+        return MC_DRV_ERR_DAEMON_UNKNOWN_SESSION;
+    }
+
+    idleMapList_t maps;
+    switch (operation) {
+    case MC_DRV_MAP_CACHE_SET_SIZE:
+        if (param > MC_DRV_MAX_MAP_CACHE_SIZE) {
+            LOG_E("mapping cache of %u buffers too large", param);
+            return MC_DRV_ERR_INVALID_PARAMETER;
+        }
+        // Start over with an empty cache
+        ts->takeIdleMaps(0, &maps);
+        unmapIdleMaps(ts, &maps);
+        ts->maxIdleMaps = param;
+        return MC_DRV_OK;
+
+    case MC_DRV_MAP_CACHE_INVALIDATE:
+        ts->takeIdleMaps(param, &maps);
+        unmapIdleMaps(ts, &maps);
+        return MC_DRV_OK;
+
+    default:
+        LOG_E("unknown mapping cache operation %u", operation);
+        return MC_DRV_ERR_INVALID_PARAMETER;
+    }
+}
+
+
 //------------------------------------------------------------------------------
 void MobiCoreDevice::donateRam(const uint32_t donationSize)
 {
@@ -587,6 +826,7 @@ void MobiCoreDevice::donateRam(const uint32_t donationSize)
           numPages,
           ramType);
 
+    mcpMutex.lock();
     do {
         // Write MCP open message to buffer
         mcpMessage->cmdDonateRam.cmdHeader.cmdId = MC_MCP_CMD_DONATE_RAM;
@@ -595,7 +835,7 @@ void MobiCoreDevice::donateRam(const uint32_t donationSize)
         mcpMessage->cmdDonateRam.ramType = ramType;
 
         // Notify MC about a new command inside the MCP buffer
-        notify(SID_MCP);
+        notifyMcp();
 
         // Wait till response from MC is available
         if (!waitMcpNotification()) {
@@ -618,6 +858,7 @@ void MobiCoreDevice::donateRam(const uint32_t donationSize)
         LOG_I("donateRam() succeeded.");
 
     } while (0);
+    mcpMutex.unlock();
 }
 
 //------------------------------------------------------------------------------
@@ -625,9 +866,12 @@ mcResult_t MobiCoreDevice::getMobiCoreVersion(
     mcDrvRspGetMobiCoreVersionPayload_ptr pRspGetMobiCoreVersionPayload
 )
 {
+    // Also guards the lazy fetch
+    mcpMutex.lock();
     // If MobiCore version info already fetched.
     if (mcVersionInfo != NULL) {
         pRspGetMobiCoreVersionPayload->versionInfo = *mcVersionInfo;
+        mcpMutex.unlock();
         return MC_DRV_OK;
         // Otherwise, fetch it via MCP.
     } else {
@@ -635,16 +879,18 @@ mcResult_t MobiCoreDevice::getMobiCoreVersion(
         mcpMessage->cmdGetMobiCoreVersion.cmdHeader.cmdId = MC_MCP_CMD_GET_MOBICORE_VERSION;
 
         // Notify MC about the availability of a new command inside the MCP buffer
-        notify(SID_MCP);
+        notifyMcp();
 
         // Wait till response from MC is available
         if (!waitMcpNotification()) {
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_MCI_ERROR;
         }
 
         // Check if the command response ID is correct
         if ((MC_MCP_CMD_GET_MOBICORE_VERSION | FLAG_RESPONSE) != mcpMessage->rspHeader.rspId) {
             LOG_E("MC_MCP_CMD_GET_MOBICORE_VERSION got invalid MCP response");
+            mcpMutex.unlock();
             return MC_DRV_ERR_DAEMON_MCI_ERROR;
         }
 
@@ -652,6 +898,7 @@ mcResult_t MobiCoreDevice::getMobiCoreVersion(
 
         if (mcRet != MC_MCP_RET_OK) {
             LOG_E("MC_MCP_CMD_GET_MOBICORE_VERSION error %d", mcRet);
+            mcpMutex.unlock();
             return MAKE_MC_DRV_MCP_ERROR(mcRet);
         }
 
@@ -660,10 +907,37 @@ mcResult_t MobiCoreDevice::getMobiCoreVersion(
         // Store MobiCore info for future reference.
         mcVersionInfo = new mcVersionInfo_t();
         *mcVersionInfo = pRspGetMobiCoreVersionPayload->versionInfo;
+        mcpMutex.unlock();
         return MC_DRV_OK;
     }
 }
 
+//------------------------------------------------------------------------------
+void MobiCoreDevice::getStats(mcDaemonStats_t *stats)
+{
+    stats->mcpRoundTrip = mcpRoundTrip;
+    stats->ssiqCount = ssiqCount;
+    stats->notificationsIn = notificationsIn;
+    stats->notificationsOut = notificationsOut;
+    stats->nqOverflows = (nq != NULL) ? nq->getOverflows() : 0;
+
+    sessionMutex.lock();
+    stats->sessions = trustletSessions.size();
+    stats->queuedNotifications = 0;
+    stats->maxQueuedNotifications = 0;
+    for (trustletSessionIterator_t session = trustletSessions.begin();
+            session != trustletSessions.end();
+            ++session) {
+        uint32_t queued = (*session)->getQueuedNotifications();
+        stats->queuedNotifications += queued;
+        if (queued > stats->maxQueuedNotifications) {
+            stats->maxQueuedNotifications = queued;
+        }
+    }
+    stats->unknownNotifications = notifications.size();
+    sessionMutex.unlock();
+}
+
 //------------------------------------------------------------------------------
 void MobiCoreDevice::queueUnknownNotification(
     notification_t notification
@@ -31,6 +31,7 @@
  */
 #include "NotificationQueue.h"
 #include <stddef.h>
+#include <sched.h>
 
 #include "log.h"
 
@@ -39,41 +40,97 @@ NotificationQueue::NotificationQueue(
     notificationQueue_t *i,
     notificationQueue_t *o,
     uint32_t size
-) : in(i), out(o)
+) : in(i), out(o), overflows(0)
 {
     in->hdr.queueSize = size;
     out->hdr.queueSize = size;
+    reserveCnt = out->hdr.writeCnt;
 }
 
 
 //------------------------------------------------------------------------------
-void NotificationQueue::putNotification(
+bool NotificationQueue::putNotification(
     notification_t *notification
 )
 {
-    mutex.lock();
-    if ((out->hdr.writeCnt - out->hdr.readCnt) < out->hdr.queueSize) {
-        out->notification[out->hdr.writeCnt & (out->hdr.queueSize - 1)]
-        = *notification;
-        out->hdr.writeCnt++;
+    return putNotifications(notification, 1) == 1;
+}
+
+
+//------------------------------------------------------------------------------
+uint32_t NotificationQueue::putNotifications(
+    const notification_t *notifications,
+    uint32_t count
+)
+{
+    uint32_t size = out->hdr.queueSize;
+    uint32_t first = __atomic_load_n(&reserveCnt, __ATOMIC_RELAXED);
+    uint32_t num;
+
+    // Reserve the slots MobiCore has read already
+    do {
+        uint32_t readCnt = __atomic_load_n(&out->hdr.readCnt, __ATOMIC_ACQUIRE);
+        uint32_t space = size - (first - readCnt);
+        num = (count < space) ? count : space;
+        if (num == 0) {
+            break;
+        }
+    } while (!__atomic_compare_exchange_n(&reserveCnt, &first, first + num, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    for (uint32_t i = 0; i < num; i++) {
+        out->notification[(first + i) & (size - 1)] = notifications[i];
+    }
+
+    if (num > 0) {
+        // Producers which reserved earlier publish first
+        while (__atomic_load_n(&out->hdr.writeCnt, __ATOMIC_ACQUIRE) != first) {
+            sched_yield();
+        }
+        __atomic_store_n(&out->hdr.writeCnt, first + num, __ATOMIC_RELEASE);
     }
-    mutex.unlock();
+
+    if (num < count) {
+        __atomic_fetch_add(&overflows, count - num, __ATOMIC_RELAXED);
+        LOG_W("Notification queue full, %u notifications dropped", count - num);
+    }
+
+    return num;
 }
 
 
 //------------------------------------------------------------------------------
-notification_t *NotificationQueue::getNotification(
-    void
+uint32_t NotificationQueue::getNotifications(
+    notification_t *notifications,
+    uint32_t maxCount
 )
 {
-    notification_t *ret = NULL;
-    mutex.lock();
-    if ((in->hdr.writeCnt - in->hdr.readCnt) > 0) {
-        ret = &(in->notification[in->hdr.readCnt & (in->hdr.queueSize - 1)]);
-        in->hdr.readCnt++;
+    uint32_t size = in->hdr.queueSize;
+    // Only this thread moves readCnt
+    uint32_t readCnt = in->hdr.readCnt;
+    uint32_t num = __atomic_load_n(&in->hdr.writeCnt, __ATOMIC_ACQUIRE) - readCnt;
+
+    if (num > maxCount) {
+        num = maxCount;
+    }
+    for (uint32_t i = 0; i < num; i++) {
+        notifications[i] = in->notification[(readCnt + i) & (size - 1)];
     }
-    mutex.unlock();
-    return ret;
+    if (num > 0) {
+        // The slots are copied, MobiCore may reuse them
+        __atomic_store_n(&in->hdr.readCnt, readCnt + num, __ATOMIC_RELEASE);
+    }
+
+    return num;
+}
+
+
+//------------------------------------------------------------------------------
+uint32_t NotificationQueue::getOverflows(
+    void
+)
+{
+    return __atomic_load_n(&overflows, __ATOMIC_RELAXED);
 }
 
 /** @} */
@@ -35,9 +35,21 @@
 
 #include <inttypes.h> //C99 data
 #include "Mci/mcinq.h"
-#include "CMutex.h"
 
+/** Notifications fetched from the queue by one getNotifications() call at most. */
+#define NQ_MAX_BATCH    (16)
 
+
+/**
+ * Both queues live in the MCI buffer and are shared with MobiCore, which
+ * consumes the outgoing and produces the incoming queue. No lock is taken:
+ * the counters are read with acquire and written with release ordering, so
+ * an element is complete before the counter making it visible moves.
+ *
+ * Any daemon thread may put notifications. Producers reserve slots with a
+ * private counter and publish writeCnt in reservation order. Only the IRQ
+ * handler thread gets notifications.
+ */
 class NotificationQueue
 {
 
@@ -60,17 +72,39 @@ public:
     /** Places an element to the outgoing queue.
      *
      * @param notification Data to be placed in queue.
+     * @return false if the queue was full, the notification is dropped and
+     *         counted as overflow.
      */
-    void putNotification(
+    bool putNotification(
         notification_t *notification
     );
 
-    /** Retrieves the first element from the queue.
+    /** Places elements to the outgoing queue, in order.
      *
-     * @return first notification Queue element.
-     * @return NULL if the queue is empty.
+     * @param notifications Data to be placed in queue.
+     * @param count Number of notifications.
+     * @return Number of notifications placed. The others did not fit, they
+     *         are dropped and counted as overflows.
      */
-    notification_t *getNotification(
+    uint32_t putNotifications(
+        const notification_t *notifications,
+        uint32_t count
+    );
+
+    /** Retrieves the first elements from the incoming queue.
+     * The elements are copied, their slots are free for MobiCore on return.
+     *
+     * @param notifications Array receiving the elements.
+     * @param maxCount Size of notifications.
+     * @return Number of notifications retrieved, 0 if the queue is empty.
+     */
+    uint32_t getNotifications(
+        notification_t *notifications,
+        uint32_t maxCount
+    );
+
+    /** Number of notifications dropped because the outgoing queue was full. */
+    uint32_t getOverflows(
         void
     );
 
@@ -78,7 +112,8 @@ private:
 
     notificationQueue_t *in;
     notificationQueue_t *out;
-    CMutex mutex;
+    uint32_t reserveCnt; /**< Slots of out taken by producers, writeCnt trails it */
+    uint32_t overflows; /**< Notifications dropped by put */
 
 };
 
@@ -264,7 +264,9 @@ void TrustZoneDevice::notify(
         .payload = 0
     };
 
-    nq->putNotification(&notification);
+    if (nq->putNotification(&notification)) {
+        __sync_fetch_and_add(&notificationsOut, 1);
+    }
     //IMPROVEMENT-2012-03-07-maneaval What happens when/if nsiq fails?
     //In the old days an exception would be thrown but it was uncertain
     //where it was handled, some server(sock or Netlink). In that case
@@ -587,43 +589,62 @@ void TrustZoneDevice::handleIrq(
             break;
         }
         LOG_V("S-SIQ received");
-
-        // Save all the
-        for (;;) {
-            notification_t *notification = nq->getNotification();
-            if (NULL == notification) {
-                break;
-            }
-
-            // check if the notification belongs to the MCP session
-            if (notification->sessionId == SID_MCP) {
-                LOG_I(" Found MCP notification, payload=%d",
-                      notification->payload);
-
-                // Signal main thread of the driver to continue after MCP
-                // command has been processed by the MC
-                signalMcpNotification();
-            } else {
-                LOG_I(" Found notification for session %d, payload=%d",
-                      notification->sessionId, notification->payload);
-
-                // Get the NQ connection for the session ID
-                Connection *connection = getSessionConnection(notification->sessionId, notification);
-                if (connection == NULL) {
-                    /* Couldn't find the session for this notifications
-                     * In practice this only means one thing: there is
-                     * a race condition between RTM and the Daemon and
-                     * RTM won. But we shouldn't drop the notification
-                     * right away we should just queue it in the device
-                     */
-                    LOG_W("Notification for unknown session ID");
-                    queueUnknownNotification(*notification);
+        ssiqCount++;
+
+        // Drain the queue, a batch at a time
+        notification_t notifications[NQ_MAX_BATCH];
+        uint32_t num;
+        while ((num = nq->getNotifications(notifications, NQ_MAX_BATCH)) > 0) {
+            notificationsIn += num;
+            for (uint32_t i = 0; i < num; i++) {
+                notification_t *notification = &notifications[i];
+
+                // check if the notification belongs to the MCP session
+                if (notification->sessionId == SID_MCP) {
+                    LOG_I(" Found MCP notification, payload=%d",
+                          notification->payload);
+
+                    // Signal main thread of the driver to continue after MCP
+                    // command has been processed by the MC
+                    signalMcpNotification();
                 } else {
-                    LOG_I(" Forward notification to McClient.");
-                    // Forward session ID and additional payload of
-                    // notification to the TLC/Application layer
-                    connection->writeData((void *)notification,
-                                          sizeof(notification_t));
+                    LOG_I(" Found notification for session %d, payload=%d",
+                          notification->sessionId, notification->payload);
+
+                    // Get the NQ connection for the session ID. The socket
+                    // is duplicated, so the write to a slow client can be
+                    // done without holding sessionMutex while the session
+                    // may be closed.
+                    int socketDescriptor = -1;
+                    sessionMutex.lock();
+                    Connection *connection = getSessionConnection(notification->sessionId, notification);
+                    if (connection == NULL) {
+                        /* Couldn't find the session for this notifications
+                         * In practice this only means one thing: there is
+                         * a race condition between RTM and the Daemon and
+                         * RTM won. But we shouldn't drop the notification
+                         * right away we should just queue it in the device
+                         */
+                        LOG_W("Notification for unknown session ID");
+                        queueUnknownNotification(*notification);
+                    } else {
+                        socketDescriptor = dup(connection->socketDescriptor);
+                        if (socketDescriptor < 0) {
+                            LOG_ERRNO("dup");
+                        }
+                    }
+                    sessionMutex.unlock();
+
+                    if (socketDescriptor >= 0) {
+                        LOG_I(" Forward notification to McClient.");
+                        // Forward session ID and additional payload of
+                        // notification to the TLC/Application layer
+                        if (send(socketDescriptor, notification, sizeof(notification_t), 0) !=
+                                (ssize_t)sizeof(notification_t)) {
+                            LOG_ERRNO("could not forward notification, because send");
+                        }
+                        ::close(socketDescriptor);
+                    }
                 }
             }
         }
@@ -635,6 +656,6 @@ void TrustZoneDevice::handleIrq(
     // Tell main thread that "something happened"
     // MSH thread MUST not block!
     DeviceIrqHandler::setExiting();
-    signalMcpNotification();
+    mcpSessionNotification.signal();
 }
 /** @} */
@@ -42,6 +42,7 @@ TrustletSession::TrustletSession(Connection *deviceConnection, uint32_t sessionI
     this->deviceConnection = deviceConnection;
     this->notificationConnection = NULL;
     this->sessionId = sessionId;
+    this->maxIdleMaps = 0;
     sessionMagic = rand();
 }
 
@@ -83,6 +84,12 @@ void TrustletSession::processQueuedNotifications(void)
     }
 }
 
+//------------------------------------------------------------------------------
+uint32_t TrustletSession::getQueuedNotifications(void)
+{
+    return notifications.size();
+}
+
 //------------------------------------------------------------------------------
 bool TrustletSession::addBulkBuff(CWsm_ptr pWsm)
 {
@@ -121,4 +128,57 @@ CWsm_ptr TrustletSession::popBulkBuff()
     return pWsm;
 }
 
+//------------------------------------------------------------------------------
+CWsm_ptr TrustletSession::findBulkBuff(uint32_t handle)
+{
+    map<uint32_t, CWsm_ptr>::iterator it = buffers.find(handle);
+    if (it == buffers.end()) {
+        return NULL;
+    }
+    return it->second;
+}
+
+//------------------------------------------------------------------------------
+bool TrustletSession::reuseIdleMap(uint32_t handle, uint32_t offsetPayload, uint32_t lenBulkMem,
+                                   uint32_t *secureVirtualAdr)
+{
+    for (idleMapList_t::iterator it = idleMaps.begin(); it != idleMaps.end(); ++it) {
+        if (it->handle == handle && it->offsetPayload == offsetPayload
+                && it->lenBulkMem == lenBulkMem) {
+            *secureVirtualAdr = it->secureVirtualAdr;
+            idleMaps.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+bool TrustletSession::parkIdleMap(const idleMap_t *map, idleMapList_t *evicted)
+{
+    if (maxIdleMaps == 0) {
+        return false;
+    }
+    idleMaps.push_front(*map);
+    while (idleMaps.size() > maxIdleMaps) {
+        evicted->push_back(idleMaps.back());
+        idleMaps.pop_back();
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void TrustletSession::takeIdleMaps(uint32_t handle, idleMapList_t *maps)
+{
+    idleMapList_t::iterator it = idleMaps.begin();
+    while (it != idleMaps.end()) {
+        if (handle == 0 || it->handle == handle) {
+            maps->push_back(*it);
+            it = idleMaps.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 /** @} */
@@ -36,19 +36,31 @@
 #include "Connection.h"
 #include <queue>
 #include <map>
+#include <list>
 
+/** A bulk buffer mapping kept in the secure world after the client unmapped it. */
+typedef struct {
+    uint32_t handle;            /**< Handle of the L2 table, stays locked. */
+    uint32_t offsetPayload;     /**< Offset of the buffer in its first page. */
+    uint32_t lenBulkMem;        /**< Length of the buffer. */
+    uint32_t secureVirtualAdr;  /**< Address of the buffer in the Trustlet. */
+} idleMap_t;
+
+typedef std::list<idleMap_t> idleMapList_t;
 
 class TrustletSession
 {
 private:
     std::queue<notification_t> notifications;
     std::map<uint32_t, CWsm_ptr> buffers;
+    idleMapList_t idleMaps; /**< Mapping cache, most recently unmapped first. */
 
 public:
     uint32_t sessionId;
     uint32_t sessionMagic; // Random data
     Connection *deviceConnection;
     Connection *notificationConnection;
+    uint32_t maxIdleMaps; /**< Size of the mapping cache, 0 if it is disabled. */
 
     TrustletSession(Connection *deviceConnection, uint32_t sessionId);
 
@@ -58,12 +70,47 @@ public:
 
     void processQueuedNotifications(void);
 
+    /**
+     * Number of notifications waiting for the notification connection.
+     */
+    uint32_t getQueuedNotifications(void);
+
     bool addBulkBuff(CWsm_ptr pWsm);
 
     bool removeBulkBuff(uint32_t handle);
 
     CWsm_ptr popBulkBuff();
 
+    CWsm_ptr findBulkBuff(uint32_t handle);
+
+    /**
+     * Take a mapping out of the cache to use it again.
+     *
+     * @param handle Handle of the L2 table.
+     * @param offsetPayload Offset of the buffer in its first page.
+     * @param lenBulkMem Length of the buffer.
+     * @param secureVirtualAdr Set to the address of the buffer in the Trustlet.
+     * @return true if the buffer is still mapped.
+     */
+    bool reuseIdleMap(uint32_t handle, uint32_t offsetPayload, uint32_t lenBulkMem,
+                      uint32_t *secureVirtualAdr);
+
+    /**
+     * Keep an unmapped buffer in the cache. The least recently unmapped
+     * buffers beyond maxIdleMaps go to evicted and must really be unmapped.
+     *
+     * @return false if the cache is disabled.
+     */
+    bool parkIdleMap(const idleMap_t *map, idleMapList_t *evicted);
+
+    /**
+     * Take mappings out of the cache to really unmap them.
+     *
+     * @param handle Handle of the L2 table, 0 for all mappings.
+     * @param maps Receives the mappings.
+     */
+    void takeIdleMaps(uint32_t handle, idleMapList_t *maps);
+
 };
 
 typedef std::list<TrustletSession *> trustletSessionList_t;
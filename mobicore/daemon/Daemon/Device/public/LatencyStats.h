@@ -0,0 +1,91 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_DEV
+ * @{
+ * @file
+ *
+ * Latency statistics of the daemon.
+ *
+ * Latencies are counted by several threads at once without a lock: each
+ * field is updated atomically, so a reader may see a latency in the count
+ * but not yet in its bucket.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef LATENCYSTATS_H_
+#define LATENCYSTATS_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "MobiCoreDriverApi.h"
+
+
+/**
+ * Current time of the monotonic clock in us.
+ */
+static inline uint64_t statsTimeUs(
+    void
+)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/**
+ * Count the latency from start until now.
+ *
+ * @param stats Histogram to count the latency in.
+ * @param startUs statsTimeUs() at the start.
+ */
+static inline void statsAddLatency(
+    mcLatencyStats_t *stats,
+    uint64_t startUs
+)
+{
+    uint64_t us = statsTimeUs() - startUs;
+    uint32_t bucket = 0;
+    uint32_t maxUs;
+
+    while (bucket < MC_STATS_NUM_BUCKETS - 1 && (us >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+    __sync_fetch_and_add(&stats->buckets[bucket], 1);
+    __sync_fetch_and_add(&stats->count, 1);
+    __sync_fetch_and_add(&stats->totalUs, us);
+    do {
+        maxUs = stats->maxUs;
+        if (us <= maxUs) {
+            break;
+        }
+    } while (!__sync_bool_compare_and_swap(&stats->maxUs, maxUs, (uint32_t)us));
+}
+
+#endif /* LATENCYSTATS_H_ */
+
+/** @} */
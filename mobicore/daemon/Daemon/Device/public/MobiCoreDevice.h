@@ -48,12 +48,14 @@
 
 #include "Connection.h"
 #include "CWsm.h"
+#include "CMutex.h"
 
 #include "ExcDevice.h"
 #include "DeviceScheduler.h"
 #include "DeviceIrqHandler.h"
 #include "NotificationQueue.h"
 #include "TrustletSession.h"
+#include "LatencyStats.h"
 #include "mcVersionInfo.h"
 
 
@@ -66,6 +68,14 @@ typedef struct {
     mclfHeader_ptr tlHeader; /**< Pointer to trustlet header. */
 } loadDataOpenSession_t, *loadDataOpenSession_ptr;
 
+typedef struct {
+    uint32_t handle;            /**< Handle of the locked WSM. */
+    uint32_t pAddrL2;           /**< Physical address of its L2 table. */
+    uint32_t offsetPayload;     /**< Offset of the buffer in its first page. */
+    uint32_t lenBulkMem;        /**< Length of the buffer. */
+    uint32_t secureVirtualAdr;  /**< Address of the buffer in the Trustlet, set by mapBulks(). */
+} bulkMap_t, *bulkMap_ptr;
+
 /**
  * Factory method to return the platform specific MobiCore device.
  * Implemented in the platform specific *Device.cpp
@@ -83,10 +93,18 @@ protected:
     CSemaphore          mcpSessionNotification; /**< Semaphore to synchronize incoming notifications for the MCP session */
 
     trustletSessionList_t trustletSessions; /**< Available Trustlet Sessions */
+    CMutex              sessionMutex; /**< Guards trustletSessions, queued notifications and notification connections */
+    CMutex              mcpMutex; /**< Serializes the commands in the MCP buffer, guards mcVersionInfo */
     mcVersionInfo_t     *mcVersionInfo; /**< MobiCore version info. */
     bool                mcFault; /**< Signal RTM fault */
     bool                mciReused; /**< Signal restart of Daemon. */
 
+    uint64_t            mcpSubmitTime; /**< statsTimeUs() when MobiCore was notified of the command in the MCP buffer */
+    mcLatencyStats_t    mcpRoundTrip; /**< MCP round trip times */
+    uint32_t            ssiqCount; /**< S-SIQs received, written by the IRQ handler only */
+    uint32_t            notificationsIn; /**< Notifications received, written by the IRQ handler only */
+    uint32_t            notificationsOut; /**< Notifications sent, counted atomically */
+
     /* In a special case a Trustlet can create a race condition in the daemon.
      * If at Trustlet start it detects an error of some sort and calls the
      * exit function before waiting for any notifications from NWD then the daemon
@@ -103,6 +121,44 @@ protected:
 
     MobiCoreDevice();
 
+    /**
+     * Look up a session. The caller holds sessionMutex.
+     */
+    TrustletSession *findTrustletSession(uint32_t sessionId);
+
+    /**
+     * Map a buffer with an MCP MAP command.
+     */
+    mcResult_t mcpMap(uint32_t sessionId, uint32_t pAddrL2, uint32_t offsetPayload,
+                      uint32_t lenBulkMem, uint32_t *secureVirtualAdr);
+
+    /**
+     * Unmap a buffer with an MCP UNMAP command.
+     */
+    mcResult_t mcpUnmap(uint32_t sessionId, uint32_t secureVirtualAdr, uint32_t lenBulkMem);
+
+    /**
+     * Really unmap mappings taken out of the cache of a session and unlock
+     * their L2 tables.
+     *
+     * @param maps Mappings to unmap, emptied.
+     * @return Number of buffers unmapped.
+     */
+    uint32_t unmapIdleMaps(TrustletSession *ts, idleMapList_t *maps);
+
+    /**
+     * Finish an open session command: add the new session to the list and
+     * hand it the notifications that arrived before.
+     *
+     * @param trustletSession The new session, NULL if opening failed.
+     */
+    void endOpenSession(TrustletSession *trustletSession);
+
+    /**
+     * Notify MobiCore about the command in the MCP buffer. The caller holds mcpMutex.
+     */
+    void notifyMcp(void);
+
     void signalMcpNotification(void);
 
     bool waitMcpNotification(void);
@@ -117,11 +173,20 @@ private:
 public:
     virtual ~MobiCoreDevice();
 
+    /**
+     * Look up a session. A session is only closed by its device connection,
+     * so the result stays valid while that connection is being served.
+     */
     TrustletSession *getTrustletSession(uint32_t sessionId);
 
     void cleanSessionBuffers(TrustletSession *session);
     void removeTrustletSession(uint32_t sessionId);
 
+    /**
+     * Get the notification connection of a session, queue the notification
+     * if there is none yet. The caller holds sessionMutex while it uses the
+     * connection.
+     */
     Connection *getSessionConnection(uint32_t sessionId, notification_t *notification);
 
     bool open(Connection *connection);
@@ -135,6 +200,10 @@ public:
                            uint32_t                        tciOffset,
                            mcDrvRspOpenSessionPayload_ptr  pRspOpenSessionPayload);
 
+    /**
+     * Attach a notification connection to its session. On success MC_DRV_OK
+     * is written to the connection, followed by the notifications queued so far.
+     */
     TrustletSession *registerTrustletConnection(Connection *connection,
             MC_DRV_CMD_NQ_CONNECT_struct  *cmdNqConnect);
 
@@ -147,22 +216,66 @@ public:
     virtual mcResult_t notify(Connection *deviceConnection, uint32_t  sessionId);
     virtual void notify(uint32_t  sessionId) = 0;
 
+    /**
+     * Reuse a mapping of the session's mapping cache. Its L2 table is
+     * still locked, so the caller must not lock it again.
+     *
+     * @return true if the buffer is still mapped, secureVirtualAdr is set.
+     */
+    bool mapCachedBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle,
+                       uint32_t offsetPayload, uint32_t lenBulkMem, uint32_t *secureVirtualAdr);
+
     mcResult_t mapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle, uint32_t pAddrL2,
                         uint32_t offsetPayload, uint32_t lenBulkMem, uint32_t *secureVirtualAdr);
 
+    /**
+     * Map several bulk buffers to a session, one MCP MAP command each.
+     * The buffers are added to the session even if mapping some of them
+     * fails, closing the session releases them.
+     *
+     * @param maps Buffers to map, their secureVirtualAdr is set on success.
+     * @param numMaps Number of buffers.
+     * @return MC_DRV_OK if all buffers are mapped, otherwise the first error.
+     */
+    mcResult_t mapBulks(Connection *deviceConnection, uint32_t sessionId,
+                        bulkMap_ptr maps, uint32_t numMaps);
+
+    /**
+     * Unmap a bulk buffer and unlock its L2 table. If the session has a
+     * mapping cache the buffer stays mapped instead, to be reused by the
+     * next mapBulk() of the same L2 table, offset and length.
+     */
     mcResult_t unmapBulk(Connection *deviceConnection, uint32_t sessionId, uint32_t handle,
                         uint32_t secureVirtualAdr, uint32_t lenBulkMem);
 
+    /**
+     * Resize or invalidate the mapping cache of a session.
+     *
+     * @param operation MC_DRV_MAP_CACHE_SET_SIZE or MC_DRV_MAP_CACHE_INVALIDATE.
+     * @param param Cache size or L2 table handle, see mcDrvMapCacheOp_t.
+     */
+    mcResult_t setMapCache(Connection *deviceConnection, uint32_t sessionId,
+                           uint32_t operation, uint32_t param);
+
     void start();
 
     void donateRam(const uint32_t donationSize);
 
     mcResult_t getMobiCoreVersion(mcDrvRspGetMobiCoreVersionPayload_ptr pRspGetMobiCoreVersionPayload);
 
+    /**
+     * Fill in the device counters, the MCP round trip times and the
+     * notification queue depths of the daemon statistics.
+     */
+    void getStats(mcDaemonStats_t *stats);
+
     bool getMcFault() {
         return mcFault;
     }
 
+    /**
+     * Keep a notification of a session being opened. The caller holds sessionMutex.
+     */
     void queueUnknownNotification(notification_t notification);
 
     virtual void dumpMobicoreStatus(void) = 0;
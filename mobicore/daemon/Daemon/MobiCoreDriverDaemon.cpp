@@ -80,6 +80,9 @@ MobiCoreDriverDaemon::MobiCoreDriverDaemon(
     for (int i = 0; i < MAX_SERVERS; i++) {
         servers[i] = NULL;
     }
+
+    memset(commandStats, 0, sizeof(commandStats));
+    memset(&registryStats, 0, sizeof(registryStats));
 }
 
 //------------------------------------------------------------------------------
@@ -155,7 +158,7 @@ void MobiCoreDriverDaemon::run(
     LOG_I("Creating socket servers");
     // Start listening for incoming TLC connections
     servers[0] = new NetlinkServer(this);
-    servers[1] = new Server(this, SOCK_PATH);
+    servers[1] = new Server(this, SOCK_PATH, SOCKET_SERVER_WORKERS);
     LOG_I("Successfully created servers");
 
     // Start all the servers
@@ -293,8 +296,8 @@ bool MobiCoreDriverDaemon::loadDeviceDriver(
         mobiCoreDevice->unregisterWsmL2(pWsm);
         pWsm = NULL;
 
-        // Free memory occupied by Trustlet data
-        free(regObj);
+        // Release the Trustlet data
+        mcRegistryPutServiceBlob(regObj);
         regObj = NULL;
 
         if (mcRet != MC_MCP_RET_OK) {
@@ -314,7 +317,7 @@ bool MobiCoreDriverDaemon::loadDeviceDriver(
             }
         }
         // No matter if we free NULL objects
-        free(regObj);
+        mcRegistryPutServiceBlob(regObj);
 
         if (conn != NULL) {
             delete conn;
@@ -419,33 +422,33 @@ void MobiCoreDriverDaemon::processCloseDevice(
 
 
 //------------------------------------------------------------------------------
-void MobiCoreDriverDaemon::processOpenSession(Connection *connection)
+mcResult_t MobiCoreDriverDaemon::openServiceSession(
+    Connection                      *connection,
+    MobiCoreDevice                  *device,
+    const mcUuid_t                  *uuid,
+    uint32_t                        tciHandle,
+    uint32_t                        tciLen,
+    uint32_t                        tciOffset,
+    mcDrvRspOpenSessionPayload_ptr  pRspOpenSessionPayload)
 {
-    MC_DRV_CMD_OPEN_SESSION_struct cmdOpenSession;
-    RECV_PAYLOAD_FROM_CLIENT(connection, &cmdOpenSession);
-
-    // Device required
-    MobiCoreDevice  *device = (MobiCoreDevice *) (connection->connectionData);
-    CHECK_DEVICE(device, connection);
-
-    // Get service blob from registry
-    regObject_t *regObj = mcRegistryGetServiceBlob(&cmdOpenSession.uuid);
+    // Get service blob from registry, which registry commands may be writing
+    registryMutex.lock();
+    regObject_t *regObj = mcRegistryGetServiceBlob(uuid);
+    registryMutex.unlock();
     if (NULL == regObj) {
-        writeResult(connection, MC_DRV_ERR_TRUSTLET_NOT_FOUND);
-        return;
+        return MC_DRV_ERR_TRUSTLET_NOT_FOUND;
     }
     if (regObj->len == 0) {
-        free(regObj);
-        writeResult(connection, MC_DRV_ERR_TRUSTLET_NOT_FOUND);
-        return;
+        mcRegistryPutServiceBlob(regObj);
+        return MC_DRV_ERR_TRUSTLET_NOT_FOUND;
     }
     LOG_I(" Sharing Service loaded at %p with Secure World", (addr_t)(regObj->value));
 
     CWsm_ptr pWsm = device->registerWsmL2((addr_t)(regObj->value), regObj->len, 0);
     if (pWsm == NULL) {
         LOG_E("allocating WSM for Trustlet failed");
-        writeResult(connection, MC_DRV_ERR_DAEMON_KMOD_ERROR);
-        return;
+        mcRegistryPutServiceBlob(regObj);
+        return MC_DRV_ERR_DAEMON_KMOD_ERROR;
     }
     // Initialize information data of open session command
     loadDataOpenSession_t loadDataOpenSession;
@@ -454,14 +457,13 @@ void MobiCoreDriverDaemon::processOpenSession(Connection *connection)
     loadDataOpenSession.len = regObj->len;
     loadDataOpenSession.tlHeader = (mclfHeader_ptr) (regObj->value + regObj->tlStartOffset);
 
-    mcDrvRspOpenSession_t rspOpenSession;
     mcResult_t ret = device->openSession(
                          connection,
                          &loadDataOpenSession,
-                         cmdOpenSession.handle,
-                         cmdOpenSession.len,
-                         cmdOpenSession.tci,
-                         &rspOpenSession.payload);
+                         tciHandle,
+                         tciLen,
+                         tciOffset,
+                         pRspOpenSessionPayload);
 
     // Unregister physical memory from kernel module.
     LOG_I(" Service buffer was copied to Secure world and processed. Stop sharing of buffer.");
@@ -469,15 +471,41 @@ void MobiCoreDriverDaemon::processOpenSession(Connection *connection)
     // This will also destroy the WSM object.
     if (!device->unregisterWsmL2(pWsm)) {
         // TODO-2012-07-02-haenellu: Can this ever happen? And if so, we should assert(), also TL might still be running.
-        writeResult(connection, MC_DRV_ERR_DAEMON_KMOD_ERROR);
-        return;
+        mcRegistryPutServiceBlob(regObj);
+        return MC_DRV_ERR_DAEMON_KMOD_ERROR;
     }
 
-    // Free memory occupied by Trustlet data
-    free(regObj);
+    // Release the Trustlet data
+    mcRegistryPutServiceBlob(regObj);
 
     if (ret != MC_DRV_OK) {
         LOG_E("Service could not be loaded.");
+    }
+    return ret;
+}
+
+
+//------------------------------------------------------------------------------
+void MobiCoreDriverDaemon::processOpenSession(Connection *connection)
+{
+    MC_DRV_CMD_OPEN_SESSION_struct cmdOpenSession;
+    RECV_PAYLOAD_FROM_CLIENT(connection, &cmdOpenSession);
+
+    // Device required
+    MobiCoreDevice  *device = (MobiCoreDevice *) (connection->connectionData);
+    CHECK_DEVICE(device, connection);
+
+    mcDrvRspOpenSession_t rspOpenSession;
+    mcResult_t ret = openServiceSession(
+                         connection,
+                         device,
+                         &cmdOpenSession.uuid,
+                         cmdOpenSession.handle,
+                         cmdOpenSession.len,
+                         cmdOpenSession.tci,
+                         &rspOpenSession.payload);
+
+    if (ret != MC_DRV_OK) {
         writeResult(connection, ret);
     } else {
         rspOpenSession.header.responseId = ret;
@@ -487,6 +515,84 @@ void MobiCoreDriverDaemon::processOpenSession(Connection *connection)
     }
 }
 
+
+//------------------------------------------------------------------------------
+void MobiCoreDriverDaemon::processOpenSessionEx(Connection *connection)
+{
+    MC_DRV_CMD_OPEN_SESSION_EX_struct cmd;
+    RECV_PAYLOAD_FROM_CLIENT(connection, &cmd);
+
+    // Device required
+    MobiCoreDevice  *device = (MobiCoreDevice *) (connection->connectionData);
+    CHECK_DEVICE(device, connection);
+
+    if (cmd.numMaps > MC_DRV_MAX_SESSION_MAPS) {
+        LOG_E("too many bulk buffers: %u", cmd.numMaps);
+        writeResult(connection, MC_DRV_ERR_INVALID_PARAMETER);
+        return;
+    }
+
+    // Resolve the bulk buffers first, a bad handle then costs no MCP command
+    bulkMap_t maps[MC_DRV_MAX_SESSION_MAPS];
+    uint32_t numLocked = 0;
+    mcResult_t ret = MC_DRV_OK;
+    for (; numLocked < cmd.numMaps; numLocked++) {
+        mcDrvSessionMap_t *map = &cmd.maps[numLocked];
+        if (!device->lockWsmL2(map->handle)) {
+            LOG_E("Couldn't lock the buffer!");
+            ret = MC_DRV_ERR_DAEMON_WSM_HANDLE_NOT_FOUND;
+            break;
+        }
+        maps[numLocked].pAddrL2 = (uint32_t)device->findWsmL2(map->handle, connection->socketDescriptor);
+        if (maps[numLocked].pAddrL2 == 0) {
+            LOG_E("Failed to resolve WSM with handle %u", map->handle);
+            device->unlockWsmL2(map->handle);
+            ret = MC_DRV_ERR_DAEMON_WSM_HANDLE_NOT_FOUND;
+            break;
+        }
+        maps[numLocked].handle = map->handle;
+        maps[numLocked].offsetPayload = map->offsetPayload;
+        maps[numLocked].lenBulkMem = map->lenBulkMem;
+        maps[numLocked].secureVirtualAdr = 0;
+    }
+
+    mcDrvRspOpenSessionEx_t rsp;
+    memset(&rsp, 0, sizeof(rsp));
+    if (ret == MC_DRV_OK) {
+        ret = openServiceSession(
+                  connection,
+                  device,
+                  &cmd.uuid,
+                  cmd.handle,
+                  cmd.len,
+                  cmd.tci,
+                  &rsp.payload.session);
+    }
+    if (ret != MC_DRV_OK) {
+        while (numLocked > 0) {
+            device->unlockWsmL2(maps[--numLocked].handle);
+        }
+        writeResult(connection, ret);
+        return;
+    }
+
+    // From here on the session owns the buffers
+    ret = device->mapBulks(connection, rsp.payload.session.sessionId, maps, cmd.numMaps);
+    if (ret != MC_DRV_OK) {
+        // All or nothing, closing the session also unlocks the buffers
+        LOG_E("Mapping bulk buffers failed, closing session %u", rsp.payload.session.sessionId);
+        device->closeSession(connection, rsp.payload.session.sessionId);
+        writeResult(connection, ret);
+        return;
+    }
+
+    for (uint32_t i = 0; i < cmd.numMaps; i++) {
+        rsp.payload.secureVirtualAdr[i] = maps[i].secureVirtualAdr;
+    }
+    rsp.header.responseId = MC_DRV_OK;
+    connection->writeData(&rsp, sizeof(rsp));
+}
+
 //------------------------------------------------------------------------------
 void MobiCoreDriverDaemon::processOpenTrustlet(Connection *connection)
 {
@@ -513,8 +619,10 @@ void MobiCoreDriverDaemon::processOpenTrustlet(Connection *connection)
         return;
     }
 
-    // Get service blob from registry
+    // Get service blob from registry, which registry commands may be writing
+    registryMutex.lock();
     regObject_t *regObj = mcRegistryMemGetServiceBlob(cmdOpenTrustlet.spid, (uint8_t*)payload, len);
+    registryMutex.unlock();
 
     // Free the payload object no matter what
     free(payload);
@@ -524,7 +632,7 @@ void MobiCoreDriverDaemon::processOpenTrustlet(Connection *connection)
     }
 
     if (regObj->len == 0) {
-        free(regObj);
+        mcRegistryPutServiceBlob(regObj);
         writeResult(connection, MC_DRV_ERR_TRUSTLET_NOT_FOUND);
         return;
     }
@@ -533,6 +641,7 @@ void MobiCoreDriverDaemon::processOpenTrustlet(Connection *connection)
     CWsm_ptr pWsm = device->registerWsmL2((addr_t)(regObj->value), regObj->len, 0);
     if (pWsm == NULL) {
         LOG_E("allocating WSM for Trustlet failed");
+        mcRegistryPutServiceBlob(regObj);
         writeResult(connection, MC_DRV_ERR_DAEMON_KMOD_ERROR);
         return;
     }
@@ -558,12 +667,13 @@ void MobiCoreDriverDaemon::processOpenTrustlet(Connection *connection)
     // This will also destroy the WSM object.
     if (!device->unregisterWsmL2(pWsm)) {
         // TODO-2012-07-02-haenellu: Can this ever happen? And if so, we should assert(), also TL might still be running.
+        mcRegistryPutServiceBlob(regObj);
         writeResult(connection, MC_DRV_ERR_DAEMON_KMOD_ERROR);
         return;
     }
 
-    // Free memory occupied by Trustlet data
-    free(regObj);
+    // Release the Trustlet data
+    mcRegistryPutServiceBlob(regObj);
 
     if (ret != MC_DRV_OK) {
         LOG_E("Service could not be loaded.");
@@ -627,6 +737,8 @@ void MobiCoreDriverDaemon::processNqConnect(Connection *connection)
         return;
     }
 
+    // On success the device answers, the result has to precede the
+    // notifications queued for the session
     TrustletSession *ts = device->registerTrustletConnection(
                               connection,
                               &cmd);
@@ -635,9 +747,6 @@ void MobiCoreDriverDaemon::processNqConnect(Connection *connection)
         writeResult(connection, MC_DRV_ERR_UNKNOWN);
         return;
     }
-
-    writeResult(connection, MC_DRV_OK);
-    ts->processQueuedNotifications();
 }
 
 
@@ -689,13 +798,25 @@ void MobiCoreDriverDaemon::processMapBulkBuf(Connection *connection)
     MobiCoreDevice *device = (MobiCoreDevice *) (connection->connectionData);
     CHECK_DEVICE(device, connection);
 
+    uint32_t secureVirtualAdr = 0;
+
+    // A buffer kept in the mapping cache costs no world switch
+    if (device->mapCachedBulk(connection, cmd.sessionId, cmd.handle,
+                              cmd.offsetPayload, cmd.lenBulkMem, &secureVirtualAdr)) {
+        mcDrvRspMapBulkMem_t rsp;
+        rsp.header.responseId = MC_DRV_OK;
+        rsp.payload.sessionId = cmd.sessionId;
+        rsp.payload.secureVirtualAdr = secureVirtualAdr;
+        connection->writeData(&rsp, sizeof(mcDrvRspMapBulkMem_t));
+        return;
+    }
+
     if (!device->lockWsmL2(cmd.handle)) {
         LOG_E("Couldn't lock the buffer!");
         writeResult(connection, MC_DRV_ERR_DAEMON_WSM_HANDLE_NOT_FOUND);
         return;
     }
 
-    uint32_t secureVirtualAdr = 0;
     uint32_t pAddrL2 = (uint32_t)device->findWsmL2(cmd.handle, connection->socketDescriptor);
 
     if (pAddrL2 == 0) {
@@ -741,13 +862,25 @@ void MobiCoreDriverDaemon::processUnmapBulkBuf(Connection *connection)
         return;
     }
 
-    // TODO-2012-09-06-haenellu: Think about not ignoring the error case.
-    device->unlockWsmL2(cmd.handle);
-
     writeResult(connection, MC_DRV_OK);
 }
 
 
+//------------------------------------------------------------------------------
+void MobiCoreDriverDaemon::processMapCache(Connection *connection)
+{
+    MC_DRV_CMD_MAP_CACHE_struct cmd;
+    RECV_PAYLOAD_FROM_CLIENT(connection, &cmd)
+
+    // Device required
+    MobiCoreDevice *device = (MobiCoreDevice *) (connection->connectionData);
+    CHECK_DEVICE(device, connection);
+
+    writeResult(connection, device->setMapCache(connection, cmd.sessionId,
+                                                cmd.operation, cmd.param));
+}
+
+
 //------------------------------------------------------------------------------
 void MobiCoreDriverDaemon::processGetVersion(
     Connection  *connection
@@ -790,6 +923,38 @@ void MobiCoreDriverDaemon::processGetMobiCoreVersion(
         sizeof(rspGetMobiCoreVersion));
 }
 
+//------------------------------------------------------------------------------
+void MobiCoreDriverDaemon::processGetStats(
+    Connection  *connection
+)
+{
+    // there is no payload to read
+
+    // Device required
+    MobiCoreDevice *device = (MobiCoreDevice *) (connection->connectionData);
+    CHECK_DEVICE(device, connection);
+
+    mcDrvRspGetStats_t rspGetStats;
+    mcDaemonStats_t *stats = &rspGetStats.payload;
+    memset(stats, 0, sizeof(*stats));
+
+    memcpy(stats->command, commandStats, sizeof(stats->command));
+    stats->registry = registryStats;
+    device->getStats(stats);
+
+    regBlobCacheStats_t blobCacheStats;
+    mcRegistryGetBlobCacheStats(&blobCacheStats);
+    stats->blobCacheHits = blobCacheStats.hits;
+    stats->blobCacheMisses = blobCacheStats.misses;
+    stats->blobCacheEvictions = blobCacheStats.evictions;
+    stats->blobCacheInvalidations = blobCacheStats.invalidations;
+    stats->blobCacheEntries = blobCacheStats.entries;
+    stats->blobCacheSize = blobCacheStats.size;
+
+    rspGetStats.header.responseId = MC_DRV_OK;
+    connection->writeData(&rspGetStats, sizeof(rspGetStats));
+}
+
 //------------------------------------------------------------------------------
 void MobiCoreDriverDaemon::processRegistryReadData(uint32_t commandId, Connection  *connection)
 {
@@ -946,7 +1111,6 @@ bool MobiCoreDriverDaemon::handleConnection(
 )
 {
     bool ret = false;
-    static CMutex mutex;
 
     /* In case of RTM fault do not try to signal anything to MobiCore
      * just answer NO to all incoming connections! */
@@ -955,7 +1119,8 @@ bool MobiCoreDriverDaemon::handleConnection(
         return false;
     }
 
-    mutex.lock();
+    // Commands of different connections are handled concurrently, the
+    // device and the registry guard their own state.
     LOG_I("handleConnection()==== %p", connection);
     do {
         // Read header
@@ -977,6 +1142,7 @@ bool MobiCoreDriverDaemon::handleConnection(
             break;
         }
         ret = true;
+        uint64_t startUs = statsTimeUs();
 
         switch (mcDrvCommandHeader.commandId) {
             //-----------------------------------------
@@ -996,6 +1162,10 @@ bool MobiCoreDriverDaemon::handleConnection(
             processOpenTrustlet(connection);
             break;
             //-----------------------------------------
+        case MC_DRV_CMD_OPEN_SESSION_EX:
+            processOpenSessionEx(connection);
+            break;
+            //-----------------------------------------
         case MC_DRV_CMD_CLOSE_SESSION:
             processCloseSession(connection);
             break;
@@ -1016,6 +1186,10 @@ bool MobiCoreDriverDaemon::handleConnection(
             processUnmapBulkBuf(connection);
             break;
             //-----------------------------------------
+        case MC_DRV_CMD_MAP_CACHE:
+            processMapCache(connection);
+            break;
+            //-----------------------------------------
         case MC_DRV_CMD_GET_VERSION:
             processGetVersion(connection);
             break;
@@ -1024,6 +1198,10 @@ bool MobiCoreDriverDaemon::handleConnection(
             processGetMobiCoreVersion(connection);
             break;
             //-----------------------------------------
+        case MC_DRV_CMD_GET_STATS:
+            processGetStats(connection);
+            break;
+            //-----------------------------------------
         /* Registry functionality */
         // Write Registry Data
         case MC_DRV_REG_STORE_AUTH_TOKEN:
@@ -1031,7 +1209,9 @@ bool MobiCoreDriverDaemon::handleConnection(
         case MC_DRV_REG_WRITE_SP_CONT:
         case MC_DRV_REG_WRITE_TL_CONT:
         case MC_DRV_REG_WRITE_SO_DATA:
+            registryMutex.lock();
             processRegistryWriteData(mcDrvCommandHeader.commandId, connection);
+            registryMutex.unlock();
             break;
             //-----------------------------------------
         // Read Registry Data
@@ -1039,7 +1219,9 @@ bool MobiCoreDriverDaemon::handleConnection(
         case MC_DRV_REG_READ_ROOT_CONT:
         case MC_DRV_REG_READ_SP_CONT:
         case MC_DRV_REG_READ_TL_CONT:
+            registryMutex.lock();
             processRegistryReadData(mcDrvCommandHeader.commandId, connection);
+            registryMutex.unlock();
             break;
             //-----------------------------------------
         // Delete registry data
@@ -1047,7 +1229,9 @@ bool MobiCoreDriverDaemon::handleConnection(
         case MC_DRV_REG_DELETE_ROOT_CONT:
         case MC_DRV_REG_DELETE_SP_CONT:
         case MC_DRV_REG_DELETE_TL_CONT:
+            registryMutex.lock();
             processRegistryDeleteData(mcDrvCommandHeader.commandId, connection);
+            registryMutex.unlock();
             break;
             //-----------------------------------------
         default:
@@ -1057,8 +1241,13 @@ bool MobiCoreDriverDaemon::handleConnection(
             ret = false;
             break;
         }
+
+        if (mcDrvCommandHeader.commandId < MC_STATS_NUM_COMMANDS) {
+            statsAddLatency(&commandStats[mcDrvCommandHeader.commandId], startUs);
+        } else if (ret) {
+            statsAddLatency(&registryStats, startUs);
+        }
     } while (0);
-    mutex.unlock();
     LOG_I("handleConnection()<-------");
 
     return ret;
@@ -43,6 +43,9 @@
 
 
 #define MAX_SERVERS 2
+/** Threads serving the socket server. Commands of different connections run in
+ * parallel, only the MCP channel to MobiCore is serialized by the device. */
+#define SOCKET_SERVER_WORKERS 4
 
 class MobicoreDriverResources
 {
@@ -113,6 +116,12 @@ private:
     driverResourcesList_t driverResources;
     /**< List of servers processing connections */
     Server *servers[MAX_SERVERS];
+    /**< Serializes registry reads and writes of the server workers */
+    CMutex registryMutex;
+    /**< Handling times of the daemon commands, by command ID */
+    mcLatencyStats_t commandStats[MC_STATS_NUM_COMMANDS];
+    /**< Handling times of the registry commands */
+    mcLatencyStats_t registryStats;
 
     bool checkPermission(Connection *connection);
 
@@ -146,6 +155,28 @@ private:
      */
     void processOpenDevice(Connection *connection);
 
+    /**
+     * Load a service from the registry and open a session to it.
+     *
+     * @param connection Device connection the session belongs to
+     * @param device Device of the connection
+     * @param uuid UUID of the service
+     * @param tciHandle Handle of the TCI WSM
+     * @param tciLen Length of the TCI
+     * @param tciOffset Offset of the TCI in its first page
+     * @param pRspOpenSessionPayload Set to the session on success
+     * @return MC_DRV_OK or an error code for the client
+     */
+    mcResult_t openServiceSession(
+        Connection                      *connection,
+        MobiCoreDevice                  *device,
+        const mcUuid_t                  *uuid,
+        uint32_t                        tciHandle,
+        uint32_t                        tciLen,
+        uint32_t                        tciOffset,
+        mcDrvRspOpenSessionPayload_ptr  pRspOpenSessionPayload
+    );
+
     /**
      * Open Session command
      *
@@ -153,6 +184,13 @@ private:
      */
     void processOpenSession(Connection *connection);
 
+    /**
+     * Open Session command with bulk buffers mapped in the same request
+     *
+     * @param connection Connection object
+     */
+    void processOpenSessionEx(Connection *connection);
+
     /**
      * Open Trustlet command
      *
@@ -202,6 +240,13 @@ private:
      */
     void processUnmapBulkBuf(Connection *connection);
 
+    /**
+     * Mapping cache command
+     *
+     * @param connection Connection object
+     */
+    void processMapCache(Connection *connection);
+
     /**
      * Get Version command
      *
@@ -216,6 +261,13 @@ private:
      */
     void processGetMobiCoreVersion(Connection *connection);
 
+    /**
+     * Get daemon statistics command
+     *
+     * @param connection Connection object
+     */
+    void processGetStats(Connection *connection);
+
     /**
      * Generic Registry read command
      *
@@ -14,4 +14,5 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/$(SERVER_PATH)/public
 
 # Add new source files here
 LOCAL_SRC_FILES += $(SERVER_PATH)/Server.cpp \
+		$(SERVER_PATH)/EventLoop.cpp \
 		$(SERVER_PATH)/NetlinkServer.cpp
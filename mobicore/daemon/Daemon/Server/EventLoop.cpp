@@ -0,0 +1,153 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_SRV
+ * @{
+ * @file
+ *
+ * Event loop of the servers.
+ */
+/* <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "public/EventLoop.h"
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+//#define LOG_VERBOSE
+#include "log.h"
+
+//------------------------------------------------------------------------------
+EventLoop::EventLoop(
+    void
+) : epollFd(-1)
+{
+}
+
+
+//------------------------------------------------------------------------------
+EventLoop::~EventLoop(
+    void
+)
+{
+    if (epollFd != -1)
+        close(epollFd);
+}
+
+
+//------------------------------------------------------------------------------
+bool EventLoop::init(
+    void
+)
+{
+    if (epollFd != -1)
+        return true;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        LOG_ERRNO("epoll_create1");
+        return false;
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+bool EventLoop::add(
+    int fd,
+    void *data,
+    bool oneShot
+)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    if (oneShot) {
+        event.events |= EPOLLONESHOT;
+    }
+    event.data.ptr = data;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        LOG_ERRNO("epoll_ctl(ADD)");
+        return false;
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+bool EventLoop::rearm(
+    int fd,
+    void *data
+)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | EPOLLONESHOT;
+    event.data.ptr = data;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) < 0) {
+        LOG_ERRNO("epoll_ctl(MOD)");
+        return false;
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+void EventLoop::remove(
+    int fd
+)
+{
+    // the event argument is ignored, but must not be NULL before 2.6.9
+    struct epoll_event event;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, &event) < 0) {
+        LOG_ERRNO("epoll_ctl(DEL)");
+    }
+}
+
+
+//------------------------------------------------------------------------------
+int EventLoop::wait(
+    struct epoll_event *events,
+    int maxEvents,
+    int32_t timeout
+)
+{
+    int numEvents;
+
+    do {
+        numEvents = epoll_wait(epollFd, events, maxEvents, timeout);
+    } while (numEvents < 0 && errno == EINTR);
+
+    return numEvents;
+}
+
+/** @} */
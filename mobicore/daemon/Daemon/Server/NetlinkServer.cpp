@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <linux/netlink.h>
 
 #include <stdlib.h>
@@ -48,7 +49,7 @@
 //------------------------------------------------------------------------------
 NetlinkServer::NetlinkServer(
     ConnectionHandler *connectionHandler
-): Server(connectionHandler, "dummy")
+): Server(connectionHandler, "dummy", 1)
 {
 }
 
@@ -72,7 +73,7 @@ void NetlinkServer::run(
         struct nlmsghdr *nlh = NULL;
         struct iovec iov;
         struct msghdr msg;
-        uint32_t len;
+        ssize_t len;
 
         memset(&src_addr, 0, sizeof(src_addr));
         src_addr.nl_family = AF_NETLINK;
@@ -84,35 +85,70 @@ void NetlinkServer::run(
             break;
         }
 
+        // The socket is drained on every event, it must not block
+        if (fcntl(serverSock, F_SETFL, fcntl(serverSock, F_GETFL) | O_NONBLOCK) < 0) {
+            LOG_ERRNO("fcntl");
+            close(serverSock);
+            break;
+        }
+
+        if (!eventLoop.init() || !eventLoop.add(serverSock, NULL, false)) {
+            close(serverSock);
+            break;
+        }
+
         // Start reading the socket
         LOG_I("\n********* successfully initialized *********\n");
 
-        for (;;) {
-            // This buffer will be taken over by the connection it was routed to
-            nlh = (struct nlmsghdr *)malloc(NLMSG_SPACE(MAX_PAYLOAD));
-            memset(&msg, 0, sizeof(msg));
-            iov.iov_base = (void *)nlh;
-            iov.iov_len = NLMSG_SPACE(MAX_PAYLOAD);
-            msg.msg_iov = &iov;
-            msg.msg_iovlen = 1;
-            msg.msg_name = &src_addr;
-            msg.msg_namelen = sizeof(src_addr);
-
-            memset(nlh, 0, NLMSG_SPACE(MAX_PAYLOAD));
-
-            // Read the incomming message and route it to the connection based
-            // on the incomming PID
-            if ((len = recvmsg(serverSock, &msg, 0)) < 0) {
-                LOG_ERRNO("recvmsg");
+        bool failed = false;
+        while (!failed) {
+            struct epoll_event events[1];
+
+            if (eventLoop.wait(events, 1, -1) < 0) {
+                LOG_ERRNO("epoll_wait");
                 break;
             }
 
-            if (NLMSG_OK(nlh, len)) {
-                handleMessage(nlh);
-            } else {
-                break;
+            for (;;) {
+                // This buffer will be taken over by the connection it was routed to,
+                // one left over from the last drain is reused
+                if (nlh == NULL) {
+                    nlh = (struct nlmsghdr *)malloc(NLMSG_SPACE(MAX_PAYLOAD));
+                }
+                memset(&msg, 0, sizeof(msg));
+                iov.iov_base = (void *)nlh;
+                iov.iov_len = NLMSG_SPACE(MAX_PAYLOAD);
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_name = &src_addr;
+                msg.msg_namelen = sizeof(src_addr);
+
+                memset(nlh, 0, NLMSG_SPACE(MAX_PAYLOAD));
+
+                // Read the incomming message and route it to the connection based
+                // on the incomming PID
+                if ((len = recvmsg(serverSock, &msg, 0)) < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        LOG_ERRNO("recvmsg");
+                        failed = true;
+                    }
+                    break;
+                }
+
+                if (NLMSG_OK(nlh, (uint32_t)len)) {
+                    handleMessage(nlh);
+                    nlh = NULL;
+                } else {
+                    failed = true;
+                    break;
+                }
             }
         }
+
+        free(nlh);
     } while (false);
 
     LOG_W("Could not open netlink socket. KernelAPI disabled");
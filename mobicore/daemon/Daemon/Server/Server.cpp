@@ -36,17 +36,43 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 
 //#define LOG_VERBOSE
 #include "log.h"
 
+/**
+ * Thread serving the event loop of a server besides the server thread.
+ */
+class ServerWorker: public CThread
+{
+
+public:
+    ServerWorker(
+        Server *server
+    ) : server(server) {
+    };
+
+    virtual void run(
+        void
+    ) {
+        server->serve();
+    };
+
+private:
+    Server *server;
+};
+
+
 //------------------------------------------------------------------------------
 Server::Server(
     ConnectionHandler *connectionHandler,
-    const char *localAddr
+    const char *localAddr,
+    uint32_t numWorkers
 ) : socketAddr(localAddr)
 {
     this->connectionHandler = connectionHandler;
+    this->numWorkers = (numWorkers > 0) ? numWorkers : 1;
 }
 
 
@@ -83,115 +109,156 @@ void Server::run(
             break;
         }
 
+        // Accept is drained on every event, it must not block
+        if (fcntl(serverSock, F_SETFL, fcntl(serverSock, F_GETFL) | O_NONBLOCK) < 0) {
+            LOG_ERRNO("fcntl");
+            break;
+        }
+
+        // The server socket is registered without a connection. With several
+        // workers every descriptor is one shot: it is handed to one worker
+        // and rearmed when that worker is done with it.
+        if (!eventLoop.init() || !eventLoop.add(serverSock, NULL, numWorkers > 1)) {
+            break;
+        }
+
         LOG_I("\n********* successfully initialized Daemon *********\n");
 
-        for (;;) {
-            fd_set fdReadSockets;
-
-            // Clear FD for select()
-            FD_ZERO(&fdReadSockets);
-
-            // Select server socket descriptor
-            FD_SET(serverSock, &fdReadSockets);
-            int maxSocketDescriptor = serverSock;
-
-            // Select socket descriptor of all connections
-            for (connectionIterator_t iterator = peerConnections.begin();
-                    iterator != peerConnections.end();
-                    ++iterator) {
-                Connection *connection = (*iterator);
-                int peerSocket = connection->socketDescriptor;
-                FD_SET(peerSocket, &fdReadSockets);
-                if (peerSocket > maxSocketDescriptor) {
-                    maxSocketDescriptor = peerSocket;
-                }
-            }
+        for (uint32_t i = 1; i < numWorkers; i++) {
+            CThread *worker = new ServerWorker(this);
+            worker->start();
+            workers.push_back(worker);
+        }
 
-            // Wait for activities, select() returns the number of sockets
-            // which require processing
-            LOG_V(" Server: waiting on sockets");
-            int numSockets = select(
-                                 maxSocketDescriptor + 1,
-                                 &fdReadSockets,
-                                 NULL, NULL, NULL);
-
-            // Check if select failed
-            if (numSockets < 0) {
-                LOG_ERRNO("select");
-                break;
-            }
+        serve();
 
-            // actually, this should not happen.
-            if (0 == numSockets) {
-                LOG_W(" Server: select() returned 0, spurious event?.");
-                continue;
-            }
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i]->join();
+            delete workers[i];
+        }
+        workers.clear();
 
-            LOG_V(" Server: events on %d socket(s).", numSockets);
+    } while (false);
 
-            // Check if a new client connected to the server socket
-            if (FD_ISSET(serverSock, &fdReadSockets)) {
-                do {
-                    LOG_V(" Server: new connection attempt.");
-                    numSockets--;
-
-                    struct sockaddr_un clientAddr;
-                    socklen_t clientSockLen = sizeof(clientAddr);
-                    int clientSock = accept(
-                                         serverSock,
-                                         (struct sockaddr *) &clientAddr,
-                                         &clientSockLen);
-
-                    if (clientSock <= 0) {
-                        LOG_ERRNO("accept");
-                        break;
-                    }
-
-                    Connection *connection = new Connection(clientSock, &clientAddr);
-                    peerConnections.push_back(connection);
-                    LOG_I(" Server: new socket connection established and start listening.");
-                } while (false);
-
-                // we can ignore any errors from accepting a new connection.
-                // If this fail, the client has to deal with it, we are done
-                // and nothing has changed.
-            }
+    LOG_ERRNO("Exiting Server, because");
+}
 
-            // Handle traffic on existing client connections
-            connectionIterator_t iterator = peerConnections.begin();
-            while ( (iterator != peerConnections.end())
-                    && (numSockets > 0) ) {
-                Connection *connection = (*iterator);
-                int peerSocket = connection->socketDescriptor;
-
-                if (!FD_ISSET(peerSocket, &fdReadSockets)) {
-                    ++iterator;
-                    continue;
-                }
 
-                numSockets--;
+//------------------------------------------------------------------------------
+void Server::serve(
+    void
+)
+{
+    // A batch of one shot events would be served by this thread one after
+    // the other while other workers idle
+    int maxEvents = (numWorkers > 1) ? 1 : EVENT_LOOP_MAX_EVENTS;
+
+    for (;;) {
+        struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
 
-                // the connection will be terminated if command processing
-                // fails
-                if (!connectionHandler->handleConnection(connection)) {
-                    LOG_I(" Server: dropping connection.");
+        // Wait for activities
+        LOG_V(" Server: waiting on sockets");
+        int numEvents = eventLoop.wait(events, maxEvents, -1);
 
-                    //Inform the driver
-                    connectionHandler->dropConnection(connection);
+        // Check if wait failed
+        if (numEvents < 0) {
+            LOG_ERRNO("epoll_wait");
+            break;
+        }
+
+        LOG_V(" Server: events on %d socket(s).", numEvents);
+
+        for (int i = 0; i < numEvents; i++) {
+            Connection *connection = (Connection *)events[i].data.ptr;
 
-                    // Remove connection from list
-                    delete connection;
-                    iterator = peerConnections.erase(iterator);
-                    continue;
+            // Check if a new client connected to the server socket
+            if (connection == NULL) {
+                acceptConnections();
+                if (numWorkers > 1) {
+                    eventLoop.rearm(serverSock, NULL);
                 }
+                continue;
+            }
+
+            // Handle traffic on existing client connections
+            serveConnection(connection);
+        }
+    }
+}
 
-                ++iterator;
+
+//------------------------------------------------------------------------------
+void Server::acceptConnections(
+    void
+)
+{
+    for (;;) {
+        LOG_V(" Server: new connection attempt.");
+
+        struct sockaddr_un clientAddr;
+        socklen_t clientSockLen = sizeof(clientAddr);
+        int clientSock = accept(
+                             serverSock,
+                             (struct sockaddr *) &clientAddr,
+                             &clientSockLen);
+
+        if (clientSock < 0) {
+            // we can ignore any errors from accepting a new connection.
+            // If this fail, the client has to deal with it, we are done
+            // and nothing has changed.
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERRNO("accept");
             }
+            break;
         }
 
-    } while (false);
+        Connection *connection = new Connection(clientSock, &clientAddr);
+        connectionsMutex.lock();
+        peerConnections.push_back(connection);
+        connectionsMutex.unlock();
+
+        // Data sent right after connect() is reported by the registration
+        // itself, possibly to another worker
+        if (!eventLoop.add(clientSock, connection, numWorkers > 1)) {
+            connectionsMutex.lock();
+            peerConnections.remove(connection);
+            connectionsMutex.unlock();
+            delete connection;
+            continue;
+        }
+        LOG_I(" Server: new socket connection established and start listening.");
+    }
+}
 
-    LOG_ERRNO("Exiting Server, because");
+
+//------------------------------------------------------------------------------
+void Server::serveConnection(
+    Connection *connection
+)
+{
+    while (!connection->detached && connection->isDataPending()) {
+        // the connection will be terminated if command processing
+        // fails
+        if (!connectionHandler->handleConnection(connection)) {
+            LOG_I(" Server: dropping connection.");
+
+            //Inform the driver
+            connectionHandler->dropConnection(connection);
+
+            // Remove connection from list
+            eventLoop.remove(connection->socketDescriptor);
+            connectionsMutex.lock();
+            peerConnections.remove(connection);
+            connectionsMutex.unlock();
+            delete connection;
+            return;
+        }
+    }
+
+    // A detached connection is no longer registered
+    if (!connection->detached && numWorkers > 1) {
+        eventLoop.rearm(connection->socketDescriptor, connection);
+    }
 }
 
 
@@ -202,16 +269,20 @@ void Server::detachConnection(
 {
     LOG_V(" Stopping to listen on notification socket.");
 
+    connectionsMutex.lock();
     for (connectionIterator_t iterator = peerConnections.begin();
             iterator != peerConnections.end();
             ++iterator) {
         Connection *tmpConnection = (*iterator);
         if (tmpConnection == connection) {
+            eventLoop.remove(connection->socketDescriptor);
+            connection->detached = true;
             peerConnections.erase(iterator);
             LOG_I(" Stopped listening on notification socket.");
             break;
         }
     }
+    connectionsMutex.unlock();
 }
 
 
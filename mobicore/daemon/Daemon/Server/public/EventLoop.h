@@ -0,0 +1,135 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON_SRV
+ * @{
+ * @file
+ *
+ * Event loop of the servers.
+ *
+ * Thin wrapper of an epoll instance. Descriptors are registered edge
+ * triggered with a pointer to the object serving them: after an event the
+ * owner has to read until the descriptor would block, it is not reported
+ * again before new data arrives. Unlike select() the cost of a wakeup does
+ * not grow with the number of registered descriptors, and there is no
+ * FD_SETSIZE limit.
+ *
+ * A loop waited on by several threads registers its descriptors one shot:
+ * each event goes to a single thread and the descriptor stays disabled until
+ * that thread rearms it, so a connection is never served twice at once.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef EVENTLOOP_H_
+#define EVENTLOOP_H_
+
+#include <inttypes.h>
+#include <sys/epoll.h>
+
+/** Number of events fetched by one wait. */
+#define EVENT_LOOP_MAX_EVENTS   (32)
+
+
+class EventLoop
+{
+
+public:
+    EventLoop(
+        void
+    );
+
+    /**
+     * Closes the epoll instance. Registered descriptors are not closed.
+     */
+    virtual ~EventLoop(
+        void
+    );
+
+    /**
+     * Create the epoll instance.
+     *
+     * @return true on success.
+     */
+    bool init(
+        void
+    );
+
+    /**
+     * Register a descriptor for input, edge triggered.
+     *
+     * @param fd Descriptor to watch.
+     * @param data Returned in epoll_event.data.ptr of its events.
+     * @param oneShot Disable the descriptor after its first event.
+     * @return true on success.
+     */
+    bool add(
+        int fd,
+        void *data,
+        bool oneShot
+    );
+
+    /**
+     * Enable a one shot descriptor again after its event was served.
+     * Data which arrived in the meantime raises a new event at once.
+     *
+     * @param fd Descriptor to watch.
+     * @param data Returned in epoll_event.data.ptr of its events.
+     * @return true on success.
+     */
+    bool rearm(
+        int fd,
+        void *data
+    );
+
+    /**
+     * Unregister a descriptor.
+     * Must be done before the descriptor is closed or handed over.
+     *
+     * @param fd Descriptor to forget.
+     */
+    void remove(
+        int fd
+    );
+
+    /**
+     * Wait for events. Interrupted waits are restarted.
+     *
+     * @param events Array receiving the events.
+     * @param maxEvents Size of events.
+     * @param timeout Timeout in milliseconds, -1 to wait forever.
+     * @return Number of events, 0 on timeout, -1 on error.
+     */
+    int wait(
+        struct epoll_event *events,
+        int maxEvents,
+        int32_t timeout
+    );
+
+private:
+    int epollFd;
+};
+
+#endif /* EVENTLOOP_H_ */
+
+/** @} */
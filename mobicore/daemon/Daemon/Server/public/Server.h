@@ -6,7 +6,10 @@
  *
  * Handles incoming socket connections from clients using the MobiCore driver.
  *
- * Iterative socket server using UNIX domain stream protocol.
+ * Socket server using UNIX domain stream protocol, driven by an edge
+ * triggered EventLoop. With more than one worker the loop is waited on by a
+ * pool of threads, so a slow command of one client does not hold up the
+ * others.
  *
  * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
  *
@@ -44,7 +47,9 @@
 #include <cstdio>
 #include <vector>
 #include "CThread.h"
+#include "CMutex.h"
 #include "ConnectionHandler.h"
+#include "EventLoop.h"
 
 /** Number of incoming connections that can be queued.
  * Additional clients will generate the error ECONNREFUSED. */
@@ -60,10 +65,12 @@ public:
      *
      * @param connectionHanler Connection handler to pass incoming connections to.
      * @param localAdrerss Pointer to a zero terminated string containing the file to listen to.
+     * @param numWorkers Number of threads serving connections, including the server thread.
      */
     Server(
         ConnectionHandler *connectionHandler,
-        const char *localAddr
+        const char *localAddr,
+        uint32_t numWorkers
     );
 
     /**
@@ -81,6 +88,14 @@ public:
     virtual void run(
     );
 
+    /**
+     * Wait for and serve events of the event loop until waiting fails.
+     * Run by the server thread and each of its workers.
+     */
+    void serve(
+        void
+    );
+
     /**
      * Remove a connection object from the list of available connections.
      * Detaching is required for notification connections wich are never used to transfer command
@@ -97,9 +112,32 @@ protected:
     int serverSock;
     string socketAddr;
     ConnectionHandler   *connectionHandler; /**< Connection handler registered to the server */
+    EventLoop           eventLoop; /**< Server socket and connections registered for input */
+    uint32_t            numWorkers; /**< Threads waiting on the event loop */
 
 private:
+    /**
+     * Accept every pending connection of the server socket.
+     */
+    void acceptConnections(
+        void
+    );
+
+    /**
+     * Serve all commands received on a connection.
+     * Events are edge triggered, the connection is served until it has no
+     * more data, is detached or dropped. A one shot connection is rearmed
+     * once it has no more data.
+     *
+     * @param connection The connection which has data to process.
+     */
+    void serveConnection(
+        Connection *connection
+    );
+
     connectionList_t    peerConnections; /**< Connections to devices */
+    CMutex              connectionsMutex; /**< Guards peerConnections */
+    vector<CThread *>   workers; /**< Workers started besides the server thread */
 
 };
 
@@ -35,6 +35,7 @@
 
 #include "mcUuid.h"
 #include "mcVersionInfo.h"
+#include "MobiCoreDriverApi.h"
 
 #define SOCK_PATH "#mcdaemon"
 
@@ -52,6 +53,9 @@ typedef enum {
     MC_DRV_CMD_GET_VERSION          = 10,
     MC_DRV_CMD_GET_MOBICORE_VERSION = 11,
     MC_DRV_CMD_OPEN_TRUSTLET        = 12,
+    MC_DRV_CMD_OPEN_SESSION_EX      = 13,
+    MC_DRV_CMD_GET_STATS            = 14,
+    MC_DRV_CMD_MAP_CACHE            = 15,
 
     // Registry Commands
 
@@ -127,6 +131,40 @@ typedef struct {
     mcDrvRspOpenSessionPayload_t  payload;
 } mcDrvRspOpenSession_t;
 
+//--------------------------------------------------------------
+#define MC_DRV_MAX_SESSION_MAPS 4 /**< Bulk buffers mapped by one MC_DRV_CMD_OPEN_SESSION_EX */
+
+typedef struct {
+    uint32_t  handle;
+    uint32_t  offsetPayload;
+    uint32_t  lenBulkMem;
+} mcDrvSessionMap_t;
+
+/**
+ * Open a session and map bulk buffers to it. Either all buffers are mapped
+ * or the session is not opened.
+ */
+struct MC_DRV_CMD_OPEN_SESSION_EX_struct {
+    uint32_t  commandId;
+    uint32_t  deviceId;
+    mcUuid_t  uuid;
+    uint32_t  tci;
+    uint32_t  handle;
+    uint32_t  len;
+    uint32_t  numMaps;
+    mcDrvSessionMap_t  maps[MC_DRV_MAX_SESSION_MAPS];
+};
+
+typedef struct {
+    mcDrvRspOpenSessionPayload_t  session;
+    uint32_t  secureVirtualAdr[MC_DRV_MAX_SESSION_MAPS];
+} mcDrvRspOpenSessionExPayload_t, *mcDrvRspOpenSessionExPayload_ptr;
+
+typedef struct {
+    mcDrvResponseHeader_t           header;
+    mcDrvRspOpenSessionExPayload_t  payload;
+} mcDrvRspOpenSessionEx_t;
+
 //--------------------------------------------------------------
 struct MC_DRV_CMD_OPEN_TRUSTLET_struct {
     uint32_t  commandId;
@@ -239,6 +277,36 @@ typedef struct {
     mcDrvRspGetMobiCoreVersionPayload_t payload;
 } mcDrvRspGetMobiCoreVersion_t;
 
+//--------------------------------------------------------------
+struct MC_DRV_CMD_GET_STATS_struct {
+    uint32_t  commandId;
+};
+
+typedef struct {
+    mcDrvResponseHeader_t       header;
+    mcDaemonStats_t             payload;
+} mcDrvRspGetStats_t;
+
+//--------------------------------------------------------------
+#define MC_DRV_MAX_MAP_CACHE_SIZE 16 /**< Unmapped buffers a session keeps mapped at most */
+
+/** Operations of MC_DRV_CMD_MAP_CACHE. */
+typedef enum {
+    MC_DRV_MAP_CACHE_SET_SIZE   = 0, /**< Keep up to param unmapped buffers mapped, 0 disables the cache. */
+    MC_DRV_MAP_CACHE_INVALIDATE = 1, /**< Really unmap the kept buffers of L2 handle param, all for 0. */
+} mcDrvMapCacheOp_t;
+
+struct MC_DRV_CMD_MAP_CACHE_struct {
+    uint32_t  commandId;
+    uint32_t  sessionId;
+    uint32_t  operation;
+    uint32_t  param;
+};
+
+typedef struct {
+    mcDrvResponseHeader_t       header;
+} mcDrvRspMapCache_t;
+
 //--------------------------------------------------------------
 typedef union {
     mcDrvCommandHeader_t                header;
@@ -246,6 +314,7 @@ typedef union {
     MC_DRV_CMD_CLOSE_DEVICE_struct      mcDrvCmdCloseDevice;
     MC_DRV_CMD_OPEN_SESSION_struct      mcDrvCmdOpenSession;
     MC_DRV_CMD_OPEN_TRUSTLET_struct     mcDrvCmdOpenTrustlet;
+    MC_DRV_CMD_OPEN_SESSION_EX_struct   mcDrvCmdOpenSessionEx;
     MC_DRV_CMD_CLOSE_SESSION_struct     mcDrvCmdCloseSession;
     MC_DRV_CMD_NQ_CONNECT_struct        mcDrvCmdNqConnect;
     MC_DRV_CMD_NOTIFY_struct            mcDrvCmdNotify;
@@ -253,6 +322,8 @@ typedef union {
     MC_DRV_CMD_UNMAP_BULK_BUF_struct    mcDrvCmdUnmapBulkMem;
     MC_DRV_CMD_GET_VERSION_struct       mcDrvCmdGetVersion;
     MC_DRV_CMD_GET_MOBICORE_VERSION_struct  mcDrvCmdGetMobiCoreVersion;
+    MC_DRV_CMD_GET_STATS_struct         mcDrvCmdGetStats;
+    MC_DRV_CMD_MAP_CACHE_struct         mcDrvCmdMapCache;
 } mcDrvCommand_t, *mcDrvCommand_ptr;
 
 typedef union {
@@ -260,12 +331,15 @@ typedef union {
     mcDrvRspOpenDevice_t         mcDrvRspOpenDevice;
     mcDrvRspCloseDevice_t        mcDrvRspCloseDevice;
     mcDrvRspOpenSession_t        mcDrvRspOpenSession;
+    mcDrvRspOpenSessionEx_t      mcDrvRspOpenSessionEx;
     mcDrvRspCloseSession_t       mcDrvRspCloseSession;
     mcDrvRspNqConnect_t          mcDrvRspNqConnect;
     mcDrvRspMapBulkMem_t         mcDrvRspMapBulkMem;
     mcDrvRspUnmapBulkMem_t       mcDrvRspUnmapBulkMem;
     mcDrvRspGetVersion_t         mcDrvRspGetVersion;
     mcDrvRspGetMobiCoreVersion_t mcDrvRspGetMobiCoreVersion;
+    mcDrvRspGetStats_t           mcDrvRspGetStats;
+    mcDrvRspMapCache_t           mcDrvRspMapCache;
 } mcDrvResponse_t, *mcDrvResponse_ptr;
 
 #endif /* MCDAEMON_H_ */
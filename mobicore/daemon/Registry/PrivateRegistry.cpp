@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <stdio.h>
+#include <ctype.h>
 #include <sys/stat.h>
 #include <assert.h>
 #include <string.h>
@@ -45,6 +46,10 @@
 #include <sys/mman.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <list>
+#include <map>
+#include <vector>
 
 #include "mcLoadFormat.h"
 #include "mcSpid.h"
@@ -52,6 +57,7 @@
 
 #include "PrivateRegistry.h"
 #include "MobiCoreRegistry.h"
+#include "CMutex.h"
 
 #include "log.h"
 
@@ -60,6 +66,11 @@
 /** Maximum size of a shared object container in bytes. */
 #define MAX_SO_CONT_SIZE  (512)
 
+/** Service blobs kept by the cache at most. */
+#define BLOB_CACHE_MAX_ENTRIES  (8)
+/** Bytes of service blobs kept by the cache at most. */
+#define BLOB_CACHE_MAX_SIZE     (4 * 1024 * 1024)
+
 // Asserts expression at compile-time (to be used within a function body).
 #define ASSERT_STATIC(e) do { enum { assert_static__ = 1 / (e) }; } while (0)
 
@@ -75,6 +86,7 @@ static const string SP_CONT_FILE_EXT = ".spcont";
 static const string TL_CONT_FILE_EXT = ".tlcont";
 static const string TL_BIN_FILE_EXT = ".tlbin";
 static const string DATA_CONT_FILE_EXT = ".datacont";
+static const string TMP_FILE_EXT = ".tmp";
 
 static const string ENV_MC_AUTH_TOKEN_PATH = "MC_AUTH_TOKEN_PATH";
 
@@ -214,6 +226,351 @@ static string getTlBinFilePath(const mcUuid_t *uuid)
     return getTlRegistryPath() + "/" + byteArrayToString(uuid, sizeof(*uuid)) + TL_BIN_FILE_EXT;
 }
 
+static void blobCacheInvalidate(void);
+
+//------------------------------------------------------------------------------
+/**
+ * Read the start of a file straight into a buffer, without stdio buffering.
+ * @param size Bytes to read at most.
+ * @return Bytes read, 0 if the file is empty, -1 if it cannot be read.
+ */
+static ssize_t readFile(const string &path, void *buf, uint32_t size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    ssize_t total = 0;
+    while ((uint32_t)total < size) {
+        ssize_t n = read(fd, (uint8_t *)buf + total, size - total);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            total = -1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    close(fd);
+
+    return total;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Replace a file atomically: the data is written to a temporary file which
+ * is synced and renamed over path, the directory is synced at last. After a
+ * crash the file holds either the old or the new data, never a mix.
+ */
+static mcResult_t writeFileAtomic(const string &path, const void *data, uint32_t size)
+{
+    string tmpPath = path + TMP_FILE_EXT;
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd == -1) {
+        LOG_ERRNO("open");
+        return MC_DRV_ERR_INVALID_DEVICE_FILE;
+    }
+
+    uint32_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, (const uint8_t *)data + written, size - written);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            break;
+        }
+        written += n;
+    }
+    if (written != size || fsync(fd) == -1) {
+        LOG_ERRNO("write");
+        close(fd);
+        unlink(tmpPath.c_str());
+        return MC_DRV_ERR_INVALID_DEVICE_FILE;
+    }
+    close(fd);
+
+    if (rename(tmpPath.c_str(), path.c_str()) == -1) {
+        LOG_ERRNO("rename");
+        unlink(tmpPath.c_str());
+        return MC_DRV_ERR_INVALID_DEVICE_FILE;
+    }
+
+    // Make the rename itself durable
+    string dir = path.substr(0, path.rfind('/'));
+    int dirFd = open(dir.c_str(), O_RDONLY);
+    if (dirFd != -1) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    return MC_DRV_OK;
+}
+
+//------------------------------------------------------------------------------
+// Container index
+//
+// The root, SP and trustlet containers are read for every service blob and
+// by the provisioning agent. They are all read from the registry directory
+// once, by the first access, and kept in an index: reads are served from
+// memory and do not build paths, writes and deletes update the file and the
+// index together. Data containers are not indexed.
+// Other processes write containers too, and the directory may only appear
+// once /data is mounted: the index is reloaded when the directory changed,
+// and a container missing from the index is looked up in its file.
+
+typedef struct contKey {
+    uint32_t    type;   /**< CONT_TYPE_ROOT, CONT_TYPE_SP or CONT_TYPE_TLCON */
+    mcSpid_t    spid;   /**< SP (CONT_TYPE_SP, CONT_TYPE_TLCON) */
+    mcUuid_t    uuid;   /**< Trustlet (CONT_TYPE_TLCON) */
+
+    bool operator<(const struct contKey &other) const {
+        return memcmp(this, &other, sizeof(*this)) < 0;
+    }
+} contKey_t;
+
+typedef map<contKey_t, vector<uint8_t> > contIndex_t;
+
+static CMutex contIndexMutex; /**< Guards contIndex, contIndexLoaded and contIndexDir */
+static contIndex_t contIndex;
+static bool contIndexLoaded;
+static struct stat contIndexDir; /**< Registry directory as indexed, all zero if missing */
+
+//------------------------------------------------------------------------------
+static contKey_t contKey(uint32_t type, mcSpid_t spid, const mcUuid_t *uuid)
+{
+    contKey_t key;
+
+    memset(&key, 0, sizeof(key));
+    key.type = type;
+    key.spid = spid;
+    if (uuid != NULL) {
+        key.uuid = *uuid;
+    }
+    return key;
+}
+
+//------------------------------------------------------------------------------
+static string contKeyPath(const contKey_t &key)
+{
+    switch (key.type) {
+    case CONT_TYPE_ROOT:
+        return getRootContFilePath();
+    case CONT_TYPE_SP:
+        return getSpContFilePath(key.spid);
+    default:
+        return getTlContFilePath(&key.uuid, key.spid);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Parse hex digits written by byteArrayToString().
+ */
+static bool stringToByteArray(const char *str, void *bytes, size_t elems)
+{
+    for (size_t i = 0; i < elems; i++) {
+        char hx[3] = { str[i * 2], str[i * 2 + 1], 0 };
+        if (!isxdigit(hx[0]) || !isxdigit(hx[1])) {
+            return false;
+        }
+        ((uint8_t *)bytes)[i] = strtoul(hx, NULL, 16);
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Parse hex digits written by uint32ToString().
+ */
+static bool stringToUint32(const char *str, uint32_t *value)
+{
+    char hx[4 * 2 + 1];
+
+    for (size_t i = 0; i < 4 * 2; i++) {
+        if (!isxdigit(str[i])) {
+            return false;
+        }
+        hx[4 * 2 - 1 - i] = str[i];
+    }
+    hx[4 * 2] = 0;
+    *value = strtoul(hx, NULL, 16);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Read all containers of the registry directory into the index.
+ * Caller holds contIndexMutex.
+ */
+static void contIndexLoad(void)
+{
+    const string &registryPath = getRegistryPath();
+    DIR *dp;
+    struct dirent *de;
+    size_t spLen = 4 * 2 + SP_CONT_FILE_EXT.length();
+    size_t tlLen = sizeof(mcUuid_t) * 2 + 1 + 4 * 2 + TL_CONT_FILE_EXT.length();
+
+    bool first = !contIndexLoaded;
+
+    contIndexLoaded = true;
+    contIndex.clear();
+    if (stat(registryPath.c_str(), &contIndexDir) != 0) {
+        memset(&contIndexDir, 0, sizeof(contIndexDir));
+    }
+    if (NULL == (dp = opendir(registryPath.c_str()))) {
+        return;
+    }
+    while (NULL != (de = readdir(dp))) {
+        string name(de->d_name);
+        contKey_t key = contKey(CONT_TYPE_SOC, 0, NULL);
+
+        if (name.length() > TMP_FILE_EXT.length() &&
+                name.compare(name.length() - TMP_FILE_EXT.length(), string::npos, TMP_FILE_EXT) == 0) {
+            // Left by an interrupted write, the container itself is intact.
+            // On a reload it may belong to a write in progress elsewhere.
+            if (first) {
+                LOG_I("delete %s", name.c_str());
+                unlink((registryPath + "/" + name).c_str());
+            }
+            continue;
+        } else if (name == ROOT_FILE_NAME) {
+            key.type = CONT_TYPE_ROOT;
+        } else if (name.length() == spLen &&
+                name.compare(4 * 2, string::npos, SP_CONT_FILE_EXT) == 0 &&
+                stringToUint32(name.c_str(), &key.spid)) {
+            key.type = CONT_TYPE_SP;
+        } else if (name.length() == tlLen &&
+                name.compare(tlLen - TL_CONT_FILE_EXT.length(), string::npos, TL_CONT_FILE_EXT) == 0 &&
+                name[sizeof(mcUuid_t) * 2] == '.' &&
+                stringToByteArray(name.c_str(), &key.uuid, sizeof(mcUuid_t)) &&
+                stringToUint32(name.c_str() + sizeof(mcUuid_t) * 2 + 1, &key.spid)) {
+            key.type = CONT_TYPE_TLCON;
+        } else {
+            continue;
+        }
+
+        uint8_t so[3 * MAX_SO_CONT_SIZE];
+        ssize_t len = readFile(registryPath + "/" + name, so, sizeof(so));
+        if (len > 0) {
+            contIndex[key].assign(so, so + len);
+        }
+    }
+    closedir(dp);
+    LOG_I("%u containers indexed", (unsigned int)contIndex.size());
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Check the registry directory against the index.
+ * Caller holds contIndexMutex.
+ * @param update Take the directory as indexed, after an own write or delete.
+ * @return true if the index is current.
+ */
+static bool contIndexCurrent(bool update)
+{
+    struct stat st;
+
+    if (stat(getRegistryPath().c_str(), &st) != 0) {
+        memset(&st, 0, sizeof(st));
+    }
+    if (update) {
+        contIndexDir = st;
+        return true;
+    }
+    return contIndexLoaded &&
+           st.st_dev == contIndexDir.st_dev &&
+           st.st_ino == contIndexDir.st_ino &&
+           st.st_mtime == contIndexDir.st_mtime;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Copy an indexed container.
+ * @param size Size of so, set to the bytes copied.
+ * @return true if the container exists and is not empty.
+ */
+static bool contIndexRead(const contKey_t &key, void *so, uint32_t *size)
+{
+    bool found = false;
+    bool reloaded = false;
+
+    contIndexMutex.lock();
+    if (!contIndexCurrent(false)) {
+        reloaded = contIndexLoaded;
+        contIndexLoad();
+    }
+    contIndex_t::iterator it = contIndex.find(key);
+    if (it == contIndex.end() || it->second.empty()) {
+        // Written within the mtime granularity of the last check
+        uint8_t buf[3 * MAX_SO_CONT_SIZE];
+        ssize_t len = readFile(contKeyPath(key), buf, sizeof(buf));
+        if (len > 0) {
+            contIndex[key].assign(buf, buf + len);
+            it = contIndex.find(key);
+        }
+    }
+    if (it != contIndex.end() && !it->second.empty()) {
+        if (*size > it->second.size()) {
+            *size = it->second.size();
+        }
+        memcpy(so, &it->second[0], *size);
+        found = true;
+    }
+    contIndexMutex.unlock();
+    if (reloaded) {
+        // Cached blobs may hold containers replaced elsewhere
+        blobCacheInvalidate();
+    }
+
+    return found;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Store a container in the index and in its file.
+ */
+static mcResult_t contIndexWrite(const contKey_t &key, const string &path, const void *so, uint32_t size)
+{
+    contIndexMutex.lock();
+    if (!contIndexCurrent(false)) {
+        contIndexLoad();
+    }
+    mcResult_t ret = writeFileAtomic(path, so, size);
+    if (ret == MC_DRV_OK) {
+        contIndex[key].assign((const uint8_t *)so, (const uint8_t *)so + size);
+        contIndexCurrent(true);
+    }
+    contIndexMutex.unlock();
+    blobCacheInvalidate();
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Remove a container from the index and delete its file.
+ * @return Result of remove().
+ */
+static int contIndexRemove(const contKey_t &key, const string &path)
+{
+    contIndexMutex.lock();
+    contIndex.erase(key);
+    int e = remove(path.c_str());
+    if (contIndexLoaded) {
+        contIndexCurrent(true);
+    }
+    contIndexMutex.unlock();
+    blobCacheInvalidate();
+
+    return e;
+}
+
 //------------------------------------------------------------------------------
 mcResult_t mcRegistryStoreAuthToken(void *so, uint32_t size)
 {
@@ -224,15 +581,10 @@ mcResult_t mcRegistryStoreAuthToken(void *so, uint32_t size)
     const string &authTokenFilePath = getAuthTokenFilePath();
     LOG_I("store AuthToken: %s", authTokenFilePath.c_str());
 
-    FILE *fs = fopen(authTokenFilePath.c_str(), "wb");
-    if (!fs) {
+    if (MC_DRV_OK != writeFileAtomic(authTokenFilePath, so, size)) {
         LOG_E("mcRegistry store So.Soc failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
         return MC_DRV_ERR_INVALID_DEVICE_FILE;
     }
-    fseek(fs, 0, SEEK_SET);
-    fwrite((char *)so, 1, size, fs);
-    fflush(fs);
-    fclose(fs);
 
     return MC_DRV_OK;
 }
@@ -290,15 +642,10 @@ mcResult_t mcRegistryStoreRoot(void *so, uint32_t size)
     const string &rootContFilePath = getRootContFilePath();
     LOG_I("store Root: %s", rootContFilePath.c_str());
 
-    FILE *fs = fopen(rootContFilePath.c_str(), "wb");
-    if (!fs) {
+    if (MC_DRV_OK != contIndexWrite(contKey(CONT_TYPE_ROOT, 0, NULL), rootContFilePath, so, size)) {
         LOG_E("mcRegistry store So.Root failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
         return MC_DRV_ERR_INVALID_DEVICE_FILE;
     }
-    fseek(fs, 0, SEEK_SET);
-    fwrite((char *)so, 1, size, fs);
-    fflush(fs);
-    fclose(fs);
 
     return MC_DRV_OK;
 }
@@ -307,25 +654,13 @@ mcResult_t mcRegistryStoreRoot(void *so, uint32_t size)
 //------------------------------------------------------------------------------
 mcResult_t mcRegistryReadRoot(void *so, uint32_t *size)
 {
-    const string &rootContFilePath = getRootContFilePath();
-    size_t readBytes;
-
     if (so == NULL) {
         LOG_E("mcRegistry read So.Root failed: %d", MC_DRV_ERR_INVALID_PARAMETER);
         return MC_DRV_ERR_INVALID_PARAMETER;
     }
-    LOG_I("read Root: %s", rootContFilePath.c_str());
+    LOG_I("read Root");
 
-    FILE *fs = fopen(rootContFilePath.c_str(), "rb");
-    if (!fs) {
-        LOG_E("mcRegistry read So.Root failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
-        return MC_DRV_ERR_INVALID_DEVICE_FILE;
-    }
-    readBytes = fread((char *)so, 1, *size, fs);
-    fclose(fs);
-
-    if (readBytes > 0) {
-        *size = readBytes;
+    if (contIndexRead(contKey(CONT_TYPE_ROOT, 0, NULL), so, size)) {
         return MC_DRV_OK;
     } else {
         LOG_E("mcRegistry read So.Root failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
@@ -345,15 +680,10 @@ mcResult_t mcRegistryStoreSp(mcSpid_t spid, void *so, uint32_t size)
     const string &spContFilePath = getSpContFilePath(spid);
     LOG_I("store SP: %s", spContFilePath.c_str());
 
-    FILE *fs = fopen(spContFilePath.c_str(), "wb");
-    if (!fs) {
+    if (MC_DRV_OK != contIndexWrite(contKey(CONT_TYPE_SP, spid, NULL), spContFilePath, so, size)) {
         LOG_E("mcRegistry store So.Sp(SpId) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
         return MC_DRV_ERR_INVALID_DEVICE_FILE;
     }
-    fseek(fs, 0, SEEK_SET);
-    fwrite((char *)so, 1, size, fs);
-    fflush(fs);
-    fclose(fs);
 
     return MC_DRV_OK;
 }
@@ -362,24 +692,13 @@ mcResult_t mcRegistryStoreSp(mcSpid_t spid, void *so, uint32_t size)
 //------------------------------------------------------------------------------
 mcResult_t mcRegistryReadSp(mcSpid_t spid, void *so, uint32_t *size)
 {
-    const string &spContFilePath = getSpContFilePath(spid);
-    size_t readBytes;
     if ((spid == 0) || (so == NULL)) {
         LOG_E("mcRegistry read So.Sp(SpId) failed: %d", MC_DRV_ERR_INVALID_PARAMETER);
         return MC_DRV_ERR_INVALID_PARAMETER;
     }
-    LOG_I("read SP: %s", spContFilePath.c_str());
+    LOG_I("read SP: %u", spid);
 
-    FILE *fs = fopen(spContFilePath.c_str(), "rb");
-    if (!fs) {
-        LOG_E("mcRegistry read So.Sp(SpId) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
-        return MC_DRV_ERR_INVALID_DEVICE_FILE;
-    }
-    readBytes = fread((char *)so, 1, *size, fs);
-    fclose(fs);
-
-    if (readBytes > 0) {
-        *size = readBytes;
+    if (contIndexRead(contKey(CONT_TYPE_SP, spid, NULL), so, size)) {
         return MC_DRV_OK;
     } else {
         LOG_E("mcRegistry read So.Sp(SpId) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
@@ -399,15 +718,10 @@ mcResult_t mcRegistryStoreTrustletCon(const mcUuid_t *uuid, const mcSpid_t spid,
     const string &tlContFilePath = getTlContFilePath(uuid, spid);
     LOG_I("store TLc: %s", tlContFilePath.c_str());
 
-    FILE *fs = fopen(tlContFilePath.c_str(), "wb");
-    if (!fs) {
+    if (MC_DRV_OK != contIndexWrite(contKey(CONT_TYPE_TLCON, spid, uuid), tlContFilePath, so, size)) {
         LOG_E("mcRegistry store So.TrustletCont(uuid) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
         return MC_DRV_ERR_INVALID_DEVICE_FILE;
     }
-    fseek(fs, 0, SEEK_SET);
-    fwrite((char *)so, 1, size, fs);
-    fflush(fs);
-    fclose(fs);
 
     return MC_DRV_OK;
 }
@@ -420,21 +734,9 @@ mcResult_t mcRegistryReadTrustletCon(const mcUuid_t *uuid, const mcSpid_t spid,
         LOG_E("mcRegistry read So.TrustletCont(uuid) failed: %d", MC_DRV_ERR_INVALID_PARAMETER);
         return MC_DRV_ERR_INVALID_PARAMETER;
     }
-    size_t readBytes;
-    const string &tlContFilePath = getTlContFilePath(uuid, spid);
-    LOG_I("read TLc: %s", tlContFilePath.c_str());
-
-    FILE *fs = fopen(tlContFilePath.c_str(), "rb");
-    if (!fs) {
-        LOG_E("mcRegistry read So.TrustletCont(uuid) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
-        return MC_DRV_ERR_INVALID_DEVICE_FILE;
-    }
-    fseek(fs, 0, SEEK_SET);
-    readBytes = fread((char *)so, 1, *size, fs);
-    fclose(fs);
+    LOG_I("read TLc: SP %u", spid);
 
-    if(readBytes > 0) {
-        *size = readBytes;
+    if (contIndexRead(contKey(CONT_TYPE_TLCON, spid, uuid), so, size)) {
         return MC_DRV_OK;
     } else {
         LOG_E("mcRegistry read So.TrustletCont(uuid) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
@@ -471,15 +773,11 @@ mcResult_t mcRegistryStoreData(void *so, uint32_t size)
 
     LOG_I("store DT: %s", filename.c_str());
 
-    FILE *fs = fopen(filename.c_str(), "wb");
-    if (!fs) {
+    if (MC_DRV_OK != writeFileAtomic(filename, dataCont,
+                                     MC_SO_SIZE(dataCont->soHeader.plainLen, dataCont->soHeader.encryptedLen))) {
         LOG_E("mcRegistry store So.Data(cid/pid) failed: %d", MC_DRV_ERR_INVALID_DEVICE_FILE);
         return MC_DRV_ERR_INVALID_DEVICE_FILE;
     }
-    fseek(fs, 0, SEEK_SET);
-    fwrite((char *)dataCont, 1, MC_SO_SIZE(dataCont->soHeader.plainLen, dataCont->soHeader.encryptedLen), fs);
-    fflush(fs);
-    fclose(fs);
 
     return MC_DRV_OK;
 }
@@ -568,7 +866,8 @@ mcResult_t mcRegistryCleanupTrustlet(const mcUuid_t *uuid, const mcSpid_t spid)
     }
     string tlContFilePath = getTlContFilePath(uuid, spid);
     LOG_I("delete Tlc: %s", tlContFilePath.c_str());
-    if (0 != (e = remove(tlContFilePath.c_str()))) {
+    e = contIndexRemove(contKey(CONT_TYPE_TLCON, spid, uuid), tlContFilePath);
+    if (0 != e) {
         LOG_E("remove Tlc failed! errno: %d", e);
         return MC_DRV_ERR_UNKNOWN;
     }
@@ -626,7 +925,8 @@ mcResult_t mcRegistryCleanupSp(mcSpid_t spid)
     }
     string spContFilePath = getSpContFilePath(spid);
     LOG_I("delete Sp: %s", spContFilePath.c_str());
-    if (0 != (e = remove(spContFilePath.c_str()))) {
+    e = contIndexRemove(contKey(CONT_TYPE_SP, spid, NULL), spContFilePath);
+    if (0 != e) {
         LOG_E("remove SP failed! error: %d", e);
         return MC_DRV_ERR_UNKNOWN;
     }
@@ -660,15 +960,310 @@ mcResult_t mcRegistryCleanupRoot(void)
 
     string rootContFilePath = getRootContFilePath();
     LOG_I("Delete root: %s", rootContFilePath.c_str());
-    if (0 != (e = remove(rootContFilePath.c_str()))) {
+    e = contIndexRemove(contKey(CONT_TYPE_ROOT, 0, NULL), rootContFilePath);
+    if (0 != e) {
         LOG_E("Delete root failed! error: %d", e);
         return MC_DRV_ERR_UNKNOWN;
     }
     return MC_DRV_OK;
 }
 
+//------------------------------------------------------------------------------
+// Service blob cache
+//
+// Assembling a service blob copies the trustlet and reads the root, SP and
+// trustlet containers. The blobs are kept and handed out shared, so opening
+// a session to the same service again costs a lookup only. A blob stays
+// allocated while it is handed out, even if the cache drops it meanwhile.
+//
+// Entries are dropped when the trustlet binary changes on disk (device,
+// inode, size or mtime) and on every container write of the registry.
+
+typedef struct {
+    regObject_t     *regobj;    /**< Blob handed out by the cache */
+    uint32_t        refs;       /**< Users of regobj */
+    bool            cached;     /**< Found by lookups, false once dropped */
+    bool            fromFile;   /**< Loaded from the registry by UUID, else from memory */
+    mcUuid_t        uuid;       /**< Trustlet UUID (fromFile) */
+    mcSpid_t        spid;       /**< SPID the containers were read for */
+    uint32_t        tlSize;     /**< Size of the trustlet binary */
+    struct stat     tlStat;     /**< Trustlet binary file (fromFile) */
+    uint32_t        lastUse;    /**< blobCacheClock at the last hit */
+} blobCacheEntry_t;
+
+typedef list<blobCacheEntry_t *> blobCacheList_t;
+
+static CMutex blobCacheMutex; /**< Guards all blobCache variables */
+static blobCacheList_t blobCache; /**< Cached entries and dropped ones still handed out */
+static uint32_t blobCacheSize; /**< Bytes of the cached entries */
+static uint32_t blobCacheClock; /**< Counts lookups, for LRU eviction */
+static uint32_t blobCacheGeneration; /**< Counts container writes */
+static regBlobCacheStats_t blobCacheStats;
+
+static regObject_t *loadServiceBlob(mcSpid_t spid, void *trustlet, uint32_t tlSize, int fd);
+static void freeServiceBlob(regObject_t *regobj);
+
+
+//------------------------------------------------------------------------------
+static uint32_t blobSize(regObject_t *regobj)
+{
+    return sizeof(regObject_t) + regobj->len;
+}
+
+
+//------------------------------------------------------------------------------
+// Caller holds blobCacheMutex.
+static void blobCacheDrop(blobCacheList_t::iterator it)
+{
+    blobCacheEntry_t *entry = *it;
+
+    if (entry->cached) {
+        entry->cached = false;
+        blobCacheSize -= blobSize(entry->regobj);
+    }
+    if (entry->refs == 0) {
+        blobCache.erase(it);
+        freeServiceBlob(entry->regobj);
+        delete entry;
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Caller holds blobCacheMutex.
+static regObject_t *blobCacheHit(blobCacheEntry_t *entry)
+{
+    entry->refs++;
+    entry->lastUse = ++blobCacheClock;
+    blobCacheStats.hits++;
+    return entry->regobj;
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ * Hand out a newly loaded blob and keep it if it fits. Blobs loaded while
+ * the registry was written are handed out but not kept, they may hold the
+ * old containers.
+ */
+static regObject_t *blobCacheAdd(regObject_t *regobj, blobCacheEntry_t *key, uint32_t generation)
+{
+    blobCacheEntry_t *entry = new blobCacheEntry_t(*key);
+    entry->regobj = regobj;
+    entry->refs = 1;
+    entry->cached = false;
+
+    blobCacheMutex.lock();
+    blobCacheStats.misses++;
+    entry->lastUse = ++blobCacheClock;
+    if (generation == blobCacheGeneration && blobSize(regobj) <= BLOB_CACHE_MAX_SIZE) {
+        // Evict the least recently used blobs until the new one fits
+        for (;;) {
+            uint32_t entries = 0;
+            blobCacheList_t::iterator lru = blobCache.end();
+            for (blobCacheList_t::iterator it = blobCache.begin(); it != blobCache.end(); ++it) {
+                if (!(*it)->cached) {
+                    continue;
+                }
+                entries++;
+                if (lru == blobCache.end() || (*it)->lastUse < (*lru)->lastUse) {
+                    lru = it;
+                }
+            }
+            if (entries < BLOB_CACHE_MAX_ENTRIES &&
+                    blobCacheSize + blobSize(regobj) <= BLOB_CACHE_MAX_SIZE) {
+                break;
+            }
+            blobCacheDrop(lru);
+            blobCacheStats.evictions++;
+        }
+        entry->cached = true;
+        blobCacheSize += blobSize(regobj);
+    }
+    blobCache.push_back(entry);
+    blobCacheMutex.unlock();
+
+    return regobj;
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ * Drop all cached blobs. Called after the containers were written, so
+ * blobs assembled before are not found any more.
+ */
+static void blobCacheInvalidate(void)
+{
+    blobCacheMutex.lock();
+    blobCacheGeneration++;
+    blobCacheList_t::iterator it = blobCache.begin();
+    while (it != blobCache.end()) {
+        blobCacheList_t::iterator next = it;
+        ++next;
+        if ((*it)->cached) {
+            blobCacheStats.invalidations++;
+        }
+        blobCacheDrop(it);
+        it = next;
+    }
+    blobCacheMutex.unlock();
+}
+
+
+//------------------------------------------------------------------------------
+void mcRegistryPutServiceBlob(regObject_t *regobj)
+{
+    if (regobj == NULL) {
+        return;
+    }
+
+    blobCacheMutex.lock();
+    for (blobCacheList_t::iterator it = blobCache.begin(); it != blobCache.end(); ++it) {
+        if ((*it)->regobj == regobj) {
+            (*it)->refs--;
+            if (!(*it)->cached) {
+                blobCacheDrop(it);
+            }
+            blobCacheMutex.unlock();
+            return;
+        }
+    }
+    blobCacheMutex.unlock();
+
+    // Not from the cache
+    freeServiceBlob(regobj);
+}
+
+
+//------------------------------------------------------------------------------
+void mcRegistryGetBlobCacheStats(regBlobCacheStats_t *stats)
+{
+    blobCacheMutex.lock();
+    *stats = blobCacheStats;
+    stats->entries = 0;
+    for (blobCacheList_t::iterator it = blobCache.begin(); it != blobCache.end(); ++it) {
+        if ((*it)->cached) {
+            stats->entries++;
+        }
+    }
+    stats->size = blobCacheSize;
+    blobCacheMutex.unlock();
+}
+
+
 //------------------------------------------------------------------------------
 regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t tlSize)
+{
+    // Ensure that a UUID is provided.
+    if (NULL == trustlet) {
+        LOG_E("No trustlet buffer given");
+        return NULL;
+    }
+
+    // The trustlet comes from the client, compare it as a whole
+    blobCacheMutex.lock();
+    uint32_t generation = blobCacheGeneration;
+    for (blobCacheList_t::iterator it = blobCache.begin(); it != blobCache.end(); ++it) {
+        blobCacheEntry_t *entry = *it;
+        if (entry->cached && !entry->fromFile && entry->spid == spid && entry->tlSize == tlSize &&
+                memcmp(entry->regobj->value + entry->regobj->tlStartOffset, trustlet, tlSize) == 0) {
+            regObject_t *regobj = blobCacheHit(entry);
+            blobCacheMutex.unlock();
+            LOG_I(" Service blob of %u bytes found in cache", tlSize);
+            return regobj;
+        }
+    }
+    blobCacheMutex.unlock();
+
+    regObject_t *regobj = loadServiceBlob(spid, trustlet, tlSize, -1);
+    if (regobj == NULL) {
+        return NULL;
+    }
+
+    blobCacheEntry_t key;
+    memset(&key, 0, sizeof(key));
+    key.fromFile = false;
+    key.spid = spid;
+    key.tlSize = tlSize;
+    return blobCacheAdd(regobj, &key, generation);
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ * Allocate a registry object holding the trustlet at tlStartOffset.
+ *
+ * Without a file the trustlet is copied to the heap. With a file its pages
+ * are mapped private in place, page aligned, behind a page holding the
+ * object header: nothing is copied until the pages are written or pinned
+ * for the Secure World, and unused pages stay shared with the page cache.
+ *
+ * @param valueSize Size of the object value, at least tlStartOffset + tlSize.
+ * @param fd Descriptor of the trustlet file, -1 to copy trustlet.
+ */
+static regObject_t *newServiceBlob(uint32_t tlStartOffset, uint32_t valueSize,
+                                   void *trustlet, uint32_t tlSize, int fd)
+{
+    regObject_t *regobj;
+
+    if (fd == -1) {
+        if (NULL == (regobj = (regObject_t *) malloc(sizeof(regObject_t) + valueSize))) {
+            return NULL;
+        }
+        regobj->mapping = NULL;
+        regobj->mappingLen = 0;
+        memcpy(regobj->value + tlStartOffset, trustlet, tlSize);
+    } else {
+        size_t pageSize = sysconf(_SC_PAGESIZE);
+        size_t headLen = sizeof(regObject_t) + tlStartOffset;
+        size_t headPages = (headLen + pageSize - 1) & ~(pageSize - 1);
+        size_t tailLen = valueSize - tlStartOffset;
+        size_t mappingLen = headPages + ((tailLen + pageSize - 1) & ~(pageSize - 1));
+
+        // Anonymous pages for the header and the containers after the file
+        uint8_t *mapping = (uint8_t *) mmap(NULL, mappingLen, PROT_READ | PROT_WRITE,
+                                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            return NULL;
+        }
+        if (mmap(mapping + headPages, tlSize, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(mapping, mappingLen);
+            return NULL;
+        }
+        regobj = (regObject_t *)(mapping + headPages - headLen);
+        regobj->mapping = mapping;
+        regobj->mappingLen = mappingLen;
+    }
+    regobj->len = valueSize;
+    regobj->tlStartOffset = tlStartOffset;
+
+    return regobj;
+}
+
+
+//------------------------------------------------------------------------------
+static void freeServiceBlob(regObject_t *regobj)
+{
+    if (regobj == NULL) {
+        return;
+    }
+    if (regobj->mapping == NULL) {
+        free(regobj);
+    } else if (munmap(regobj->mapping, regobj->mappingLen)) {
+        LOG_ERRNO("munmap");
+    }
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ * Assemble a service blob.
+ * @param trustlet Trustlet binary, its header is checked.
+ * @param fd Descriptor of the file holding trustlet, to map it instead of
+ *           copying it, or -1.
+ */
+static regObject_t *loadServiceBlob(mcSpid_t spid, void *trustlet, uint32_t tlSize, int fd)
 {
     regObject_t *regobj = NULL;
 
@@ -708,34 +1303,28 @@ regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t
     // If loadable driver or system trustlet.
     if (pHeader->serviceType == SERVICE_TYPE_DRIVER  || pHeader->serviceType == SERVICE_TYPE_SYSTEM_TRUSTLET) {
         // Take trustlet blob 'as is'.
-        if (NULL == (regobj = (regObject_t *) (malloc(sizeof(regObject_t) + tlSize)))) {
+        if (NULL == (regobj = newServiceBlob(0, tlSize, trustlet, tlSize, fd))) {
             LOG_E("mcRegistryGetServiceBlob() failed: Out of memory");
             return NULL;
         }
-        regobj->len = tlSize;
-        regobj->tlStartOffset = 0;
-        memcpy((char *)regobj->value, trustlet, tlSize);
         // If user trustlet.
     }
     else if (pHeader->serviceType == SERVICE_TYPE_SP_TRUSTLET) {
         // Take trustlet blob and append root, sp, and tl container.
         size_t regObjValueSize = tlSize + sizeof(mcBlobLenInfo_t) + 3 * MAX_SO_CONT_SIZE;
 
-        // Prepare registry object.
-        if (NULL == (regobj = (regObject_t *) malloc(sizeof(regObject_t) + regObjValueSize))) {
+        // Prepare registry object, the trustlet blob follows the len info.
+        if (NULL == (regobj = newServiceBlob(sizeof(mcBlobLenInfo_t), regObjValueSize,
+                                             trustlet, tlSize, fd))) {
             LOG_E("mcRegistryGetServiceBlob() failed: Out of memory");
             return NULL;
         }
-        regobj->len = regObjValueSize;
-        regobj->tlStartOffset = sizeof(mcBlobLenInfo_t);
         uint8_t *p = regobj->value;
 
         // Reserve space for the blob length structure
         mcBlobLenInfo_ptr lenInfo = (mcBlobLenInfo_ptr)p;
         lenInfo->magic = MC_TLBLOBLEN_MAGIC;
         p += sizeof(mcBlobLenInfo_t);
-        // Fill in trustlet blob after the len info
-        memcpy(p, trustlet, tlSize);
         p += tlSize;
 
         // Final registry object value looks like this:
@@ -794,7 +1383,7 @@ regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t
 
         if (MC_DRV_OK != ret) {
             LOG_E("mcRegistryGetServiceBlob() failed: Error code: %d", ret);
-            free(regobj);
+            freeServiceBlob(regobj);
             return NULL;
         }
         // Now we know the sizes for all containers so set the correct size
@@ -811,9 +1400,12 @@ regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t
 
 
 //------------------------------------------------------------------------------
-regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet)
+/**
+ * Load a service blob from a file, bypassing the cache.
+ * @param sb Set to the status of the file read.
+ */
+static regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet, struct stat *sb)
 {
-    struct stat sb;
     regObject_t *regobj = NULL;
     void *buffer;
 
@@ -829,21 +1421,22 @@ regObject_t *mcRegistryFileGetServiceBlob(const char* trustlet)
         return NULL;
     }
 
-    if (fstat(fd, &sb) == -1){
+    if (fstat(fd, sb) == -1){
         LOG_E("mcRegistryGetServiceBlob() failed: Cound't get file size");
         goto error;
     }
 
-    buffer = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    buffer = mmap(NULL, sb->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (buffer == MAP_FAILED) {
         LOG_E("mcRegistryGetServiceBlob(): Failed to map file to memory");
         goto error;
     }
 
-    regobj = mcRegistryMemGetServiceBlob(0, buffer, sb.st_size);
+    // The header is checked in the read only mapping, the blob maps the file again
+    regobj = loadServiceBlob(0, buffer, sb->st_size, fd);
 
     // We don't actually care if either of them fails but should still print warnings
-    if (munmap(buffer, sb.st_size)) {
+    if (munmap(buffer, sb->st_size)) {
         LOG_E("mcRegistryGetServiceBlob(): Failed to unmap memory");
     }
 
@@ -867,15 +1460,59 @@ regObject_t *mcRegistryGetServiceBlob(const mcUuid_t *uuid)
 
     // Open service blob file.
     string tlBinFilePath = getTlBinFilePath(uuid);
+
+    // A cached blob is valid while the file is unchanged
+    struct stat sb;
+    bool found = (stat(tlBinFilePath.c_str(), &sb) == 0);
+    blobCacheMutex.lock();
+    uint32_t generation = blobCacheGeneration;
+    if (found) {
+        blobCacheList_t::iterator it = blobCache.begin();
+        while (it != blobCache.end()) {
+            blobCacheList_t::iterator next = it;
+            ++next;
+            blobCacheEntry_t *entry = *it;
+            if (!entry->cached || !entry->fromFile ||
+                    memcmp(&entry->uuid, uuid, sizeof(mcUuid_t)) != 0) {
+                it = next;
+                continue;
+            }
+            if (entry->tlStat.st_dev == sb.st_dev &&
+                    entry->tlStat.st_ino == sb.st_ino &&
+                    entry->tlStat.st_size == sb.st_size &&
+                    entry->tlStat.st_mtime == sb.st_mtime) {
+                regObject_t *regobj = blobCacheHit(entry);
+                blobCacheMutex.unlock();
+                LOG_I(" Using cached %s", tlBinFilePath.c_str());
+                return regobj;
+            }
+            // The file was replaced, the entry is stale
+            blobCacheDrop(it);
+            it = next;
+        }
+    }
+    blobCacheMutex.unlock();
+
     LOG_I(" Loading %s", tlBinFilePath.c_str());
+    regObject_t *regobj = mcRegistryFileGetServiceBlob(tlBinFilePath.c_str(), &sb);
+    if (regobj == NULL) {
+        return NULL;
+    }
 
-    return mcRegistryFileGetServiceBlob(tlBinFilePath.c_str());
+    blobCacheEntry_t key;
+    memset(&key, 0, sizeof(key));
+    key.fromFile = true;
+    key.uuid = *uuid;
+    key.tlSize = sb.st_size;
+    key.tlStat = sb;
+    return blobCacheAdd(regobj, &key, generation);
 }
 
 //------------------------------------------------------------------------------
 regObject_t *mcRegistryGetDriverBlob(const char *filename)
 {
-    regObject_t *regobj = mcRegistryFileGetServiceBlob(filename);
+    struct stat sb;
+    regObject_t *regobj = mcRegistryFileGetServiceBlob(filename, &sb);
 
     if (regobj == NULL) {
         LOG_E("mcRegistryGetDriverBlob() failed");
@@ -889,7 +1526,7 @@ regObject_t *mcRegistryGetDriverBlob(const char *filename)
     if (pHeader->serviceType != SERVICE_TYPE_DRIVER) {
         LOG_E("mcRegistryGetServiceBlob() failed: Unsupported service type %u", pHeader->serviceType);
         pHeader = NULL;
-        free(regobj);
+        freeServiceBlob(regobj);
         regobj = NULL;
     }
 
@@ -49,9 +49,23 @@ extern "C" {
     typedef struct {
         uint32_t len;
         uint32_t tlStartOffset;
+        void *mapping;          /**< Mapping holding the object, NULL if allocated on the heap */
+        size_t mappingLen;      /**< Length of mapping */
         uint8_t value[];
     } regObject_t;
 
+    /**
+     * Statistics of the service blob cache.
+     */
+    typedef struct {
+        uint32_t hits;          /**< Lookups served from the cache */
+        uint32_t misses;        /**< Lookups which assembled the blob */
+        uint32_t evictions;     /**< Blobs dropped to make room */
+        uint32_t invalidations; /**< Blobs dropped by registry writes */
+        uint32_t entries;       /**< Blobs cached now */
+        uint32_t size;          /**< Bytes cached now */
+    } regBlobCacheStats_t;
+
 //-----------------------------------------------------------------
 
     /** Stores an authentication token in registry.
@@ -166,27 +180,37 @@ extern "C" {
      * @param trustlet buffer with trustlet binary
      * @param tlSize buffer size
      * @return Registry object.
-     * @note It is the responsibility of the caller to free the registry object
-     * allocated by this function.
+     * @note The registry object is shared, it has to be released with
+     * mcRegistryPutServiceBlob() and must not be modified.
      */
     regObject_t *mcRegistryMemGetServiceBlob(mcSpid_t spid, void *trustlet, uint32_t tlSize);
 
     /** Returns a registry object for a given service.
      * @param uuid service UUID
      * @return Registry object.
-     * @note It is the responsibility of the caller to free the registry object
-     * allocated by this function.
+     * @note The registry object is shared, it has to be released with
+     * mcRegistryPutServiceBlob() and must not be modified.
      */
     regObject_t *mcRegistryGetServiceBlob(const mcUuid_t  *uuid);
 
     /** Returns a registry object for a given service.
      * @param driverFilename driver filename
      * @return Registry object.
-     * @note It is the responsibility of the caller to free the registry object
-     * allocated by this function.
+     * @note The registry object has to be released with
+     * mcRegistryPutServiceBlob().
      */
     regObject_t *mcRegistryGetDriverBlob(const char *filename);
 
+    /** Releases a registry object returned by one of the functions above.
+     * @param regobj Registry object, may be NULL.
+     */
+    void mcRegistryPutServiceBlob(regObject_t *regobj);
+
+    /** Returns the statistics of the service blob cache.
+     * @param[out] stats Statistics.
+     */
+    void mcRegistryGetBlobCacheStats(regBlobCacheStats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
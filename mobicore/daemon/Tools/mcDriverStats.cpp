@@ -0,0 +1,184 @@
+/** @addtogroup MCD_MCDIMPL_DAEMON
+ * @{
+ * @file
+ *
+ * Dump the performance counters of the MobiCore driver daemon.
+ *
+ * <!-- Copyright Giesecke & Devrient GmbH 2009 - 2012 -->
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "MobiCoreDriverApi.h"
+
+/** Names of the daemon commands, by command ID. */
+static const char *commandNames[MC_STATS_NUM_COMMANDS] = {
+    "PING", "GET_INFO", "OPEN_DEVICE", "CLOSE_DEVICE", "NQ_CONNECT",
+    "OPEN_SESSION", "CLOSE_SESSION", "NOTIFY", "MAP_BULK_BUF",
+    "UNMAP_BULK_BUF", "GET_VERSION", "GET_MOBICORE_VERSION",
+    "OPEN_TRUSTLET", "OPEN_SESSION_EX", "GET_STATS", "MAP_CACHE"
+};
+
+//------------------------------------------------------------------------------
+/**
+ * Upper bound of the latency below which a share of all latencies lies,
+ * from the histogram.
+ */
+static uint32_t percentileUs(
+    const mcLatencyStats_t *stats,
+    uint32_t percent
+)
+{
+    uint64_t rank = ((uint64_t)stats->count * percent + 99) / 100;
+    uint64_t counted = 0;
+
+    for (uint32_t i = 0; i < MC_STATS_NUM_BUCKETS - 1; i++) {
+        counted += stats->buckets[i];
+        if (counted >= rank) {
+            uint32_t bound = 2u << i;
+            return (bound < stats->maxUs) ? bound : stats->maxUs;
+        }
+    }
+    return stats->maxUs;
+}
+
+//------------------------------------------------------------------------------
+static void printLatency(
+    const char *name,
+    const mcLatencyStats_t *stats,
+    bool histogram
+)
+{
+    if (stats->count == 0) {
+        return;
+    }
+    printf("%-22s %8u %10llu %8u %8u %8u\n", name, stats->count,
+           (unsigned long long)(stats->totalUs / stats->count),
+           percentileUs(stats, 50), percentileUs(stats, 99), stats->maxUs);
+
+    if (histogram) {
+        for (uint32_t i = 0; i < MC_STATS_NUM_BUCKETS; i++) {
+            if (stats->buckets[i] == 0) {
+                continue;
+            }
+            if (i == MC_STATS_NUM_BUCKETS - 1) {
+                printf("%24s>= %6uus %8u\n", "", 1u << i, stats->buckets[i]);
+            } else {
+                printf("%24s<  %6uus %8u\n", "", 2u << i, stats->buckets[i]);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+static void printStats(
+    const mcDaemonStats_t *stats,
+    bool histogram
+)
+{
+    printf("%-22s %8s %10s %8s %8s %8s\n", "latency [us]", "count", "avg", "p50<=", "p99<=", "max");
+    for (uint32_t i = 0; i < MC_STATS_NUM_COMMANDS; i++) {
+        printLatency(commandNames[i], &stats->command[i], histogram);
+    }
+    printLatency("REGISTRY", &stats->registry, histogram);
+    printLatency("MCP round trip", &stats->mcpRoundTrip, histogram);
+
+    printf("\nS-SIQs                 %u\n", stats->ssiqCount);
+    printf("notifications in       %u\n", stats->notificationsIn);
+    printf("notifications out      %u\n", stats->notificationsOut);
+    printf("NQ overflows           %u\n", stats->nqOverflows);
+    printf("sessions               %u\n", stats->sessions);
+    printf("queued notifications   %u (max %u per session, %u unknown session)\n",
+           stats->queuedNotifications, stats->maxQueuedNotifications,
+           stats->unknownNotifications);
+    printf("blob cache             %u hits, %u misses, %u evictions, %u invalidations\n",
+           stats->blobCacheHits, stats->blobCacheMisses,
+           stats->blobCacheEvictions, stats->blobCacheInvalidations);
+    printf("                       %u entries, %u bytes\n",
+           stats->blobCacheEntries, stats->blobCacheSize);
+}
+
+//------------------------------------------------------------------------------
+static void printUsage(
+    char *args[]
+)
+{
+    fprintf(stderr, "usage: %s [-bh] [-i SECONDS]\n", args[0]);
+    fprintf(stderr, "Dump the performance counters of the MobiCore Daemon\n\n");
+    fprintf(stderr, "-h\t\tshow this help\n");
+    fprintf(stderr, "-b\t\tshow the latency histograms\n");
+    fprintf(stderr, "-i SECONDS\tdump again every SECONDS\n");
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char *args[])
+{
+    bool histogram = false;
+    int interval = 0;
+    int c;
+
+    while ((c = getopt(argc, args, "bhi:")) != -1) {
+        switch (c) {
+        case 'b':
+            histogram = true;
+            break;
+        case 'i':
+            interval = atoi(optarg);
+            break;
+        default:
+            printUsage(args);
+            return 2;
+        }
+    }
+
+    mcResult_t mcRet = mcOpenDevice(MC_DEVICE_ID_DEFAULT);
+    if (mcRet != MC_DRV_OK) {
+        fprintf(stderr, "mcOpenDevice failed: 0x%x\n", mcRet);
+        return 1;
+    }
+
+    for (;;) {
+        mcDaemonStats_t stats;
+        mcRet = mcGetDaemonStats(MC_DEVICE_ID_DEFAULT, &stats);
+        if (mcRet != MC_DRV_OK) {
+            fprintf(stderr, "mcGetDaemonStats failed: 0x%x\n", mcRet);
+            break;
+        }
+        printStats(&stats, histogram);
+        if (interval <= 0) {
+            break;
+        }
+        sleep(interval);
+        printf("\n");
+    }
+
+    mcCloseDevice(MC_DEVICE_ID_DEFAULT);
+    return (mcRet == MC_DRV_OK) ? 0 : 1;
+}
+
+/** @} */